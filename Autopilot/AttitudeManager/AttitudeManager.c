@@ -8,6 +8,7 @@
 //Include Header Files
 #include "AttitudeManager.h"
 #include "VN100.h"
+#include "VN100Async.h"
 #include "InputCapture.h"
 #include "OutputCompare.h"
 #include "PWM.h"
@@ -16,14 +17,22 @@
 #include "main.h"
 #include "../Common/Interfaces/SPI.h"
 #include "Network/Datalink.h"
+#include "Network/CompactTelemetry.h"
 #include "ProgramStatus.h"
 #include "Drivers/Radio.h"
+#if USE_RADIO == RADIO_XBEE
+#include "Drivers/RadioXbee.h"
+#elif USE_RADIO == RADIO_3DR
+#include "Drivers/RadioMavlink.h"
+#endif
 #include "Peripherals/UHF.h"
 #include "../Common/Interfaces/InterchipDMA.h"
 #include "../Common/Clock/Timer.h"
 #include "../Common/Utilities/LED.h"
 #include "../Common/Utilities/Logger.h"
+#include "../Common/Utilities/ByteRing.h"
 #include "StatusManager.h"
+#include "LatencyTrace.h"
 #include <string.h>
 
 extern int input_RC_Flap; // Flaps need to finish being refactored.
@@ -92,6 +101,9 @@ float imu_RollAngle = 0;
 float imu_PitchAngle = 0;
 float imu_YawAngle = 0;
 
+//Time (us) from the last IMU sample being taken to it being used by the control loop
+static uint16_t imu_sample_age = 0;
+
 //RC Input Signals (Input Capture Values)
 int input_RC_Throttle = MIN_PWM;
 int input_RC_RollRate = 0;
@@ -123,6 +135,8 @@ int lastCommandCounter = 0;
 
 static uint16_t pm_interchip_error_count = 0;
 static uint16_t gps_communication_error_count = 0;
+static uint16_t gps_setpoint_latency = 0;
+static InterchipLinkStats pm_link_stats;
 static bool show_gains = false;
 static bool show_scaled_pwm = true;
 
@@ -130,6 +144,7 @@ void attitudeInit() {
     setProgramStatus(INITIALIZATION);
     //Initialize Timer
     initTimer4();
+    initTimer3(CONTROL_LOOP_PERIOD_US);
     
     initLED(1);
     
@@ -169,8 +184,18 @@ void attitudeInit() {
     else{
         setSensorStatus(VECTORNAV, SENSOR_CONNECTED & FALSE);
     }
+    //All further reads in the control loop are non-blocking
+    VN100_initAsync();
+#if VN100_STREAMING
+    VN100_startStreaming();
+#endif
     
     orientationInit();
+#if DEBUG
+    benchmarkPID();
+    benchmarkPWM();
+    benchmarkBRing();
+#endif
     initDatalink();
     setSensorStatus(XBEE, SENSOR_INITIALIZED & TRUE);
     initialization();
@@ -191,6 +216,14 @@ char checkDMA(){
         airspeed = interchip_receive_buffer.pm_data.airspeed;
         pmOrbitGain = interchip_receive_buffer.pm_data.pmOrbitGain;
         pmPathGain = interchip_receive_buffer.pm_data.pmPathGain;
+        gps_setpoint_latency = interchip_receive_buffer.pm_data.gps_setpoint_latency;
+        pm_link_stats = interchip_receive_buffer.pm_data.link_stats;
+
+        //the path manager sends as soon as the heading setpoint changes, even
+        //without new GPS data, so pick it up before the redundancy check below
+        if (gps_PositionFix){
+            input_AP_Heading = interchip_receive_buffer.pm_data.sp_Heading;
+        }
         
          //Check if this data is new and requires action or if it is old and redundant
         if (gps_Altitude == interchip_receive_buffer.pm_data.altitude 
@@ -208,10 +241,6 @@ char checkDMA(){
         gps_Altitude = interchip_receive_buffer.pm_data.altitude;
         pm_interchip_error_count = interchip_receive_buffer.pm_data.interchip_error_count;
         gps_communication_error_count = interchip_receive_buffer.pm_data.gps_communication_error_count;
-
-        if (gps_PositionFix){
-            input_AP_Heading = interchip_receive_buffer.pm_data.sp_Heading;
-        }
         return TRUE;
 }
 
@@ -312,6 +341,10 @@ void setHeadingSetpoint(int setpoint){
 
 void inputCapture(){
     int* channelIn;
+    //The RC inputs only change when a new frame comes in from the receiver
+    if (!checkNewPWMInputs(getTime(), NULL)){
+        return;
+    }
     channelIn = getPWMArray(getTime());
 
     inputMixing(channelIn, &input_RC_RollRate, &input_RC_PitchRate, &input_RC_Throttle, &input_RC_YawRate);
@@ -422,21 +455,42 @@ int getHeadingInput(char source){
         return 0;
 }
 
+void startIMUCommunication(){
+#if !VN100_STREAMING
+    //Attitude and rates come from the same register, so only one SPI turnaround is needed
+    VN100_startSample();
+#endif
+}
+
 void imuCommunication(){
     /*****************************************************************************
      *****************************************************************************
                                 IMU COMMUNICATION
      *****************************************************************************
      *****************************************************************************/
-    float imuData[3];
+    VN100_Sample sample;
+
+#if VN100_STREAMING
+    if (!VN100_getLatestSample(&sample)){
+        return; //no new sample since the last step, keep the last values
+    }
+#else
+    if (!VN100_waitSample(&sample)){
+        return; //keep the last values
+    }
+#endif
 
-    VN100_SPI_GetYPR(0, &imu_YawAngle, &imu_PitchAngle, &imu_RollAngle);
-    VN100_SPI_GetRates(0, imuData);
+    uint32_t age = getTimeUs() - sample.time;
+    imu_sample_age = age > UINT16_MAX ? UINT16_MAX : age;
+
+    imu_YawAngle = sample.yaw;
+    imu_PitchAngle = sample.pitch;
+    imu_RollAngle = sample.roll;
 
     //Outputs in order: Roll,Pitch,Yaw
-    imu_RollRate = rad2deg(imuData[IMU_ROLL_RATE]);
-    imu_PitchRate = rad2deg(imuData[IMU_PITCH_RATE]);
-    imu_YawRate = rad2deg(imuData[IMU_YAW_RATE]);
+    imu_RollRate = rad2deg(sample.rates[IMU_ROLL_RATE]);
+    imu_PitchRate = rad2deg(sample.rates[IMU_PITCH_RATE]);
+    imu_YawRate = rad2deg(sample.rates[IMU_YAW_RATE]);
 }
 
 // Type is both bit shift value and index of bit mask array
@@ -462,11 +516,49 @@ static void setGains(ControlChannel channel, float* gains){
     setGain(channel, KD, gains[2]);    
 }
 
-void readDatalink(void){
-    struct DatalinkCommand* cmd = popDatalinkCommand();
+/**
+ * @param cmd Uplink command ID
+ * @return Whether the command is forwarded to the path manager, through the interchip send buffer
+ */
+static bool isPathManagerCommand(uint8_t cmd){
+    switch (cmd) {
+        case SET_PATH_GAIN:
+        case SET_ORBIT_GAIN:
+        case CALIBRATE_ALTIMETER:
+        case CLEAR_WAYPOINTS:
+        case REMOVE_WAYPOINT:
+        case SET_TARGET_WAYPOINT:
+        case RETURN_HOME:
+        case CANCEL_RETURN_HOME:
+        case CALIBRATE_AIRSPEED:
+        case FOLLOW_PATH:
+        case EXIT_HOLD_ORBIT:
+        case NEW_WAYPOINT:
+        case INSERT_WAYPOINT:
+        case UPDATE_WAYPOINT:
+        case SET_RETURN_HOME_COORDINATES:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool readDatalink(uint32_t budget_us){
+    uint32_t start = getTimeUs();
+    struct DatalinkCommand* cmd;
+    bool applied = false;
 
     //TODO: Add rudimentary input validation
-    if ( cmd ) {
+    //apply all the queued commands, unless that takes longer than the budget
+    while ((uint32_t)getTimeUs() - start < budget_us && (cmd = peekDatalinkCommand()) != NULL) {
+        //the path manager only reads one interchip frame per transfer, so sending another
+        //command before it has clocked out the last one would overwrite it. The rest of
+        //the queue waits for the next call, so that commands are still applied in order
+        if (isPathManagerCommand(cmd->cmd) && !isInterchipSendReady()){
+            break;
+        }
+        popDatalinkCommand();
+        applied = true;
         resetHeartbeatTimer();
         
         if (lastCommandSentCode[lastCommandCounter]/100 == cmd->cmd){
@@ -487,13 +579,13 @@ void readDatalink(void){
                 show_gains = true;
                 break;
             case SET_PATH_GAIN:
-                interchip_send_buffer.am_data.pathGain = CMD_TO_FLOAT(cmd->data);
-                interchip_send_buffer.am_data.command = PM_SET_PATH_GAIN;
+                INTERCHIP_SEND(am_data.pathGain, CMD_TO_FLOAT(cmd->data));
+                INTERCHIP_SEND(am_data.command, PM_SET_PATH_GAIN);
                 sendInterchipData();
                 break;
             case SET_ORBIT_GAIN:
-                interchip_send_buffer.am_data.orbitGain = CMD_TO_FLOAT(cmd->data);
-                interchip_send_buffer.am_data.command = PM_SET_ORBIT_GAIN;
+                INTERCHIP_SEND(am_data.orbitGain, CMD_TO_FLOAT(cmd->data));
+                INTERCHIP_SEND(am_data.command, PM_SET_ORBIT_GAIN);
                 sendInterchipData();
                 break;
             case SET_PITCH_RATE:
@@ -546,38 +638,38 @@ void readDatalink(void){
                 roll_turn_mix = CMD_TO_FLOAT(cmd->data);
                 break;
             case CALIBRATE_ALTIMETER:
-                interchip_send_buffer.am_data.calibrationHeight = CMD_TO_FLOAT(cmd->data);
-                interchip_send_buffer.am_data.command = PM_CALIBRATE_ALTIMETER;
+                INTERCHIP_SEND(am_data.calibrationHeight, CMD_TO_FLOAT(cmd->data));
+                INTERCHIP_SEND(am_data.command, PM_CALIBRATE_ALTIMETER);
                 sendInterchipData();
                 break;
             case CLEAR_WAYPOINTS:
-                interchip_send_buffer.am_data.waypoint.id = *cmd->data; //Dummy Data
-                interchip_send_buffer.am_data.command = PM_CLEAR_WAYPOINTS;
+                INTERCHIP_SEND(am_data.waypoint.id, *cmd->data); //Dummy Data
+                INTERCHIP_SEND(am_data.command, PM_CLEAR_WAYPOINTS);
                 sendInterchipData();
                 break;
             case REMOVE_WAYPOINT:
-                interchip_send_buffer.am_data.waypoint.id = *cmd->data;
-                interchip_send_buffer.am_data.command = PM_REMOVE_WAYPOINT;
+                INTERCHIP_SEND(am_data.waypoint.id, *cmd->data);
+                INTERCHIP_SEND(am_data.command, PM_REMOVE_WAYPOINT);
                 sendInterchipData();
                 break;
             case SET_TARGET_WAYPOINT:
-                interchip_send_buffer.am_data.waypoint.id = *cmd->data;
-                interchip_send_buffer.am_data.command = PM_SET_TARGET_WAYPOINT;
+                INTERCHIP_SEND(am_data.waypoint.id, *cmd->data);
+                INTERCHIP_SEND(am_data.command, PM_SET_TARGET_WAYPOINT);
                 sendInterchipData();
                 break;
             case RETURN_HOME:
-                interchip_send_buffer.am_data.command = PM_RETURN_HOME;
+                INTERCHIP_SEND(am_data.command, PM_RETURN_HOME);
                 sendInterchipData();
                 break;
             case CANCEL_RETURN_HOME:
-                interchip_send_buffer.am_data.command = PM_CANCEL_RETURN_HOME;
+                INTERCHIP_SEND(am_data.command, PM_CANCEL_RETURN_HOME);
                 sendInterchipData();
                 break;
             case SEND_HEARTBEAT:
                 queueRadioStatusPacket();
                 break;
             case CALIBRATE_AIRSPEED:
-                interchip_send_buffer.am_data.command = PM_CALIBRATE_AIRSPEED;
+                INTERCHIP_SEND(am_data.command, PM_CALIBRATE_AIRSPEED);
                 sendInterchipData();
                 break;
             case SET_ADVERSE_YAW_MIX:
@@ -610,12 +702,12 @@ void readDatalink(void){
                     dearmVehicle();
                 break;
             case FOLLOW_PATH:
-                interchip_send_buffer.am_data.command = PM_FOLLOW_PATH;
-                interchip_send_buffer.am_data.followPath = *cmd->data;
+                INTERCHIP_SEND(am_data.command, PM_FOLLOW_PATH);
+                INTERCHIP_SEND(am_data.followPath, *cmd->data);
                 sendInterchipData();
                 break;
             case EXIT_HOLD_ORBIT:
-                interchip_send_buffer.am_data.command = PM_EXIT_HOLD_ORBIT;
+                INTERCHIP_SEND(am_data.command, PM_EXIT_HOLD_ORBIT);
                 sendInterchipData();
                 break;
             case SHOW_SCALED_PWM:
@@ -623,24 +715,25 @@ void readDatalink(void){
                 break;
             case REMOVE_LIMITS:
                 limitSetpoint = *(bool*)cmd->data;
+                break;
             case NEW_WAYPOINT:
-                interchip_send_buffer.am_data.waypoint = CMD_TO_TYPE(cmd->data, WaypointWrapper);
-                interchip_send_buffer.am_data.command = PM_NEW_WAYPOINT;
+                INTERCHIP_SEND(am_data.waypoint, CMD_TO_TYPE(cmd->data, WaypointWrapper));
+                INTERCHIP_SEND(am_data.command, PM_NEW_WAYPOINT);
                 sendInterchipData();
                 break;
             case INSERT_WAYPOINT:
-                interchip_send_buffer.am_data.waypoint = CMD_TO_TYPE(cmd->data, WaypointWrapper);
-                interchip_send_buffer.am_data.command = PM_INSERT_WAYPOINT;
+                INTERCHIP_SEND(am_data.waypoint, CMD_TO_TYPE(cmd->data, WaypointWrapper));
+                INTERCHIP_SEND(am_data.command, PM_INSERT_WAYPOINT);
                 sendInterchipData();
                 break;
             case UPDATE_WAYPOINT:
-                interchip_send_buffer.am_data.waypoint = CMD_TO_TYPE(cmd->data, WaypointWrapper);
-                interchip_send_buffer.am_data.command = PM_UPDATE_WAYPOINT;
+                INTERCHIP_SEND(am_data.waypoint, CMD_TO_TYPE(cmd->data, WaypointWrapper));
+                INTERCHIP_SEND(am_data.command, PM_UPDATE_WAYPOINT);
                 sendInterchipData();
                 break;
             case SET_RETURN_HOME_COORDINATES:
-                interchip_send_buffer.am_data.waypoint = CMD_TO_TYPE(cmd->data, WaypointWrapper);
-                interchip_send_buffer.am_data.command = PM_SET_RETURN_HOME_COORDINATES;
+                INTERCHIP_SEND(am_data.waypoint, CMD_TO_TYPE(cmd->data, WaypointWrapper));
+                INTERCHIP_SEND(am_data.command, PM_SET_RETURN_HOME_COORDINATES);
                 sendInterchipData();
                 break;
             case TARE_IMU:
@@ -681,31 +774,66 @@ void readDatalink(void){
         }
        freeDatalinkCommand( cmd );
     }
+    return applied;
+}
+
+/**
+ * Fills in a position telemetry block with the current state
+ * @param position
+ */
+static void getPositionBlock(struct packet_type_position_block* position){
+    position->lat = getLatitude();
+    position->lon = getLongitude();
+    position->sys_time = getTime();
+    position->gps_time = gps_Time; //the utc time
+    position->pitch = getPitch();
+    position->roll = getRoll();
+    position->yaw = getYaw();
+    position->pitch_rate = getPitchRate();
+    position->roll_rate = getRollRate();
+    position->yaw_rate = getYawRate();
+    position->airspeed = airspeed;
+    position->altitude = getAltitude();
+    position->ground_speed = gps_GroundSpeed;
+    position->heading = getHeading();
+    position->imu_sample_age = imu_sample_age;
 }
 
 bool writeDatalink(PacketType packet){
     static TelemetryBlock statusData;
+    static TelemetryBlock referenceData;
+    struct packet_type_position_block position;
 
     int* input;
     int* output; //Pointers used for RC channel inputs and outputs
+    InterchipLinkStats interchip_stats;
+    PPMStats ppm_stats;
+    LatencyStats latency_stats;
+    UplinkStats uplink_stats;
+    const CPULoadStats* cpu_load_stats;
+    const ControlLoopStats* control_loop_stats;
+#if USE_RADIO == RADIO_XBEE
+    const XbeeFramePoolStats* pool_stats;
+    const XbeeReliableStats* reliable_stats;
+#elif USE_RADIO == RADIO_3DR
+    const MavlinkParserStats* mavlink_stats;
+#endif
+    static uint8_t latency_histogram_section = 0;
+    uint8_t i;
     statusData.type = packet;
     
     switch(packet){
         case PACKET_TYPE_POSITION:
-            statusData.data.position_block.lat = getLatitude();
-            statusData.data.position_block.lon = getLongitude();
-            statusData.data.position_block.sys_time = getTime();
-            statusData.data.position_block.gps_time = gps_Time; //the utc time
-            statusData.data.position_block.pitch = getPitch();
-            statusData.data.position_block.roll = getRoll();
-            statusData.data.position_block.yaw = getYaw();
-            statusData.data.position_block.pitch_rate = getPitchRate();
-            statusData.data.position_block.roll_rate = getRollRate();
-            statusData.data.position_block.yaw_rate = getYawRate();
-            statusData.data.position_block.airspeed = airspeed;
-            statusData.data.position_block.altitude = getAltitude();
-            statusData.data.position_block.ground_speed = gps_GroundSpeed;
-            statusData.data.position_block.heading = getHeading();
+            getPositionBlock(&statusData.data.position_block);
+            break;
+        case PACKET_TYPE_POSITION_COMPACT:
+            getPositionBlock(&position);
+            if (encodeCompactPosition(&position, &statusData.data.compact_position_block, &referenceData.data.position_reference_block)){
+                referenceData.type = PACKET_TYPE_POSITION_REFERENCE;
+                if (!queueTelemetryBlock(&referenceData)){
+                    resetCompactPositionReference();
+                }
+            }
             break;
         case PACKET_TYPE_STATUS:
             statusData.data.status_block.roll_rate_setpoint = getRollRateSetpoint();
@@ -797,6 +925,97 @@ bool writeDatalink(PacketType packet){
             statusData.data.channels_block.ch6_out = output[5];
             statusData.data.channels_block.ch7_out = output[6];
             statusData.data.channels_block.ch8_out = output[7];
+            getPPMStats(&ppm_stats);
+            statusData.data.channels_block.rc_frame_rate = ppm_stats.frame_rate;
+            statusData.data.channels_block.rc_frame_jitter = ppm_stats.frame_jitter;
+            statusData.data.channels_block.rc_frame_errors = ppm_stats.length_errors + ppm_stats.pulse_errors;
+            break;
+        case PACKET_TYPE_INTERCHIP:
+            getInterchipLinkStats(&interchip_stats);
+            statusData.data.interchip_block.good_frames = interchip_stats.good_frames;
+            statusData.data.interchip_block.checksum_errors = interchip_stats.checksum_errors;
+            statusData.data.interchip_block.empty_frames = interchip_stats.empty_frames;
+            statusData.data.interchip_block.duplicate_frames = interchip_stats.duplicate_frames;
+            statusData.data.interchip_block.sequence_errors = interchip_stats.sequence_errors;
+            statusData.data.interchip_block.round_trip_time = interchip_stats.round_trip_time;
+            statusData.data.interchip_block.last_frame_age = interchip_stats.last_frame_age;
+            statusData.data.interchip_block.message_rate = interchip_stats.message_rate;
+            statusData.data.interchip_block.pm_interchip_errors = pm_interchip_error_count;
+            statusData.data.interchip_block.gps_setpoint_latency = gps_setpoint_latency;
+            statusData.data.interchip_block.pm_good_frames = pm_link_stats.good_frames;
+            statusData.data.interchip_block.pm_empty_frames = pm_link_stats.empty_frames;
+            statusData.data.interchip_block.pm_sequence_errors = pm_link_stats.sequence_errors;
+            statusData.data.interchip_block.pm_round_trip_time = pm_link_stats.round_trip_time;
+            statusData.data.interchip_block.pm_last_frame_age = pm_link_stats.last_frame_age;
+            statusData.data.interchip_block.pm_message_rate = pm_link_stats.message_rate;
+            break;
+        case PACKET_TYPE_LATENCY:
+            getLatencyStats(&latency_stats);
+            for (i = 0; i < TRACE_SECTIONS; i++){
+                statusData.data.latency_block.count[i] = latency_stats.sections[i].count;
+                statusData.data.latency_block.min[i] = latency_stats.sections[i].min;
+                statusData.data.latency_block.mean[i] = latency_stats.sections[i].mean;
+                statusData.data.latency_block.max[i] = latency_stats.sections[i].max;
+            }
+            //the full histogram only fits for one section at a time
+            memcpy(statusData.data.latency_block.histogram, latency_stats.sections[latency_histogram_section].histogram, sizeof(statusData.data.latency_block.histogram));
+            statusData.data.latency_block.histogram_section = latency_histogram_section;
+            statusData.data.latency_block.dropped = latency_stats.dropped;
+            latency_histogram_section = (latency_histogram_section + 1) % TRACE_SECTIONS;
+            break;
+        case PACKET_TYPE_CPU_LOAD:
+            cpu_load_stats = getCPULoadStats();
+            statusData.data.cpu_load_block.cpu_load = cpu_load_stats->cpu_load;
+            for (i = 0; i < TASK_COUNT; i++){
+                statusData.data.cpu_load_block.task_load[i] = cpu_load_stats->tasks[i].load;
+                statusData.data.cpu_load_block.task_max_time[i] = cpu_load_stats->tasks[i].max_time;
+                statusData.data.cpu_load_block.task_calls[i] = cpu_load_stats->tasks[i].calls;
+            }
+            break;
+        case PACKET_TYPE_UPLINK:
+            getUplinkStats(&uplink_stats);
+            statusData.data.uplink_block.mean_latency = uplink_stats.mean_latency;
+            statusData.data.uplink_block.max_latency = uplink_stats.max_latency;
+            statusData.data.uplink_block.applied = uplink_stats.applied;
+            statusData.data.uplink_block.queue_depth = uplink_stats.queue_depth;
+            statusData.data.uplink_block.max_queue_depth = uplink_stats.max_queue_depth;
+            statusData.data.uplink_block.dropped = uplink_stats.dropped;
+            break;
+        case PACKET_TYPE_CONTROL_LOOP:
+            control_loop_stats = getControlLoopStats();
+            statusData.data.control_loop_block.steps = control_loop_stats->steps;
+            statusData.data.control_loop_block.overruns = control_loop_stats->overruns;
+            statusData.data.control_loop_block.max_step_time = control_loop_stats->max_step_time;
+            memcpy(statusData.data.control_loop_block.jitter_histogram, control_loop_stats->jitter_histogram, sizeof(statusData.data.control_loop_block.jitter_histogram));
+            break;
+        case PACKET_TYPE_RADIO:
+            memset(&statusData.data.radio_block, 0, sizeof(statusData.data.radio_block));
+            statusData.data.radio_block.radio = USE_RADIO;
+#if USE_RADIO == RADIO_XBEE
+            pool_stats = getXbeeFramePoolStats();
+            reliable_stats = getXbeeReliableStats();
+            statusData.data.radio_block.stats.xbee.queued = pool_stats->queued;
+            statusData.data.radio_block.stats.xbee.sent = pool_stats->sent;
+            statusData.data.radio_block.stats.xbee.dropped = pool_stats->dropped;
+            statusData.data.radio_block.stats.xbee.expired = pool_stats->expired;
+            statusData.data.radio_block.stats.xbee.coalesced = pool_stats->coalesced;
+            statusData.data.radio_block.stats.xbee.rejected = pool_stats->rejected;
+            statusData.data.radio_block.stats.xbee.depth = pool_stats->depth;
+            statusData.data.radio_block.stats.xbee.max_depth = pool_stats->max_depth;
+            statusData.data.radio_block.stats.xbee.reliable_queued = reliable_stats->queued;
+            statusData.data.radio_block.stats.xbee.reliable_sent = reliable_stats->sent;
+            statusData.data.radio_block.stats.xbee.delivered = reliable_stats->delivered;
+            statusData.data.radio_block.stats.xbee.retransmitted = reliable_stats->retransmitted;
+            statusData.data.radio_block.stats.xbee.failed = reliable_stats->failed;
+            statusData.data.radio_block.stats.xbee.reliable_rejected = reliable_stats->rejected;
+            statusData.data.radio_block.stats.xbee.reliable_pending = reliable_stats->pending;
+#elif USE_RADIO == RADIO_3DR
+            mavlink_stats = getMavlinkUplinkStats();
+            statusData.data.radio_block.stats.mavlink.received = mavlink_stats->received;
+            statusData.data.radio_block.stats.mavlink.crc_errors = mavlink_stats->crc_errors;
+            statusData.data.radio_block.stats.mavlink.unknown = mavlink_stats->unknown;
+            statusData.data.radio_block.stats.mavlink.sequence_gaps = mavlink_stats->sequence_gaps;
+#endif
             break;
         default:
             break;
@@ -805,6 +1024,7 @@ bool writeDatalink(PacketType packet){
 }
 
 void adjustVNOrientationMatrix(float* adjustment){
+    VN100_pauseStreaming(); //the blocking reads and writes below need the bus
 
     adjustment[0] = deg2rad(adjustment[0]);
     adjustment[1] = deg2rad(adjustment[1]);
@@ -825,10 +1045,12 @@ void adjustVNOrientationMatrix(float* adjustment){
     VN100_SPI_SetRefFrameRot(0, (float*)&refRotationMatrix);
     VN100_SPI_WriteSettings(0);
     VN100_SPI_Reset(0);
-
+    VN_Delay(VN100_RESET_DELAY_US); //the sensor has to restart before it is read again
+    VN100_resumeStreaming();
 }
 
 void setVNOrientationMatrix(float* angleOffset){
+    VN100_pauseStreaming();
     //angleOffset[0] = x, angleOffset[1] = y, angleOffset[2] = z
     angleOffset[0] = deg2rad(angleOffset[0]);
     angleOffset[1] = deg2rad(angleOffset[1]);
@@ -850,17 +1072,22 @@ void setVNOrientationMatrix(float* angleOffset){
     VN100_SPI_SetRefFrameRot(0, (float*)&refRotationMatrix);
     VN100_SPI_WriteSettings(0);
     VN100_SPI_Reset(0);
+    VN_Delay(VN100_RESET_DELAY_US); //the sensor has to restart before it is read again
+    VN100_resumeStreaming();
 }
 
 void setAngularWalkVariance(float variance){
+    VN100_pauseStreaming();
     float previousVariance[10];
     VN100_SPI_GetFiltMeasVar(0, (float*)&previousVariance);
     previousVariance[0] = variance;
     VN100_SPI_SetFiltMeasVar(0, (float*)&previousVariance);
     VN100_SPI_WriteSettings(0);
+    VN100_resumeStreaming();
 }
 
 void setGyroVariance(float variance){
+    VN100_pauseStreaming();
     float previousVariance[10];
     VN100_SPI_GetFiltMeasVar(0, (float*)&previousVariance);
     previousVariance[1] = variance; //X -Can be split up later if needed
@@ -868,9 +1095,11 @@ void setGyroVariance(float variance){
     previousVariance[3] = variance; //Z
     VN100_SPI_SetFiltMeasVar(0, (float*)&previousVariance);
     VN100_SPI_WriteSettings(0);
+    VN100_resumeStreaming();
 }
 
 void setMagneticVariance(float variance){
+    VN100_pauseStreaming();
     float previousVariance[10];
     VN100_SPI_GetFiltMeasVar(0, (float*)&previousVariance);
     previousVariance[4] = variance; //X -Can be split up later if needed
@@ -878,9 +1107,11 @@ void setMagneticVariance(float variance){
     previousVariance[6] = variance; //Z
     VN100_SPI_SetFiltMeasVar(0, (float*)&previousVariance);
     VN100_SPI_WriteSettings(0);
+    VN100_resumeStreaming();
 }
 
 void setAccelVariance(float variance){
+    VN100_pauseStreaming();
     float previousVariance[10];
     VN100_SPI_GetFiltMeasVar(0, (float*)&previousVariance);
     previousVariance[7] = variance; //X -Can be split up later if needed
@@ -888,4 +1119,5 @@ void setAccelVariance(float variance){
     previousVariance[9] = variance; //Z
     VN100_SPI_SetFiltMeasVar(0, (float*)&previousVariance);
     VN100_SPI_WriteSettings(0);
+    VN100_resumeStreaming();
 }
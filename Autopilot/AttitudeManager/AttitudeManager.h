@@ -114,6 +114,14 @@ int getHeadingInput(char source);
 
 int getFlapInput(char source);
 
+/**
+ * Starts reading the IMU in the background. The result is picked up by imuCommunication()
+ */
+void startIMUCommunication(void);
+
+/**
+ * Waits for the IMU read started by startIMUCommunication() and updates the IMU values
+ */
 void imuCommunication();
 
 /**
@@ -125,21 +133,23 @@ bool showGains(void);
 uint8_t getControlValue(CtrlType type);
 
 /*****************************************************************************
- * Function: void readDatalink(void);
+ * Function: bool readDatalink(uint32_t budget_us);
  *
  * Preconditions: The datalink must have been initialized to use this properly.
  *
  * Overview: This function is responsible for reading commands from the datalink.
  * Each command has an associated function identified by the "cmd" parameter of the
  * data struct. Additional functions may be added to the switch statement (up to
- * 256 possible commands).
+ * 256 possible commands). All the queued commands are applied, until the budget
+ * runs out or a command for the path manager has to wait for the interchip link
+ * to clock out the last one. Whatever is left is applied in the next call.
  *
- * Input:   None.
+ * Input:   budget_us: Time in us after which no more commands are started.
  *
- * Output:  None.
+ * Output:  Whether any commands were applied.
  *
  *****************************************************************************/
-void readDatalink(void);
+bool readDatalink(uint32_t budget_us);
 
 /*****************************************************************************
  * Function: int writeDatalink(long frequency);
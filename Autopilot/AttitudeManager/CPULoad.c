@@ -0,0 +1,58 @@
+/**
+ * @file CPULoad.c
+ * @author Waterloo Aerial Robotics Group
+ * @date October 18, 2026
+ * @copyright Waterloo Aerial Robotics Group 2017 \n
+ *   https://raw.githubusercontent.com/UWARG/PICpilot/master/LICENCE
+ */
+
+#include "CPULoad.h"
+#include "../Common/Clock/Timer.h"
+#include <string.h>
+
+//CPU usage of the current and the last complete window
+static CPULoadStats window_stats;
+static CPULoadStats cpu_load_stats;
+static uint32_t window_start = 0;
+
+void accountTask(StateMachineTask task, uint32_t start)
+{
+    TaskStats* stats = &window_stats.tasks[task];
+    uint32_t elapsed = (uint32_t)getTimeUs() - start;
+
+    stats->total_time += elapsed;
+    if (elapsed > stats->max_time) {
+        stats->max_time = elapsed > UINT16_MAX ? UINT16_MAX : elapsed;
+    }
+    if (stats->calls != UINT16_MAX) {
+        stats->calls++;
+    }
+}
+
+void updateCPULoad(void)
+{
+    uint32_t now = getTimeUs();
+    uint32_t window = now - window_start;
+    uint32_t window_ms = window / 1000;
+    uint32_t busy = 0;
+    uint8_t i;
+
+    if (window < CPU_LOAD_WINDOW_MS * 1000UL) {
+        return;
+    }
+    //the window can run over if the main loop was held up, so scale to its real length
+    for (i = 0; i < TASK_COUNT; i++) {
+        window_stats.tasks[i].load = window_stats.tasks[i].total_time / window_ms;
+        busy += window_stats.tasks[i].total_time;
+    }
+    window_stats.cpu_load = busy / window_ms;
+
+    cpu_load_stats = window_stats;
+    memset(&window_stats, 0, sizeof(window_stats));
+    window_start = now;
+}
+
+const CPULoadStats* getCPULoadStats(void)
+{
+    return &cpu_load_stats;
+}
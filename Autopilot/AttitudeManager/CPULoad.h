@@ -0,0 +1,77 @@
+/**
+ * @file CPULoad.h
+ * @author Waterloo Aerial Robotics Group
+ * @date October 18, 2026
+ * @brief
+ * Measures how much of the CPU time each task of the state machine uses, over
+ * windows of CPU_LOAD_WINDOW_MS, using Timer4. The time that isn't charged to a
+ * task is the headroom left in the main loop.
+ *
+ * @copyright Waterloo Aerial Robotics Group 2017 \n
+ *   https://raw.githubusercontent.com/UWARG/PICpilot/master/LICENCE
+ */
+
+#ifndef CPULOAD_H
+#define	CPULOAD_H
+
+#include <stdint.h>
+
+/**
+ * Length of the window over which the CPU load and task stats are measured, in ms
+ */
+#define CPU_LOAD_WINDOW_MS 1000
+
+/**
+ * The tasks run by the state machine. Don't reorder these, the ground station relies on it
+ */
+typedef enum {
+    TASK_CONTROL = 0, //control step (IMU read, RC input, PID control and output)
+    TASK_INTERCHIP = 1, //picking up new data from the path manager
+    TASK_UPLINK = 2, //running received commands
+    TASK_DOWNLINK = 3, //building telemetry packets
+    TASK_LED = 4,
+    TASK_DATALINK_PARSE = 5, //parsing data received by the radio
+    TASK_DATALINK_SEND = 6, //sending queued packets to the radio
+    TASK_UHF = 7, //checking the UHF status for kill mode
+    TASK_TRACE = 8, //processing latency trace points
+    TASK_COUNT = 9
+} StateMachineTask;
+
+typedef struct {
+    uint32_t total_time; //us spent in the task in the window
+    uint16_t max_time; //us, longest single run in the window
+    uint16_t calls; //runs in the window
+    uint16_t load; //fraction of the window spent in the task, in 1/1000ths
+} TaskStats;
+
+/**
+ * CPU usage over the last complete window. The state machine only charges the
+ * control, interchip, uplink, downlink and LED tasks when they have work to do.
+ * The other tasks are polled, and charged on every poll, since even a poll that
+ * doesn't complete anything (ie a partial frame) may have done work. So the load
+ * errs on the high side
+ */
+typedef struct {
+    TaskStats tasks[TASK_COUNT];
+    uint16_t cpu_load; //fraction of the window spent in tasks, in 1/1000ths
+} CPULoadStats;
+
+/**
+ * Charges a run of a task to the current window
+ * @param task
+ * @param start Time (us) at which the task started. It ends now
+ */
+void accountTask(StateMachineTask task, uint32_t start);
+
+/**
+ * Publishes the stats of the current window once it's complete, and starts a
+ * new one. Should be called once per main loop iteration
+ */
+void updateCPULoad(void);
+
+/**
+ * @return CPU usage of the last complete window
+ */
+const CPULoadStats* getCPULoadStats(void);
+
+#endif
@@ -19,7 +19,8 @@
 #define RADIO_3DR 1
 
 /**
- * Which radio driver to compile for
+ * Which radio driver to compile for. RADIO_3DR is any transparent serial radio,
+ * spoken to in MAVLink v2 (see RadioMavlink.h)
  */
 #define USE_RADIO RADIO_XBEE
 
@@ -38,13 +39,49 @@ void initRadio(void);
  */
 void queueRadioStatusPacket(void);
 
+/**
+ * How a queued downlink packet is treated while the link can't keep up
+ */
+typedef struct {
+    uint8_t priority; //queued packets with a higher priority are sent first
+    uint16_t deadline; //ms after being queued that the packet is dropped if it hasn't been sent. 0 for none
+    /**
+     * Bitmask of the "latest value" data in the packet. A queued packet is replaced
+     * in place by a newer one whose contents include all of its own. 0 if the packet
+     * has anything else in it, and can't be replaced
+     */
+    uint16_t contents;
+    /**
+     * If set, newer packets are never merged into packets queued before this one,
+     * so that none of them can be sent ahead of it. For packets that the ones after
+     * them depend on
+     */
+    bool barrier;
+} RadioPacketClass;
+
 /**
  * Queues data to be sent down the data link
  * @param data Bytes of the payload data to send
  * @param data_length Length of the aforementioned data
- * @return 1 if the downlink data was successfully queued. 0 otherwise (probably because of malloc)
+ * @param packet_class Priority, deadline and contents of the packet. Radios that don't
+ *      queue packets themselves may ignore it
+ * @return 1 if the downlink data was successfully queued. 0 otherwise (probably because the data
+ *      is too long for the radio, or everything queued has a higher priority)
+ */
+bool queueDownlinkPacket(uint8_t* data, uint16_t data_length, const RadioPacketClass* packet_class);
+
+/**
+ * Queues data to be sent down the data link, and resends it until the radio
+ * reports that it was received or gives up on it. Use this for packets that the
+ * ground station needs but won't ask for again (ie. gains). Radios that can't tell
+ * whether a packet was received send it once, like queueDownlinkPacket(). Reliable
+ * packets never expire, and take priority over everything else
+ * @param data Bytes of the payload data to send. Copied, so it can be reused
+ * @param data_length Length of the aforementioned data
+ * @return 1 if the downlink data was successfully queued. 0 otherwise (too long for
+ *      the radio, or too many reliable packets are still waiting to be received)
  */
-bool queueDownlinkPacket(uint8_t* data, uint16_t data_length);
+bool queueReliableDownlinkPacket(uint8_t* data, uint16_t data_length);
 
 /**
  * Sends the next queued up down the data link. Note that this will at most only 
@@ -55,15 +92,35 @@ bool queueDownlinkPacket(uint8_t* data, uint16_t data_length);
 bool sendQueuedDownlinkPacket(void);
 
 /**
- * Parses a received uplink packet received from the radio
- * @param length Length of the returned array, if applicable
- * @return A pointer to the parsed array of data, if it exists. This array will be
- *      created dynamically, so free it afterwords. This may also be NULL. A null 
- *      would indicate that 1) The UART RX buffer hasn't filled and the radio hasn't 
- *      finished its RX tranmission, 2) The parsed uplink was in some way invalid, 
- *      3) The packet is not applicable to received data from the link (ie. AT command)
+ * Upper bound of getRadioBackpressure()
+ */
+#define RADIO_BACKPRESSURE_MAX 100
+
+/**
+ * @return How backed up the downlink is, from 0 (nothing waiting to be sent) to
+ *      RADIO_BACKPRESSURE_MAX (the queues are full, and packets will be dropped)
+ */
+uint8_t getRadioBackpressure(void);
+
+/**
+ * Size of the buffers uplink packets are parsed into
+ */
+#define RADIO_UPLINK_BUFFER_LENGTH 128
+
+/**
+ * Parses received uplink data into a receive buffer. A packet that has only
+ * partially been received is kept in the buffer between calls, so keep passing
+ * the same buffer until a packet is returned
+ * @param buffer 2 byte aligned buffer of RADIO_UPLINK_BUFFER_LENGTH bytes to parse into
+ * @param length Length of the returned packet, if applicable
+ * @return A pointer to the received packet within the buffer. The packet starts at an
+ *      odd address, so that everything after its first byte (the command id) is
+ *      2 byte aligned. This may also be NULL. A null would indicate that 1) The UART
+ *      RX buffer hasn't filled and the radio hasn't finished its RX tranmission,
+ *      2) The parsed uplink was in some way invalid, 3) The packet is not applicable
+ *      to received data from the link (ie. AT command)
  */
-uint8_t* parseUplinkPacket(uint16_t* length);
+uint8_t* parseUplinkPacket(uint8_t* buffer, uint16_t* length);
 
 /**
  * Clears the downlink packet queue. Be wary of using this, as all commands
@@ -72,8 +129,7 @@ uint8_t* parseUplinkPacket(uint16_t* length);
 void clearRadioDownlinkQueue(void);
 
 /**
- * These are Xbee specific functions that are to be removed when the mavlink
- * implementation comes into place
+ * Link quality, as reported by the radio. The RSSI is in the radio's own units
  * @return 
  */
 uint8_t getRadioRSSI(void);
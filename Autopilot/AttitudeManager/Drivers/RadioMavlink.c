@@ -0,0 +1,322 @@
+/**
+ * @file RadioMavlink.c
+ * @author Waterloo Aerial Robotics Group
+ * @date October 18, 2026
+ * @copyright Waterloo Aerial Robotics Group 2017 \n
+ *   https://raw.githubusercontent.com/UWARG/PICpilot/master/LICENCE
+ */
+
+#include "./Radio.h"
+#include "./RadioMavlink.h"
+#include "../Network/Datalink.h"
+#include "../Network/CompactTelemetry.h"
+#include "../main.h"
+#include "../../Common/Common.h"
+#include "../../Common/Clock/Timer.h"
+#include "../../Common/Utilities/Logger.h"
+#include "../../Common/Interfaces/UART.h"
+#include <math.h>
+#include <string.h>
+#include <stddef.h>
+
+#if USE_RADIO == RADIO_3DR
+
+/**
+ * Values of the standard enums we send
+ */
+#define MAV_TYPE_GENERIC 0
+#define MAV_TYPE_FIXED_WING 1
+#define MAV_TYPE_QUADROTOR 2
+#define MAV_AUTOPILOT_GENERIC 0
+#define MAV_MODE_FLAG_CUSTOM_MODE_ENABLED 1
+#define MAV_STATE_ACTIVE 4
+#define MAVLINK_VERSION 3
+
+#if VEHICLE_TYPE == FIXED_WING
+#define MAVLINK_VEHICLE_TYPE MAV_TYPE_FIXED_WING
+#elif VEHICLE_TYPE == MULTIROTOR
+#define MAVLINK_VEHICLE_TYPE MAV_TYPE_QUADROTOR
+#else
+#define MAVLINK_VEHICLE_TYPE MAV_TYPE_GENERIC
+#endif
+
+/**
+ * RSSI and receive error count from the last RADIO_STATUS
+ */
+static uint8_t latest_rssi;
+static uint16_t received_error_count;
+
+/**
+ * Percentage of the radio's TX buffer that was free in the last RADIO_STATUS
+ */
+static uint8_t radio_tx_free;
+
+static MavlinkParser uplink_parser;
+
+/**
+ * Autonomous level from the last status block, which the heartbeat carries as its
+ * custom mode, and when the last heartbeat was sent (ms)
+ */
+static uint16_t autonomous_level;
+static uint32_t last_heartbeat_time;
+
+/**
+ * Last position reference block sent down, which compact position blocks are decoded with
+ */
+static struct packet_type_position_reference_block position_reference;
+
+/**
+ * Reliable packets are sent once, like any other
+ */
+static const RadioPacketClass reliable_class = {0, 0, 0, false};
+
+static void sendStandardTelemetry(uint8_t* data, uint16_t data_length);
+static void sendHeartbeat(void);
+static void sendPosition(const struct packet_type_position_block* position);
+static void sendStatus(const struct packet_type_status_block* status);
+
+void initRadio()
+{
+    latest_rssi = 0;
+    received_error_count = 0;
+    radio_tx_free = RADIO_BACKPRESSURE_MAX;
+    memset(&uplink_parser, 0, sizeof(uplink_parser));
+    autonomous_level = 0;
+    last_heartbeat_time = 0;
+    memset(&position_reference, 0, sizeof(position_reference));
+
+    initUART(MAVLINK_UART_INTERFACE, MAVLINK_UART_BAUD_RATE, MAVLINK_UART_BUFFER_SIZE, UART_TX_RX_ENABLE);
+
+    info("MAVLink Radio Initialized");
+}
+
+uint8_t getRadioRSSI()
+{
+    return latest_rssi;
+}
+
+uint16_t getRadioTransmissionErrors()
+{
+    //the radio doesn't report these, so count the messages that didn't make it to the radio
+    return getMavlinkDroppedMessages();
+}
+
+uint16_t getRadioReceiveErrors()
+{
+    return received_error_count;
+}
+
+void queueRadioStatusPacket()
+{
+    //the radio sends RADIO_STATUS on its own
+}
+
+void clearRadioDownlinkQueue()
+{
+    //messages go straight into the UART TX buffer, there's no queue to clear
+}
+
+const MavlinkParserStats* getMavlinkUplinkStats(void)
+{
+    return &uplink_parser.stats;
+}
+
+uint8_t getRadioBackpressure()
+{
+    //the fuller of the UART TX buffer and the radio's own buffer
+    uint16_t uart_capacity = getTXCapacity(MAVLINK_UART_INTERFACE);
+    uint8_t radio = RADIO_BACKPRESSURE_MAX - radio_tx_free;
+    uint8_t uart;
+
+    if (uart_capacity == 0) {
+        return RADIO_BACKPRESSURE_MAX; //the UART is down, so nothing can be sent
+    }
+    uart = (uint32_t)(uart_capacity - getTXSpace(MAVLINK_UART_INTERFACE)) * RADIO_BACKPRESSURE_MAX / uart_capacity;
+    return radio > uart ? radio : uart;
+}
+
+bool sendQueuedDownlinkPacket()
+{
+    //packets are serialised into the UART TX buffer when they're queued, so the
+    //only thing to send here is the heartbeat, which has to keep its rate on its own
+#if MAVLINK_STANDARD_TELEMETRY
+    if (getTime() - last_heartbeat_time >= MAVLINK_HEARTBEAT_INTERVAL) {
+        last_heartbeat_time = getTime();
+        sendHeartbeat();
+        return true;
+    }
+#endif
+    return false;
+}
+
+bool queueDownlinkPacket(uint8_t* data, uint16_t data_length, const RadioPacketClass* packet_class)
+{
+    //messages go straight into the UART TX buffer, so there's no queue to order or drop from
+    (void)packet_class;
+
+    if (data_length > MAVLINK_EXTENSION_MAX_DATA_LENGTH) {
+        return false;
+    }
+    if (!sendMavlinkExtension(MAVLINK_UART_INTERFACE, MAVLINK_PICPILOT_MESSAGE_TYPE, data, data_length)) {
+        return false;
+    }
+#if MAVLINK_STANDARD_TELEMETRY
+    sendStandardTelemetry(data, data_length);
+#endif
+    return true;
+}
+
+bool queueReliableDownlinkPacket(uint8_t* data, uint16_t data_length)
+{
+    //transparent radios don't say whether anything was received, so there's nothing to resend on
+    return queueDownlinkPacket(data, data_length, &reliable_class);
+}
+
+/**
+ * Parses the received bytes until a command from the ground station is received,
+ * or the UART RX buffer is empty
+ * @param buffer
+ * @param length
+ * @return A pointer to the command within the buffer, or NULL
+ */
+uint8_t* parseUplinkPacket(uint8_t* buffer, uint16_t* length)
+{
+    MavlinkMessage* message = &uplink_parser.message;
+    MavlinkRadioStatus radio_status;
+    uint16_t message_type;
+    uint16_t command_length;
+
+    while (getRXSize(MAVLINK_UART_INTERFACE) != 0) {
+        if (!parseMavlinkByte(&uplink_parser, readRXData(MAVLINK_UART_INTERFACE))) {
+            continue;
+        }
+
+        if (message->msg_id == MAVLINK_MSG_ID_RADIO_STATUS) {
+            memcpy(&radio_status, message->payload, MAVLINK_MSG_RADIO_STATUS_LEN);
+            latest_rssi = radio_status.rssi;
+            received_error_count = radio_status.rxerrors;
+            radio_tx_free = radio_status.txbuf > RADIO_BACKPRESSURE_MAX ? RADIO_BACKPRESSURE_MAX : radio_status.txbuf;
+        } else if (message->msg_id == MAVLINK_MSG_ID_V2_EXTENSION && message->length > MAVLINK_EXTENSION_HEADER_LENGTH) {
+            message_type = message->payload[0] | ((uint16_t)message->payload[1] << 8);
+            command_length = message->length - MAVLINK_EXTENSION_HEADER_LENGTH;
+            if (message_type != MAVLINK_PICPILOT_MESSAGE_TYPE || command_length >= RADIO_UPLINK_BUFFER_LENGTH) {
+                continue;
+            }
+            //the parser holds a single message, so the command is moved out of its way.
+            //Starting at buffer[1] aligns the data after the command id
+            memcpy(&buffer[1], &message->payload[MAVLINK_EXTENSION_HEADER_LENGTH], command_length);
+            *length = command_length;
+            return &buffer[1];
+        }
+        //nothing else from the ground control software is handled yet
+    }
+    return NULL;
+}
+
+/**
+ * Sends the standard messages for the position and status blocks in a downlink frame.
+ * Compact position blocks are decoded with the last position reference block
+ */
+static void sendStandardTelemetry(uint8_t* data, uint16_t data_length)
+{
+    //blocks aren't aligned within the frame, so they have to be copied out
+    PacketPayload block;
+    struct packet_type_position_block position;
+    uint16_t pos = 0;
+    uint8_t type;
+    uint8_t length;
+
+    while (pos + TELEMETRY_BLOCK_HEADER_LENGTH <= data_length) {
+        type = data[pos];
+        length = data[pos + 1];
+        pos += TELEMETRY_BLOCK_HEADER_LENGTH;
+        if (pos + length > data_length) {
+            return;
+        }
+
+        if (type == PACKET_TYPE_POSITION && length >= sizeof(block.position_block)) {
+            memcpy(&block, &data[pos], sizeof(block.position_block));
+            sendPosition(&block.position_block);
+        } else if (type == PACKET_TYPE_POSITION_REFERENCE && length >= sizeof(position_reference)) {
+            memcpy(&position_reference, &data[pos], sizeof(position_reference));
+        } else if (type == PACKET_TYPE_POSITION_COMPACT && length >= sizeof(block.compact_position_block)) {
+            memcpy(&block, &data[pos], sizeof(block.compact_position_block));
+            if (decodeCompactPosition(&block.compact_position_block, &position_reference, &position)) {
+                sendPosition(&position);
+            }
+        } else if (type == PACKET_TYPE_STATUS && length >= sizeof(block.status_block)) {
+            memcpy(&block, &data[pos], sizeof(block.status_block));
+            sendStatus(&block.status_block);
+        }
+        pos += length;
+    }
+}
+
+static void sendPosition(const struct packet_type_position_block* position)
+{
+    MavlinkAttitude attitude;
+    MavlinkGlobalPositionInt global_position;
+    int16_t heading = position->heading % 360;
+    float heading_rad;
+
+    attitude.time_boot_ms = position->sys_time;
+    attitude.roll = deg2rad(position->roll);
+    attitude.pitch = deg2rad(position->pitch);
+    attitude.yaw = deg2rad(position->yaw);
+    attitude.rollspeed = deg2rad(position->roll_rate);
+    attitude.pitchspeed = deg2rad(position->pitch_rate);
+    attitude.yawspeed = deg2rad(position->yaw_rate);
+    MAVLINK_SEND(MAVLINK_UART_INTERFACE, ATTITUDE, &attitude);
+
+    if (heading < 0) {
+        heading += 360;
+    }
+    heading_rad = deg2rad(heading);
+    global_position.time_boot_ms = position->sys_time;
+    global_position.lat = (int32_t)(position->lat * 1e7);
+    global_position.lon = (int32_t)(position->lon * 1e7);
+    global_position.alt = (int32_t)(position->altitude * 1000);
+    global_position.relative_alt = global_position.alt;
+    global_position.vx = (int16_t)(position->ground_speed * cosf(heading_rad) * 100);
+    global_position.vy = (int16_t)(position->ground_speed * sinf(heading_rad) * 100);
+    global_position.vz = 0;
+    global_position.hdg = heading * 100;
+    MAVLINK_SEND(MAVLINK_UART_INTERFACE, GLOBAL_POSITION_INT, &global_position);
+}
+
+static void sendHeartbeat(void)
+{
+    MavlinkHeartbeat heartbeat;
+
+    heartbeat.custom_mode = autonomous_level;
+    heartbeat.type = MAVLINK_VEHICLE_TYPE;
+    heartbeat.autopilot = MAV_AUTOPILOT_GENERIC;
+    heartbeat.base_mode = MAV_MODE_FLAG_CUSTOM_MODE_ENABLED;
+    heartbeat.system_status = MAV_STATE_ACTIVE;
+    heartbeat.mavlink_version = MAVLINK_VERSION;
+    MAVLINK_SEND(MAVLINK_UART_INTERFACE, HEARTBEAT, &heartbeat);
+}
+
+static void sendStatus(const struct packet_type_status_block* status)
+{
+    MavlinkSysStatus sys_status;
+    MavlinkMissionCurrent mission_current;
+
+    autonomous_level = status->autonomous_level;
+
+    memset(&sys_status, 0, sizeof(sys_status));
+    sys_status.voltage_battery = status->internal_battery_voltage * 10; //V * 100 to mV
+    sys_status.current_battery = -1;
+    sys_status.errors_comm = status->ul_receive_errors;
+    sys_status.errors_count1 = status->am_interchip_errors;
+    sys_status.errors_count2 = status->pm_interchip_errors;
+    sys_status.errors_count3 = status->gps_communication_errors;
+    sys_status.errors_count4 = status->startup_errors;
+    sys_status.battery_remaining = -1;
+    MAVLINK_SEND(MAVLINK_UART_INTERFACE, SYS_STATUS, &sys_status);
+
+    mission_current.seq = status->waypoint_index;
+    MAVLINK_SEND(MAVLINK_UART_INTERFACE, MISSION_CURRENT, &mission_current);
+}
+
+#endif
@@ -0,0 +1,64 @@
+/**
+ * @file RadioMavlink.h
+ * @author Waterloo Aerial Robotics Group
+ * @date October 18, 2026
+ * @brief
+ * Radio driver for transparent serial radios (3DR/SiK), speaking MAVLink v2.
+ * Downlink frames are tunnelled to the ground station in V2_EXTENSION messages,
+ * and position and status blocks are also translated into the standard messages
+ * (ATTITUDE, GLOBAL_POSITION_INT, SYS_STATUS, MISSION_CURRENT), along with a
+ * HEARTBEAT every MAVLINK_HEARTBEAT_INTERVAL, so that
+ * off the shelf ground control software can follow the aircraft. Uplink commands
+ * are expected in V2_EXTENSION messages of the same message type.
+ *
+ * The radio's own RADIO_STATUS messages provide the RSSI and error counts, and
+ * how full its buffers are.
+ *
+ * @copyright Waterloo Aerial Robotics Group 2017 \n
+ *   https://raw.githubusercontent.com/UWARG/PICpilot/master/LICENCE
+ */
+
+#ifndef RADIOMAVLINK_H
+#define	RADIOMAVLINK_H
+
+#include "../Network/Mavlink.h"
+
+/**
+ * Which baud rate to communicate with the radio at. 57600 is the SiK default
+ */
+#define MAVLINK_UART_BAUD_RATE 57600
+
+/**
+ * Which UART interface the radio should use
+ */
+#define MAVLINK_UART_INTERFACE 2
+
+/**
+ * Size of the rx and tx uart buffer (a power of 2). Messages are serialised
+ * straight into the TX buffer, so it has to hold a couple of full downlink frames
+ */
+#define MAVLINK_UART_BUFFER_SIZE 512
+
+/**
+ * V2_EXTENSION message type of the tunnelled downlink frames and uplink commands
+ * (in the private use range)
+ */
+#define MAVLINK_PICPILOT_MESSAGE_TYPE 32768
+
+/**
+ * Whether to translate position and status blocks into the standard messages as
+ * well as tunnelling them
+ */
+#define MAVLINK_STANDARD_TELEMETRY 1
+
+/**
+ * Interval in ms at which the HEARTBEAT is sent, whatever the downlink rate
+ */
+#define MAVLINK_HEARTBEAT_INTERVAL 1000
+
+/**
+ * @return Receive statistics of the uplink
+ */
+const MavlinkParserStats* getMavlinkUplinkStats(void);
+
+#endif
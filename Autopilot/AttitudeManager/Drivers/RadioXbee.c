@@ -11,6 +11,7 @@
 #include "./RadioXbee.h"
 #include "../../Common/Utilities/Logger.h"
 #include "../../Common/Interfaces/UART.h"
+#include "../../Common/Clock/Timer.h"
 #include <string.h>
 #include <stddef.h>
 #include <stdlib.h>
@@ -20,12 +21,46 @@
 #if USE_RADIO == RADIO_XBEE
 
 /**
- * Set the internal buffer sizes of the TX and RX of the XBEE
- * Maximum length of an xbee transmission is 100 bytes, however the API command to do so has a 13 byte
- * overhead. So we'll need 113 bytes, but allocate 128 bytes for good measure
+ * Received API frames are parsed into the receive buffer from this offset, so
+ * that the payload of an RX indicator frame, which starts at the 13th byte of
+ * the frame data, is at an odd address
  */
-#define XBEE_TX_BUFFER_LENGTH 128
-#define XBEE_RX_BUFFER_LENGTH  128
+#define XBEE_RX_FRAME_OFFSET 1
+
+/**
+ * The RF data of an RX indicator frame follows the frame type, the 8 byte source
+ * address, 2 reserved bytes and the receive options
+ */
+#define XBEE_RX_INDICATOR_HEADER_LENGTH 12
+
+/**
+ * Every API frame has a start delimiter, 2 length bytes and the frame type before
+ * the frame specific data, and a checksum after it
+ */
+#define XBEE_API_FRAME_HEADER_LENGTH 4
+#define XBEE_API_FRAME_OVERHEAD 5
+
+/**
+ * A TX request has a 13 byte header (frame id, destination address, reserved bytes,
+ * broadcast radius and transmit options) before the payload
+ */
+#define XBEE_TX_REQUEST_HEADER_LENGTH 13
+
+/**
+ * An AT command is the frame id followed by the 2 character command
+ */
+#define XBEE_AT_COMMAND_LENGTH 3
+
+/**
+ * AT commands are few and small, and the radio status depends on them, so they go
+ * before any downlink packets
+ */
+#define XBEE_AT_COMMAND_PRIORITY UINT8_MAX
+
+/**
+ * Length of the longest API frame we send, a TX request with the largest payload
+ */
+#define XBEE_API_FRAME_MAX_LENGTH (XBEE_API_FRAME_OVERHEAD + XBEE_TX_REQUEST_HEADER_LENGTH + XBEE_MAX_PAYLOAD_LENGTH)
 
 /**
  * RSSI of the last received packet
@@ -49,52 +84,94 @@ static uint16_t received_error_count;
 static uint64_t receiver_address;
 
 /**
- * Current frame id of the response. Used to identify responses for AT commands
+ * Next frame ids to request responses with. AT commands and reliable frames
+ * each have their own range, see XBEE_AT_FRAME_ID_FIRST
  */
-static uint16_t current_frame_id;
+static uint8_t current_frame_id;
+static uint8_t reliable_frame_id;
 
 /**
  * When we receive an AT response with this frame id, we know that we received
  * the last frame representing the radio status. Thus we know we can send over
  * the updated radio status (includes RSSI, transmission errors, and received error count
  */
-static uint16_t transmit_status_frame_id;
+static uint8_t transmit_status_frame_id;
 
 /**
- * Representation of an xbee api frame, which is what we'll send to the xbee. Is a
- * node that contains a pointer to the next node in the queue, thus its a linked list
+ * Representation of an xbee api frame, which is what we'll send to the xbee. The
+ * frame is built in place, exactly as it will be written to the UART
  */
-typedef struct _XbeeApiFrame {
-    /**
-     * Frame time of the api frame. ie AT command, TX request
-     */
-    uint8_t frame_type;
-    /**
-     * This should be the payload data coming after the frame type and before the checksum.
-     * This array should be dynamically allocated
-     */
-    uint8_t* data;
-
+typedef struct {
     /**
-     * This should be the length of the payload described above
+     * The whole frame, from the start delimiter to the checksum
      */
-    uint16_t data_length;
-    struct _XbeeApiFrame* next_frame;
+    uint8_t bytes[XBEE_API_FRAME_MAX_LENGTH];
+    uint8_t length;
 } XbeeApiFrame;
 
 /**
- * Single object that represents the actual queue of data that we'll send over
+ * A frame in the pool, along with how it should be treated while it's queued
+ */
+typedef struct {
+    XbeeApiFrame frame;
+    uint32_t deadline; //ms. If the frame expires, it's dropped when it hasn't been sent by then
+    uint16_t sequence; //order the frames were queued in, so that frames of the same priority go in order
+    uint16_t contents; //see RadioPacketClass
+    uint8_t priority;
+    bool barrier; //see RadioPacketClass
+    bool expires;
+    bool queued; //false if the slot is free
+} XbeePoolFrame;
+
+/**
+ * The frames queued for transmission. The highest priority frame is sent first,
+ * and the oldest of those if there are several
+ */
+static XbeePoolFrame frame_pool[XBEE_FRAME_POOL_SIZE];
+static uint16_t next_sequence;
+static XbeeFramePoolStats pool_stats;
+
+static const RadioPacketClass at_command_class = {XBEE_AT_COMMAND_PRIORITY, 0, 0, false};
+
+/**
+ * A frame that is resent until the xbee reports that it was received. It keeps its
+ * frame id (and slot) until then, or until we give up on it
  */
-struct _XbeeFrameQueue {
-    XbeeApiFrame* head;
-    XbeeApiFrame* tail;
-} XbeeFrameQueue;
+typedef struct {
+    XbeeApiFrame frame;
+    uint32_t time; //ms. When it's next due to be sent, or when it was last sent if awaiting_status
+    uint8_t frame_id; //0 if the slot is free
+    uint8_t attempts;
+    bool awaiting_status;
+} XbeeReliableFrame;
 
-static bool queueATCommand(char* at_command_id);
-static void queueApiFrame(XbeeApiFrame* frame);
+static XbeeReliableFrame reliable_frames[XBEE_RELIABLE_FRAME_COUNT];
+static XbeeReliableStats reliable_stats;
+
+/**
+ * The header of TX requests to the receiver address, and the part of the checksum
+ * it (and the frame type) contributes. Built whenever the address changes, so that
+ * queueing a TX request only has to copy the payload
+ */
+static uint8_t tx_request_header[XBEE_TX_REQUEST_HEADER_LENGTH];
+static uint8_t tx_request_header_checksum;
+
+static void queueATCommand(char* at_command_id);
+static uint8_t nextFrameId(uint8_t* current, uint8_t first, uint8_t last);
+static void initApiFrame(XbeeApiFrame* frame, uint8_t frame_type, uint16_t data_length);
+static XbeePoolFrame* allocateApiFrame(uint8_t frame_type, uint16_t data_length, const RadioPacketClass* packet_class);
+static void queueApiFrame(XbeePoolFrame* to_queue, uint8_t checksum);
+static bool isQueuedBefore(const XbeePoolFrame* a, const XbeePoolFrame* b);
+static XbeePoolFrame* getLastBarrierFrame(void);
+static XbeePoolFrame* getNextPoolFrame(void);
+static void finishApiFrame(XbeeApiFrame* frame, uint8_t checksum);
+static uint8_t buildTXRequest(XbeeApiFrame* frame, uint8_t frame_id, uint8_t* data, uint16_t data_length);
+static void buildTXRequestHeader(void);
+static XbeeReliableFrame* getDueReliableFrame(void);
+static void failReliableAttempt(XbeeReliableFrame* reliable, uint32_t now);
 static uint8_t* parseReceivedApiFrame(uint8_t* data, uint16_t data_length, uint16_t* length);
 static void parseReceivedATResponse(uint8_t* data, uint16_t data_length);
-static XbeeApiFrame* popApiFrame(void);
+static void parseReceivedTransmitStatus(uint8_t* data, uint16_t data_length);
 
 void initRadio()
 {
@@ -103,12 +180,17 @@ void initRadio()
     transmission_errors = 0;
     received_error_count = 0;
     latest_rssi = 0;
-    current_frame_id = 1; //frame id's should start at 1
-
-    XbeeFrameQueue.head = NULL;
-    XbeeFrameQueue.tail = NULL;
+    current_frame_id = XBEE_AT_FRAME_ID_FIRST;
+    reliable_frame_id = XBEE_RELIABLE_FRAME_ID_FIRST;
+
+    memset(frame_pool, 0, sizeof(frame_pool));
+    next_sequence = 0;
+    memset(&pool_stats, 0, sizeof(pool_stats));
+    memset(reliable_frames, 0, sizeof(reliable_frames));
+    memset(&reliable_stats, 0, sizeof(reliable_stats));
+    buildTXRequestHeader();
     
-    initUART(XBEE_UART_INTERFACE, XBEE_UART_BAUD_RATE, XBEE_UART_BUFFER_INITIAL_SIZE, XBEE_UART_BUFFER_MAX_SIZE, UART_TX_RX_ENABLE);
+    initUART(XBEE_UART_INTERFACE, XBEE_UART_BAUD_RATE, XBEE_UART_BUFFER_SIZE, UART_TX_RX_ENABLE);
     
     //request destination address
     queueATCommand(XBEE_AT_COMMAND_DESTINATION_ADDRESS_HIGH);
@@ -143,134 +225,164 @@ void queueRadioStatusPacket()
 
 void clearRadioDownlinkQueue()
 {
-    XbeeApiFrame* packet = popApiFrame();
-    while (packet != NULL) {
-        free(packet->data);
-        free(packet);
-        packet = popApiFrame();
+    uint8_t i;
+
+    for (i = 0; i < XBEE_FRAME_POOL_SIZE; i++) {
+        frame_pool[i].queued = false;
+    }
+    pool_stats.depth = 0;
+    for (i = 0; i < XBEE_RELIABLE_FRAME_COUNT; i++) {
+        reliable_frames[i].frame_id = 0;
     }
-    current_frame_id = 1; //also reset the current frame id
+    reliable_stats.pending = 0;
+    current_frame_id = XBEE_AT_FRAME_ID_FIRST; //also reset the current frame ids
+    reliable_frame_id = XBEE_RELIABLE_FRAME_ID_FIRST;
+}
+
+const XbeeFramePoolStats* getXbeeFramePoolStats(void)
+{
+    return &pool_stats;
+}
+
+const XbeeReliableStats* getXbeeReliableStats(void)
+{
+    return &reliable_stats;
+}
+
+uint8_t getRadioBackpressure()
+{
+    //the fuller of the frame pool and the UART TX buffer
+    uint16_t uart_capacity = getTXCapacity(XBEE_UART_INTERFACE);
+    uint8_t pool = (uint16_t)pool_stats.depth * RADIO_BACKPRESSURE_MAX / XBEE_FRAME_POOL_SIZE;
+    uint8_t uart;
+
+    if (uart_capacity == 0) {
+        return RADIO_BACKPRESSURE_MAX; //the UART is down, so nothing can be sent
+    }
+    uart = (uint32_t)(uart_capacity - getTXSpace(XBEE_UART_INTERFACE)) * RADIO_BACKPRESSURE_MAX / uart_capacity;
+    return pool > uart ? pool : uart;
 }
 
 bool sendQueuedDownlinkPacket()
 {
-    //to temporarily store the api messages to send over the uart line
-    static uint8_t send_buffer[XBEE_TX_BUFFER_LENGTH];
-    
-    uint8_t checksum = 0;
+    XbeeReliableFrame* reliable = NULL;
+    XbeePoolFrame* next = NULL;
+    XbeeApiFrame* to_send;
+
+    //reliable frames that are due go first. There are few of them, and they only
+    //take the UART's time when they're (re)sent, never while waiting for their status
+    if (reliable_stats.pending != 0) {
+        reliable = getDueReliableFrame();
+    }
+    if (reliable == NULL && pool_stats.depth != 0) {
+        next = getNextPoolFrame(); //We're only peeking at the frame here, not popping!
+    }
 
-    send_buffer[0] = XBEE_START_DELIMITER;
-    XbeeApiFrame* to_send = XbeeFrameQueue.head; //to save on typing. We're only peeking at the value here, not popping!
+    if (reliable != NULL) {
+        to_send = &reliable->frame;
+    } else if (next != NULL) {
+        to_send = &next->frame;
+    } else {
+        return false;
+    }
 
-    if (to_send != NULL) {
-        //the 5 comes from the start delimiter, 2 bytes for length, 1 for frame type, 1 for checksum
-        uint16_t total_frame_length = to_send->data_length + 5;
+    //if we cant transmit the entire API frame within our UART buffer, don't send anything (yet)
+    if (getTXSpace(XBEE_UART_INTERFACE) < to_send->length) {
+        return false;
+    }
 
-        //the data_length doesn't include the frame_type byte
-        uint16_t total_payload_length = to_send->data_length + 1;
+    queueTXData(XBEE_UART_INTERFACE, to_send->bytes, to_send->length); //queue the data for tranmission over UART
 
-        //if we cant transmit the entire API frame within our UART buffer, don't send anything (yet)
-        if (getTXSpace(XBEE_UART_INTERFACE) < total_frame_length) {
-            return false;
-        }
-        //weve got enough space for the packet. Pop it from the queue
-        popApiFrame();
-        
-        send_buffer[1] = total_payload_length >> 8; //upper 8 bits of the length
-        send_buffer[2] = total_payload_length & 0xFF; //lower 8 bits of the length
-        send_buffer[3] = to_send->frame_type;
-        
-        checksum += to_send->frame_type;
-
-        uint16_t i;
-        for (i = 0; i < to_send->data_length; i++) {
-            send_buffer[i + 4] = to_send->data[i];
-            checksum += to_send->data[i];
+    if (reliable != NULL) {
+        //the frame is kept until its transmit status comes back
+        reliable->awaiting_status = true;
+        reliable->time = getTime();
+        reliable_stats.sent++;
+        if (reliable->attempts != 0) {
+            reliable_stats.retransmitted++;
         }
-        //add the checksum
-        send_buffer[total_frame_length - 1] = 0xFF - checksum;
-        
-        queueTXData(XBEE_UART_INTERFACE, send_buffer, total_frame_length); //queue the data for tranmission over UART
-
-        free(to_send->data);
-        free(to_send);
+        reliable->attempts++;
         return true;
     }
-    return false;
+
+    //the UART has its own copy of the frame now, so the slot can be reused
+    next->queued = false;
+    pool_stats.depth--;
+    pool_stats.sent++;
+    return true;
 }
 
-bool queueDownlinkPacket(uint8_t* data, uint16_t data_length)
+bool queueDownlinkPacket(uint8_t* data, uint16_t data_length, const RadioPacketClass* packet_class)
 {
-    int i;
-    XbeeApiFrame* to_send = malloc(sizeof(XbeeApiFrame));
+    XbeePoolFrame* to_send;
 
-    if (to_send == NULL) {
+    if (data_length > XBEE_MAX_PAYLOAD_LENGTH) {
+        pool_stats.rejected++;
         return false;
     }
 
     //a non explicit TX frame requires 13 more bytes of header data to be attached than the payload we're actually transmitted
-    to_send->data = malloc(data_length + 13);
-
-    if (to_send->data == NULL) {
-        free(to_send);
+    to_send = allocateApiFrame(XBEE_FRAME_TYPE_TX_REQUEST, data_length + XBEE_TX_REQUEST_HEADER_LENGTH, packet_class);
+    if (to_send == NULL) {
         return false;
     }
 
-    //this will be a TX api frame
-    to_send->frame_type = XBEE_FRAME_TYPE_TX_REQUEST;
+    //Frame id 0, since there's no need for the transmit status of best effort frames
+    queueApiFrame(to_send, buildTXRequest(&to_send->frame, 0, data, data_length));
+    return true;
+}
 
-    //Frame id. Since there's not much benefit in processing response frames to check status of transmits, we'll set this to 0
-    to_send->data[0] = 0;
+bool queueReliableDownlinkPacket(uint8_t* data, uint16_t data_length)
+{
+    XbeeReliableFrame* reliable = NULL;
+    uint8_t i;
 
-    //copy the destination address to the tx frame
-    for (i = 7; i >= 0; i--) {
-        to_send->data[1 + (7 - i)] = (receiver_address >> i * 8) & 0xFF;
+    for (i = 0; i < XBEE_RELIABLE_FRAME_COUNT; i++) {
+        if (reliable_frames[i].frame_id == 0) {
+            reliable = &reliable_frames[i];
+            break;
+        }
     }
 
-    //reserved values
-    to_send->data[9] = 0xFF;
-    to_send->data[10] = 0xFE;
-
-    //set the broadcast radius of this TX frame
-    to_send->data[11] = XBEE_BROADCAST_RADIUS;
-
-    //transmit options. 0x00 will use the saved transmit options parameter (the one saved in XCTU)
-    to_send->data[12] = 0x00;
-
-    //finally copy the payload data
-    for (i = 0; i < data_length; i++) {
-        to_send->data[i + 13] = data[i];
+    if (data_length > XBEE_MAX_PAYLOAD_LENGTH || reliable == NULL) {
+        reliable_stats.rejected++;
+        return false;
     }
 
-    to_send->data_length = data_length + 13;
-
-    to_send->next_frame = NULL;
+    reliable->frame_id = nextFrameId(&reliable_frame_id, XBEE_RELIABLE_FRAME_ID_FIRST, XBEE_RELIABLE_FRAME_ID_LAST);
+    reliable->attempts = 0;
+    reliable->awaiting_status = false;
+    reliable->time = getTime(); //due straight away
 
-    //queue the frame for transmission
-    queueApiFrame(to_send);
+    initApiFrame(&reliable->frame, XBEE_FRAME_TYPE_TX_REQUEST, data_length + XBEE_TX_REQUEST_HEADER_LENGTH);
+    finishApiFrame(&reliable->frame, buildTXRequest(&reliable->frame, reliable->frame_id, data, data_length));
 
+    reliable_stats.queued++;
+    reliable_stats.pending++;
     return true;
 }
 
 /**
- * This function will queue and read characters received in the UART byte buffer
- * until one of two things happen
+ * This function will read characters received in the UART byte buffer, in place,
+ * until one of these things happen
  * 1) The buffer becomes empty
  * 2) The start delimiter is detected, in which this function will keep parsing
  * 3) If the start delimiter is detected, and the length of the packet is reached,
  *      will perform the checksum check on the received api frame. If it passses,
  *      will send the api frame over for parsing
+ * Only the bytes that were parsed are removed from the UART buffer
+ * @param buffer
  * @param length
- * @return A link to a dynamically allocated array representing data received from the groundstation,
+ * @return A pointer to the data received from the groundstation within the buffer,
  *      if applicable. NULL if the recieved packet was an AT command
  */
-uint8_t* parseUplinkPacket(uint16_t* length)
+uint8_t* parseUplinkPacket(uint8_t* buffer, uint16_t* length)
 {
     ///whether we're in the middle of parsing a received packet
     static bool parsing_rx_packet = false;
 
-    //used to temporarily store the data as we're receiving it
-    static uint8_t receive_buffer[XBEE_RX_BUFFER_LENGTH];
+    //the frame data is parsed straight into the caller's buffer
+    uint8_t* frame_data = &buffer[XBEE_RX_FRAME_OFFSET];
 
     //if we're currently parsing the packet, this indicates what position in the buffer
     static uint16_t rx_packet_pos;
@@ -281,59 +393,63 @@ uint8_t* parseUplinkPacket(uint16_t* length)
     //current calculated checksum of the in-progress packet
     static uint8_t checksum;
 
-    uint8_t byte; //bytes after the start delimiter
-
-    //if we're parsing an existing packet. This block will wait for the start delimiter to be received
-    if (parsing_rx_packet == false) {
-        if (getRXSize(XBEE_UART_INTERFACE) == 0) {
-            return NULL;
-        }
-
-        byte = readRXData(XBEE_UART_INTERFACE);
-
-        //wait until we get the start delimiter
-        while (byte != XBEE_START_DELIMITER) {
-            if (getRXSize(XBEE_UART_INTERFACE) != 0) {
-                byte = readRXData(XBEE_UART_INTERFACE);
-            } else {
-                return NULL;
-            }
-        }
-
-        //here we have the start delimeter. subsequent packets are now part of a single API frame
-        parsing_rx_packet = true;
-        rx_packet_pos = 1;
-        rx_packet_length = 0;
-    }
-
-    if (parsing_rx_packet == true) {
-        while (getRXSize(XBEE_UART_INTERFACE) != 0) {
-            byte = readRXData(XBEE_UART_INTERFACE);
-
-            if (rx_packet_pos == 1) {
+    uint8_t* span; //received bytes, straight out of the UART buffer
+    uint16_t span_length;
+    uint16_t i;
+    uint16_t copy_length;
+    uint8_t byte;
+
+    while ((span_length = peekRXSpan(XBEE_UART_INTERFACE, &span)) != 0) {
+        i = 0;
+        while (i < span_length) {
+            byte = span[i];
+
+            if (parsing_rx_packet == false) {
+                //wait until we get the start delimiter. Subsequent bytes are part of a single API frame
+                if (byte == XBEE_START_DELIMITER) {
+                    parsing_rx_packet = true;
+                    rx_packet_pos = 1;
+                    rx_packet_length = 0;
+                }
+                i++;
+            } else if (rx_packet_pos == 1) {
                 //first byte is MSB of length of upcoming packet
                 rx_packet_length = ((uint16_t) byte) << 8;
+                rx_packet_pos++;
+                i++;
             } else if (rx_packet_pos == 2) {
                 //second byte is the LSB of the length of the upcoming packet
                 rx_packet_length += (uint16_t) byte;
                 checksum = 0;
-            } else if (rx_packet_pos >= 3) {
-                //copy over the payload (not including checksum). 2 because of the 2 length bytes
-                if (rx_packet_pos <= rx_packet_length + 2) {
-                    receive_buffer[rx_packet_pos - 3] = byte;
-                    checksum += byte;
-                } else { //we've finished copying the payload, check the checksum byte
-                    if ((checksum + byte) != 0xFF) {
-                        parsing_rx_packet = false;
-                        return NULL;
-                    } else {
-                        parsing_rx_packet = false;
-                        return parseReceivedApiFrame(receive_buffer, rx_packet_length, length);
-                    }
+                rx_packet_pos++;
+                i++;
+                if (rx_packet_length > RADIO_UPLINK_BUFFER_LENGTH - XBEE_RX_FRAME_OFFSET) {
+                    //too long for the buffer, and not something we'd send ourselves
+                    parsing_rx_packet = false;
+                    consumeRXSpan(XBEE_UART_INTERFACE, i);
+                    return NULL;
+                }
+            } else if (rx_packet_pos <= rx_packet_length + 2) {
+                //copy over as much of the payload (not including checksum) as there is in this span. 2 because of the 2 length bytes
+                copy_length = rx_packet_length + 3 - rx_packet_pos;
+                if (copy_length > span_length - i) {
+                    copy_length = span_length - i;
+                }
+                memcpy(&frame_data[rx_packet_pos - 3], &span[i], copy_length);
+                rx_packet_pos += copy_length;
+                while (copy_length-- != 0) {
+                    checksum += span[i++];
                 }
+            } else { //we've finished copying the payload, check the checksum byte
+                parsing_rx_packet = false;
+                consumeRXSpan(XBEE_UART_INTERFACE, i + 1);
+                if ((checksum + byte) != 0xFF) {
+                    return NULL;
+                }
+                return parseReceivedApiFrame(frame_data, rx_packet_length, length);
             }
-            rx_packet_pos++;
         }
+        consumeRXSpan(XBEE_UART_INTERFACE, span_length);
     }
     return NULL;
 }
@@ -342,46 +458,36 @@ uint8_t* parseUplinkPacket(uint16_t* length)
  * Trigger a read of an at command
  * @param at_command_id 2 character id of the at command
  */
-static bool queueATCommand(char* at_command_id)
+static void queueATCommand(char* at_command_id)
 {
-    XbeeApiFrame* to_send = malloc(sizeof(XbeeApiFrame));
+    //an AT command request will take 3 bytes after the frame type
+    XbeePoolFrame* to_send = allocateApiFrame(XBEE_FRAME_TYPE_AT_COMMAND, XBEE_AT_COMMAND_LENGTH, &at_command_class);
+    uint8_t* data;
 
     if (to_send == NULL) {
-        return false;
-    }
-
-    //an AT command request will take 3 bytes after the frame type dedicated
-    to_send->data = malloc(3);
-
-    if (to_send->data == NULL) {
-        free(to_send);
-        return false;
+        return;
     }
-
-    to_send->frame_type = XBEE_FRAME_TYPE_AT_COMMAND;
-    to_send->data_length = 3;
+    data = &to_send->frame.bytes[XBEE_API_FRAME_HEADER_LENGTH];
 
     //set the frame id so that we get a response with the data
-    to_send->data[0] = current_frame_id;
-    current_frame_id++;
+    data[0] = nextFrameId(&current_frame_id, XBEE_AT_FRAME_ID_FIRST, XBEE_AT_FRAME_ID_LAST);
 
     //the 2 character code of the at command we're sending
-    to_send->data[1] = at_command_id[0];
-    to_send->data[2] = at_command_id[1];
+    data[1] = at_command_id[0];
+    data[2] = at_command_id[1];
 
-    queueApiFrame(to_send);
-    return true;
+    queueApiFrame(to_send, XBEE_FRAME_TYPE_AT_COMMAND + data[0] + data[1] + data[2]);
 }
 
 /**
- * Parses the payload of a received API frame. If it is a is a RX response, this
- * method will copy over the received data into a dynamic array and return
- * a pointer to it. Otherwise if its an AT response or anything else, will return
+ * Parses the payload of a received API frame. If it is a RX response, this
+ * method will return a pointer to the received data, which was parsed in place
+ * into the caller's buffer. Otherwise if its an AT response or anything else, will return
  * NULL and perform necessary actions if applicable
  * @param data Frame specific data. Comes after the length
  * @param data_length length of the frame specific data, not including the checksum byte
  * @param length The length of the payload if this was a RX frame
- * @return An array representing received TX data, or NULL otherwise
+ * @return A pointer to the received RF data within the frame, or NULL otherwise
  */
 static uint8_t* parseReceivedApiFrame(uint8_t* data, uint16_t data_length, uint16_t* length)
 {
@@ -391,25 +497,18 @@ static uint8_t* parseReceivedApiFrame(uint8_t* data, uint16_t data_length, uint1
     case XBEE_FRAME_TYPE_AT_RESPONSE:
         parseReceivedATResponse(data, data_length);
         return NULL;
+    case XBEE_FRAME_TYPE_TRANSMIT_STATUS:
+        parseReceivedTransmitStatus(data, data_length);
+        return NULL;
     case XBEE_FRAME_TYPE_RX_INDICATOR:
         //From the xbee api docs, we not care about the sender address in our case or what the receive options are
         //so we'll just skip to the payload ,since thats the only thing we really care about
         //according to the docs, the actual RF packet will start at 13th byte of the api frame payload
-        data_length = data_length - 12;
-        uint8_t* copied = malloc(data_length);
-
-        //if we couldnt allocate the data, discard the packet
-        if (copied == NULL) {
+        if (data_length <= XBEE_RX_INDICATOR_HEADER_LENGTH) {
             return NULL;
         }
-
-        uint16_t i;
-        for (i = 0; i < data_length; i++) {
-            copied[i] = data[i + 12];
-        }
-
-        *length = data_length;
-        return copied;
+        *length = data_length - XBEE_RX_INDICATOR_HEADER_LENGTH;
+        return &data[XBEE_RX_INDICATOR_HEADER_LENGTH];
     default:
         return NULL;
     }
@@ -470,6 +569,7 @@ static void parseReceivedATResponse(uint8_t* data, uint16_t data_length)
             receiver_address += (uint64_t) data[6] << 48;
             receiver_address += (uint64_t) data[7] << 40;
             receiver_address += (uint64_t) data[8] << 32;
+            buildTXRequestHeader();
         } else if (strcmp(at_command, XBEE_AT_COMMAND_DESTINATION_ADDRESS_LOW) == 0) {
             //command data should be 8 bytes. Thus total data length should be 13
             if (data_length < 9) {
@@ -481,6 +581,7 @@ static void parseReceivedATResponse(uint8_t* data, uint16_t data_length)
             receiver_address += (uint64_t) data[6] << 16;
             receiver_address += (uint64_t) data[7] << 8;
             receiver_address += (uint64_t) data[8];
+            buildTXRequestHeader();
         }
     }
 
@@ -490,39 +591,320 @@ static void parseReceivedATResponse(uint8_t* data, uint16_t data_length)
 }
 
 /**
- * Pops an element from the xbee frame queue
- * @return Null if nothing to pop
+ * Parses a transmit status frame. Reliable frames that were received are done
+ * with, and the rest are resent after a backoff
+ * @param data Frame specific data (comes after length)
+ * @param data_length Length of frame specific data, not including the checksum
  */
-static XbeeApiFrame* popApiFrame(){
-    XbeeApiFrame* packet = XbeeFrameQueue.head;
-    
-    if (packet == XbeeFrameQueue.tail){
-        XbeeFrameQueue.tail = NULL;
-        XbeeFrameQueue.head = NULL;
-    } else {
-        XbeeFrameQueue.head = packet->next_frame;
+static void parseReceivedTransmitStatus(uint8_t* data, uint16_t data_length)
+{
+    //frame type, frame id, 16 bit address, retry count, delivery status and discovery status
+    uint8_t frame_id;
+    uint8_t i;
+
+    if (data_length < 7) {
+        return;
+    }
+
+    frame_id = data[1];
+    if (frame_id < XBEE_RELIABLE_FRAME_ID_FIRST) {
+        return; //not one of ours
+    }
+    for (i = 0; i < XBEE_RELIABLE_FRAME_COUNT; i++) {
+        if (reliable_frames[i].frame_id == frame_id && reliable_frames[i].awaiting_status) {
+            if (data[5] == XBEE_DELIVERY_STATUS_SUCCESS) {
+                reliable_frames[i].frame_id = 0;
+                reliable_stats.pending--;
+                reliable_stats.delivered++;
+            } else {
+                failReliableAttempt(&reliable_frames[i], getTime());
+            }
+            return;
+        }
+    }
+}
+
+/**
+ * Finds a reliable frame that should be sent now. Frames whose transmit status
+ * didn't come back in time are treated as failed on the way
+ * @return The frame, or NULL if none are due
+ */
+static XbeeReliableFrame* getDueReliableFrame(void)
+{
+    XbeeReliableFrame* due = NULL;
+    uint32_t now = getTime();
+    uint8_t i;
+
+    for (i = 0; i < XBEE_RELIABLE_FRAME_COUNT; i++) {
+        XbeeReliableFrame* reliable = &reliable_frames[i];
+        if (reliable->frame_id == 0) {
+            continue;
+        }
+        if (reliable->awaiting_status && now - reliable->time >= XBEE_RELIABLE_STATUS_TIMEOUT) {
+            failReliableAttempt(reliable, now);
+        }
+        //the frame may have been given up on above
+        if (due == NULL && reliable->frame_id != 0 && !reliable->awaiting_status && (int32_t)(now - reliable->time) >= 0) {
+            due = reliable;
+        }
+    }
+    return due;
+}
+
+/**
+ * Schedules the next attempt of a reliable frame, with twice the backoff of the
+ * last one, or gives up on it if that was the last attempt
+ */
+static void failReliableAttempt(XbeeReliableFrame* reliable, uint32_t now)
+{
+    if (reliable->attempts >= XBEE_RELIABLE_MAX_ATTEMPTS) {
+        reliable->frame_id = 0;
+        reliable_stats.pending--;
+        reliable_stats.failed++;
+        return;
+    }
+    reliable->awaiting_status = false;
+    reliable->time = now + ((uint32_t)XBEE_RELIABLE_BACKOFF << (reliable->attempts - 1));
+}
+
+/**
+ * @param current The next frame id of the range. Moved on to the one after
+ * @param first First frame id of the range. Never 0, since that disables the response
+ * @param last Last frame id of the range
+ * @return The next frame id to request a response with
+ */
+static uint8_t nextFrameId(uint8_t* current, uint8_t first, uint8_t last)
+{
+    uint8_t frame_id = *current;
+
+    *current = frame_id == last ? first : frame_id + 1;
+    return frame_id;
+}
+
+/**
+ * Fills in the start delimiter, length and frame type of an API frame
+ * @param frame
+ * @param frame_type
+ * @param data_length Length of the frame specific data, coming after the frame type
+ */
+static void initApiFrame(XbeeApiFrame* frame, uint8_t frame_type, uint16_t data_length)
+{
+    uint16_t payload_length = data_length + 1; //the length includes the frame type
+
+    frame->bytes[0] = XBEE_START_DELIMITER;
+    frame->bytes[1] = payload_length >> 8; //upper 8 bits of the length
+    frame->bytes[2] = payload_length & 0xFF; //lower 8 bits of the length
+    frame->bytes[3] = frame_type;
+    frame->length = data_length + XBEE_API_FRAME_OVERHEAD;
+}
+
+/**
+ * Takes a slot in the pool for a new API frame, and fills in its start delimiter,
+ * length and frame type. A queued frame that the new one has all the contents of
+ * is replaced in place, unless a barrier frame was queued after it. Otherwise if
+ * the pool is full, the oldest of the lowest
+ * priority frames is dropped to make room, unless they all have a higher priority
+ * than the new one. The frame isn't sent until it's passed to queueApiFrame
+ * @param frame_type
+ * @param data_length Length of the frame specific data, coming after the frame type
+ * @param packet_class
+ * @return The slot, or NULL if there's no room. The frame specific data starts at
+ *      XBEE_API_FRAME_HEADER_LENGTH
+ */
+static XbeePoolFrame* allocateApiFrame(uint8_t frame_type, uint16_t data_length, const RadioPacketClass* packet_class)
+{
+    XbeePoolFrame* slot = NULL;
+    XbeePoolFrame* lowest = NULL; //the frame to drop if the pool is full
+    XbeePoolFrame* barrier = NULL; //frames queued before it can't be replaced
+    uint8_t i;
+
+    if (packet_class->contents != 0) {
+        barrier = getLastBarrierFrame();
     }
-    return packet;
+
+    for (i = 0; i < XBEE_FRAME_POOL_SIZE; i++) {
+        XbeePoolFrame* frame = &frame_pool[i];
+        if (!frame->queued) {
+            if (slot == NULL) {
+                slot = frame;
+            }
+        } else if (packet_class->contents != 0 && frame->contents != 0
+                && (frame->contents & ~packet_class->contents) == 0
+                && (barrier == NULL || isQueuedBefore(barrier, frame))) {
+            //everything in the queued frame is older than what's in the new one. It keeps its place in the queue
+            slot = frame;
+            pool_stats.coalesced++;
+            break;
+        } else if (lowest == NULL || frame->priority < lowest->priority
+                || (frame->priority == lowest->priority && isQueuedBefore(frame, lowest))) {
+            lowest = frame;
+        }
+    }
+
+    if (slot == NULL) {
+        pool_stats.dropped++;
+        if (lowest->priority > packet_class->priority) {
+            return NULL;
+        }
+        slot = lowest;
+        slot->queued = false;
+        pool_stats.depth--;
+    }
+
+    if (!slot->queued) {
+        slot->sequence = next_sequence++;
+        slot->queued = true;
+        pool_stats.depth++;
+        if (pool_stats.depth > pool_stats.max_depth) {
+            pool_stats.max_depth = pool_stats.depth;
+        }
+    }
+    slot->priority = packet_class->priority;
+    slot->contents = packet_class->contents;
+    slot->barrier = packet_class->barrier;
+    slot->expires = packet_class->deadline != 0;
+    if (slot->expires) {
+        slot->deadline = getTime() + packet_class->deadline;
+    }
+
+    initApiFrame(&slot->frame, frame_type, data_length);
+    return slot;
 }
 
 /**
  * Queues an API frame for transmission, however does not send it yet
+ * @param to_queue Slot returned by the last call to allocateApiFrame
+ * @param checksum Sum of the frame type and the frame specific data
+ */
+static void queueApiFrame(XbeePoolFrame* to_queue, uint8_t checksum)
+{
+    finishApiFrame(&to_queue->frame, checksum);
+    pool_stats.queued++;
+}
+
+/**
+ * @return Whether frame a was queued before frame b
+ */
+static bool isQueuedBefore(const XbeePoolFrame* a, const XbeePoolFrame* b)
+{
+    return (int16_t)(a->sequence - b->sequence) < 0;
+}
+
+/**
+ * @return The most recently queued barrier frame in the pool, or NULL if there are none
+ */
+static XbeePoolFrame* getLastBarrierFrame(void)
+{
+    XbeePoolFrame* last = NULL;
+    uint8_t i;
+
+    for (i = 0; i < XBEE_FRAME_POOL_SIZE; i++) {
+        XbeePoolFrame* frame = &frame_pool[i];
+        if (frame->queued && frame->barrier && (last == NULL || isQueuedBefore(last, frame))) {
+            last = frame;
+        }
+    }
+    return last;
+}
+
+/**
+ * Finds the frame in the pool to send next, dropping the ones that have expired
+ * @return The highest priority frame, or the oldest of those. NULL if there are none
+ */
+static XbeePoolFrame* getNextPoolFrame(void)
+{
+    XbeePoolFrame* next = NULL;
+    bool have_time = false;
+    uint32_t now = 0;
+    uint8_t i;
+
+    for (i = 0; i < XBEE_FRAME_POOL_SIZE; i++) {
+        XbeePoolFrame* frame = &frame_pool[i];
+        if (!frame->queued) {
+            continue;
+        }
+        if (frame->expires) {
+            if (!have_time) {
+                now = getTime();
+                have_time = true;
+            }
+            if ((int32_t)(now - frame->deadline) >= 0) {
+                frame->queued = false;
+                pool_stats.depth--;
+                pool_stats.expired++;
+                continue;
+            }
+        }
+        if (next == NULL || frame->priority > next->priority
+                || (frame->priority == next->priority && isQueuedBefore(frame, next))) {
+            next = frame;
+        }
+    }
+    return next;
+}
+
+/**
+ * Fills in the checksum of an API frame
  * @param frame
+ * @param checksum Sum of the frame type and the frame specific data
  */
-static void queueApiFrame(XbeeApiFrame* frame)
+static void finishApiFrame(XbeeApiFrame* frame, uint8_t checksum)
 {
-    if (frame == NULL){
-        return;
+    frame->bytes[frame->length - 1] = 0xFF - checksum;
+}
+
+/**
+ * Copies the TX request header and the payload into the frame specific data of
+ * a TX request
+ * @param frame Frame with room for the payload
+ * @param frame_id 0, or the frame id to report the transmit status with
+ * @return Sum of the frame type and the frame specific data
+ */
+static uint8_t buildTXRequest(XbeeApiFrame* frame, uint8_t frame_id, uint8_t* data, uint16_t data_length)
+{
+    uint16_t i;
+    uint8_t checksum = tx_request_header_checksum + frame_id;
+    uint8_t* payload = &frame->bytes[XBEE_API_FRAME_HEADER_LENGTH + XBEE_TX_REQUEST_HEADER_LENGTH];
+
+    memcpy(&frame->bytes[XBEE_API_FRAME_HEADER_LENGTH], tx_request_header, XBEE_TX_REQUEST_HEADER_LENGTH);
+    frame->bytes[XBEE_API_FRAME_HEADER_LENGTH] = frame_id;
+
+    //finally copy the payload data
+    for (i = 0; i < data_length; i++) {
+        payload[i] = data[i];
+        checksum += data[i];
     }
-    
-    frame->next_frame = NULL;
-    
-    if (XbeeFrameQueue.head == NULL){
-        XbeeFrameQueue.head = frame;
-        XbeeFrameQueue.tail = frame;
-    } else {
-        XbeeFrameQueue.tail->next_frame = frame;
-        XbeeFrameQueue.tail = frame;
+    return checksum;
+}
+
+/**
+ * Builds the header of TX requests to the current receiver address
+ */
+static void buildTXRequestHeader(void)
+{
+    int i;
+
+    //Frame id. Set per frame, depending on whether we need its transmit status
+    tx_request_header[0] = 0;
+
+    //copy the destination address to the tx frame
+    for (i = 7; i >= 0; i--) {
+        tx_request_header[1 + (7 - i)] = (receiver_address >> i * 8) & 0xFF;
+    }
+
+    //reserved values
+    tx_request_header[9] = 0xFF;
+    tx_request_header[10] = 0xFE;
+
+    //set the broadcast radius of this TX frame
+    tx_request_header[11] = XBEE_BROADCAST_RADIUS;
+
+    //transmit options. 0x00 will use the saved transmit options parameter (the one saved in XCTU)
+    tx_request_header[12] = 0x00;
+
+    tx_request_header_checksum = XBEE_FRAME_TYPE_TX_REQUEST;
+    for (i = 0; i < XBEE_TX_REQUEST_HEADER_LENGTH; i++) {
+        tx_request_header_checksum += tx_request_header[i];
     }
 }
 
@@ -9,6 +9,8 @@
 #ifndef RADIOXBEE_H
 #define	RADIOXBEE_H
 
+#include <stdint.h>
+
 /**
  * Which baud rate to communicate the xbee with
  */
@@ -20,14 +22,51 @@
 #define XBEE_UART_INTERFACE 2
 
 /**
- * Initial size of the rx and tx uart buffer. Will not go smaller than this value
+ * Size of the rx and tx uart buffer. Has to be a power of 2
+ */
+#define XBEE_UART_BUFFER_SIZE 512
+
+/**
+ * Number of API frames that can be queued for transmission. When the pool is full,
+ * the oldest of the lowest priority frames is dropped to make room for the new one
+ */
+#define XBEE_FRAME_POOL_SIZE 8
+
+/**
+ * Number of reliable frames that can be waiting to be received at once
+ */
+#define XBEE_RELIABLE_FRAME_COUNT 4
+
+/**
+ * How many times a reliable frame is sent before giving up on it
+ */
+#define XBEE_RELIABLE_MAX_ATTEMPTS 4
+
+/**
+ * Time in ms before a failed reliable frame is resent. Doubles with every failed
+ * attempt, so that a congested link isn't flooded with retransmissions
+ */
+#define XBEE_RELIABLE_BACKOFF 50
+
+/**
+ * Time in ms to wait for the transmit status of a reliable frame. If there's none
+ * by then, the attempt counts as failed
+ */
+#define XBEE_RELIABLE_STATUS_TIMEOUT 500
+
+/**
+ * Frame ids are split between AT commands and reliable TX requests, so that the
+ * response to one can never be taken for the other's. 0 requests no response
  */
-#define XBEE_UART_BUFFER_INITIAL_SIZE 200
+#define XBEE_AT_FRAME_ID_FIRST 0x01
+#define XBEE_AT_FRAME_ID_LAST 0x7F
+#define XBEE_RELIABLE_FRAME_ID_FIRST 0x80
+#define XBEE_RELIABLE_FRAME_ID_LAST 0xFF
 
 /**
- * Max size of the rx and tx uart buffer
+ * Largest payload that can be sent in a single TX request
  */
-#define XBEE_UART_BUFFER_MAX_SIZE 400
+#define XBEE_MAX_PAYLOAD_LENGTH 100
 
 /**
  * Sets maximum number of hops a broadcast transmission can occur. If set to 0, 
@@ -55,6 +94,17 @@
  */
 #define XBEE_FRAME_TYPE_TX_REQUEST 0x10
 
+/**
+ * API id returned from the xbee after it's done sending a TX request with a non zero
+ * frame id, saying whether it was received
+ */
+#define XBEE_FRAME_TYPE_TRANSMIT_STATUS 0x8B
+
+/**
+ * Delivery status of a transmit status frame when the TX request was received
+ */
+#define XBEE_DELIVERY_STATUS_SUCCESS 0
+
 /**
  * API id returned from the xbee as a response from an AT command
  */
@@ -93,5 +143,43 @@
 #define XBEE_AT_COMMAND_STATUS_OK 0
 #define XBEE_AT_COMMAND_STATUS_ERROR 1
 
+/**
+ * Statistics of the API frame pool since startup
+ */
+typedef struct {
+    uint16_t queued; //frames queued for transmission
+    uint16_t sent; //frames handed to the UART
+    uint16_t dropped; //frames dropped because the pool was full, queued or new
+    uint16_t expired; //frames dropped because they weren't sent by their deadline
+    uint16_t coalesced; //queued frames replaced in place by newer ones
+    uint16_t rejected; //payloads that were too long to fit in a frame
+    uint8_t depth; //frames currently queued
+    uint8_t max_depth; //most frames that were queued at once
+} XbeeFramePoolStats;
+
+/**
+ * Delivery statistics of the reliable frames since startup. Best effort frames are
+ * never acknowledged, so the frame pool statistics are all there is for them
+ */
+typedef struct {
+    uint16_t queued; //frames queued with queueReliableDownlinkPacket()
+    uint16_t sent; //transmissions handed to the UART, including retransmissions
+    uint16_t delivered; //frames the xbee reported as received
+    uint16_t retransmitted; //transmissions after the first of a frame
+    uint16_t failed; //frames given up on after XBEE_RELIABLE_MAX_ATTEMPTS
+    uint16_t rejected; //payloads that were too long, or came while every slot was in use
+    uint8_t pending; //frames currently waiting to be received
+} XbeeReliableStats;
+
+/**
+ * @return Statistics of the API frame pool since startup
+ */
+const XbeeFramePoolStats* getXbeeFramePoolStats(void);
+
+/**
+ * @return Delivery statistics of the reliable frames since startup
+ */
+const XbeeReliableStats* getXbeeReliableStats(void);
+
 #endif
 
@@ -13,6 +13,8 @@
 #include "StatusManager.h"
 #include "../Common/Interfaces/InterchipDMA.h"
 #include "../Common/Utilities/Logger.h"
+#include "Mixer.h"
+#include "LatencyTrace.h"
 
 #if VEHICLE_TYPE == FIXED_WING
 
@@ -27,6 +29,44 @@ int input_GS_Flap;
 float adverse_yaw_mix = 0.5; // Roll rate -> yaw rate scaling (to counter adverse yaw)
 float roll_turn_mix = 1.0; // Roll angle -> pitch rate scaling (for banked turns) 
 
+/*
+ * Mixer table for the tail type. Weights are in the order roll, pitch, yaw, throttle.
+ * The tail servos are mirrored, so the same signal deflects them in opposite directions
+ */
+#define OUTPUT(channel, min, max, roll, pitch, yaw, throttle) {channel, min, max, {MIX(roll), MIX(pitch), MIX(yaw), MIX(throttle)}}
+
+#if TAIL_TYPE == STANDARD_TAIL
+static const MixerOutput mixer_outputs[] = {
+    OUTPUT(THROTTLE_OUT_CHANNEL, MIN_PWM, MAX_PWM, 0, 0, 0, 1),
+    OUTPUT(ROLL_OUT_CHANNEL, MIN_ROLL_PWM, MAX_ROLL_PWM, 1, 0, 0, 0),
+    OUTPUT(PITCH_OUT_CHANNEL, MIN_L_TAIL_PWM, MAX_L_TAIL_PWM, 0, 1, 0, 0),
+    OUTPUT(YAW_OUT_CHANNEL, MIN_R_TAIL_PWM, MAX_R_TAIL_PWM, 0, 0, 1, 0)
+};
+#elif TAIL_TYPE == V_TAIL
+// Same as the inverse V-tail, except that the rudder moves the other way
+static const MixerOutput mixer_outputs[] = {
+    OUTPUT(THROTTLE_OUT_CHANNEL, MIN_PWM, MAX_PWM, 0, 0, 0, 1),
+    OUTPUT(ROLL_OUT_CHANNEL, MIN_ROLL_PWM, MAX_ROLL_PWM, 1, 0, 0, 0),
+    OUTPUT(L_TAIL_OUT_CHANNEL, MIN_L_TAIL_PWM, MAX_L_TAIL_PWM, 0, -ELEVATOR_PROPORTION, -RUDDER_PROPORTION, 0),
+    OUTPUT(R_TAIL_OUT_CHANNEL, MIN_R_TAIL_PWM, MAX_R_TAIL_PWM, 0, ELEVATOR_PROPORTION, -RUDDER_PROPORTION, 0)
+};
+#elif TAIL_TYPE == INV_V_TAIL
+static const MixerOutput mixer_outputs[] = {
+    OUTPUT(THROTTLE_OUT_CHANNEL, MIN_PWM, MAX_PWM, 0, 0, 0, 1),
+    OUTPUT(ROLL_OUT_CHANNEL, MIN_ROLL_PWM, MAX_ROLL_PWM, 1, 0, 0, 0),
+    OUTPUT(L_TAIL_OUT_CHANNEL, MIN_L_TAIL_PWM, MAX_L_TAIL_PWM, 0, -ELEVATOR_PROPORTION, RUDDER_PROPORTION, 0),
+    OUTPUT(R_TAIL_OUT_CHANNEL, MIN_R_TAIL_PWM, MAX_R_TAIL_PWM, 0, ELEVATOR_PROPORTION, RUDDER_PROPORTION, 0)
+};
+#elif TAIL_TYPE == FLYING_WING
+static const MixerOutput mixer_outputs[] = {
+    OUTPUT(THROTTLE_OUT_CHANNEL, MIN_PWM, MAX_PWM, 0, 0, 0, 1),
+    OUTPUT(L_ELEVON_OUT_CHANNEL, MIN_ROLL_PWM, MAX_ROLL_PWM, ELEVON_ROLL_PROPORTION, -ELEVON_PITCH_PROPORTION, 0, 0),
+    OUTPUT(R_ELEVON_OUT_CHANNEL, MIN_ROLL_PWM, MAX_ROLL_PWM, ELEVON_ROLL_PROPORTION, ELEVON_PITCH_PROPORTION, 0, 0)
+};
+#endif
+
+static const MixerTable mixer = {mixer_outputs, sizeof(mixer_outputs) / sizeof(MixerOutput), false};
+
 void initialization(){
     setPWM(THROTTLE_OUT_CHANNEL, MIN_PWM);
 
@@ -47,9 +87,14 @@ void armVehicle(){
     resetHeartbeatTimer();
 
     setPWM(THROTTLE_OUT_CHANNEL, MIN_PWM);
+#if TAIL_TYPE == FLYING_WING
+    setPWM(L_ELEVON_OUT_CHANNEL, 0);
+    setPWM(R_ELEVON_OUT_CHANNEL, 0);
+#else
     setPWM(ROLL_OUT_CHANNEL, 0);
     setPWM(L_TAIL_OUT_CHANNEL, 0);
     setPWM(R_TAIL_OUT_CHANNEL, 0);
+#endif
     setPWM(FLAP_OUT_CHANNEL, MIN_PWM);
 
 }
@@ -72,7 +117,7 @@ void inputMixing(int* channelIn, int* rollRate, int* pitchRate, int* throttle, i
         *throttle = channelIn[THROTTLE_IN_CHANNEL - 1];
     }
 
-#if TAIL_TYPE == STANDARD_TAIL
+#if TAIL_TYPE == STANDARD_TAIL || TAIL_TYPE == FLYING_WING
     if (getControlValue(ROLL_CONTROL_SOURCE) == RC_SOURCE){
         *rollRate = -channelIn[ROLL_IN_CHANNEL - 1];
     }
@@ -82,7 +127,14 @@ void inputMixing(int* channelIn, int* rollRate, int* pitchRate, int* throttle, i
     *yawRate = -channelIn[YAW_IN_CHANNEL - 1];
 
 #elif TAIL_TYPE == V_TAIL
-    
+    if (getControlValue(ROLL_CONTROL_SOURCE) == RC_SOURCE) {
+        *rollRate = channelIn[ROLL_IN_CHANNEL - 1];
+    }
+    if (getControlValue(PITCH_CONTROL_SOURCE) == RC_SOURCE){
+        *pitchRate = (channelIn[R_TAIL_IN_CHANNEL - 1] - channelIn[L_TAIL_IN_CHANNEL - 1]) / (2 * ELEVATOR_PROPORTION);
+    }
+    *yawRate = -(channelIn[L_TAIL_IN_CHANNEL - 1] + channelIn[R_TAIL_IN_CHANNEL - 1] ) / (2 * RUDDER_PROPORTION);
+
 #elif TAIL_TYPE == INV_V_TAIL
     if (getControlValue(ROLL_CONTROL_SOURCE) == RC_SOURCE) {
         *rollRate = channelIn[ROLL_IN_CHANNEL - 1];
@@ -116,34 +168,20 @@ void inputMixing(int* channelIn, int* rollRate, int* pitchRate, int* throttle, i
  */
 
 void outputMixing(int* channelOut, int* control_Roll, int* control_Pitch, int* control_Throttle, int* control_Yaw){
-    *control_Yaw += *control_Roll * adverse_yaw_mix; // mix roll rate into rudder to counter adverse yaw
-
-    //code for different tail configurations
-    #if TAIL_TYPE == STANDARD_TAIL  //is a normal t-tail
-    channelOut[PITCH_OUT_CHANNEL - 1] = (*control_Pitch);
-    channelOut[YAW_OUT_CHANNEL - 1] = (*control_Yaw);
+    int inputs[MIXER_INPUTS];
 
-    #elif TAIL_TYPE == V_TAIL    //V-tail
-    // TODO
+    *control_Yaw += *control_Roll * adverse_yaw_mix; // mix roll rate into rudder to counter adverse yaw
 
-    #elif TAIL_TYPE == INV_V_TAIL   //Inverse V-Tail
-    channelOut[L_TAIL_OUT_CHANNEL - 1] =  (*control_Yaw) * RUDDER_PROPORTION - (*control_Pitch) * ELEVATOR_PROPORTION ; //Tail Output Left
-    channelOut[R_TAIL_OUT_CHANNEL - 1] =  (*control_Yaw) * RUDDER_PROPORTION + (*control_Pitch) * ELEVATOR_PROPORTION ; //Tail Output Right
+    inputs[MIXER_ROLL] = *control_Roll;
+    inputs[MIXER_PITCH] = *control_Pitch;
+    inputs[MIXER_YAW] = *control_Yaw;
+    inputs[MIXER_THROTTLE] = *control_Throttle;
 
-    #endif
-    channelOut[ROLL_OUT_CHANNEL - 1] = (*control_Roll);
-    channelOut[THROTTLE_OUT_CHANNEL - 1] = (*control_Throttle);
+    applyMixer(&mixer, inputs, channelOut);
 }
 
 void checkLimits(int* channelOut){
-    constrain(&(channelOut[THROTTLE_OUT_CHANNEL - 1]), MIN_PWM, MAX_PWM);
-
-    constrain(&(channelOut[ROLL_OUT_CHANNEL - 1]), MIN_ROLL_PWM, MAX_ROLL_PWM);
-
-    constrain(&(channelOut[L_TAIL_OUT_CHANNEL - 1]), MIN_L_TAIL_PWM, MAX_L_TAIL_PWM);
-
-    constrain(&(channelOut[R_TAIL_OUT_CHANNEL - 1]), MIN_R_TAIL_PWM, MAX_R_TAIL_PWM);
-
+    //the mixed outputs are already constrained by the mixer
     constrain(&(channelOut[FLAP_OUT_CHANNEL - 1]), MIN_PWM, MAX_PWM);
 }
 
@@ -199,19 +237,28 @@ void lowLevelControl(){
     outputSignal[FLAP_OUT_CHANNEL - 1] = getFlapInput(getControlValue(FLAP_CONTROL_SOURCE)); // don't need to mix the flaps
 
     //Mixing!
+    TRACE_BEGIN(TRACE_MIXING);
     outputMixing(outputSignal, &control_Roll, &control_Pitch, &control_Throttle, &control_Yaw);
+    TRACE_END(TRACE_MIXING);
 
     //Error Checking
     checkLimits(outputSignal);
     //Then Output
 
     if (getProgramStatus() != KILL_MODE) {
+        TRACE_BEGIN(TRACE_PWM_WRITE);
         setAllPWM(outputSignal);
+        TRACE_END(TRACE_PWM_WRITE);
     } else{ //if in kill mode, full deflection of all control surfaces
         setPWM(THROTTLE_OUT_CHANNEL, MIN_PWM);  //Throttle
+#if TAIL_TYPE == FLYING_WING
+        setPWM(L_ELEVON_OUT_CHANNEL, MIN_PWM);
+        setPWM(R_ELEVON_OUT_CHANNEL, MIN_PWM);
+#else
         setPWM(ROLL_OUT_CHANNEL, MIN_PWM);      //Roll
         setPWM(L_TAIL_OUT_CHANNEL, MIN_PWM);    //Pitch
         setPWM(R_TAIL_OUT_CHANNEL, MIN_PWM);    //Yaw
+#endif
     }
 
     //Check for kill mode
@@ -224,8 +271,9 @@ void lowLevelControl(){
         setProgramStatus(KILL_MODE);
     }
 
-    if (getHeartbeatStatus() == CONNECTION_WARN && getProgramStatus() != KILL_MODE_WARNING && getProgramStatus() != KILL_MODE){
-        interchip_send_buffer.am_data.command = PM_RETURN_HOME;
+    //waits for the interchip link, so that the return home command isn't lost
+    if (getHeartbeatStatus() == CONNECTION_WARN && getProgramStatus() != KILL_MODE_WARNING && getProgramStatus() != KILL_MODE && isInterchipSendReady()){
+        INTERCHIP_SEND(am_data.command, PM_RETURN_HOME);
         sendInterchipData();
         info("Setting kill mode warning due to HEARTBEAT");
         setProgramStatus(KILL_MODE_WARNING);
@@ -36,9 +36,13 @@ void lowLevelControl();
 #define RUDDER_PROPORTION 0.75
 #define ELEVATOR_PROPORTION 0.75
 
+#define ELEVON_ROLL_PROPORTION 0.75
+#define ELEVON_PITCH_PROPORTION 0.75
+
 #define STANDARD_TAIL 0
 #define V_TAIL 1
 #define INV_V_TAIL 2
+#define FLYING_WING 3 //elevons, no tail
 
 // Set airplane tail type
 #define TAIL_TYPE INV_V_TAIL 
@@ -77,6 +81,19 @@ void lowLevelControl();
 #define R_TAIL_OUT_CHANNEL 4
 #define FLAP_OUT_CHANNEL 5
 
+#elif TAIL_TYPE == FLYING_WING
+// Inputs
+#define THROTTLE_IN_CHANNEL 1
+#define ROLL_IN_CHANNEL 2
+#define PITCH_IN_CHANNEL 3
+#define YAW_IN_CHANNEL 4
+
+// Outputs
+#define THROTTLE_OUT_CHANNEL 1
+#define L_ELEVON_OUT_CHANNEL 2
+#define R_ELEVON_OUT_CHANNEL 3
+#define FLAP_OUT_CHANNEL 5
+
 #endif
 
 #endif	/* FIXEDWING_H */
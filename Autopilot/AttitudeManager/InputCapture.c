@@ -6,12 +6,19 @@
 #include <p33Fxxxx.h>
 #include "InputCapture.h"
 #include "../Common/Clock/Timer.h"
+#include "../Common/Utilities/FixedPoint.h"
 
 /**
  * Number of timer ticks that indicate a sync pulse
  */
 #define PPM_SYNC_TICKS (int)(((float)PPM_MIN_SYNC_TIME/1000)*T2_TICKS_TO_MSEC)
 
+/**
+ * Range of a valid PPM pulse in timer ticks
+ */
+#define PPM_MIN_PULSE_TICKS (int)(((float)PPM_MIN_PULSE_TIME/1000)*T2_TICKS_TO_MSEC)
+#define PPM_MAX_PULSE_TICKS (int)(((float)PPM_MAX_PULSE_TIME/1000)*T2_TICKS_TO_MSEC)
+
 /**
  * Holds the capture start and end time so that we can compare them later. We can
  * only do 8 with PWM enabled. With PPM, we only need the time of the last edge we catch.
@@ -32,10 +39,19 @@ static char new_data_available[8];
 #endif
 
 /**
- * The actual time between interrupts (in timer2 ticks, not ms)
+ * The actual time between interrupts (in timer2 ticks, not ms). With PPM, frames
+ * are double buffered: the interrupt fills in the back buffer, and once the frame
+ * is complete and valid, calibrates it and swaps it to the front
  */
 #if USE_PPM
-static unsigned int capture_value[PPM_CHANNELS];
+static unsigned int capture_value[2][PPM_CHANNELS];
+static int calibrated_value[2][PPM_CHANNELS];
+static volatile uint8_t front_frame;
+
+/**
+ * Returned by getICValues() when disconnected
+ */
+static unsigned int disconnected_value[PPM_CHANNELS];
 #else
 static unsigned int capture_value[8];
 #endif
@@ -43,19 +59,40 @@ static unsigned int capture_value[8];
 /**
  * Last capture time in ms for all the channels. Used for detecting a channel/pwm
  * disconnect. If using PPM, we only store it as one variable, since we've only got
- * one physical connection
+ * one physical connection, and its only updated on valid frames
  */
 #if USE_PPM
-static unsigned long int ppm_last_capture_time;
+static volatile unsigned long int ppm_last_capture_time;
 #else
 static unsigned long int last_capture_time[8];
 #endif
 
+#if USE_PPM
 /**
- * Used to keep track of the pulse position when PPM is enabled
+ * Used to keep track of the pulse position when PPM is enabled, and whether all
+ * the pulses of the frame so far were valid. The index is PPM_WAIT_SYNC until the
+ * first sync, and PPM_CHANNELS + 1 once a frame has too many pulses
  */
-#if USE_PPM
+#define PPM_WAIT_SYNC 0xFF
 static unsigned char ppm_index;
+static bool ppm_frame_valid;
+
+/**
+ * Calibration of each PPM channel
+ */
+static q16_t ppm_scale_factors[PPM_CHANNELS];
+static int ppm_offsets[PPM_CHANNELS];
+
+/**
+ * New frame flag and the time it was received in us
+ */
+static volatile bool ppm_new_frame;
+static volatile uint64_t ppm_frame_time;
+
+static PPMStats ppm_stats;
+static unsigned long int rate_window_start; //ms
+static uint16_t rate_window_frames;
+static uint16_t window_min_period, window_max_period; //us
 #endif
 
 unsigned int* getICValues(unsigned long int sys_time)
@@ -64,16 +101,13 @@ unsigned int* getICValues(unsigned long int sys_time)
 #if USE_PPM
     /**
      * The actual calculation of comparison values is already done in the ISR
-     * as part of the sync pulse detection, so we just return the values, unless
+     * as part of the sync pulse detection, so we just return the last frame, unless
      * we detected a disconnect
      */
-    if ((sys_time - ppm_last_capture_time) > PWM_ALIVE_THRESHOLD){
-        int i;
-        for (i = 0; i < PPM_CHANNELS; i++){
-            capture_value[i] = 0;
-        }
+    if (!isPPMConnected(sys_time)){
+        return disconnected_value;
     }
-    return capture_value;
+    return capture_value[front_frame];
 #else
     int channel;
     for (channel = 0; channel < 8; channel++) {
@@ -105,6 +139,68 @@ unsigned int* getICValues(unsigned long int sys_time)
 #endif
 }
 
+#if USE_PPM
+void calibratePPMChannel(uint8_t channel, q16_t scale, int offset)
+{
+    if (channel < PPM_CHANNELS) {
+        uint16_t interrupt_enabled = IEC1bits.IC7IE;
+        IEC1bits.IC7IE = 0; //so that a frame isn't calibrated with half of the new values
+        ppm_scale_factors[channel] = scale;
+        ppm_offsets[channel] = offset;
+        IEC1bits.IC7IE = interrupt_enabled;
+    }
+}
+
+bool checkNewPPMFrame(uint64_t* frame_time)
+{
+    bool new_frame;
+    uint16_t interrupt_enabled = IEC1bits.IC7IE;
+    IEC1bits.IC7IE = 0;
+    new_frame = ppm_new_frame;
+    ppm_new_frame = false;
+    if (frame_time) {
+        *frame_time = ppm_frame_time;
+    }
+    IEC1bits.IC7IE = interrupt_enabled;
+    return new_frame;
+}
+
+int* getPPMFrame(void)
+{
+    return calibrated_value[front_frame];
+}
+
+bool isPPMConnected(unsigned long int sys_time)
+{
+    return (sys_time - ppm_last_capture_time) <= PWM_ALIVE_THRESHOLD;
+}
+#endif
+
+void getPPMStats(PPMStats* stats)
+{
+#if USE_PPM
+    uint16_t interrupt_enabled = IEC1bits.IC7IE;
+    IEC1bits.IC7IE = 0;
+    *stats = ppm_stats;
+    uint32_t age = getTime() - ppm_last_capture_time;
+    IEC1bits.IC7IE = interrupt_enabled;
+
+    if (ppm_last_capture_time == 0 || age > UINT16_MAX) {
+        stats->last_frame_age = UINT16_MAX;
+    } else {
+        stats->last_frame_age = (uint16_t)age;
+    }
+
+    //the rate is only updated when frames come in, so it goes stale if the receiver dies
+    if (age > 1000) {
+        stats->frame_rate = 0;
+    }
+#else
+    PPMStats empty = {0};
+    *stats = empty;
+#endif
+}
+
 /**
  * Initializes interrupts for the specified channels. Sets Timer2
  * as the time base, and configures it so that interrupts occur on every rising and
@@ -127,7 +223,9 @@ void initIC(unsigned char initIC)
     IFS1bits.IC7IF = 0; // Clear IC7 Interrupt Status Flag
     IEC1bits.IC7IE = 1; // Enable IC7 interrupt
 
-    ppm_index = 0;
+    ppm_index = PPM_WAIT_SYNC;
+    ppm_frame_valid = false;
+    window_min_period = UINT16_MAX;
 #else
 
     if (initIC & 0b01) {
@@ -212,16 +310,61 @@ void initIC(unsigned char initIC)
 }
 
 #if USE_PPM
+/**
+ * Calibrates a complete frame in the back buffer, swaps it to the front, and
+ * updates the frame flag and stats. Called from the PPM interrupt
+ * @param back_frame Index of the back buffer
+ */
+static void completePPMFrame(uint8_t back_frame)
+{
+    uint8_t i;
+    uint64_t now = getTimeUs();
+    uint32_t now_ms = getTime();
+
+    for (i = 0; i < PPM_CHANNELS; i++) {
+        calibrated_value[back_frame][i] = q16ScaleInt((int)capture_value[back_frame][i] - ppm_offsets[i], ppm_scale_factors[i]);
+    }
+    front_frame = back_frame;
+
+    if (ppm_stats.good_frames != 0) {
+        uint32_t period = now - ppm_frame_time;
+        ppm_stats.frame_period = period > UINT16_MAX ? UINT16_MAX : period;
+        if (ppm_stats.frame_period < window_min_period) {
+            window_min_period = ppm_stats.frame_period;
+        }
+        if (ppm_stats.frame_period > window_max_period) {
+            window_max_period = ppm_stats.frame_period;
+        }
+    }
+    if (now_ms - rate_window_start >= 1000) {
+        ppm_stats.frame_rate = rate_window_frames;
+        ppm_stats.frame_jitter = window_max_period > window_min_period ? window_max_period - window_min_period : 0;
+        rate_window_frames = 0;
+        rate_window_start = now_ms;
+        window_min_period = UINT16_MAX;
+        window_max_period = 0;
+    }
+    rate_window_frames++;
+    ppm_stats.good_frames++;
+
+    ppm_frame_time = now;
+    ppm_new_frame = true;
+    ppm_last_capture_time = now_ms; //for detecting disconnect
+}
+
 /**
 * PPM Interrupt Service routine for Channel 7 for when PPM is enabled. Will trigger
 * on rising or falling edge on channel 7 (depending on PPM_INVERTED). Calculates the time
 * between the last edge time and the current edge to determine if a PPM sync occurred,
-* used to keep track of the positions of the channels.
+* used to keep track of the positions of the channels. A frame is used as soon as its
+* PPM_CHANNELS-th pulse is captured, if all of its pulses were valid, rather than waiting
+* for the next sync. Pulses past PPM_CHANNELS are counted as a length error at the sync.
 */
 void __attribute__((__interrupt__, no_auto_psv)) _IC7Interrupt(void)
 {
     unsigned int this_edge = IC7BUF;
     unsigned int time_diff;
+    uint8_t back_frame = front_frame ^ 1;
 
     // Check for timer overflow
     if (this_edge > last_edge) {
@@ -229,18 +372,29 @@ void __attribute__((__interrupt__, no_auto_psv)) _IC7Interrupt(void)
     } else {
         time_diff = (PR2 - last_edge) + this_edge;
     }
+    last_edge = this_edge;
+
     if (time_diff >= PPM_SYNC_TICKS){ //if we just captured the first edge of a new frame
+        if (ppm_index != PPM_CHANNELS && ppm_index != PPM_WAIT_SYNC) {
+            ppm_stats.length_errors++;
+        }
         ppm_index = 0;
-    } else {
-        ppm_index = (ppm_index + 1) % (PPM_CHANNELS + 1); // index should reset, but just in case
-    }
-    if (ppm_index != 0) { // the first edge doesn't give us any data
-        capture_value[ppm_index - 1] = time_diff;
-    }
-
-    last_edge = this_edge;
+        ppm_frame_valid = true;
+    } else if (ppm_index < PPM_CHANNELS) {
+        if (time_diff < PPM_MIN_PULSE_TICKS || time_diff > PPM_MAX_PULSE_TICKS) {
+            ppm_frame_valid = false;
+        }
+        capture_value[back_frame][ppm_index] = time_diff;
+        ppm_index++;
 
-    ppm_last_capture_time = getTime(); //for detecting disconnect
+        if (ppm_index == PPM_CHANNELS && ppm_frame_valid) {
+            completePPMFrame(back_frame);
+        } else if (ppm_index == PPM_CHANNELS) {
+            ppm_stats.pulse_errors++;
+        }
+    } else if (ppm_index != PPM_WAIT_SYNC) {
+        ppm_index = PPM_CHANNELS + 1; //too many pulses. Counted at the next sync
+    }
 
     /**
      * Clear the input compare buffer to avoid any issues when hot swapping PWM cables.
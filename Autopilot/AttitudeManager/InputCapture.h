@@ -12,6 +12,10 @@
 #ifndef INPUTCAPTURE_H
 #define	INPUTCAPTURE_H
 
+#include <stdint.h>
+#include <stdbool.h>
+#include "../Common/Utilities/FixedPoint.h"
+
 /**
 * Use this setting to disable or enable PPM. PPM is currently only configured
 * for channel 7. If disabled, regular PWM via the 8 channel inputs is used
@@ -38,12 +42,32 @@
  */
 #define PPM_MIN_SYNC_TIME 3000
 
+/**
+ * Range of a valid PPM pulse (the time between two edges within a frame) in us.
+ * A frame with a pulse outside of this range is discarded
+ */
+#define PPM_MIN_PULSE_TIME 700
+#define PPM_MAX_PULSE_TIME 2300
+
 /**
  * Number of ms after the last detected edge on a channel before it can be assumed to be
  * disconnected
  */
 #define PWM_ALIVE_THRESHOLD 100
 
+/**
+ * Health and timing of the PPM signal from the RC receiver
+ */
+typedef struct {
+    uint16_t good_frames;
+    uint16_t length_errors; //frames with the wrong number of pulses between two syncs. Frames with too many were still used
+    uint16_t pulse_errors; //frames with a pulse outside of PPM_MIN_PULSE_TIME - PPM_MAX_PULSE_TIME
+    uint16_t frame_rate; //good frames received in the last second
+    uint16_t frame_period; //us between the last two good frames
+    uint16_t frame_jitter; //us, difference between the longest and shortest frame period in the last second
+    uint16_t last_frame_age; //ms since the last good frame
+} PPMStats;
+
 /**
  * Initializes capture configuration of the PWM input channels. Make sure to initialize Timer2
  * before calling this! Disabled channels will not have interrupts called on them, and
@@ -61,4 +85,42 @@ void initIC(unsigned char initIC);
  */
 unsigned int* getICValues(unsigned long int sys_time);
 
+/**
+ * Gets the health and timing of the PPM signal. All zero if PPM is disabled
+ * @param stats Set to the current stats
+ */
+void getPPMStats(PPMStats* stats);
+
+#if USE_PPM
+/**
+ * Sets the calibration applied to a PPM channel. Each frame is calibrated once,
+ * in the interrupt, as soon as it has been received and validated, so that
+ * (ticks - offset) * scale ~= MIN_PWM - MAX_PWM
+ * @param channel Number from 0 to PPM_CHANNELS - 1
+ * @param scale Q16.16 scale factor
+ * @param offset Offset in Timer2 ticks
+ */
+void calibratePPMChannel(uint8_t channel, q16_t scale, int offset);
+
+/**
+ * Checks whether a new valid PPM frame was received since the last call
+ * @param frame_time Set to the time (us) at which the frame was received. May be NULL
+ * @return True if there's a new frame
+ */
+bool checkNewPPMFrame(uint64_t* frame_time);
+
+/**
+ * Gets the calibrated channels of the last valid PPM frame. Frames are double
+ * buffered, so the returned array won't change until the next frame is received
+ * @return Array of size PPM_CHANNELS
+ */
+int* getPPMFrame(void);
+
+/**
+ * @param sys_time The system time in milliseconds
+ * @return Whether a valid PPM frame was received in the last PWM_ALIVE_THRESHOLD ms
+ */
+bool isPPMConnected(unsigned long int sys_time);
+#endif
+
 #endif
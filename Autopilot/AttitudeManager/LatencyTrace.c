@@ -0,0 +1,120 @@
+/**
+ * @file LatencyTrace.c
+ * @author Waterloo Aerial Robotics Group
+ * @date October 18, 2026
+ * @copyright Waterloo Aerial Robotics Group 2017 \n
+ *   https://raw.githubusercontent.com/UWARG/PICpilot/master/LICENCE
+ */
+
+#include "LatencyTrace.h"
+#include "../Common/Clock/Timer.h"
+#include <string.h>
+
+#define TRACE_END_FLAG 0x80
+
+typedef struct {
+    uint8_t point; //section, with TRACE_END_FLAG set for the end
+    uint32_t time; //raw Timer4 timestamp, see getTimeTicks()
+} TracePoint;
+
+static TracePoint trace_buffer[LATENCY_TRACE_BUFFER_SIZE];
+static uint8_t trace_head; //next point to be written
+static uint8_t trace_tail; //next point to be processed
+
+/**
+ * Start time of each section, and which sections have started but not ended
+ */
+static uint32_t begin_time[TRACE_SECTIONS];
+static uint16_t open_sections;
+
+static LatencyStats stats;
+static uint32_t duration_sums[TRACE_SECTIONS];
+
+void recordTracePoint(TraceSection section, bool end)
+{
+    uint8_t next = (trace_head + 1) & (LATENCY_TRACE_BUFFER_SIZE - 1);
+    if (next == trace_tail) {
+        stats.dropped++;
+        return;
+    }
+    trace_buffer[trace_head].point = section | (end ? TRACE_END_FLAG : 0);
+    trace_buffer[trace_head].time = getTimeTicks();
+    trace_head = next;
+}
+
+/**
+ * @param begin Raw Timer4 timestamp at the start of a section
+ * @param end Raw Timer4 timestamp at the end of it
+ * @return us between the two, saturated to 16 bits
+ */
+static uint16_t getDuration(uint32_t begin, uint32_t end)
+{
+    uint16_t ms = (uint16_t)(end >> 16) - (uint16_t)(begin >> 16);
+    int32_t ticks = (int32_t)ms * (T4_TICKS_TO_USEC * 1000L) + (uint16_t)end - (uint16_t)begin;
+    uint32_t duration = ticks / T4_TICKS_TO_USEC;
+
+    return duration > UINT16_MAX ? UINT16_MAX : duration;
+}
+
+/**
+ * Adds the duration of a completed section to its stats
+ * @param section
+ * @param duration us
+ */
+static void addDuration(uint8_t section, uint16_t duration)
+{
+    LatencySectionStats* section_stats = &stats.sections[section];
+    uint16_t limit = LATENCY_HISTOGRAM_MIN_US;
+    uint8_t bin = 0;
+
+    if (section_stats->count == UINT16_MAX) {
+        return; //the mean would be off if the count saturated
+    }
+    if (section_stats->count == 0 || duration < section_stats->min) {
+        section_stats->min = duration;
+    }
+    if (duration > section_stats->max) {
+        section_stats->max = duration;
+    }
+    section_stats->count++;
+    duration_sums[section] += duration;
+
+    while (duration >= limit && bin < LATENCY_HISTOGRAM_BINS - 1) {
+        limit <<= 1;
+        bin++;
+    }
+    section_stats->histogram[bin]++;
+}
+
+void processTracePoints(void)
+{
+    while (trace_tail != trace_head) {
+        TracePoint* point = &trace_buffer[trace_tail];
+        uint8_t section = point->point & ~TRACE_END_FLAG;
+
+        if (!(point->point & TRACE_END_FLAG)) {
+            begin_time[section] = point->time;
+            open_sections |= 1 << section;
+        } else if (open_sections & (1 << section)) { //ends without a beginning are ignored
+            addDuration(section, getDuration(begin_time[section], point->time));
+            open_sections &= ~(1 << section);
+        }
+        trace_tail = (trace_tail + 1) & (LATENCY_TRACE_BUFFER_SIZE - 1);
+    }
+}
+
+void getLatencyStats(LatencyStats* out)
+{
+    uint8_t i;
+    processTracePoints();
+
+    for (i = 0; i < TRACE_SECTIONS; i++) {
+        if (stats.sections[i].count != 0) {
+            stats.sections[i].mean = duration_sums[i] / stats.sections[i].count;
+        }
+    }
+    *out = stats;
+
+    memset(&stats, 0, sizeof(stats));
+    memset(duration_sums, 0, sizeof(duration_sums));
+}
@@ -0,0 +1,100 @@
+/**
+ * @file LatencyTrace.h
+ * @author Waterloo Aerial Robotics Group
+ * @date October 18, 2026
+ * @brief
+ * Lightweight timing of the sections of the control path and the datalink. Each
+ * section is marked with a TRACE_BEGIN() and a TRACE_END(), which only store the
+ * section and a raw Timer4 timestamp in a RAM ring, so that they can be left in the
+ * hot path. processTracePoints() later pairs them up, converts the timestamps to us
+ * and aggregates the durations into the min/max/mean and a histogram for each section,
+ * which are sent down in the latency telemetry packet.
+ *
+ * Trace points must only be recorded from the main loop, not from interrupts.
+ * Sections longer than 65ms are counted as 65ms, since the durations are 16-bit.
+ *
+ * @copyright Waterloo Aerial Robotics Group 2017 \n
+ *   https://raw.githubusercontent.com/UWARG/PICpilot/master/LICENCE
+ */
+
+#ifndef LATENCYTRACE_H
+#define	LATENCYTRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Whether the trace points are recorded (1) or compiled out (0)
+ */
+#define LATENCY_TRACE 1
+
+/**
+ * Number of trace points the ring can hold before processTracePoints() has to
+ * be called. A control step records 12. Must be a power of 2
+ */
+#define LATENCY_TRACE_BUFFER_SIZE 64
+
+/**
+ * Number of histogram bins per section. The first bin holds durations under
+ * LATENCY_HISTOGRAM_MIN_US, each following bin is twice as wide as the last, and
+ * the last bin holds everything longer
+ */
+#define LATENCY_HISTOGRAM_BINS 8
+#define LATENCY_HISTOGRAM_MIN_US 32
+
+/**
+ * The sections that are timed. Don't reorder these, the ground station relies on it
+ */
+typedef enum {
+    TRACE_CONTROL = 0, //from the start of the IMU read to the PWM write, ie the whole control path
+    TRACE_IMU = 1, //IMU read, including the RC input processed while the transfer runs
+    TRACE_HIGH_LEVEL = 2, //high level (angle, heading, altitude) control
+    TRACE_LOW_LEVEL = 3, //low level (rate) control, including mixing and the PWM write
+    TRACE_MIXING = 4,
+    TRACE_PWM_WRITE = 5,
+    TRACE_DATALINK_PARSE = 6, //reading and parsing the uplink from the radio
+    TRACE_DATALINK_SEND = 7, //sending queued downlink packets to the radio
+    TRACE_SECTIONS = 8
+} TraceSection;
+
+typedef struct {
+    uint16_t count; //completed sections
+    uint16_t min, max, mean; //us
+    uint16_t histogram[LATENCY_HISTOGRAM_BINS];
+} LatencySectionStats;
+
+typedef struct {
+    LatencySectionStats sections[TRACE_SECTIONS];
+    uint16_t dropped; //trace points lost because the ring was full
+} LatencyStats;
+
+#if LATENCY_TRACE
+#define TRACE_BEGIN(section) recordTracePoint((section), false)
+#define TRACE_END(section) recordTracePoint((section), true)
+#else
+#define TRACE_BEGIN(section)
+#define TRACE_END(section)
+#endif
+
+/**
+ * Records a trace point in the ring. Use the TRACE_BEGIN and TRACE_END macros
+ * instead of calling this directly, so that they can be compiled out
+ * @param section
+ * @param end Whether this is the end of the section (or the beginning)
+ */
+void recordTracePoint(TraceSection section, bool end);
+
+/**
+ * Pairs up the recorded trace points and adds the durations of the completed
+ * sections to the stats. Should be called once per main loop iteration
+ */
+void processTracePoints(void);
+
+/**
+ * Gets the stats since the last call, and resets them
+ * @param stats Set to the stats. The min, max and mean of sections that didn't
+ *      complete since the last call are 0
+ */
+void getLatencyStats(LatencyStats* stats);
+
+#endif
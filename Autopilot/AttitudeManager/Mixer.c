@@ -0,0 +1,61 @@
+/**
+ * @file Mixer.c
+ * @author Waterloo Aerial Robotics Group
+ * @date October 18, 2026
+ * @copyright Waterloo Aerial Robotics Group 2017 \n
+ *   https://raw.githubusercontent.com/UWARG/PICpilot/master/LICENCE
+ */
+
+#include "Mixer.h"
+#include "PWM.h"
+
+uint8_t applyMixer(const MixerTable* mixer, const int* inputs, int* channelOut){
+    int32_t mixed[NUM_CHANNELS];
+    int32_t shift_min = INT32_MIN; //the range all the outputs can be shifted by and stay within limits
+    int32_t shift_max = INT32_MAX;
+    int32_t shift = 0;
+    uint8_t clipped = 0;
+    uint8_t i;
+
+    for (i = 0; i < mixer->output_count; i++){
+        const MixerOutput* output = &mixer->outputs[i];
+        int32_t sum = (int32_t)output->coefficients[MIXER_ROLL] * inputs[MIXER_ROLL]
+                + (int32_t)output->coefficients[MIXER_PITCH] * inputs[MIXER_PITCH]
+                + (int32_t)output->coefficients[MIXER_YAW] * inputs[MIXER_YAW]
+                + (int32_t)output->coefficients[MIXER_THROTTLE] * inputs[MIXER_THROTTLE];
+
+        mixed[i] = (sum + (1L << (MIXER_FRACTIONAL_BITS - 1))) >> MIXER_FRACTIONAL_BITS;
+
+        if (output->min - mixed[i] > shift_min){
+            shift_min = output->min - mixed[i];
+        }
+        if (output->max - mixed[i] < shift_max){
+            shift_max = output->max - mixed[i];
+        }
+    }
+
+    if (mixer->desaturate){
+        if (shift_min > shift_max){
+            shift = (shift_min + shift_max) / 2;
+        } else if (shift_min > 0){
+            shift = shift_min;
+        } else if (shift_max < 0){
+            shift = shift_max;
+        }
+    }
+
+    for (i = 0; i < mixer->output_count; i++){
+        const MixerOutput* output = &mixer->outputs[i];
+        int32_t value = mixed[i] + shift;
+
+        if (value > output->max){
+            value = output->max;
+            clipped++;
+        } else if (value < output->min){
+            value = output->min;
+            clipped++;
+        }
+        channelOut[output->channel - 1] = value;
+    }
+    return clipped;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file Mixer.h
+ * @author Waterloo Aerial Robotics Group
+ * @date October 18, 2026
+ * @brief
+ * Table-driven output mixing. Each airframe describes its outputs as a constant
+ * table of weights for the roll, pitch, yaw and throttle control signals, along
+ * with the limits of each output. All airframes are then mixed by the same loop,
+ * in integer math.
+ *
+ * The weights are stored as Q2.14 fixed-point values, so that each term is a
+ * single 16x16 bit multiply on the dsPIC.
+ *
+ * @copyright Waterloo Aerial Robotics Group 2017 \n
+ *   https://raw.githubusercontent.com/UWARG/PICpilot/master/LICENCE
+ */
+
+#ifndef MIXER_H
+#define	MIXER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Order of the control signals in the mixer input array and the coefficients
+ */
+#define MIXER_ROLL 0
+#define MIXER_PITCH 1
+#define MIXER_YAW 2
+#define MIXER_THROTTLE 3
+#define MIXER_INPUTS 4
+
+#define MIXER_FRACTIONAL_BITS 14
+
+/**
+ * Converts a constant weight to Q2.14 at compile time. Must be within [-2, 2),
+ * as 2 itself doesn't fit in an int16_t. Weights out of range fail to compile
+ */
+#define MIX(x) ((int16_t)((x) * 16384.0 + ((x) >= 0 ? 0.5 : -0.5) + MIX_RANGE_CHECK(x)))
+
+/**
+ * 0 if the weight rounds to a value within [-2, 2) in Q2.14, and a negative
+ * array size otherwise
+ */
+#define MIX_RANGE_CHECK(x) (0 * (int)sizeof(char[((x) * 16384.0 >= -32768.5 && (x) * 16384.0 < 32767.5) ? 1 : -1]))
+
+typedef struct {
+    uint8_t channel; //output channel, 1 to NUM_CHANNELS (as in setPWM)
+    int16_t min, max; //limits for this output
+    int16_t coefficients[MIXER_INPUTS]; //Q2.14 weights of the roll, pitch, yaw and throttle signals
+} MixerOutput;
+
+typedef struct {
+    const MixerOutput* outputs;
+    uint8_t output_count;
+    /**
+     * If set, when the outputs can't all be kept within their limits, they are all
+     * shifted together by as little as possible so that they are, which keeps
+     * the differences between them (the attitude control) intact at the expense
+     * of the common part (the throttle). If they can't fit even then, they're
+     * centered in their limits so that they clip evenly. This only makes sense
+     * if all outputs have the same throttle weight, ie for multirotors
+     */
+    bool desaturate;
+} MixerTable;
+
+/**
+ * Mixes the control signals into the outputs of the table, and constrains them
+ * to their limits. Channels that aren't in the table are left untouched
+ * @param mixer The airframe's mixer table
+ * @param inputs The roll, pitch, yaw and throttle signals, in the order of MIXER_ROLL, etc.
+ * @param channelOut Zero-indexed output array, so channel 1 is index 0
+ * @return The number of outputs that had to be clipped to their limits
+ */
+uint8_t applyMixer(const MixerTable* mixer, const int* inputs, int* channelOut);
+
+#endif
@@ -10,17 +10,88 @@
 #include "AttitudeManager.h"
 #include "PWM.h"
 #include "ProgramStatus.h"
+#include "Mixer.h"
+#include "LatencyTrace.h"
 
 #if VEHICLE_TYPE == MULTIROTOR
 
 static int outputSignal[NUM_CHANNELS];
 static int control_Roll, control_Pitch, control_Yaw, control_Throttle;
 
+/*
+ * Mixer tables. For a motor at an angle a (clockwise from the front), the roll
+ * weight is -sin(a) and the pitch weight is cos(a), normalized so that the largest
+ * weight is 1. Yaw alternates with the direction of rotation of each motor
+ */
+#define MOTOR(channel, roll, pitch, yaw) {channel, MIN_PWM, MAX_PWM, {MIX(roll), MIX(pitch), MIX(yaw), MIX(1)}}
+
+#if ROTOR_TYPE == QUAD_X
+static const MixerOutput mixer_outputs[NUM_MOTORS] = {
+    MOTOR(FRONT_LEFT_MOTOR, 1, 1, -1),
+    MOTOR(FRONT_RIGHT_MOTOR, -1, 1, 1),
+    MOTOR(BACK_RIGHT_MOTOR, -1, -1, -1),
+    MOTOR(BACK_LEFT_MOTOR, 1, -1, 1)
+};
+#elif ROTOR_TYPE == QUAD_P
+static const MixerOutput mixer_outputs[NUM_MOTORS] = {
+    MOTOR(FRONT_MOTOR, 0, 1, -1),
+    MOTOR(RIGHT_MOTOR, -1, 0, 1),
+    MOTOR(BACK_MOTOR, 0, -1, -1),
+    MOTOR(LEFT_MOTOR, 1, 0, 1)
+};
+#elif ROTOR_TYPE == HEX_X
+static const MixerOutput mixer_outputs[NUM_MOTORS] = {
+    MOTOR(1, -0.5, 1, 1), // 30 degrees
+    MOTOR(2, -1, 0, -1),
+    MOTOR(3, -0.5, -1, 1),
+    MOTOR(4, 0.5, -1, -1),
+    MOTOR(5, 1, 0, 1),
+    MOTOR(6, 0.5, 1, -1)
+};
+#elif ROTOR_TYPE == HEX_P
+static const MixerOutput mixer_outputs[NUM_MOTORS] = {
+    MOTOR(1, 0, 1, -1), // 0 degrees
+    MOTOR(2, -1, 0.5, 1),
+    MOTOR(3, -1, -0.5, -1),
+    MOTOR(4, 0, -1, 1),
+    MOTOR(5, 1, -0.5, -1),
+    MOTOR(6, 1, 0.5, 1)
+};
+#elif ROTOR_TYPE == OCTO_X
+static const MixerOutput mixer_outputs[NUM_MOTORS] = {
+    MOTOR(1, -0.414, 1, 1), // 22.5 degrees
+    MOTOR(2, -1, 0.414, -1),
+    MOTOR(3, -1, -0.414, 1),
+    MOTOR(4, -0.414, -1, -1),
+    MOTOR(5, 0.414, -1, 1),
+    MOTOR(6, 1, -0.414, -1),
+    MOTOR(7, 1, 0.414, 1),
+    MOTOR(8, 0.414, 1, -1)
+};
+#elif ROTOR_TYPE == OCTO_P
+static const MixerOutput mixer_outputs[NUM_MOTORS] = {
+    MOTOR(1, 0, 1, -1), // 0 degrees
+    MOTOR(2, -0.707, 0.707, 1),
+    MOTOR(3, -1, 0, -1),
+    MOTOR(4, -0.707, -0.707, 1),
+    MOTOR(5, 0, -1, -1),
+    MOTOR(6, 0.707, -0.707, 1),
+    MOTOR(7, 1, 0, -1),
+    MOTOR(8, 0.707, 0.707, 1)
+};
+#endif
+
+static const MixerTable mixer = {mixer_outputs, NUM_MOTORS, true};
+
+static void stopMotors(void){
+    int motor;
+    for (motor = 1; motor <= NUM_MOTORS; motor++){
+        setPWM(motor, MIN_PWM);
+    }
+}
+
 void initialization(){
-    setPWM(1, MIN_PWM);
-    setPWM(2, MIN_PWM);
-    setPWM(3, MIN_PWM);
-    setPWM(4, MIN_PWM);
+    stopMotors();
     
     int channel = 0;
     for (; channel < NUM_CHANNELS; channel++) {
@@ -36,10 +107,7 @@ void initialization(){
 void armVehicle(){
     setProgramStatus(ARMING);
 
-    setPWM(1, MIN_PWM);
-    setPWM(2, MIN_PWM);
-    setPWM(3, MIN_PWM);
-    setPWM(4, MIN_PWM);
+    stopMotors();
 }
 
 void dearmVehicle(){
@@ -71,25 +139,13 @@ void inputMixing(int* channelIn, int* rollRate, int* pitchRate, int* throttle, i
 }
 
 void outputMixing(int* channelOut, int* control_Roll, int* control_Pitch, int* control_Throttle, int* control_Yaw){
-# if ROTOR_TYPE == QUAD_X
-    channelOut[FRONT_LEFT_MOTOR - 1] = (*control_Throttle) + (*control_Pitch) + (*control_Roll) - (*control_Yaw);
-    channelOut[FRONT_RIGHT_MOTOR - 1] = (*control_Throttle) + (*control_Pitch) - (*control_Roll) + (*control_Yaw);
-    channelOut[BACK_RIGHT_MOTOR - 1] = (*control_Throttle) - (*control_Pitch) - (*control_Roll) - (*control_Yaw);
-    channelOut[BACK_LEFT_MOTOR - 1] = (*control_Throttle) - (*control_Pitch) + (*control_Roll) + (*control_Yaw);
-#elif ROTOR_TYPE == QUAD_P
-    channelOut[FRONT_MOTOR - 1] = (*control_Throttle) + (*control_Pitch) - (*control_Yaw);
-    channelOut[RIGHT_MOTOR - 1] = (*control_Throttle) - (*control_Roll) + (*control_Yaw);
-    channelOut[BACK_MOTOR - 1] = (*control_Throttle) - (*control_Pitch) - (*control_Yaw);
-    channelOut[LEFT_MOTOR - 1] = (*control_Throttle) + (*control_Roll) + (*control_Yaw);
+    int inputs[MIXER_INPUTS];
+    inputs[MIXER_ROLL] = *control_Roll;
+    inputs[MIXER_PITCH] = *control_Pitch;
+    inputs[MIXER_YAW] = *control_Yaw;
+    inputs[MIXER_THROTTLE] = *control_Throttle;
 
-#endif
-}
-
-void checkLimits(int* channelOut){
-    int i;
-    for (i = 0; i < NUM_CHANNELS; i++) {
-        constrain(&(channelOut[i]), MIN_PWM, MAX_PWM);
-    }
+    applyMixer(&mixer, inputs, channelOut);
 }
 
 void highLevelControl(){
@@ -138,19 +194,17 @@ void lowLevelControl() {
     control_Yaw = PIDcontrol(getPID(YAW_RATE), getYawRateSetpoint() - getYawRate(), HALF_PWM_RANGE / MAX_YAW_RATE);
     control_Throttle = getThrottleSetpoint();
     
-    //Mixing!
+    //Mixing! The mixer also keeps the outputs within their limits
+    TRACE_BEGIN(TRACE_MIXING);
     outputMixing(outputSignal, &control_Roll, &control_Pitch, &control_Throttle, &control_Yaw);
-
-    //Error Checking
-    checkLimits(outputSignal);
+    TRACE_END(TRACE_MIXING);
 
     if (control_Throttle > -850 && getProgramStatus() != KILL_MODE) {
+        TRACE_BEGIN(TRACE_PWM_WRITE);
         setAllPWM(outputSignal);
+        TRACE_END(TRACE_PWM_WRITE);
     } else {
-        setPWM(1, MIN_PWM);
-        setPWM(2, MIN_PWM);
-        setPWM(3, MIN_PWM);
-        setPWM(4, MIN_PWM);
+        stopMotors();
     }
 }
 
@@ -19,7 +19,6 @@ void armVehicle(int delayTime);
 void dearmVehicle();
 void inputMixing(int* channelIn, int* rollRate, int* pitchRate, int* throttle, int* yawRate);
 void outputMixing(int* channelOut, int* control_Roll, int* control_Pitch, int* control_Throttle, int* control_Yaw);
-void checkLimits(int* channelOut);
 void highLevelControl();
 void lowLevelControl();
 
@@ -27,6 +26,8 @@ void lowLevelControl();
 #define QUAD_P 1
 #define HEX_X 2 
 #define HEX_P 3
+#define OCTO_X 4
+#define OCTO_P 5
 
 // Set multirotor type
 #define ROTOR_TYPE QUAD_P
@@ -37,21 +38,30 @@ void lowLevelControl();
 #define PITCH_IN_CHANNEL 3
 #define YAW_IN_CHANNEL 4
 
-// Outputs
+// Outputs. The mixer for each type is in Multirotor.c
 #if ROTOR_TYPE == QUAD_X
 #define FRONT_LEFT_MOTOR 1
 #define FRONT_RIGHT_MOTOR 2
 #define BACK_RIGHT_MOTOR 3
 #define BACK_LEFT_MOTOR 4
+#define NUM_MOTORS 4
 
 #elif ROTOR_TYPE == QUAD_P
 #define FRONT_MOTOR 1
 #define RIGHT_MOTOR 2
 #define BACK_MOTOR 3
 #define LEFT_MOTOR 4
+#define NUM_MOTORS 4
+
+#elif ROTOR_TYPE == HEX_X || ROTOR_TYPE == HEX_P
+// Motors are numbered clockwise (seen from above), starting from the front right
+// motor for X frames, and from the front motor for + frames
+#define NUM_MOTORS 6
+
+#elif ROTOR_TYPE == OCTO_X || ROTOR_TYPE == OCTO_P
+#define NUM_MOTORS 8
 
 #endif
-// TODO: implement channel/motor mixing for other multirotor types
 
 #endif	/* MULTIROTOR_H */
 
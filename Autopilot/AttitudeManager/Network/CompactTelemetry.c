@@ -0,0 +1,136 @@
+/**
+ * @file CompactTelemetry.c
+ * @author Waterloo Aerial Robotics Group
+ * @date October 18, 2026
+ * @copyright Waterloo Aerial Robotics Group 2017 \n
+ *   https://raw.githubusercontent.com/UWARG/PICpilot/master/LICENCE
+ */
+
+#include "CompactTelemetry.h"
+#include <stdint.h>
+
+/**
+ * Scale factors from the units of the position block to the compact encoding
+ */
+#define LAT_LON_SCALE 1e7 //degrees to 1e-7 degrees
+#define ANGLE_SCALE 100.0f //degrees to 0.01 degrees
+#define DISTANCE_SCALE 100.0f //m to cm
+
+/**
+ * The reference the compact blocks are currently encoded relative to, in the
+ * units of the compact encoding
+ */
+static int32_t reference_altitude;
+static int32_t reference_airspeed;
+static int32_t reference_ground_speed;
+static uint8_t reference_id = 0;
+static uint8_t blocks_since_reference = COMPACT_POSITION_REFERENCE_INTERVAL;
+
+/**
+ * Rounds and saturates a value to an int16
+ */
+static int16_t quantise16(float value){
+    if (value >= INT16_MAX){
+        return INT16_MAX;
+    } else if (value <= INT16_MIN){
+        return INT16_MIN;
+    }
+    return (int16_t)(value < 0 ? value - 0.5f : value + 0.5f);
+}
+
+/**
+ * Rounds and saturates a value to an int32
+ */
+static int32_t quantise32(long double value){
+    if (value >= INT32_MAX){
+        return INT32_MAX;
+    } else if (value <= INT32_MIN){
+        return INT32_MIN;
+    }
+    return (int32_t)(value < 0 ? value - 0.5 : value + 0.5);
+}
+
+/**
+ * @return Whether a delta from the reference fits in the compact block
+ */
+static bool deltaFits(int32_t value, int32_t reference){
+    int32_t delta = value - reference;
+    return delta <= INT16_MAX && delta >= INT16_MIN;
+}
+
+bool encodeCompactPosition(const struct packet_type_position_block* position,
+        struct packet_type_compact_position_block* compact,
+        struct packet_type_position_reference_block* reference){
+    int32_t altitude = quantise32(position->altitude * DISTANCE_SCALE);
+    int32_t airspeed = quantise32(position->airspeed * DISTANCE_SCALE);
+    int32_t ground_speed = quantise32(position->ground_speed * DISTANCE_SCALE);
+    bool new_reference = blocks_since_reference >= COMPACT_POSITION_REFERENCE_INTERVAL
+            || !deltaFits(altitude, reference_altitude)
+            || !deltaFits(airspeed, reference_airspeed)
+            || !deltaFits(ground_speed, reference_ground_speed);
+
+    if (new_reference){
+        reference_id++;
+        reference_altitude = altitude;
+        reference_airspeed = airspeed;
+        reference_ground_speed = ground_speed;
+        blocks_since_reference = 0;
+
+        reference->version = COMPACT_TELEMETRY_VERSION;
+        reference->reference_id = reference_id;
+        reference->altitude = reference_altitude;
+        reference->airspeed = reference_airspeed;
+        reference->ground_speed = reference_ground_speed;
+    }
+    blocks_since_reference++;
+
+    compact->version = COMPACT_TELEMETRY_VERSION;
+    compact->reference_id = reference_id;
+    compact->lat = quantise32(position->lat * LAT_LON_SCALE);
+    compact->lon = quantise32(position->lon * LAT_LON_SCALE);
+    compact->sys_time = position->sys_time;
+    compact->gps_time = position->gps_time;
+    compact->pitch = quantise16(position->pitch * ANGLE_SCALE);
+    compact->roll = quantise16(position->roll * ANGLE_SCALE);
+    compact->yaw = quantise16(position->yaw * ANGLE_SCALE);
+    //the rates saturate at +-327.67 degrees/s without any flag. The airframe shouldn't
+    //get there, and if it does the ground station sees a pinned value rather than a wrapped one
+    compact->pitch_rate = quantise16(position->pitch_rate * ANGLE_SCALE);
+    compact->roll_rate = quantise16(position->roll_rate * ANGLE_SCALE);
+    compact->yaw_rate = quantise16(position->yaw_rate * ANGLE_SCALE);
+    compact->altitude_delta = altitude - reference_altitude;
+    compact->airspeed_delta = airspeed - reference_airspeed;
+    compact->ground_speed_delta = ground_speed - reference_ground_speed;
+    compact->heading = position->heading;
+    compact->imu_sample_age = position->imu_sample_age;
+    return new_reference;
+}
+
+bool decodeCompactPosition(const struct packet_type_compact_position_block* compact,
+        const struct packet_type_position_reference_block* reference,
+        struct packet_type_position_block* position){
+    if (compact->version != COMPACT_TELEMETRY_VERSION || reference->version != COMPACT_TELEMETRY_VERSION
+            || compact->reference_id != reference->reference_id){
+        return false;
+    }
+    position->lat = compact->lat / LAT_LON_SCALE;
+    position->lon = compact->lon / LAT_LON_SCALE;
+    position->sys_time = compact->sys_time;
+    position->gps_time = compact->gps_time;
+    position->pitch = compact->pitch / ANGLE_SCALE;
+    position->roll = compact->roll / ANGLE_SCALE;
+    position->yaw = compact->yaw / ANGLE_SCALE;
+    position->pitch_rate = compact->pitch_rate / ANGLE_SCALE;
+    position->roll_rate = compact->roll_rate / ANGLE_SCALE;
+    position->yaw_rate = compact->yaw_rate / ANGLE_SCALE;
+    position->altitude = (reference->altitude + compact->altitude_delta) / DISTANCE_SCALE;
+    position->airspeed = (reference->airspeed + compact->airspeed_delta) / DISTANCE_SCALE;
+    position->ground_speed = (reference->ground_speed + compact->ground_speed_delta) / DISTANCE_SCALE;
+    position->heading = compact->heading;
+    position->imu_sample_age = compact->imu_sample_age;
+    return true;
+}
+
+void resetCompactPositionReference(void){
+    blocks_since_reference = COMPACT_POSITION_REFERENCE_INTERVAL;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file CompactTelemetry.h
+ * @author Waterloo Aerial Robotics Group
+ * @date October 18, 2026
+ * @brief
+ * Compact, quantised encoding of the position telemetry block. Latitude and
+ * longitude are sent as 1e-7 degrees, and the angles and rates as 0.01 degrees (per
+ * second). Altitude, airspeed and ground speed are sent as cm (per second) deltas
+ * from a position reference block, which is sent down along with the first compact
+ * block that uses it. Each compact block names the reference it's relative to, so
+ * losing a compact block doesn't affect the following ones, and the ground station
+ * can tell when it's missing a reference.
+ *
+ * A new reference is made every COMPACT_POSITION_REFERENCE_INTERVAL blocks, or
+ * as soon as a delta doesn't fit. tools/decode_position.py decodes both encodings.
+ *
+ * @copyright Waterloo Aerial Robotics Group 2017 \n
+ *   https://raw.githubusercontent.com/UWARG/PICpilot/master/LICENCE
+ */
+
+#ifndef COMPACTTELEMETRY_H
+#define	COMPACTTELEMETRY_H
+
+#include <stdbool.h>
+#include "Datalink.h"
+
+/**
+ * Version of the compact encoding. Sent in every compact and reference block, so
+ * that the ground station can reject blocks it doesn't know how to decode
+ */
+#define COMPACT_TELEMETRY_VERSION 1
+
+/**
+ * Number of compact position blocks sent relative to each position reference
+ */
+#define COMPACT_POSITION_REFERENCE_INTERVAL 10
+
+/**
+ * Encodes a position block in the compact encoding. Values that don't fit are
+ * saturated silently: in particular the angular rates are clamped to +-327.67
+ * degrees/s
+ * @param position Position block to encode
+ * @param compact Set to the encoded position
+ * @param reference Set to a new reference, if one was needed
+ * @return Whether a new reference was made. If so, it has to be sent down before
+ *      the compact block
+ */
+bool encodeCompactPosition(const struct packet_type_position_block* position,
+        struct packet_type_compact_position_block* compact,
+        struct packet_type_position_reference_block* reference);
+
+/**
+ * Decodes a compact position block back into the units of the position block,
+ * like the ground station does. For on board users of the downlink frames
+ * @param compact Compact block to decode
+ * @param reference The latest reference block received
+ * @param position Set to the decoded position
+ * @return Whether the block could be decoded. It can't if it's relative to
+ *      another reference, or of an unknown version
+ */
+bool decodeCompactPosition(const struct packet_type_compact_position_block* compact,
+        const struct packet_type_position_reference_block* reference,
+        struct packet_type_position_block* position);
+
+/**
+ * Makes the next encoded block start a new reference. Call this if a reference
+ * couldn't be queued, so that the ground station doesn't wait a whole interval
+ * for the next one
+ */
+void resetCompactPositionReference(void);
+
+#endif
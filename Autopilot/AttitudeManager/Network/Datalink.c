@@ -8,32 +8,88 @@
 
 #include "Datalink.h"
 #include "../Drivers/Radio.h"
-#include "../../Common/Utilities/ByteQueue.h"
+#include "../../Common/Utilities/ByteRing.h"
 #include "../../Common/Utilities/Logger.h"
+#include "../../Common/Clock/Timer.h"
 #include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
-#include <stdlib.h>
 #include <string.h>
 
 /** Index position in the DEFAULT_PACKET_ORDER array */
 static uint8_t continuous_packet_order_index = 0;
-static ByteQueue requested_packet_type_queue; //used to store the intermittent packets
+static ByteRing requested_packet_type_queue; //used to store the intermittent packets
+static uint8_t requested_packet_types[16];
+
+/** Telemetry blocks packed so far, waiting to be sent down in a single transmission */
+static uint8_t downlink_frame[DOWNLINK_FRAME_LENGTH];
+static uint8_t downlink_frame_length = 0;
+static uint16_t downlink_frame_types = 0; //bitmask of the packet types in the frame
+
+/** State of the downlink rate controller */
+static uint16_t downlink_interval = DOWNLINK_SEND_INTERVAL;
+static uint16_t radio_status_timer = 0;
+static uint16_t last_transmission_errors = 0;
 
 static void pushDatalinkCommand(DatalinkCommand* command);
+static uint8_t getTelemetryBlockLength(PacketType type);
+static uint8_t skipShedPacketTypes(uint8_t index);
+static bool queueReliableTelemetryBlock(TelemetryBlock* telem, uint8_t size);
+static void getFrameClass(uint16_t packet_types, RadioPacketClass* frame_class);
 
 struct DatalinkCommandQueue {
     DatalinkCommand* head;
     DatalinkCommand* tail;
 } datalinkCommandQueue;
 
+/**
+ * A command, and the buffer the radio parses it into. The command comes first so
+ * that a command can be turned back into its slot
+ */
+typedef struct {
+    DatalinkCommand command;
+    uint16_t buffer[RADIO_UPLINK_BUFFER_LENGTH / 2]; //uint16_t to keep it 2 byte aligned
+} DatalinkCommandSlot;
+
+static DatalinkCommandSlot command_slots[DATALINK_COMMAND_POOL_SIZE];
+
+/** Unused slots, linked through their commands */
+static DatalinkCommand* free_commands;
+
+/** The slot the radio is currently parsing into. Kept until a command is received */
+static DatalinkCommandSlot* receiving_slot;
+
+/**
+ * Parsed into while every slot is in use, so that the radio keeps reading its own
+ * frames (ie transmit statuses). Commands received into it are dropped
+ */
+static DatalinkCommandSlot overflow_slot;
+
+/** Uplink stats since they were last read, and the sum of the latencies for the mean */
+static UplinkStats uplink_stats;
+static uint32_t total_latency;
+
 void initDatalink(void){
+    uint8_t i;
+
     initRadio();
+    downlink_interval = DOWNLINK_SEND_INTERVAL;
+    radio_status_timer = 0;
+    last_transmission_errors = 0;
     datalinkCommandQueue.tail = NULL;
     datalinkCommandQueue.head = NULL;
 
-    //allocate 16 bytes for the special packet type requests. Should be more than sufficient
-    initBQueue(&requested_packet_type_queue, 16, 16);
+    free_commands = NULL;
+    receiving_slot = NULL;
+    memset(&uplink_stats, 0, sizeof(uplink_stats));
+    total_latency = 0;
+    for (i = 0; i < DATALINK_COMMAND_POOL_SIZE; i++){
+        command_slots[i].command.next = free_commands;
+        free_commands = &command_slots[i].command;
+    }
+
+    //16 bytes for the special packet type requests. Should be more than sufficient
+    initBRing(&requested_packet_type_queue, requested_packet_types, sizeof(requested_packet_types));
 
     info("Datalink Initialized");
     //print out some debug info. Useful for debugging datalink
@@ -41,41 +97,73 @@ void initDatalink(void){
     debugInt("Status Block Size", sizeof(struct packet_type_status_block));
     debugInt("Gains Block Size", sizeof(struct packet_type_gain_block));
     debugInt("Channels Block Size", sizeof(struct packet_type_channels_block));
+    debugInt("Interchip Block Size", sizeof(struct packet_type_interchip_block));
+    debugInt("Latency Block Size", sizeof(struct packet_type_latency_block));
+    debugInt("CPU Load Block Size", sizeof(struct packet_type_cpu_load_block));
+    debugInt("Compact Position Block Size", sizeof(struct packet_type_compact_position_block));
+    debugInt("Position Reference Block Size", sizeof(struct packet_type_position_reference_block));
+    debugInt("Uplink Block Size", sizeof(struct packet_type_uplink_block));
+    debugInt("Control Loop Block Size", sizeof(struct packet_type_control_loop_block));
+    debugInt("Radio Block Size", sizeof(struct packet_type_radio_block));
     debugInt("Telemetry Block Size", sizeof(TelemetryBlock));
 }
 
-void parseDatalinkBuffer(void) {
+bool parseDatalinkBuffer(void) {
     uint16_t length;
+    uint8_t* received;
+    
+    if (receiving_slot == NULL || receiving_slot == &overflow_slot){
+        if (free_commands != NULL){
+            //a command may have been partially parsed into the overflow slot, so it moves over
+            if (receiving_slot == &overflow_slot){
+                memcpy(((DatalinkCommandSlot*)free_commands)->buffer, overflow_slot.buffer, sizeof(overflow_slot.buffer));
+            }
+            receiving_slot = (DatalinkCommandSlot*)free_commands;
+            free_commands = free_commands->next;
+        } else { //every command is still waiting to be processed
+            receiving_slot = &overflow_slot;
+        }
+    }
+    
+    received = parseUplinkPacket((uint8_t*)receiving_slot->buffer, &length);
     
-    uint8_t* received = parseUplinkPacket(&length);
+    if (received != NULL && length != 0 && receiving_slot == &overflow_slot){
+        uplink_stats.dropped++;
+        receiving_slot = NULL;
+        return false;
+    }
     
     //if we received a packet from the radio
-    if (received != NULL){
-        DatalinkCommand* command = malloc(sizeof(DatalinkCommand));
-        
-        if (command == NULL){ //we couldn't do malloc, so we'll discard of the data
-            free(received);
-            return;
-        }
+    if (received != NULL && length != 0){
+        DatalinkCommand* command = &receiving_slot->command;
         
         command->data_length = length - 1; //data length doesnt acount the cmd id
         command->cmd = received[0];
         
-        command->data = received;
+        //the radio leaves the data after the command id word aligned, which is required for casting
+        command->data = received + 1;
+        command->received_time = getTimeUs();
         
-        //don't include the command id in the data part of the command. This is required so
-        //that the data that we later parse is word aligned, which is required for casting
-        memcpy(command->data, command->data + 1, command->data_length);
-        command->next = NULL;
-        
-        //append the command to our queue
+        //append the command to our queue. The next command needs a new slot
         pushDatalinkCommand(command);
+        receiving_slot = NULL;
+        uplink_stats.queue_depth++;
+        if (uplink_stats.queue_depth > uplink_stats.max_queue_depth){
+            uplink_stats.max_queue_depth = uplink_stats.queue_depth;
+        }
+        return true;
     }
+    return false;
 }
 
 DatalinkCommand* popDatalinkCommand(){
     DatalinkCommand* command = datalinkCommandQueue.head;
     
+    if (command == NULL){
+        return NULL;
+    }
+    uplink_stats.queue_depth--;
+    
     if (command == datalinkCommandQueue.tail){
         datalinkCommandQueue.tail = NULL;
         datalinkCommandQueue.head = NULL;
@@ -85,14 +173,44 @@ DatalinkCommand* popDatalinkCommand(){
     return command;
 }
 
+DatalinkCommand* peekDatalinkCommand(){
+    return datalinkCommandQueue.head;
+}
+
 void freeDatalinkCommand(DatalinkCommand* to_destroy){
-    free(to_destroy->data);
-    free(to_destroy);
+    uint32_t latency = (uint32_t)getTimeUs() - to_destroy->received_time;
+
+    uplink_stats.applied++;
+    total_latency += latency;
+    if (latency > uplink_stats.max_latency){
+        uplink_stats.max_latency = latency;
+    }
+
+    to_destroy->next = free_commands;
+    free_commands = to_destroy;
 }
 
-bool queueTelemetryBlock(TelemetryBlock* telem) {
-    uint16_t size = 0;
-    switch (telem->type){
+void getUplinkStats(UplinkStats* stats){
+    uint8_t queue_depth = uplink_stats.queue_depth;
+
+    if (uplink_stats.applied != 0){
+        uplink_stats.mean_latency = total_latency / uplink_stats.applied;
+    }
+    *stats = uplink_stats;
+
+    memset(&uplink_stats, 0, sizeof(uplink_stats));
+    total_latency = 0;
+    uplink_stats.queue_depth = queue_depth;
+    uplink_stats.max_queue_depth = queue_depth;
+}
+
+/**
+ * @param type
+ * @return Length of the data of a telemetry block of this type
+ */
+static uint8_t getTelemetryBlockLength(PacketType type) {
+    uint8_t size = 0;
+    switch (type){
         case PACKET_TYPE_POSITION:
             size = sizeof(struct packet_type_position_block);
             break;
@@ -105,23 +223,190 @@ bool queueTelemetryBlock(TelemetryBlock* telem) {
         case PACKET_TYPE_CHANNELS:
             size = sizeof(struct packet_type_channels_block);
             break;
+        case PACKET_TYPE_INTERCHIP:
+            size = sizeof(struct packet_type_interchip_block);
+            break;
+        case PACKET_TYPE_LATENCY:
+            size = sizeof(struct packet_type_latency_block);
+            break;
+        case PACKET_TYPE_CPU_LOAD:
+            size = sizeof(struct packet_type_cpu_load_block);
+            break;
+        case PACKET_TYPE_POSITION_COMPACT:
+            size = sizeof(struct packet_type_compact_position_block);
+            break;
+        case PACKET_TYPE_POSITION_REFERENCE:
+            size = sizeof(struct packet_type_position_reference_block);
+            break;
+        case PACKET_TYPE_UPLINK:
+            size = sizeof(struct packet_type_uplink_block);
+            break;
+        case PACKET_TYPE_CONTROL_LOOP:
+            size = sizeof(struct packet_type_control_loop_block);
+            break;
+        case PACKET_TYPE_RADIO:
+            size = sizeof(struct packet_type_radio_block);
+            break;
     }
-    
-    return queueDownlinkPacket((uint8_t*)(telem), size + 2); //2 bytes for the packet type
+    return size;
+}
+
+bool queueTelemetryBlock(TelemetryBlock* telem) {
+    uint8_t size = getTelemetryBlockLength(telem->type);
+
+    if (RELIABLE_PACKET_TYPES & (1 << telem->type)){
+        return queueReliableTelemetryBlock(telem, size);
+    }
+
+    if (!telemetryBlockFits(telem->type) && !flushTelemetryBlocks()){
+        return false;
+    }
+
+    downlink_frame[downlink_frame_length] = telem->type;
+    downlink_frame[downlink_frame_length + 1] = size;
+    memcpy(&downlink_frame[downlink_frame_length + TELEMETRY_BLOCK_HEADER_LENGTH], &telem->data, size);
+    downlink_frame_length += size + TELEMETRY_BLOCK_HEADER_LENGTH;
+    downlink_frame_types |= 1 << telem->type;
+    return true;
+}
+
+/**
+ * Queues a telemetry block in a frame of its own, to be resent until it's received
+ * @param telem
+ * @param size Length of the block's data
+ * @return True if successfully queued
+ */
+static bool queueReliableTelemetryBlock(TelemetryBlock* telem, uint8_t size) {
+    uint8_t frame[TELEMETRY_BLOCK_HEADER_LENGTH + sizeof(PacketPayload)];
+    RadioPacketClass frame_class;
+
+    frame[0] = telem->type;
+    frame[1] = size;
+    memcpy(&frame[TELEMETRY_BLOCK_HEADER_LENGTH], &telem->data, size);
+
+    if (queueReliableDownlinkPacket(frame, size + TELEMETRY_BLOCK_HEADER_LENGTH)){
+        return true;
+    }
+    //if the radio can't take any more reliable frames, it's still worth sending it once
+    getFrameClass(1 << telem->type, &frame_class);
+    return queueDownlinkPacket(frame, size + TELEMETRY_BLOCK_HEADER_LENGTH, &frame_class);
+}
+
+/**
+ * Works out how the radio should treat a frame with blocks of the given types
+ * @param packet_types Bitmask of the packet types in the frame
+ * @param frame_class Set to the highest priority and the longest deadline of the
+ *      types. The frame can only be replaced if they're all latest value types,
+ *      and is a barrier if any of them are barrier types
+ */
+static void getFrameClass(uint16_t packet_types, RadioPacketClass* frame_class){
+    bool expires = true;
+    uint8_t type;
+
+    frame_class->priority = 0;
+    frame_class->deadline = 0;
+    frame_class->contents = (packet_types & ~LATEST_VALUE_PACKET_TYPES) ? 0 : packet_types;
+    frame_class->barrier = (packet_types & BARRIER_PACKET_TYPES) != 0;
+
+    for (type = 0; type < sizeof(PACKET_TYPE_PRIORITY); type++){
+        if (!(packet_types & (1 << type))){
+            continue;
+        }
+        if (PACKET_TYPE_PRIORITY[type] > frame_class->priority){
+            frame_class->priority = PACKET_TYPE_PRIORITY[type];
+        }
+        if (PACKET_TYPE_DEADLINE[type] == 0){
+            expires = false;
+        } else if (PACKET_TYPE_DEADLINE[type] > frame_class->deadline){
+            frame_class->deadline = PACKET_TYPE_DEADLINE[type];
+        }
+    }
+
+    if (!expires){
+        frame_class->deadline = 0;
+    }
+}
+
+bool telemetryBlockFits(PacketType type) {
+    if (RELIABLE_PACKET_TYPES & (1 << type)){
+        return true; //never packed into the frame
+    }
+    return downlink_frame_length + TELEMETRY_BLOCK_HEADER_LENGTH + getTelemetryBlockLength(type) <= DOWNLINK_FRAME_LENGTH;
+}
+
+bool flushTelemetryBlocks(void) {
+    RadioPacketClass frame_class;
+    bool queued;
+
+    if (downlink_frame_length == 0){
+        return true;
+    }
+    getFrameClass(downlink_frame_types, &frame_class);
+    queued = queueDownlinkPacket(downlink_frame, downlink_frame_length, &frame_class);
+    downlink_frame_length = 0; //if it couldn't be queued, the blocks are stale by the next frame anyway
+    downlink_frame_types = 0;
+    return queued;
 }
 
 PacketType getNextPacketType(){
-    if (getBQueueSize(&requested_packet_type_queue) != 0){ //if the queue isnt empty
-        return popBQueue(&requested_packet_type_queue);
+    if (getBRingSize(&requested_packet_type_queue) != 0){ //if the queue isnt empty
+        return popBRing(&requested_packet_type_queue);
     }
 
+    continuous_packet_order_index = skipShedPacketTypes(continuous_packet_order_index);
     uint8_t to_return = DEFAULT_PACKET_ORDER[continuous_packet_order_index];
     continuous_packet_order_index = (continuous_packet_order_index + 1)%sizeof(DEFAULT_PACKET_ORDER);
     return to_return;
 }
 
+PacketType peekNextPacketType(){
+    if (getBRingSize(&requested_packet_type_queue) != 0){
+        return peekBRing(&requested_packet_type_queue);
+    }
+    return DEFAULT_PACKET_ORDER[skipShedPacketTypes(continuous_packet_order_index)];
+}
+
+/**
+ * Skips the packet types that aren't sent at the current downlink rate
+ * @param index Position in the default packet order
+ * @return The first position from index on whose packet type is sent
+ */
+static uint8_t skipShedPacketTypes(uint8_t index){
+    if (downlink_interval <= DOWNLINK_SEND_INTERVAL){
+        return index;
+    }
+    while (DOWNLINK_SHED_PACKET_TYPES & (1 << DEFAULT_PACKET_ORDER[index])){
+        index = (index + 1)%sizeof(DEFAULT_PACKET_ORDER);
+    }
+    return index;
+}
+
+uint16_t getDownlinkInterval(void){
+    return downlink_interval;
+}
+
+void updateDownlinkRate(void){
+    uint8_t backpressure = getRadioBackpressure();
+    uint16_t transmission_errors = getRadioTransmissionErrors();
+
+    //back off quickly when the radio can't keep up, and speed up slowly when it can
+    if (backpressure >= DOWNLINK_BACKPRESSURE_HIGH || transmission_errors != last_transmission_errors){
+        downlink_interval = downlink_interval * 2 > DOWNLINK_MAX_SEND_INTERVAL ? DOWNLINK_MAX_SEND_INTERVAL : downlink_interval * 2;
+    } else if (backpressure <= DOWNLINK_BACKPRESSURE_LOW){
+        downlink_interval = downlink_interval - DOWNLINK_INTERVAL_STEP < DOWNLINK_MIN_SEND_INTERVAL ? DOWNLINK_MIN_SEND_INTERVAL : downlink_interval - DOWNLINK_INTERVAL_STEP;
+    }
+    last_transmission_errors = transmission_errors;
+
+    //keep the transmission error count fresh
+    radio_status_timer += downlink_interval;
+    if (radio_status_timer >= DOWNLINK_RADIO_STATUS_INTERVAL){
+        radio_status_timer = 0;
+        queueRadioStatusPacket();
+    }
+}
+
 void queuePacketType(PacketType type){
-    pushBQueue(&requested_packet_type_queue, type);
+    pushBRing(&requested_packet_type_queue, type);
 }
 
 /**
@@ -13,12 +13,51 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "Commands.h"
+#include "../LatencyTrace.h"
 
-/** Time in ms on how often to send down a packet. Packets will not be send to the radio faster than this */
+/**
+ * Initial time in ms between downlink frames. The rate controller then adapts it
+ * between DOWNLINK_MIN_SEND_INTERVAL and DOWNLINK_MAX_SEND_INTERVAL, depending on
+ * how well the radio keeps up
+ */
 #define DOWNLINK_SEND_INTERVAL 150
+#define DOWNLINK_MIN_SEND_INTERVAL 50
+#define DOWNLINK_MAX_SEND_INTERVAL 1000
+
+/**
+ * Radio backpressure (see getRadioBackpressure()) at or above which the downlink
+ * interval is doubled, and at or below which it is shortened by DOWNLINK_INTERVAL_STEP
+ */
+#define DOWNLINK_BACKPRESSURE_HIGH 50
+#define DOWNLINK_BACKPRESSURE_LOW 10
+#define DOWNLINK_INTERVAL_STEP 10
+
+/**
+ * Time in ms between requests for the radio status, whose transmission error
+ * count also makes the downlink back off
+ */
+#define DOWNLINK_RADIO_STATUS_INTERVAL 2000
 
-/** Time in miliseconds for how often to check for new messages from the uplink **/
-#define UPLINK_CHECK_FREQUENCY 500
+/**
+ * Max length of a downlink frame, which is as many telemetry blocks as fit in a
+ * single radio transmission. Must not be larger than the largest payload the radio
+ * can send (XBEE_MAX_PAYLOAD_LENGTH)
+ */
+#define DOWNLINK_FRAME_LENGTH 100
+
+/**
+ * Each telemetry block in a downlink frame is preceded by a 1 byte packet type and
+ * the 1 byte length of the block data that follows. The ground station unpacks them
+ * with tools/unpack_downlink.py
+ */
+#define TELEMETRY_BLOCK_HEADER_LENGTH 2
+
+/**
+ * Max time in us spent applying uplink commands in each pass of the state machine.
+ * Commands that are left over are applied in the next pass, so a burst of commands
+ * can't hold up the control loop
+ */
+#define UPLINK_TIME_BUDGET_US 1000
 
 /**
  * Different packet types that we can send over via the downlink
@@ -27,9 +66,98 @@ typedef enum {
     PACKET_TYPE_POSITION = 0,
     PACKET_TYPE_STATUS = 1,
     PACKET_TYPE_GAINS = 2,
-    PACKET_TYPE_CHANNELS = 3
+    PACKET_TYPE_CHANNELS = 3,
+    PACKET_TYPE_INTERCHIP = 4,
+    PACKET_TYPE_LATENCY = 5,
+    PACKET_TYPE_CPU_LOAD = 6,
+    PACKET_TYPE_POSITION_COMPACT = 7,
+    PACKET_TYPE_POSITION_REFERENCE = 8,
+    PACKET_TYPE_UPLINK = 9,
+    PACKET_TYPE_CONTROL_LOOP = 10,
+    PACKET_TYPE_RADIO = 11
 } PacketType;
 
+/**
+ * Whether the position is sent down in the compact, quantised encoding (1), or in
+ * the full floating point one (0). See CompactTelemetry.h
+ */
+#define COMPACT_POSITION_TELEMETRY 1
+
+#if COMPACT_POSITION_TELEMETRY
+#define PACKET_TYPE_POSITION_DEFAULT PACKET_TYPE_POSITION_COMPACT
+#else
+#define PACKET_TYPE_POSITION_DEFAULT PACKET_TYPE_POSITION
+#endif
+
+/**
+ * Packet types in DEFAULT_PACKET_ORDER that are skipped while the downlink is slower
+ * than DOWNLINK_SEND_INTERVAL, so that the position and status keep their rate.
+ * Must not contain every type in the order
+ */
+#define DOWNLINK_SHED_PACKET_TYPES ((1 << PACKET_TYPE_INTERCHIP) | (1 << PACKET_TYPE_LATENCY) | (1 << PACKET_TYPE_CPU_LOAD) | (1 << PACKET_TYPE_UPLINK) | (1 << PACKET_TYPE_CONTROL_LOOP) | (1 << PACKET_TYPE_RADIO))
+
+/**
+ * Packet types that are sent in a frame of their own, and resent until the ground
+ * station receives them (see queueReliableDownlinkPacket()). These are sent on
+ * events, so the ground station wouldn't otherwise know to ask for them again
+ */
+#define RELIABLE_PACKET_TYPES (1 << PACKET_TYPE_GAINS)
+
+/**
+ * Packet types whose blocks are superseded by the next block of the same type.
+ * The diagnostics count events since their last block, so they aren't. A queued
+ * frame of only these is replaced by a newer frame that has all of its types
+ */
+#define LATEST_VALUE_PACKET_TYPES ((1 << PACKET_TYPE_POSITION) | (1 << PACKET_TYPE_POSITION_COMPACT) | (1 << PACKET_TYPE_STATUS) | (1 << PACKET_TYPE_CHANNELS))
+
+/**
+ * Packet types that the blocks after them depend on. Newer frames are never merged
+ * into frames queued before one of these, so they can't be sent ahead of it
+ */
+#define BARRIER_PACKET_TYPES (1 << PACKET_TYPE_POSITION_REFERENCE)
+
+/**
+ * Downlink priority of each packet type. Frames with a higher priority are sent
+ * first when the radio falls behind, and a frame has the highest priority of its blocks.
+ * Position references must be at least as high as any type that can share a frame
+ * with compact positions, so that a reference is never overtaken by the compact
+ * positions that are relative to it
+ */
+static const uint8_t PACKET_TYPE_PRIORITY[] = {
+    [PACKET_TYPE_POSITION] = 2,
+    [PACKET_TYPE_STATUS] = 3,
+    [PACKET_TYPE_GAINS] = 4,
+    [PACKET_TYPE_CHANNELS] = 2,
+    [PACKET_TYPE_INTERCHIP] = 1,
+    [PACKET_TYPE_LATENCY] = 1,
+    [PACKET_TYPE_CPU_LOAD] = 1,
+    [PACKET_TYPE_POSITION_COMPACT] = 2,
+    [PACKET_TYPE_POSITION_REFERENCE] = 3,
+    [PACKET_TYPE_UPLINK] = 1,
+    [PACKET_TYPE_CONTROL_LOOP] = 1,
+    [PACKET_TYPE_RADIO] = 1
+};
+
+/**
+ * Time in ms after which a block of each packet type is too old to be worth sending,
+ * or 0 if it always is. A frame is only dropped once all of its blocks are too old,
+ * so position references (which the compact positions after them need) keep theirs
+ */
+static const uint16_t PACKET_TYPE_DEADLINE[] = {
+    [PACKET_TYPE_POSITION] = 1000,
+    [PACKET_TYPE_STATUS] = 2000,
+    [PACKET_TYPE_GAINS] = 0,
+    [PACKET_TYPE_CHANNELS] = 1000,
+    [PACKET_TYPE_INTERCHIP] = 3000,
+    [PACKET_TYPE_LATENCY] = 3000,
+    [PACKET_TYPE_CPU_LOAD] = 3000,
+    [PACKET_TYPE_POSITION_COMPACT] = 1000,
+    [PACKET_TYPE_POSITION_REFERENCE] = 0,
+    [PACKET_TYPE_UPLINK] = 3000,
+    [PACKET_TYPE_CONTROL_LOOP] = 3000,
+    [PACKET_TYPE_RADIO] = 3000
+};
+
 /**
  * Defines the normal order that packets will be send down.  Note that this list contains packet types that should continually
  * be sent down. It should NOT contain packets types that should be sent down from
@@ -37,12 +165,18 @@ typedef enum {
  * be called to move the packet type to the front of the queue
  */
 static const uint8_t DEFAULT_PACKET_ORDER[] = {
-    PACKET_TYPE_POSITION,
-    PACKET_TYPE_POSITION,
+    PACKET_TYPE_POSITION_DEFAULT,
+    PACKET_TYPE_POSITION_DEFAULT,
     PACKET_TYPE_STATUS,
-    PACKET_TYPE_POSITION,
-    PACKET_TYPE_POSITION,
-    PACKET_TYPE_CHANNELS
+    PACKET_TYPE_POSITION_DEFAULT,
+    PACKET_TYPE_POSITION_DEFAULT,
+    PACKET_TYPE_CHANNELS,
+    PACKET_TYPE_INTERCHIP,
+    PACKET_TYPE_LATENCY,
+    PACKET_TYPE_CPU_LOAD,
+    PACKET_TYPE_UPLINK,
+    PACKET_TYPE_CONTROL_LOOP,
+    PACKET_TYPE_RADIO
 };
 
 /* For reference: 
@@ -54,7 +188,7 @@ static const uint8_t DEFAULT_PACKET_ORDER[] = {
  long double    : 8 bytes
  */
 
-//62 bytes. High Frequency - Multiple times per second
+//64 bytes. High Frequency - Multiple times per second
 struct packet_type_position_block { //
     long double lat, lon;
     uint32_t sys_time;
@@ -65,6 +199,30 @@ struct packet_type_position_block { //
     float altitude;
     float ground_speed;
     int16_t heading;
+    uint16_t imu_sample_age; //us from the attitude above being sampled to it being used for control
+};
+
+//40 bytes. High Frequency. The position block in the compact encoding, see CompactTelemetry.h
+struct packet_type_compact_position_block {
+    uint8_t version; //COMPACT_TELEMETRY_VERSION
+    uint8_t reference_id; //position reference block the deltas below are from
+    int32_t lat, lon; //1e-7 degrees
+    uint32_t sys_time;
+    float gps_time;
+    int16_t pitch, roll, yaw; //0.01 degrees
+    int16_t pitch_rate, roll_rate, yaw_rate; //0.01 degrees/s, saturates at about 327 degrees/s
+    int16_t altitude_delta; //cm
+    int16_t airspeed_delta, ground_speed_delta; //cm/s
+    int16_t heading;
+    uint16_t imu_sample_age;
+};
+
+//14 bytes. Sent along with the first compact position block that uses it
+struct packet_type_position_reference_block {
+    uint8_t version; //COMPACT_TELEMETRY_VERSION
+    uint8_t reference_id;
+    int32_t altitude; //cm
+    int32_t airspeed, ground_speed; //cm/s
 };
 
 //50 bytes. Medium frequency. About once every second
@@ -106,11 +264,77 @@ struct packet_type_gain_block{
     float orbit_kp;
 };
 
-//34 bytes
+//40 bytes
 struct packet_type_channels_block {
     int16_t ch1_in, ch2_in, ch3_in, ch4_in, ch5_in, ch6_in, ch7_in, ch8_in;
     int16_t ch1_out, ch2_out, ch3_out, ch4_out, ch5_out, ch6_out, ch7_out, ch8_out;
     bool channels_scaled; //whether the following values are scaled, or raw
+    uint16_t rc_frame_rate; //PPM frames received from the RC receiver in the last second
+    uint16_t rc_frame_jitter; //us, spread of the PPM frame period in the last second
+    uint16_t rc_frame_errors; //PPM frames discarded for a bad length or pulse
+};
+
+//32 bytes. Low frequency. Receive side health of the interchip link on both chips
+struct packet_type_interchip_block {
+    uint16_t good_frames, checksum_errors, empty_frames, duplicate_frames, sequence_errors;
+    uint16_t round_trip_time; //us
+    uint16_t last_frame_age; //ms since the last good frame from the path manager
+    uint16_t message_rate; //frames per second
+    uint16_t pm_interchip_errors; //checksum errors seen by the path manager
+    uint16_t gps_setpoint_latency; //us from the path manager receiving GPS data to sending the heading setpoint
+    uint16_t pm_good_frames, pm_empty_frames, pm_sequence_errors; //as above, seen by the path manager. It doesn't count duplicates
+    uint16_t pm_round_trip_time; //us
+    uint16_t pm_last_frame_age; //ms since the last good frame from the attitude manager, when the path manager last sent
+    uint16_t pm_message_rate;
+};
+
+//84 bytes. Low frequency. Control loop and datalink timing since the last one, see LatencyTrace.h
+struct packet_type_latency_block {
+    uint16_t count[TRACE_SECTIONS]; //times each section completed, in the order of TraceSection
+    uint16_t min[TRACE_SECTIONS], mean[TRACE_SECTIONS], max[TRACE_SECTIONS]; //us
+    uint16_t histogram[LATENCY_HISTOGRAM_BINS]; //of histogram_section only. Each packet has the next section
+    uint16_t histogram_section;
+    uint16_t dropped; //trace points lost because the ring was full
+};
+
+//56 bytes. Low frequency. CPU usage of the attitude manager over the last second, see CPULoadStats
+struct packet_type_cpu_load_block {
+    uint16_t cpu_load; //1/1000ths of the time spent in tasks
+    uint16_t task_load[9]; //1/1000ths of the time spent in each task, in the order of StateMachineTask
+    uint16_t task_max_time[9]; //us, longest single run of each task
+    uint16_t task_calls[9];
+};
+
+//14 bytes. Low frequency. Uplink commands since the last uplink block, see UplinkStats
+struct packet_type_uplink_block {
+    uint32_t mean_latency, max_latency; //us, from a command being received to it being applied
+    uint16_t applied; //commands applied
+    uint8_t queue_depth, max_queue_depth; //commands waiting to be applied
+    uint16_t dropped; //commands dropped because the queue was full
+};
+
+//24 bytes. Low frequency. Timing of the control loop since startup, see ControlLoopStats
+struct packet_type_control_loop_block {
+    uint32_t steps; //control steps run
+    uint16_t overruns; //control ticks or IMU samples missed
+    uint16_t max_step_time; //us
+    uint16_t jitter_histogram[8]; //delay from the tick to the start of the step, in CONTROL_JITTER_BIN_US wide bins
+};
+
+//30 bytes. Low frequency. Statistics of the radio driver since startup. What they are depends on the radio
+struct packet_type_radio_block {
+    uint16_t radio; //USE_RADIO, which says which member of stats is sent
+    union {
+        struct { //RADIO_XBEE. See XbeeFramePoolStats and XbeeReliableStats
+            uint16_t queued, sent, dropped, expired, coalesced, rejected; //frame pool
+            uint8_t depth, max_depth;
+            uint16_t reliable_queued, reliable_sent, delivered, retransmitted, failed, reliable_rejected;
+            uint8_t reliable_pending;
+        } xbee;
+        struct { //RADIO_3DR. Uplink messages, see MavlinkParserStats
+            uint16_t received, crc_errors, unknown, sequence_gaps;
+        } mavlink;
+    } stats;
 };
 
 typedef union {
@@ -118,6 +342,14 @@ typedef union {
     struct packet_type_status_block status_block;
     struct packet_type_gain_block gain_block;
     struct packet_type_channels_block channels_block;
+    struct packet_type_interchip_block interchip_block;
+    struct packet_type_latency_block latency_block;
+    struct packet_type_cpu_load_block cpu_load_block;
+    struct packet_type_compact_position_block compact_position_block;
+    struct packet_type_position_reference_block position_reference_block;
+    struct packet_type_uplink_block uplink_block;
+    struct packet_type_control_loop_block control_loop_block;
+    struct packet_type_radio_block radio_block;
 } PacketPayload;
 
 typedef struct {
@@ -125,13 +357,36 @@ typedef struct {
     PacketPayload data;
 } TelemetryBlock;
 
+/**
+ * Number of uplink commands that can be waiting to be processed (or being received)
+ * at once. While they're all in use, the radio is still read, but the commands it
+ * receives are dropped
+ */
+#define DATALINK_COMMAND_POOL_SIZE 8
+
+/**
+ * A received uplink command. The data points into the receive buffer the
+ * command was parsed into, and is 2 byte aligned so that it can be cast
+ */
 typedef struct DatalinkCommand {
     uint8_t cmd;
     uint8_t data_length;
     uint8_t* data;
+    uint32_t received_time; //us
     struct DatalinkCommand* next;
 } DatalinkCommand;
 
+/**
+ * How quickly uplink commands are being applied
+ */
+typedef struct {
+    uint32_t mean_latency, max_latency; //us, from a command being received to it being freed
+    uint16_t applied; //commands freed
+    uint8_t queue_depth; //commands waiting to be popped
+    uint8_t max_queue_depth;
+    uint16_t dropped; //commands received while every command slot was in use
+} UplinkStats;
+
 /**
  * Initializes the data link connection. Initializes the specified Radio as 
  * well as sets up the internal command buffer
@@ -144,8 +399,9 @@ void initDatalink(void);
  * from the ground station, will parse the command and add to the internal command
  * queue. This function should be called whenever possible, as it is non-blocking,
  * and will add at most a single command
+ * @return Whether a command was added
  */
-void parseDatalinkBuffer(void);
+bool parseDatalinkBuffer(void);
 
 /**
  * Pop a command from the internal command queue
@@ -154,17 +410,48 @@ void parseDatalinkBuffer(void);
 DatalinkCommand* popDatalinkCommand(void);
 
 /**
- * Destroys a command appropriately. Make sure to use this method rather than
- * calling free() on a Command yourself
+ * Gets the next command of the internal command queue without popping it
+ * @return The command, or NULL if there are no commands available
+ */
+DatalinkCommand* peekDatalinkCommand(void);
+
+/**
+ * Returns a command to the command pool once it's been applied, which also
+ * counts it towards the uplink latency. The command and its data can't be used
+ * afterwards
  * @param to_destroy
  */
 void freeDatalinkCommand(DatalinkCommand* to_destroy);
 
+/**
+ * Gets the uplink stats since the last call, and resets them. The queue depth is
+ * the current one
+ * @param stats Set to the stats
+ */
+void getUplinkStats(UplinkStats* stats);
+
 /**
  * @return The packet type that should be sent down in the next transmission
  */
 PacketType getNextPacketType(void);
 
+/**
+ * @return The packet type that getNextPacketType() will return next, without
+ *      moving on to the following one
+ */
+PacketType peekNextPacketType(void);
+
+/**
+ * @return Time in ms that should pass between downlink frames
+ */
+uint16_t getDownlinkInterval(void);
+
+/**
+ * Adapts the downlink interval and packet mix to how backed up the radio is. Should
+ * be called once per downlink frame, after it was queued
+ */
+void updateDownlinkRate(void);
+
 /**
  * Call this method to request a specific packet type to be queued down in the downlink.
  * This call will make this packet type take priority over the continous/default packets
@@ -173,10 +460,27 @@ PacketType getNextPacketType(void);
 void queuePacketType(PacketType type);
 
 /**
- * Queues a telemetry block to be sent down the data link
+ * Packs a telemetry block into the downlink frame. If the frame doesn't have room
+ * for the block, the frame is queued to be sent down the data link first, and the
+ * block starts a new one. Blocks in RELIABLE_PACKET_TYPES are queued straight away
+ * in a frame of their own instead
  * @param data
- * @return True if successfully queued, false otherwise
+ * @return True if successfully packed, false if a full frame couldn't be queued
  */
 bool queueTelemetryBlock(TelemetryBlock* data);
 
+/**
+ * @param type
+ * @return Whether a telemetry block of this type fits in the downlink frame without
+ *      having to queue the frame first
+ */
+bool telemetryBlockFits(PacketType type);
+
+/**
+ * Queues the downlink frame to be sent down the data link, if anything has been
+ * packed into it
+ * @return True if successfully queued (or there was nothing to queue), false otherwise
+ */
+bool flushTelemetryBlocks(void);
+
 #endif
@@ -0,0 +1,289 @@
+/**
+ * @file Mavlink.c
+ * @author Waterloo Aerial Robotics Group
+ * @date October 18, 2026
+ * @copyright Waterloo Aerial Robotics Group 2017 \n
+ *   https://raw.githubusercontent.com/UWARG/PICpilot/master/LICENCE
+ */
+
+#include "Mavlink.h"
+#include "../../Common/Interfaces/UART.h"
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Parser states, in the order the fields of a frame are received
+ */
+enum {
+    MAVLINK_PARSE_STX = 0,
+    MAVLINK_PARSE_LENGTH,
+    MAVLINK_PARSE_INCOMPAT_FLAGS,
+    MAVLINK_PARSE_COMPAT_FLAGS,
+    MAVLINK_PARSE_SEQUENCE,
+    MAVLINK_PARSE_SYSTEM_ID,
+    MAVLINK_PARSE_COMPONENT_ID,
+    MAVLINK_PARSE_MSG_ID,
+    MAVLINK_PARSE_PAYLOAD,
+    MAVLINK_PARSE_CRC,
+    MAVLINK_PARSE_SIGNATURE
+};
+
+typedef struct {
+    uint8_t msg_id;
+    uint8_t length;
+    uint8_t crc_extra;
+} MavlinkMessageInfo;
+
+/**
+ * The messages we know about, and so can receive. All their ids fit in a byte
+ */
+static const MavlinkMessageInfo message_info[] = {
+    {MAVLINK_MSG_ID_HEARTBEAT, MAVLINK_MSG_HEARTBEAT_LEN, MAVLINK_MSG_HEARTBEAT_CRC},
+    {MAVLINK_MSG_ID_SYS_STATUS, MAVLINK_MSG_SYS_STATUS_LEN, MAVLINK_MSG_SYS_STATUS_CRC},
+    {MAVLINK_MSG_ID_ATTITUDE, MAVLINK_MSG_ATTITUDE_LEN, MAVLINK_MSG_ATTITUDE_CRC},
+    {MAVLINK_MSG_ID_GLOBAL_POSITION_INT, MAVLINK_MSG_GLOBAL_POSITION_INT_LEN, MAVLINK_MSG_GLOBAL_POSITION_INT_CRC},
+    {MAVLINK_MSG_ID_MISSION_CURRENT, MAVLINK_MSG_MISSION_CURRENT_LEN, MAVLINK_MSG_MISSION_CURRENT_CRC},
+    {MAVLINK_MSG_ID_MISSION_REQUEST_LIST, MAVLINK_MSG_MISSION_REQUEST_LIST_LEN, MAVLINK_MSG_MISSION_REQUEST_LIST_CRC},
+    {MAVLINK_MSG_ID_MISSION_COUNT, MAVLINK_MSG_MISSION_COUNT_LEN, MAVLINK_MSG_MISSION_COUNT_CRC},
+    {MAVLINK_MSG_ID_MISSION_CLEAR_ALL, MAVLINK_MSG_MISSION_CLEAR_ALL_LEN, MAVLINK_MSG_MISSION_CLEAR_ALL_CRC},
+    {MAVLINK_MSG_ID_MISSION_ITEM_REACHED, MAVLINK_MSG_MISSION_ITEM_REACHED_LEN, MAVLINK_MSG_MISSION_ITEM_REACHED_CRC},
+    {MAVLINK_MSG_ID_MISSION_ACK, MAVLINK_MSG_MISSION_ACK_LEN, MAVLINK_MSG_MISSION_ACK_CRC},
+    {MAVLINK_MSG_ID_MISSION_REQUEST_INT, MAVLINK_MSG_MISSION_REQUEST_INT_LEN, MAVLINK_MSG_MISSION_REQUEST_INT_CRC},
+    {MAVLINK_MSG_ID_MISSION_ITEM_INT, MAVLINK_MSG_MISSION_ITEM_INT_LEN, MAVLINK_MSG_MISSION_ITEM_INT_CRC},
+    {MAVLINK_MSG_ID_RADIO_STATUS, MAVLINK_MSG_RADIO_STATUS_LEN, MAVLINK_MSG_RADIO_STATUS_CRC},
+    {MAVLINK_MSG_ID_V2_EXTENSION, MAVLINK_MSG_V2_EXTENSION_LEN, MAVLINK_MSG_V2_EXTENSION_CRC},
+};
+
+#define MESSAGE_INFO_COUNT (sizeof(message_info) / sizeof(message_info[0]))
+
+/**
+ * Sequence number of the next sent message
+ */
+static uint8_t tx_sequence = 0;
+
+static uint16_t dropped_messages = 0;
+
+static const MavlinkMessageInfo* getMessageInfo(uint32_t msg_id);
+static void trackSequence(MavlinkParser* parser, const MavlinkMessage* message);
+static bool beginMessage(uint8_t interface, uint32_t msg_id, uint8_t length, uint16_t* crc);
+static void writeMessageData(uint8_t interface, const uint8_t* data, uint8_t length, uint16_t* crc);
+static void endMessage(uint8_t interface, uint8_t crc_extra, uint16_t crc);
+
+uint16_t mavlinkCrcAccumulate(uint8_t byte, uint16_t crc){
+    uint8_t tmp = byte ^ (uint8_t)crc;
+    tmp ^= tmp << 4;
+    return (crc >> 8) ^ ((uint16_t)tmp << 8) ^ ((uint16_t)tmp << 3) ^ (tmp >> 4);
+}
+
+bool sendMavlinkMessage(uint8_t interface, uint32_t msg_id, const void* payload, uint8_t length, uint8_t crc_extra){
+    uint16_t crc;
+
+    if (!beginMessage(interface, msg_id, length, &crc)){
+        return false;
+    }
+    writeMessageData(interface, payload, length, &crc);
+    endMessage(interface, crc_extra, crc);
+    return true;
+}
+
+bool sendMavlinkExtension(uint8_t interface, uint16_t message_type, const uint8_t* data, uint8_t data_length){
+    //message type, then broadcast to every network, system and component
+    uint8_t header[MAVLINK_EXTENSION_HEADER_LENGTH] = {message_type & 0xFF, message_type >> 8, 0, 0, 0};
+    uint16_t crc;
+
+    if (data_length > MAVLINK_EXTENSION_MAX_DATA_LENGTH){
+        return false;
+    }
+    if (!beginMessage(interface, MAVLINK_MSG_ID_V2_EXTENSION, MAVLINK_EXTENSION_HEADER_LENGTH + data_length, &crc)){
+        return false;
+    }
+    writeMessageData(interface, header, MAVLINK_EXTENSION_HEADER_LENGTH, &crc);
+    writeMessageData(interface, data, data_length, &crc);
+    endMessage(interface, MAVLINK_MSG_V2_EXTENSION_CRC, crc);
+    return true;
+}
+
+uint16_t getMavlinkDroppedMessages(void){
+    return dropped_messages;
+}
+
+bool parseMavlinkByte(MavlinkParser* parser, uint8_t byte){
+    MavlinkMessage* message = &parser->message;
+    const MavlinkMessageInfo* info;
+
+    if (parser->state != MAVLINK_PARSE_STX && parser->state < MAVLINK_PARSE_CRC){
+        parser->crc = mavlinkCrcAccumulate(byte, parser->crc);
+    }
+
+    switch (parser->state){
+        case MAVLINK_PARSE_STX:
+            if (byte == MAVLINK_STX){
+                parser->crc = 0xFFFF;
+                parser->state = MAVLINK_PARSE_LENGTH;
+            }
+            break;
+        case MAVLINK_PARSE_LENGTH:
+            message->length = byte;
+            parser->state = MAVLINK_PARSE_INCOMPAT_FLAGS;
+            break;
+        case MAVLINK_PARSE_INCOMPAT_FLAGS:
+            parser->incompat_flags = byte;
+            parser->state = (byte & ~MAVLINK_IFLAG_SIGNED) ? MAVLINK_PARSE_STX : MAVLINK_PARSE_COMPAT_FLAGS;
+            break;
+        case MAVLINK_PARSE_COMPAT_FLAGS:
+            parser->state = MAVLINK_PARSE_SEQUENCE;
+            break;
+        case MAVLINK_PARSE_SEQUENCE:
+            message->sequence = byte;
+            parser->state = MAVLINK_PARSE_SYSTEM_ID;
+            break;
+        case MAVLINK_PARSE_SYSTEM_ID:
+            message->system_id = byte;
+            parser->state = MAVLINK_PARSE_COMPONENT_ID;
+            break;
+        case MAVLINK_PARSE_COMPONENT_ID:
+            message->component_id = byte;
+            message->msg_id = 0;
+            parser->position = 0;
+            parser->state = MAVLINK_PARSE_MSG_ID;
+            break;
+        case MAVLINK_PARSE_MSG_ID:
+            message->msg_id |= (uint32_t)byte << (8 * parser->position);
+            parser->position++;
+            if (parser->position == 3){
+                parser->position = 0;
+                parser->state = message->length ? MAVLINK_PARSE_PAYLOAD : MAVLINK_PARSE_CRC;
+            }
+            break;
+        case MAVLINK_PARSE_PAYLOAD:
+            message->payload[parser->position] = byte;
+            parser->position++;
+            if (parser->position == message->length){
+                parser->position = 0;
+                parser->state = MAVLINK_PARSE_CRC;
+            }
+            break;
+        case MAVLINK_PARSE_CRC:
+            if (parser->position == 0){
+                parser->received_crc = byte;
+                parser->position++;
+                break;
+            }
+            parser->received_crc |= (uint16_t)byte << 8;
+            parser->position = 0;
+            parser->state = MAVLINK_PARSE_STX;
+
+            info = getMessageInfo(message->msg_id);
+            if (info == NULL){
+                parser->stats.unknown++;
+                break;
+            }
+            if (mavlinkCrcAccumulate(info->crc_extra, parser->crc) != parser->received_crc){
+                parser->stats.crc_errors++;
+                break;
+            }
+
+            trackSequence(parser, message);
+            parser->stats.received++;
+
+            //restore the trailing zeros v2 trims off
+            if (message->length < info->length){
+                memset(&message->payload[message->length], 0, info->length - message->length);
+            }
+            if (parser->incompat_flags & MAVLINK_IFLAG_SIGNED){
+                //the signature isn't checked, but has to be skipped over
+                parser->state = MAVLINK_PARSE_SIGNATURE;
+            }
+            return true;
+        case MAVLINK_PARSE_SIGNATURE:
+            parser->position++;
+            if (parser->position == MAVLINK_SIGNATURE_LENGTH){
+                parser->position = 0;
+                parser->state = MAVLINK_PARSE_STX;
+            }
+            break;
+        default:
+            parser->state = MAVLINK_PARSE_STX;
+            break;
+    }
+    return false;
+}
+
+static const MavlinkMessageInfo* getMessageInfo(uint32_t msg_id){
+    uint8_t i;
+    for (i = 0; i < MESSAGE_INFO_COUNT; i++){
+        if (message_info[i].msg_id == msg_id){
+            return &message_info[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Counts the messages missed from the sender of a received message, since the
+ * last message from it
+ */
+static void trackSequence(MavlinkParser* parser, const MavlinkMessage* message){
+    MavlinkSender* sender = NULL;
+    uint8_t i;
+
+    for (i = 0; i < parser->sender_count; i++){
+        if (parser->senders[i].system_id == message->system_id){
+            sender = &parser->senders[i];
+            parser->stats.sequence_gaps += (uint8_t)(message->sequence - sender->expected_sequence);
+            break;
+        }
+    }
+    if (sender == NULL){
+        if (parser->sender_count == MAVLINK_MAX_SENDERS){
+            return;
+        }
+        sender = &parser->senders[parser->sender_count++];
+        sender->system_id = message->system_id;
+    }
+    sender->expected_sequence = message->sequence + 1;
+}
+
+/**
+ * Queues the frame header, if there's space in the UART TX buffer for the whole frame
+ * @param crc Set to the CRC of the header
+ * @return Whether the header was queued
+ */
+static bool beginMessage(uint8_t interface, uint32_t msg_id, uint8_t length, uint16_t* crc){
+    uint8_t header[MAVLINK_HEADER_LENGTH] = {MAVLINK_STX, length, 0, 0, tx_sequence,
+        MAVLINK_SYSTEM_ID, MAVLINK_COMPONENT_ID, msg_id & 0xFF, (msg_id >> 8) & 0xFF, (msg_id >> 16) & 0xFF};
+    uint8_t i;
+
+    if (getTXSpace(interface) < MAVLINK_FRAME_OVERHEAD + length){
+        dropped_messages++;
+        return false;
+    }
+
+    *crc = 0xFFFF;
+    for (i = 1; i < MAVLINK_HEADER_LENGTH; i++){ //the STX isn't part of the CRC
+        *crc = mavlinkCrcAccumulate(header[i], *crc);
+    }
+    queueTXData(interface, header, MAVLINK_HEADER_LENGTH);
+    tx_sequence++;
+    return true;
+}
+
+/**
+ * Queues part of the payload, straight from where it is
+ */
+static void writeMessageData(uint8_t interface, const uint8_t* data, uint8_t length, uint16_t* crc){
+    uint8_t i;
+    for (i = 0; i < length; i++){
+        *crc = mavlinkCrcAccumulate(data[i], *crc);
+    }
+    queueTXData(interface, (uint8_t*)data, length);
+}
+
+static void endMessage(uint8_t interface, uint8_t crc_extra, uint16_t crc){
+    uint8_t checksum[MAVLINK_CHECKSUM_LENGTH];
+
+    crc = mavlinkCrcAccumulate(crc_extra, crc);
+    checksum[0] = crc & 0xFF;
+    checksum[1] = crc >> 8;
+    queueTXData(interface, checksum, MAVLINK_CHECKSUM_LENGTH);
+}
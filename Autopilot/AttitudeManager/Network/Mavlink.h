@@ -0,0 +1,287 @@
+/**
+ * @file Mavlink.h
+ * @author Waterloo Aerial Robotics Group
+ * @date October 18, 2026
+ * @brief
+ * Minimal MAVLink v2 framing, for the messages the autopilot sends and receives.
+ * Messages are serialised straight from their payload structs into a UART TX
+ * buffer, with the CRC computed as the bytes are queued, so no frame is ever built
+ * up in memory. Received frames are parsed a byte at a time, with the CRC updated
+ * incrementally, so that the parser can be fed from the UART RX buffer as data
+ * arrives.
+ *
+ * Only the messages below are known. Payload structs are laid out in MAVLink wire
+ * order (fields sorted by size), which the dsPIC's little endian, 2 byte aligned
+ * layout matches, so they can be sent as is. Their sizeof() may include trailing
+ * padding, so always send MAVLINK_MSG_*_LEN bytes.
+ *
+ * @see https://mavlink.io/en/guide/serialization.html
+ * @copyright Waterloo Aerial Robotics Group 2017 \n
+ *   https://raw.githubusercontent.com/UWARG/PICpilot/master/LICENCE
+ */
+
+#ifndef MAVLINK_H
+#define	MAVLINK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * System and component id of the autopilot (MAV_COMP_ID_AUTOPILOT1)
+ */
+#define MAVLINK_SYSTEM_ID 1
+#define MAVLINK_COMPONENT_ID 1
+
+/**
+ * First byte of every MAVLink v2 frame
+ */
+#define MAVLINK_STX 0xFD
+
+/**
+ * A frame is the STX, 9 header bytes, the payload and 2 CRC bytes. Signed frames
+ * have 13 more signature bytes after the CRC
+ */
+#define MAVLINK_HEADER_LENGTH 10
+#define MAVLINK_CHECKSUM_LENGTH 2
+#define MAVLINK_FRAME_OVERHEAD (MAVLINK_HEADER_LENGTH + MAVLINK_CHECKSUM_LENGTH)
+#define MAVLINK_SIGNATURE_LENGTH 13
+#define MAVLINK_MAX_PAYLOAD_LENGTH 255
+
+/**
+ * Incompatibility flag set on signed frames. Frames with any other incompatibility
+ * flag set are dropped
+ */
+#define MAVLINK_IFLAG_SIGNED 0x01
+
+/**
+ * Message ids, payload lengths (without v2 extension fields) and CRC extra bytes
+ * of the messages we know about
+ */
+#define MAVLINK_MSG_ID_HEARTBEAT 0
+#define MAVLINK_MSG_HEARTBEAT_LEN 9
+#define MAVLINK_MSG_HEARTBEAT_CRC 50
+
+#define MAVLINK_MSG_ID_SYS_STATUS 1
+#define MAVLINK_MSG_SYS_STATUS_LEN 31
+#define MAVLINK_MSG_SYS_STATUS_CRC 124
+
+#define MAVLINK_MSG_ID_ATTITUDE 30
+#define MAVLINK_MSG_ATTITUDE_LEN 28
+#define MAVLINK_MSG_ATTITUDE_CRC 39
+
+#define MAVLINK_MSG_ID_GLOBAL_POSITION_INT 33
+#define MAVLINK_MSG_GLOBAL_POSITION_INT_LEN 28
+#define MAVLINK_MSG_GLOBAL_POSITION_INT_CRC 104
+
+#define MAVLINK_MSG_ID_MISSION_CURRENT 42
+#define MAVLINK_MSG_MISSION_CURRENT_LEN 2
+#define MAVLINK_MSG_MISSION_CURRENT_CRC 28
+
+#define MAVLINK_MSG_ID_MISSION_REQUEST_LIST 43
+#define MAVLINK_MSG_MISSION_REQUEST_LIST_LEN 2
+#define MAVLINK_MSG_MISSION_REQUEST_LIST_CRC 132
+
+#define MAVLINK_MSG_ID_MISSION_COUNT 44
+#define MAVLINK_MSG_MISSION_COUNT_LEN 4
+#define MAVLINK_MSG_MISSION_COUNT_CRC 221
+
+#define MAVLINK_MSG_ID_MISSION_CLEAR_ALL 45
+#define MAVLINK_MSG_MISSION_CLEAR_ALL_LEN 2
+#define MAVLINK_MSG_MISSION_CLEAR_ALL_CRC 232
+
+#define MAVLINK_MSG_ID_MISSION_ITEM_REACHED 46
+#define MAVLINK_MSG_MISSION_ITEM_REACHED_LEN 2
+#define MAVLINK_MSG_MISSION_ITEM_REACHED_CRC 11
+
+#define MAVLINK_MSG_ID_MISSION_ACK 47
+#define MAVLINK_MSG_MISSION_ACK_LEN 3
+#define MAVLINK_MSG_MISSION_ACK_CRC 153
+
+#define MAVLINK_MSG_ID_MISSION_REQUEST_INT 51
+#define MAVLINK_MSG_MISSION_REQUEST_INT_LEN 4
+#define MAVLINK_MSG_MISSION_REQUEST_INT_CRC 196
+
+#define MAVLINK_MSG_ID_MISSION_ITEM_INT 73
+#define MAVLINK_MSG_MISSION_ITEM_INT_LEN 37
+#define MAVLINK_MSG_MISSION_ITEM_INT_CRC 38
+
+#define MAVLINK_MSG_ID_RADIO_STATUS 109
+#define MAVLINK_MSG_RADIO_STATUS_LEN 9
+#define MAVLINK_MSG_RADIO_STATUS_CRC 185
+
+#define MAVLINK_MSG_ID_V2_EXTENSION 248
+#define MAVLINK_MSG_V2_EXTENSION_LEN 254
+#define MAVLINK_MSG_V2_EXTENSION_CRC 8
+
+/**
+ * The V2_EXTENSION header before the tunnelled data: message type, target network,
+ * system and component
+ */
+#define MAVLINK_EXTENSION_HEADER_LENGTH 5
+#define MAVLINK_EXTENSION_MAX_DATA_LENGTH (MAVLINK_MSG_V2_EXTENSION_LEN - MAVLINK_EXTENSION_HEADER_LENGTH)
+
+/**
+ * Sends a message with one of the payload structs below, ie.
+ * MAVLINK_SEND(2, HEARTBEAT, &heartbeat)
+ */
+#define MAVLINK_SEND(interface, name, payload) sendMavlinkMessage(interface, \
+        MAVLINK_MSG_ID_##name, payload, MAVLINK_MSG_##name##_LEN, MAVLINK_MSG_##name##_CRC)
+
+typedef struct {
+    uint32_t custom_mode;
+    uint8_t type; //MAV_TYPE
+    uint8_t autopilot; //MAV_AUTOPILOT
+    uint8_t base_mode; //MAV_MODE_FLAG
+    uint8_t system_status; //MAV_STATE
+    uint8_t mavlink_version;
+} MavlinkHeartbeat;
+
+typedef struct {
+    uint32_t onboard_control_sensors_present;
+    uint32_t onboard_control_sensors_enabled;
+    uint32_t onboard_control_sensors_health;
+    uint16_t load; //0.1%
+    uint16_t voltage_battery; //mV
+    int16_t current_battery; //10mA, -1 if unknown
+    uint16_t drop_rate_comm; //0.01%
+    uint16_t errors_comm;
+    uint16_t errors_count1, errors_count2, errors_count3, errors_count4;
+    int8_t battery_remaining; //%, -1 if unknown
+} MavlinkSysStatus;
+
+typedef struct {
+    uint32_t time_boot_ms;
+    float roll, pitch, yaw; //rad
+    float rollspeed, pitchspeed, yawspeed; //rad/s
+} MavlinkAttitude;
+
+typedef struct {
+    uint32_t time_boot_ms;
+    int32_t lat, lon; //1e-7 degrees
+    int32_t alt, relative_alt; //mm
+    int16_t vx, vy, vz; //cm/s, north east down
+    uint16_t hdg; //0.01 degrees, UINT16_MAX if unknown
+} MavlinkGlobalPositionInt;
+
+typedef struct {
+    uint16_t seq;
+} MavlinkMissionCurrent;
+
+typedef struct {
+    uint16_t count;
+    uint8_t target_system, target_component;
+} MavlinkMissionCount;
+
+typedef struct {
+    uint8_t target_system, target_component;
+    uint8_t type; //MAV_MISSION_RESULT
+} MavlinkMissionAck;
+
+typedef struct {
+    uint16_t seq;
+    uint8_t target_system, target_component;
+} MavlinkMissionRequestInt;
+
+typedef struct {
+    float param1, param2, param3, param4;
+    int32_t x, y; //1e-7 degrees
+    float z;
+    uint16_t seq;
+    uint16_t command; //MAV_CMD
+    uint8_t target_system, target_component;
+    uint8_t frame; //MAV_FRAME
+    uint8_t current;
+    uint8_t autocontinue;
+} MavlinkMissionItemInt;
+
+typedef struct {
+    uint16_t rxerrors;
+    uint16_t fixed;
+    uint8_t rssi, remrssi;
+    uint8_t txbuf; //% of the radio's TX buffer that is free
+    uint8_t noise, remnoise;
+} MavlinkRadioStatus;
+
+/**
+ * A received message. Payloads shorter than the message's length (v2 trims trailing
+ * zeros) are zero filled, so the payload can be cast to the message's struct
+ */
+typedef struct {
+    uint32_t msg_id;
+    uint8_t length; //as received
+    uint8_t sequence;
+    uint8_t system_id;
+    uint8_t component_id;
+    uint8_t payload[MAVLINK_MAX_PAYLOAD_LENGTH];
+} MavlinkMessage;
+
+typedef struct {
+    uint16_t received; //valid messages
+    uint16_t crc_errors;
+    uint16_t unknown; //well formed frames of messages we don't know the CRC extra of
+    uint16_t sequence_gaps; //messages missed, according to the sequence numbers of each system
+} MavlinkParserStats;
+
+/**
+ * Number of systems on a link whose sequence numbers are tracked. Each system
+ * numbers its messages on its own (ie the ground station and the radio). Gaps
+ * aren't counted for systems past the first ones heard from
+ */
+#define MAVLINK_MAX_SENDERS 4
+
+typedef struct {
+    uint8_t system_id;
+    uint8_t expected_sequence;
+} MavlinkSender;
+
+/**
+ * Receive state. One of these per link, zero it before use
+ */
+typedef struct {
+    uint8_t state;
+    uint8_t position; //within the current state
+    uint8_t incompat_flags;
+    uint16_t crc;
+    uint16_t received_crc;
+    MavlinkSender senders[MAVLINK_MAX_SENDERS];
+    uint8_t sender_count;
+    MavlinkMessage message;
+    MavlinkParserStats stats;
+} MavlinkParser;
+
+/**
+ * Adds a byte to a CRC-16/MCRF4XX (X.25) checksum. Start with 0xFFFF
+ */
+uint16_t mavlinkCrcAccumulate(uint8_t byte, uint16_t crc);
+
+/**
+ * Serialises a message into the UART TX buffer. The whole frame is queued, or
+ * nothing is if there isn't enough space for it
+ * @param interface UART interface to send on
+ * @param payload Payload, in wire order
+ * @return Whether the message was queued
+ */
+bool sendMavlinkMessage(uint8_t interface, uint32_t msg_id, const void* payload, uint8_t length, uint8_t crc_extra);
+
+/**
+ * Tunnels arbitrary data in a V2_EXTENSION message, broadcast to all systems
+ * @param message_type Identifies the protocol of the data. Values from 32768 are
+ *      for private use
+ * @param data_length At most MAVLINK_EXTENSION_MAX_DATA_LENGTH
+ * @return Whether the message was queued
+ */
+bool sendMavlinkExtension(uint8_t interface, uint16_t message_type, const uint8_t* data, uint8_t data_length);
+
+/**
+ * @return Number of messages that weren't queued because the TX buffer was full
+ */
+uint16_t getMavlinkDroppedMessages(void);
+
+/**
+ * Parses the next received byte
+ * @return Whether the byte completed a valid message, which is then in
+ *      parser->message until the next byte is parsed
+ */
+bool parseMavlinkByte(MavlinkParser* parser, uint8_t byte);
+
+#endif
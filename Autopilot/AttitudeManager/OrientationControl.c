@@ -55,9 +55,11 @@ void setGain(ControlChannel channel, GainType type, float value){
         } else if (type == KI){
             pids[channel].ki = value;
             pids[channel].integral = 0; // if we change the Ki (tuning), reset the integrator.
+            pids[channel].integral_q = 0;
         } else if (type == KD){
             pids[channel].kd = value;
         }
+        updatePIDGains(&pids[channel]);
     }
 }
 
@@ -9,6 +9,9 @@
 
 static uint16_t oc_values[8];
 
+/** Bit mask of the channels that were enabled by initOC() */
+static uint8_t enabled_channels = 0;
+
 uint16_t* getOCValues(){
     return oc_values;
 }
@@ -48,8 +51,49 @@ void setOCValue(unsigned int channel, unsigned int duty)
     }
 }
 
+void setAllOCValues(const uint16_t* duty)
+{
+    uint8_t i;
+    for (i = 0; i < 8; i++) {
+        if (enabled_channels & (1 << i)) {
+            oc_values[i] = duty[i];
+        }
+    }
+
+    //Interrupts are held off so that the writes can't be delayed past the end of the period
+    __builtin_disi(0x3FFF);
+    while (TMR2 >= PR2 - OC_UPDATE_GUARD_TICKS); //wait for the new period to start
+    if (enabled_channels & 0b1) {
+        OC1RS = duty[0];
+    }
+    if (enabled_channels & 0b10) {
+        OC2RS = duty[1];
+    }
+    if (enabled_channels & 0b100) {
+        OC3RS = duty[2];
+    }
+    if (enabled_channels & 0b1000) {
+        OC4RS = duty[3];
+    }
+    if (enabled_channels & 0b10000) {
+        OC5RS = duty[4];
+    }
+    if (enabled_channels & 0b100000) {
+        OC6RS = duty[5];
+    }
+    if (enabled_channels & 0b1000000) {
+        OC7RS = duty[6];
+    }
+    if (enabled_channels & 0b10000000) {
+        OC8RS = duty[7];
+    }
+    DISICNT = 0;
+}
+
 void initOC(char OC)
 {
+    enabled_channels = OC;
+
     //Initialize each of the 8 OCs
     if (OC & 0b1) {
         OC1CONbits.OCM = 0b000; // Disable Output Compare Module )required to set it as something else)
@@ -11,6 +11,13 @@
 
 #include <stdint.h>
 
+/**
+ * Number of Timer2 ticks before the end of the PWM period in which setAllOCValues()
+ * won't start writing the outputs, so that the writes can't straddle the end of
+ * the period. Writing all 8 takes well under one tick (64 cycles)
+ */
+#define OC_UPDATE_GUARD_TICKS 4
+
 /**
  * Initializes the output compare registers and pins for PWM output. Writes a 1.5 ms
  * duty cycle on the selected channels to start off with
@@ -25,6 +32,16 @@ void initOC(char OC);
  */
 void setOCValue(unsigned int channel, unsigned int duty);
 
+/**
+ * Sets the PWM of all 8 output pins at once. The new duty cycles are only loaded
+ * by the hardware at the end of the current PWM period, and they're all written
+ * within the same period, so all the outputs change on the same pulse. May wait
+ * for up to OC_UPDATE_GUARD_TICKS Timer2 ticks if the period is about to end.
+ * Only the channels enabled by initOC() are written, the others keep their value
+ * @param duty Array of size 8 of the times/duty cycles in Timer2 ticks
+ */
+void setAllOCValues(const uint16_t* duty);
+
 
 /**
  * Retrieve the set values for the output compare
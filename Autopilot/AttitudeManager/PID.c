@@ -8,12 +8,25 @@
 
 #include "PID.h"
 #include "../Common/Clock/Timer.h"
+#include "../Common/Utilities/Logger.h"
+#include <math.h>
 
 /**
  * Filtering constant for derivative. Between 0 and 1.
  * The larger this is, the more twitchy D control is. 
  */
 #define FILTER 0.4f
+#define FILTER_Q Q16(0.4)
+
+/** Time in us that has to elapse before the I and D terms are calculated */
+#define MIN_DELTA_USEC 500
+
+/* Time of the current control step, and its interval precomputed for all loops */
+static uint64_t step_time = 0;
+static uint32_t step_delta_usec = 0;
+static float step_seconds = 0;
+static float step_inverse = 0;
+static q16_t step_inverse_q = 0;
 
 /* Generic PID functions. Can be used to PID other things (flaps, etc) */
 
@@ -27,32 +40,73 @@ void initPID(PIDVal* pid, float kp, float ki, float kd, int16_t i_max) {
     pid->last_time = 0;
     pid->last_err = 0;
     pid->last_der = 0;
+    pid->integral_q = 0;
+    pid->last_err_q = 0;
+    pid->last_der_q = 0;
+    pid->scale = 0;
+    pid->scale_q = 0;
+    updatePIDGains(pid);
+}
+
+void updatePIDGains(PIDVal* pid) {
+    pid->kp_q = floatToQ16(pid->kp);
+    pid->ki_q = floatToQ16(pid->ki);
+    pid->kd_q = floatToQ16(pid->kd);
+    pid->i_max_q = INT_TO_Q16(pid->i_max);
+}
+
+void setPIDStepTime(uint64_t time_usec, uint32_t delta_usec) {
+    step_time = time_usec;
+    if (delta_usec != step_delta_usec && delta_usec > MIN_DELTA_USEC) {
+        step_delta_usec = delta_usec;
+        step_seconds = delta_usec / 1e6f;
+        step_inverse = 1e6f / delta_usec;
+        step_inverse_q = q16InverseMicros(delta_usec);
+    }
 }
 
 // PID loop function. error is (setpointValue - currentValue)
 float PIDcontrol(PIDVal* pid, float error, float scale) {
+    uint32_t delta_usec = (step_time - pid->last_time);
+
+    // the first update resets the I and D terms, same as going too long without updating
+    if (pid->last_time == 0) {
+        delta_usec = PID_RESET_TIME + 1;
+    }
+    pid->last_time = step_time;
+
+#if PID_FIXED_POINT
+    // every loop is always called with the same scale, so it is only converted once
+    if (scale != pid->scale) {
+        pid->scale = scale;
+        pid->scale_q = floatToQ16(scale);
+    }
+    return q16ToFloat(PIDcontrolFixed(pid, floatToQ16(error), pid->scale_q, delta_usec));
+#else
+    return PIDcontrolFloat(pid, error, scale, delta_usec);
+#endif
+}
+
+float PIDcontrolFloat(PIDVal* pid, float error, float scale, uint32_t delta_usec) {
     float output = 0;
-        
-    uint64_t now = getTimeUs();
-    uint32_t delta_usec = (now - pid->last_time);
-    
+
     // check if we've gone too long without updating (keeps the I and D from freaking out)
-    if (delta_usec > PID_RESET_TIME || pid->last_time == 0) {
+    if (delta_usec > PID_RESET_TIME) {
         delta_usec = 0;
         pid->integral = 0;
         pid->last_err = error;
     }
-    
-    pid->last_time = now;
 
     output += pid->kp * error; // Proportional control
-    
-    if (delta_usec > 500) { // only compute time-sensitive control if time has elapsed (more then 500 us)
-        float dTime = delta_usec / 1e6f; // elapsed time in seconds
-        
+
+    if (delta_usec > MIN_DELTA_USEC) { // only compute time-sensitive control if time has elapsed (more then 500 us)
+        // elapsed time in seconds. Loops that ran in the last step can use the precomputed values
+        float dTime = (delta_usec == step_delta_usec) ? step_seconds : delta_usec / 1e6f;
+        float inverse = (delta_usec == step_delta_usec) ? step_inverse : 1 / dTime;
+
         if (fabsf(pid->ki) > 0) { // Integral control
             pid->integral += (pid->ki * error) * dTime;
-            
+
             if (pid->integral < -pid->i_max) { // ensure integral stays manageable
                 pid->integral = -pid->i_max;
             } else if (pid->integral > pid->i_max) {
@@ -62,14 +116,69 @@ float PIDcontrol(PIDVal* pid, float error, float scale) {
         }
 
         if (fabsf(pid->kd) > 0) { // Derivative control
-            float derivative = (error - pid->last_err) / dTime;
+            float derivative = (error - pid->last_err) * inverse;
             derivative = derivative * FILTER + pid->last_der * (1-FILTER); // reduce jitter in derivative by averaging
             pid->last_err = error;
             pid->last_der = derivative;
             output += pid->kd * derivative;
         }
     }
-    
+
     return output * scale;
 }
 
+q16_t PIDcontrolFixed(PIDVal* pid, q16_t error, q16_t scale, uint32_t delta_usec) {
+    q16_t output;
+
+    if (delta_usec > PID_RESET_TIME) {
+        delta_usec = 0;
+        pid->integral_q = 0;
+        pid->last_err_q = error;
+    }
+
+    output = q16Mul(pid->kp_q, error); // Proportional control
+
+    if (delta_usec > MIN_DELTA_USEC) {
+        if (pid->ki_q != 0) { // Integral control
+            pid->integral_q = q16Add(pid->integral_q, q16MulMicros(q16Mul(pid->ki_q, error), delta_usec));
+
+            if (pid->integral_q < -pid->i_max_q) {
+                pid->integral_q = -pid->i_max_q;
+            } else if (pid->integral_q > pid->i_max_q) {
+                pid->integral_q = pid->i_max_q;
+            }
+            output = q16Add(output, pid->integral_q);
+        }
+
+        if (pid->kd_q != 0) { // Derivative control
+            q16_t inverse = (delta_usec == step_delta_usec) ? step_inverse_q : q16InverseMicros(delta_usec);
+            q16_t derivative = q16Mul(q16Sub(error, pid->last_err_q), inverse);
+            derivative = q16Add(q16Mul(derivative, FILTER_Q), q16Mul(pid->last_der_q, Q16_ONE - FILTER_Q));
+            pid->last_err_q = error;
+            pid->last_der_q = derivative;
+            output = q16Add(output, q16Mul(pid->kd_q, derivative));
+        }
+    }
+
+    return q16Mul(output, scale);
+}
+
+void benchmarkPID(void) {
+    PIDVal pid;
+    uint16_t i;
+    uint64_t start;
+
+    initPID(&pid, 1.5f, 0.5f, 0.05f, 1000);
+    start = getTimeUs();
+    for (i = 0; i < PID_BENCHMARK_ITERATIONS; i++) {
+        PIDcontrolFloat(&pid, (float)(i % 20) - 10.f, 5.6f, 5000);
+    }
+    debugInt("PID float (us)", getTimeUs() - start);
+
+    initPID(&pid, 1.5f, 0.5f, 0.05f, 1000);
+    start = getTimeUs();
+    for (i = 0; i < PID_BENCHMARK_ITERATIONS; i++) {
+        PIDcontrolFixed(&pid, INT_TO_Q16((int16_t)(i % 20) - 10), Q16(5.6), 5000);
+    }
+    debugInt("PID fixed (us)", getTimeUs() - start);
+}
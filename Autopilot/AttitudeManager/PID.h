@@ -9,16 +9,28 @@
 #ifndef PID_H
 #define	PID_H
 
-#include "main.h"
+#include <stdint.h>
+#include "../Common/Utilities/FixedPoint.h"
 
 #define PID_RESET_TIME 500000 // timeout to reset I and D terms (us)
 
-/* 
- * Floating-point PID loops for attitude control. 
+/**
+ * Whether PIDcontrol() uses the Q16.16 fixed-point implementation (1) or the
+ * floating-point one (0). Both keep their state in the same PIDVal struct
+ */
+#define PID_FIXED_POINT 1
+
+/**
+ * Number of iterations benchmarkPID() runs for each implementation
+ */
+#define PID_BENCHMARK_ITERATIONS 100
+
+/*
+ * PID loops for attitude control, in floating-point and Q16.16 fixed-point.
  * Inspired by ArduPilot control code.
- * TODO: convert to fixed-point (integers) for increased speed, decreased size.
- * (could probably do with tenth- or hundredth-degree integers)
- * Floating-point math on the dsPIC33 is done via emulation, and is very slow.
+ * Floating-point math on the dsPIC33 is done via emulation, and is very slow,
+ * so the fixed-point version is used by default. All values must stay within
+ * +-32768 for it (see FixedPoint.h), which is the case for all our control loops.
  */
 
 typedef struct { //holds values for a generic PID loop
@@ -32,6 +44,17 @@ typedef struct { //holds values for a generic PID loop
     float last_der; // last derivative, for filtering
     float integral;
     int16_t i_max; // maximum value for integral
+
+    // Fixed-point gains and state. Gains are kept in sync by updatePIDGains()
+    q16_t kp_q;
+    q16_t ki_q;
+    q16_t kd_q;
+    q16_t i_max_q;
+    float scale; // scale of the last PIDcontrol() call, and its fixed-point value
+    q16_t scale_q;
+    q16_t last_err_q;
+    q16_t last_der_q;
+    q16_t integral_q;
 } PIDVal;
 
 /**
@@ -45,7 +68,26 @@ typedef struct { //holds values for a generic PID loop
 void initPID(PIDVal* pid, float kp, float ki, float kd, int16_t i_max);
 
 /**
- * Calculates output signal from a PID controller
+ * Updates the fixed-point gains from the float gains. Must be called whenever
+ * kp, ki, kd or i_max are changed
+ * @param pid
+ */
+void updatePIDGains(PIDVal* pid);
+
+/**
+ * Sets the time of the current control step. All PIDcontrol() calls until the
+ * next call will use this time rather than reading the clock, so that all loops
+ * in the same step see the same dt. The step interval and its inverse are also
+ * precomputed here once, instead of in every loop
+ * @param time_usec Time of the control step in us
+ * @param delta_usec Time since the last control step in us
+ */
+void setPIDStepTime(uint64_t time_usec, uint32_t delta_usec);
+
+/**
+ * Calculates output signal from a PID controller, using the implementation
+ * selected by PID_FIXED_POINT. The time since the last call is taken from the
+ * step time set by setPIDStepTime()
  * @param pid Pointer to the PIDVal struct to be updated
  * @param error Error value (setpoint - position)
  * @param scale Factor to help with I/O relationships
@@ -53,5 +95,32 @@ void initPID(PIDVal* pid, float kp, float ki, float kd, int16_t i_max);
  */
 float PIDcontrol(PIDVal* pid, float error, float scale);
 
-#endif	/* PID_H */
+/**
+ * Floating-point PID step
+ * @param pid Pointer to the PIDVal struct to be updated
+ * @param error Error value (setpoint - position)
+ * @param scale Factor to help with I/O relationships
+ * @param delta_usec Time since the last step in us. More than PID_RESET_TIME
+ *      resets the I and D terms, which is what the first step should pass
+ * @return Control signal for a PID controller
+ */
+float PIDcontrolFloat(PIDVal* pid, float error, float scale, uint32_t delta_usec);
 
+/**
+ * Q16.16 fixed-point PID step. Same behaviour as PIDcontrolFloat()
+ * @param pid Pointer to the PIDVal struct to be updated
+ * @param error Error value (setpoint - position)
+ * @param scale Factor to help with I/O relationships
+ * @param delta_usec Time since the last step in us. More than PID_RESET_TIME
+ *      resets the I and D terms, which is what the first step should pass
+ * @return Control signal for a PID controller
+ */
+q16_t PIDcontrolFixed(PIDVal* pid, q16_t error, q16_t scale, uint32_t delta_usec);
+
+/**
+ * Times PID_BENCHMARK_ITERATIONS steps of both implementations with all terms
+ * enabled and outputs the results (in us) via the debug logger
+ */
+void benchmarkPID(void);
+
+#endif	/* PID_H */
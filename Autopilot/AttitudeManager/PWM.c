@@ -6,6 +6,8 @@
 #include "OutputCompare.h"
 #include "InputCapture.h"
 #include "../Common/Clock/Timer.h"
+#include "../Common/Utilities/FixedPoint.h"
+#include "../Common/Utilities/Logger.h"
 
 /**
  * Initial scale factors used for scaling the RC inputs to the MIN_PWM - MAX_PWM range,
@@ -36,13 +38,41 @@ static unsigned char disconnected_pwm_inputs;
 static unsigned char enabled_input_channels;
 
 /**
- * Scale factors and offsets for each of the 8 channels
+ * Scale factors and offsets for each of the 8 channels. The scale factors are
+ * converted to Q16.16 when they're set, so that no float math is done when
+ * reading or setting the PWM values
  */
-static float input_scale_factors[NUM_CHANNELS];
+static q16_t input_scale_factors[NUM_CHANNELS];
 static int input_offsets[NUM_CHANNELS];
-static float output_scale_factors[NUM_CHANNELS];
+static q16_t output_scale_factors[NUM_CHANNELS];
 static int output_offsets[NUM_CHANNELS];
 
+/**
+ * The OC values (in Timer2 ticks) of all the outputs, as last written by setAllPWM() or setPWM()
+ */
+static uint16_t oc_duties[NUM_CHANNELS];
+
+/**
+ * Where benchmarkPWM() writes its results, so that they aren't optimized out
+ */
+static volatile uint16_t benchmark_duties[NUM_CHANNELS];
+
+/**
+ * @param channel Zero-indexed channel
+ * @param pwm Value from MIN_PWM to MAX_PWM
+ * @return The OC value for the output, in Timer2 ticks
+ */
+static uint16_t scaleOutput(unsigned int channel, int pwm)
+{
+    int32_t duty = (int32_t)q16ScaleInt(pwm, output_scale_factors[channel]) + output_offsets[channel];
+    return duty < 0 ? 0 : (uint16_t)duty;
+}
+
+int scalePWMInput(unsigned int channel, unsigned int ticks)
+{
+    return q16ScaleInt((int)ticks - input_offsets[channel], input_scale_factors[channel]);
+}
+
 void initPWM(unsigned char inputChannels, unsigned char outputChannels)
 {
     initTimer2();
@@ -55,10 +85,14 @@ void initPWM(unsigned char inputChannels, unsigned char outputChannels)
     //Set the initial offsets and scaling factors
     int i = 0;
     for (i = 0; i < NUM_CHANNELS; i++) {
-        input_scale_factors[i] = DEFAULT_INPUT_SCALE_FACTOR;
-        output_scale_factors[i] = DEFAULT_OUTPUT_SCALE_FACTOR;
+        input_scale_factors[i] = Q16(DEFAULT_INPUT_SCALE_FACTOR);
+        output_scale_factors[i] = Q16(DEFAULT_OUTPUT_SCALE_FACTOR);
         output_offsets[i] = MIDDLE_PWM;
         input_offsets[i] = MIDDLE_PWM;
+        oc_duties[i] = 0;
+#if USE_PPM
+        calibratePPMChannel(i, input_scale_factors[i], input_offsets[i]);
+#endif
     }
 }
 
@@ -66,6 +100,9 @@ int* getPWMArray(unsigned long int sys_time)
 {
     unsigned char channel_enabled;
     unsigned int* ic_values = getICValues(sys_time);
+#if USE_PPM
+    int* ppm_frame = getPPMFrame(); //already calibrated when the frame was received
+#endif
     int channel = 0;
 
     for (channel = 0; channel < NUM_CHANNELS; channel++) {
@@ -77,29 +114,54 @@ int* getPWMArray(unsigned long int sys_time)
             pwm_inputs[channel] = DISCONNECTED_PWM_VALUE;
             disconnected_pwm_inputs = disconnected_pwm_inputs | (1 << channel); //set the bit as 1
         } else { //otherwise if its a connected, enabled channel, calculate its value
-            pwm_inputs[channel] = ((int)(ic_values[channel]) - input_offsets[channel]) * input_scale_factors[channel];
+#if USE_PPM
+            pwm_inputs[channel] = ppm_frame[channel];
+#else
+            pwm_inputs[channel] = scalePWMInput(channel, ic_values[channel]);
+#endif
             disconnected_pwm_inputs = disconnected_pwm_inputs & (~(1 << channel)); //set the bit as 0
         }
     }
     return pwm_inputs;
 }
 
+bool checkNewPWMInputs(unsigned long int sys_time, uint64_t* frame_time)
+{
+#if USE_PPM
+    if (checkNewPPMFrame(frame_time)) {
+        return true;
+    }
+    //no frames come in when the receiver is disconnected, but getPWMArray() still needs to pick it up
+    return !isPPMConnected(sys_time);
+#else
+    if (frame_time) {
+        *frame_time = getTimeUs();
+    }
+    return true;
+#endif
+}
+
 void setPWM(unsigned int channel, int pwm)
 {
     if (channel > 0 && channel <= NUM_CHANNELS && pwm >= MIN_PWM && pwm <= MAX_PWM) {
         pwm_outputs[channel - 1] = pwm;
-        setOCValue(channel - 1, (int) (pwm * output_scale_factors[channel - 1] + output_offsets[channel - 1]));
+        oc_duties[channel - 1] = scaleOutput(channel - 1, pwm);
+        setOCValue(channel - 1, oc_duties[channel - 1]);
     }
 }
 
 void setAllPWM(int* pwms) {
-    unsigned int channel = 1;
-    for (; channel <= NUM_CHANNELS; channel++) {
-        setPWM(channel, pwms[channel - 1]);
+    unsigned int channel = 0;
+    for (; channel < NUM_CHANNELS; channel++) {
+        if (pwms[channel] >= MIN_PWM && pwms[channel] <= MAX_PWM) {
+            pwm_outputs[channel] = pwms[channel];
+            oc_duties[channel] = scaleOutput(channel, pwms[channel]);
+        }
     }
+    setAllOCValues(oc_duties);
 }
 
-int* getPWMOutputs()
+int* getPWMOutputs(void)
 {
     return pwm_outputs;
 }
@@ -112,15 +174,44 @@ unsigned char getPWMInputStatus(void)
 void calibratePWMInputs(unsigned int channel, float signalScaleFactor, unsigned int signalOffset)
 {
     if (channel > 0 && channel <= NUM_CHANNELS) { //Check if channel number is valid
-        input_scale_factors[channel - 1] = signalScaleFactor;
+        input_scale_factors[channel - 1] = floatToQ16(signalScaleFactor);
         input_offsets[channel - 1] = signalOffset;
+#if USE_PPM
+        calibratePPMChannel(channel - 1, input_scale_factors[channel - 1], input_offsets[channel - 1]);
+#endif
     }
 }
 
 void calibratePWMOutputs(unsigned int channel, float signalScaleFactor, unsigned int signalOffset)
 {
     if (channel > 0 && channel <= NUM_CHANNELS) { //Check if channel number is valid
-        output_scale_factors[channel - 1] = signalScaleFactor;
+        output_scale_factors[channel - 1] = floatToQ16(signalScaleFactor);
         output_offsets[channel - 1] = signalOffset;
     }
 }
+
+void benchmarkPWM(void)
+{
+    //Outputs in the range of a typical control step
+    static int pwms[NUM_CHANNELS] = {MIN_PWM, -700, -300, -10, 10, 300, 700, MAX_PWM};
+    float scale_factor = DEFAULT_OUTPUT_SCALE_FACTOR;
+    uint16_t i;
+    uint8_t channel;
+    uint64_t start;
+
+    start = getTimeUs();
+    for (i = 0; i < PWM_BENCHMARK_ITERATIONS; i++) {
+        for (channel = 0; channel < NUM_CHANNELS; channel++) {
+            benchmark_duties[channel] = (int) (pwms[channel] * scale_factor + output_offsets[channel]);
+        }
+    }
+    debugInt("PWM float (us)", getTimeUs() - start);
+
+    start = getTimeUs();
+    for (i = 0; i < PWM_BENCHMARK_ITERATIONS; i++) {
+        for (channel = 0; channel < NUM_CHANNELS; channel++) {
+            benchmark_duties[channel] = scaleOutput(channel, pwms[channel]);
+        }
+    }
+    debugInt("PWM fixed (us)", getTimeUs() - start);
+}
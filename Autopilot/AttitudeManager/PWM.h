@@ -17,6 +17,9 @@
 #ifndef PWM_H
 #define	PWM_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
 /**
  * Number of channels available. This is not meant to be configurable, so don't change it
  */
@@ -59,6 +62,11 @@
  */
 #define DISCONNECTED_PWM_VALUE -10000
 
+/**
+ * Number of iterations benchmarkPWM() runs for each implementation
+ */
+#define PWM_BENCHMARK_ITERATIONS 100
+
 /**
  * Shortcuts for the applicable PWM statuses
  */
@@ -81,6 +89,28 @@ void initPWM(unsigned char inputChannels,unsigned char outputChannels);
  */
 int* getPWMArray(unsigned long int sys_time);
 
+/**
+ * Scales a raw input capture value with the input calibration of a channel. This
+ * is what getPWMArray() does without PPM. With PPM, frames are calibrated the same
+ * way in the input capture interrupt
+ * @param channel Zero-indexed channel
+ * @param ticks Input capture value, in Timer2 ticks
+ * @return The calibrated value, from MIN_PWM to MAX_PWM for a pulse within the calibrated range
+ */
+int scalePWMInput(unsigned int channel, unsigned int ticks);
+
+/**
+ * Checks whether the PWM inputs have changed since the last call, so that they only
+ * need to be read and processed when they have. With PPM, this is when a new frame
+ * was received from the RC receiver (about every 20ms), or when it's disconnected
+ * so that the disconnect can be picked up. Without PPM, the channels aren't synchronized,
+ * so this is always true
+ * @param sys_time System time in ms used for detecting disconnects
+ * @param frame_time Set to the time (us) at which the inputs were received. May be NULL
+ * @return True if getPWMArray() should be called
+ */
+bool checkNewPWMInputs(unsigned long int sys_time, uint64_t* frame_time);
+
 /**
  * Sets the PWM output of a particular output. Make sure initPWM is called before
  * this, otherwise unexpected behavior will occur
@@ -93,7 +123,8 @@ void setPWM(unsigned int channel, int pwm);
 
 /**
  * Sets the PWM outputs on all available channels. Make sure initPWM is called before
- * this, otherwise unexpected behavior will occur.
+ * this, otherwise unexpected behavior will occur. All the outputs are updated in
+ * one go, so that they all change at the start of the same PWM period
  * @param pwms C-style array of values from MIN_PWM to MAX_PWM (or -1024 to 1024), ordered
  *      by channel number, zero-indexed. Values outside of this range will be ignored
  */
@@ -104,7 +135,7 @@ void setAllPWM(int* pwms);
  * @return An array of size 8 containing the latest set PWM value in the range of MIN_PWM and MAX_PWM
  *      for all the channels. Note the array is 0-indexed, so channel 1 is array index 0
  */
-int* getPWMOutputs();
+int* getPWMOutputs(void);
 
 /**
  * Returns 8-bit bit mask indicating the status of each channel. A 0 means that the channel
@@ -119,7 +150,7 @@ unsigned char getPWMInputStatus(void);
 /**
  * Calibrates the input range and trim of a PWM channel input
  * @param channel Number from 1-8 indicating the channel (not zero-based)
- * @param signalScaleFactor The scale factor that the input will be scaled by
+ * @param signalScaleFactor The scale factor that the input will be scaled by. Stored in Q16.16, so it must be within +-32768
  * @param signalOffset The signal offset for the signal, or trim
  * 
  * @note The signal factor and signal offset should be values such that:
@@ -130,7 +161,7 @@ void calibratePWMInputs(unsigned int channel, float signalScaleFactor, unsigned
 /**
  * Calibrates the output range and trim of a PWM output
  * @param channel Number from 1-8 indicating the channel (not zero-based)
- * @param signalScaleFactor The scale factor that the input will be scaled by
+ * @param signalScaleFactor The scale factor that the input will be scaled by. Stored in Q16.16, so it must be within +-32768
  * @param signalOffset The signal offset for the signal, or trim
  * 
  * @note The signal factor and signal offset should be values such that:
@@ -139,4 +170,11 @@ void calibratePWMInputs(unsigned int channel, float signalScaleFactor, unsigned
  */
 void calibratePWMOutputs(unsigned int channel, float signalScaleFactor, unsigned int signalOffset);
 
+/**
+ * Times PWM_BENCHMARK_ITERATIONS scalings of all 8 outputs, with the float math
+ * that used to be done and with the fixed-point math that's used now, and logs
+ * the results
+ */
+void benchmarkPWM(void);
+
 #endif
\ No newline at end of file
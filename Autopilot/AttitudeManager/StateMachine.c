@@ -17,63 +17,59 @@
 #include "../Common/Clock/Timer.h"
 #include "../Common/Utilities/LED.h"
 #include "StatusManager.h"
+#include "VN100Async.h"
+#include "LatencyTrace.h"
 
 //State Machine Triggers (Mostly Timers)
-static int uplinkTimer = 0;
-static int downlinkTimer = 0;
-static int imuTimer = 0;
+static uint16_t downlinkTimer = 0; //same type as getDownlinkInterval()
 static int ledTimer = 0;
 static long int stateMachineTimer = 0;
 static int dTime = 0;
 
-static bool flightUpdate = false;
+//Control loop timing
+static uint64_t last_control_tick = 0;
+static ControlLoopStats control_stats;
+
+static bool controlStep(char entryLocation);
 
 void StateMachine(char entryLocation){
+    uint32_t start;
     dTime = (int)(getTime() - stateMachineTimer);
     stateMachineTimer += dTime;
-    uplinkTimer += dTime;
     downlinkTimer += dTime;
-    imuTimer += dTime;
     ledTimer += dTime;
 
     //Clear Watchdog timer
     asm("CLRWDT");
-    //Feedback systems such as this autopilot are very sensitive to timing. In order to keep it consistent we should try to keep the timing between the calculation of error corrections and the output the same.
-    //In other words, roll pitch and yaw control, mixing, and output should take place in the same step.
-
-    if(IMU_UPDATE_FREQUENCY <= imuTimer){
-        imuTimer = 0;
-        //Poll Sensor
-        imuCommunication();
-        // If there's new IMU data, run flight control.
-        flightUpdate = true;
-    }
-    if(newInterchipData() && checkDMA()){
-        // if we have new interchip data (heading, etc), run flight control
-        flightUpdate = true;
-    }
 
-    if (entryLocation == STATEMACHINE_IDLE) {
-        // If we're waiting to be armed, don't run the flight control regardless of other states.
-        flightUpdate = false;
+    if(newInterchipData()){
+        // new interchip data (heading, etc) is picked up by the next control step
+        start = getTimeUs();
+        checkDMA();
+        accountTask(TASK_INTERCHIP, start);
     }
 
-    if (flightUpdate) {
-        flightUpdate = false;
-        //Input from Controller
-        inputCapture();
-        highLevelControl();
-        lowLevelControl();
+    start = getTimeUs();
+    if (controlStep(entryLocation)){
+        accountTask(TASK_CONTROL, start);
     }
 
-    if(UPLINK_CHECK_FREQUENCY <= uplinkTimer){
-        uplinkTimer = 0;
-        readDatalink();
+    //commands are applied as soon as they're received, with a budget to protect the control loop
+    start = getTimeUs();
+    if (readDatalink(UPLINK_TIME_BUDGET_US)){
+        accountTask(TASK_UPLINK, start);
     }
 
-    if(downlinkTimer >= DOWNLINK_SEND_INTERVAL){
+    if(downlinkTimer >= getDownlinkInterval()){
         downlinkTimer = 0;
-        writeDatalink(getNextPacketType());
+        start = getTimeUs();
+        //pack as many telemetry blocks as fit into a single radio transmission
+        do {
+            writeDatalink(getNextPacketType());
+        } while (telemetryBlockFits(peekNextPacketType()));
+        flushTelemetryBlocks();
+        updateDownlinkRate();
+        accountTask(TASK_DOWNLINK, start);
     }
 
     if (areGainsUpdated() || showGains()){
@@ -82,18 +78,116 @@ void StateMachine(char entryLocation){
     
     // Update status LED
     if (ledTimer >= LED_BLINK_LONG) {
+        start = getTimeUs();
         toggleLEDState();
         if (getProgramStatus() == UNARMED) {
             ledTimer -= LED_BLINK_LONG;
         } else if (getProgramStatus() == MAIN_EXECUTION) {
             ledTimer -= LED_BLINK_SHORT;
         }
+        accountTask(TASK_LED, start);
     }
 
+    //the polled tasks below are charged whether or not they completed anything
+    start = getTimeUs();
     checkUHFStatus(); //for kill mode. Need to determine if we still have uhf
+    accountTask(TASK_UHF, start);
     
+    TRACE_BEGIN(TRACE_DATALINK_PARSE);
+    start = getTimeUs();
     parseDatalinkBuffer(); //read any incoming data from the Xbee and put in buffer
+    accountTask(TASK_DATALINK_PARSE, start);
+    TRACE_END(TRACE_DATALINK_PARSE);
+    TRACE_BEGIN(TRACE_DATALINK_SEND);
+    start = getTimeUs();
     sendQueuedDownlinkPacket(); //send any outgoing info
+    accountTask(TASK_DATALINK_SEND, start);
+    TRACE_END(TRACE_DATALINK_SEND);
+
+    start = getTimeUs();
+    processTracePoints();
+    accountTask(TASK_TRACE, start);
+    updateCPULoad();
+}
+
+const ControlLoopStats* getControlLoopStats(void){
+    return &control_stats;
+}
+
+/**
+ * Runs the control loop if a control tick has happened. Feedback systems such as
+ * this autopilot are very sensitive to timing. In order to keep it consistent,
+ * the sensor read, the calculation of error corrections and the output all take
+ * place in the same step, at a fixed rate, and all PID loops in the step share
+ * the same timestamp and dt.
+ * When the IMU is streaming, the step is triggered by each new IMU sample instead,
+ * so that the control law always runs on data that is as fresh as possible
+ * @return Whether a step was run
+ */
+static bool controlStep(char entryLocation){
+    uint64_t tick_time;
+    uint16_t missed_ticks;
+    bool tick = checkTimer3Tick(&tick_time, &missed_ticks);
+
+#if VN100_STREAMING
+    uint64_t sample_time;
+    uint16_t skipped_samples;
+    if (VN100_checkNewSample(&sample_time, &skipped_samples)){
+        tick_time = sample_time;
+        missed_ticks = skipped_samples;
+    } else if (!tick || tick_time - last_control_tick < CONTROL_IMU_TIMEOUT_US){
+        return false;
+    }
+#else
+    if (!tick){
+        return false;
+    }
+#endif
+
+    uint64_t start = getTimeUs();
+    uint32_t delay = start - tick_time;
+    uint16_t bin = delay / CONTROL_JITTER_BIN_US;
+    if (bin >= CONTROL_JITTER_BINS){
+        bin = CONTROL_JITTER_BINS - 1;
+    }
+    control_stats.jitter_histogram[bin]++;
+    control_stats.overruns += missed_ticks;
+    control_stats.steps++;
+
+    if (last_control_tick != 0){
+        setPIDStepTime(tick_time, tick_time - last_control_tick);
+    }
+    last_control_tick = tick_time;
+
+    //Poll Sensor. The transfer runs in the background while the controller input is read
+    TRACE_BEGIN(TRACE_CONTROL);
+    TRACE_BEGIN(TRACE_IMU);
+    startIMUCommunication();
+
+    // If we're waiting to be armed, don't run the flight control
+    if (entryLocation != STATEMACHINE_IDLE) {
+        //Input from Controller
+        inputCapture();
+    }
+
+    imuCommunication();
+    TRACE_END(TRACE_IMU);
+
+    if (entryLocation != STATEMACHINE_IDLE) {
+        TRACE_BEGIN(TRACE_HIGH_LEVEL);
+        highLevelControl();
+        TRACE_END(TRACE_HIGH_LEVEL);
+        TRACE_BEGIN(TRACE_LOW_LEVEL);
+        lowLevelControl();
+        TRACE_END(TRACE_LOW_LEVEL);
+    }
+    TRACE_END(TRACE_CONTROL);
+
+    uint32_t step_time = getTimeUs() - start;
+    if (step_time > control_stats.max_step_time){
+        control_stats.max_step_time = step_time > UINT16_MAX ? UINT16_MAX : step_time;
+    }
+    return true;
 }
 
 void killPlane(char action){
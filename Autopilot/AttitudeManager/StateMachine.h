@@ -14,8 +14,45 @@
 #include "main.h"
 #include "AttitudeManager.h"
 #include "VN100.h"
+#include "CPULoad.h"
+
+/**
+ * Rate in Hz at which the control loop (IMU read, PID control and output) runs.
+ * It is triggered by Timer3, so it must be at least 77Hz
+ */
+#define CONTROL_LOOP_RATE 200
+
+#define CONTROL_LOOP_PERIOD_US (1000000 / CONTROL_LOOP_RATE)
+
+/**
+ * When the IMU is streaming, the control loop runs as soon as each new sample is
+ * received instead of on the Timer3 tick. If no sample is received for this long
+ * (in us), it falls back to the tick so that the outputs keep being updated
+ */
+#define CONTROL_IMU_TIMEOUT_US (2 * CONTROL_LOOP_PERIOD_US)
+
+/**
+ * The control loop jitter histogram has this many bins, each this many us wide.
+ * The last bin holds everything larger. The control loop telemetry block has room
+ * for 8 bins
+ */
+#define CONTROL_JITTER_BINS 8
+#define CONTROL_JITTER_BIN_US 50
+
+typedef struct {
+    uint32_t steps; //control steps run
+    uint16_t overruns; //control ticks or IMU samples missed because the main loop took longer than a period
+    uint16_t max_step_time; //us, longest time taken by a control step
+    uint16_t jitter_histogram[CONTROL_JITTER_BINS]; //delay from the control tick (or IMU sample) to the start of the step
+} ControlLoopStats;
 
 void StateMachine(char entryLocation);
+
+/**
+ * @return Timing statistics of the control loop since startup
+ */
+const ControlLoopStats* getControlLoopStats(void);
+
 void killPlane(char action);
 
 #endif	/* STATEMACHINE_H */
@@ -319,7 +319,7 @@ VN100_SPI_Packet* VN100_SPI_SetADOF(unsigned char sensorID, VN100_ADOFType ADOF)
   unsigned long regValue = (unsigned long)ADOF;
 
   /* Write register and return SPI packet*/
-  return VN100_SPI_WriteRegister(sensorID, VN100_REG_ADOR, 1, &regValue);
+  return VN100_SPI_WriteRegister(sensorID, VN100_REG_ADOF, 1, &regValue);
 }
 
 /*******************************************************************************
@@ -618,6 +618,41 @@ VN100_SPI_Packet* VN100_SPI_GetYPRMagAccRates(unsigned char sensorID, float* YPR
   return &VN_SPI_LastReceivedPacket;
 }
 
+/*******************************************************************************
+* Function Name  : VN100_SPI_GetYPRRates(unsigned char sensorID, float* yaw, float* pitch, float* roll, float* rates)
+* Description    : Get the yaw, pitch, roll and angular rates in a single SPI
+*                  transaction. This reads the same register as
+*                  VN100_SPI_GetYPRMagAccRates(), but only decodes the attitude
+*                  and rates, so that the control loop only pays for one
+*                  request/response turnaround per step instead of two.
+* Input          : sensorID -> The sensor to get the requested data from.
+* Output         : yaw -> The yaw angle measured in degrees.
+*                  pitch -> The pitch angle measured in degrees.
+*                  roll -> The roll angle measured in degrees.
+*                  rates -> Measured angular rates (3x1) in rad/s.
+* Return         : Pointer to SPI packet returned by the sensor
+*******************************************************************************/
+VN100_SPI_Packet* VN100_SPI_GetYPRRates(unsigned char sensorID, float* yaw, float* pitch, float* roll, float* rates){
+
+  unsigned long i;
+
+  /* Read register */
+  VN100_SPI_ReadRegister(sensorID, VN100_REG_YMR, 12);
+
+  /* Get Yaw, Pitch, Roll */
+  *yaw   = VN_SPI_LastReceivedPacket.Data[0].Float;
+  *pitch = VN_SPI_LastReceivedPacket.Data[1].Float;
+  *roll  = VN_SPI_LastReceivedPacket.Data[2].Float;
+
+  /* Get Angular Rates */
+  for(i=0;i<3;i++){
+    rates[i] = VN_SPI_LastReceivedPacket.Data[i+9].Float;
+  }
+
+  /* Return pointer to SPI packet */
+  return &VN_SPI_LastReceivedPacket;
+}
+
 /*******************************************************************************
 * Function Name  : VN100_SPI_GetDCM(unsigned char sensorID, float* DCM)
 * Description    : Get the measured attitude as a directional cosine matrix.
@@ -22,7 +22,6 @@
 #include "VN_type.h"
 #include "VN_lib.h"
 
-#define IMU_UPDATE_FREQUENCY 5 //Time in milliseconds // this really should be faster. 
 #define IMU_SPI_PORT 2
 
 /* Exported constants --------------------------------------------------------*/
@@ -205,6 +204,7 @@ VN100_SPI_Packet* VN100_SPI_GetQuatMagAcc(unsigned char sensorID, float* q, floa
 VN100_SPI_Packet* VN100_SPI_GetQuatAccRates(unsigned char sensorID, float* q, float* Acc, float* rates);
 VN100_SPI_Packet* VN100_SPI_GetQuatMagAccRates(unsigned char sensorID, float* q, float* mag, float* Acc, float* rates);
 VN100_SPI_Packet* VN100_SPI_GetYPRMagAccRates(unsigned char sensorID, float* YPR, float* mag, float* Acc, float* rates);
+VN100_SPI_Packet* VN100_SPI_GetYPRRates(unsigned char sensorID, float* yaw, float* pitch, float* roll, float* rates);
 VN100_SPI_Packet* VN100_SPI_GetDCM(unsigned char sensorID, float **DCM);
 VN100_SPI_Packet* VN100_SPI_GetMag(unsigned char sensorID, float* mag);
 VN100_SPI_Packet* VN100_SPI_GetAcc(unsigned char sensorID, float* Acc);
@@ -0,0 +1,371 @@
+/**
+ * @file VN100Async.c
+ * @author Waterloo Aerial Robotics Group
+ * @date October 18, 2026
+ * @copyright Waterloo Aerial Robotics Group 2017 \n
+ *   https://raw.githubusercontent.com/UWARG/PICpilot/master/LICENCE
+ *
+ * DMA channel 2 is used for receiving data, DMA channel 3 is used for sending data.
+ * Timer5 times the turnaround between the request and response, and Timer1 paces
+ * the reads in streaming mode.
+ */
+
+#include <xc.h>
+#include <string.h>
+#include "VN100Async.h"
+#include "../Common/Interfaces/SPI.h"
+#include "../Common/Clock/Timer.h"
+
+/** Size of the response header (zero byte, command, register and error IDs) */
+#define RESPONSE_HEADER_SIZE 4
+
+/** Timer1 and Timer5 ticks per us with the 1:8 prescaler */
+#define T1_TICKS_TO_USEC 5
+#define T5_TICKS_TO_USEC 5
+
+/** Offsets of the attitude and rates in the response to a YMR register read */
+#define YMR_WIDTH 12
+#define YMR_YPR_OFFSET (RESPONSE_HEADER_SIZE)
+#define YMR_RATES_OFFSET (RESPONSE_HEADER_SIZE + 9 * 4)
+
+typedef enum {
+    ASYNC_IDLE = 0,
+    ASYNC_REQUEST, //sending the request
+    ASYNC_TURNAROUND, //waiting for the sensor to process the request
+    ASYNC_RESPONSE, //receiving the response
+    ASYNC_DONE
+} AsyncState;
+
+static volatile AsyncState state = ASYNC_IDLE;
+static uint8_t response_width = 0;
+static uint16_t timeouts = 0;
+static volatile uint16_t response_errors = 0;
+static volatile uint64_t request_time = 0;
+
+//Streaming mode. The ISR writes the sample after the newest one, then increments the count
+static bool streaming = false;
+static VN100_Sample samples[VN100_SAMPLE_BUFFER_SIZE];
+static volatile uint16_t sample_count = 0;
+static uint16_t last_read_count = 0;
+
+//Only the first 4 bytes of the send buffer are ever written (the request). They are
+//cleared before the response is clocked in, so the sensor always receives zeros then
+static volatile uint8_t dma2_space[RESPONSE_HEADER_SIZE + VN100_ASYNC_MAX_REG_WIDTH * 4] __attribute__((space(dma)));
+static volatile uint8_t dma3_space[RESPONSE_HEADER_SIZE + VN100_ASYNC_MAX_REG_WIDTH * 4] __attribute__((space(dma)));
+
+static void initDMA2(void);
+static void initDMA3(void);
+static void initTimer1(void);
+static void initTimer5(void);
+static void startTransfer(uint16_t length);
+static bool waitForResponse(void);
+static bool parseSample(VN100_Sample* sample);
+
+void VN100_initAsync(void){
+    initDMA2();
+    initDMA3();
+    initTimer1();
+    initTimer5();
+}
+
+bool VN100_startReadRegister(unsigned char regID, unsigned char regWidth){
+    if ((state != ASYNC_IDLE && state != ASYNC_DONE) || regWidth > VN100_ASYNC_MAX_REG_WIDTH){
+        return false;
+    }
+    response_width = regWidth;
+
+    //same request as VN100_SPI_ReadRegister(), in the order the bytes go out
+    dma3_space[0] = VN100_CmdID_ReadRegister;
+    dma3_space[1] = regID;
+    dma3_space[2] = 0;
+    dma3_space[3] = 0;
+
+    state = ASYNC_REQUEST;
+    startTransfer(RESPONSE_HEADER_SIZE);
+    return true;
+}
+
+bool VN100_isReadComplete(void){
+    return state == ASYNC_DONE;
+}
+
+bool VN100_waitReadRegister(VN100_SPI_Packet* packet){
+    if (!waitForResponse()){
+        return false;
+    }
+
+    //the response words are received least significant byte first, so the buffer
+    //has the same layout as the packet
+    memcpy(packet, (uint8_t*)dma2_space, RESPONSE_HEADER_SIZE + response_width * 4);
+    state = ASYNC_IDLE;
+    return true;
+}
+
+bool VN100_startSample(void){
+    return VN100_startReadRegister(VN100_REG_YMR, YMR_WIDTH);
+}
+
+bool VN100_waitSample(VN100_Sample* sample){
+    if (!waitForResponse()){
+        return false;
+    }
+    state = ASYNC_IDLE;
+    return parseSample(sample);
+}
+
+void VN100_startStreaming(void){
+    streaming = true;
+    VN100_resumeStreaming();
+}
+
+void VN100_pauseStreaming(void){
+    if (!streaming){
+        return;
+    }
+    T1CONbits.TON = 0;
+    IFS0bits.T1IF = 0;
+    waitForResponse();
+    state = ASYNC_IDLE;
+}
+
+void VN100_resumeStreaming(void){
+    if (!streaming){
+        return;
+    }
+    TMR1 = 0;
+    T1CONbits.TON = 1;
+}
+
+bool VN100_checkNewSample(uint64_t* received_time, uint16_t* skipped_samples){
+    uint16_t count;
+
+    do {
+        count = sample_count;
+        if (count == last_read_count){
+            return false;
+        }
+        *received_time = samples[(count - 1) & (VN100_SAMPLE_BUFFER_SIZE - 1)].received;
+    } while (count != sample_count);
+
+    *skipped_samples = count - last_read_count - 1;
+    return true;
+}
+
+bool VN100_getLatestSample(VN100_Sample* sample){
+    uint16_t count;
+
+    //if a new sample arrives while copying, copy again. The ISR writes to the next
+    //slot in the buffer, so this can only happen if the copy is interrupted by a
+    //whole buffer's worth of samples
+    do {
+        count = sample_count;
+        if (count == 0){
+            return false;
+        }
+        *sample = samples[(count - 1) & (VN100_SAMPLE_BUFFER_SIZE - 1)];
+    } while (count != sample_count);
+
+    if (count == last_read_count){
+        return false;
+    }
+    last_read_count = count;
+    return true;
+}
+
+uint16_t VN100_getAsyncTimeouts(void){
+    return timeouts;
+}
+
+uint16_t VN100_getAsyncResponseErrors(void){
+    return response_errors;
+}
+
+/**
+ * Waits for the read in progress to complete. If it doesn't complete within
+ * VN100_ASYNC_TIMEOUT_US it is aborted
+ * @return True if the response is in the receive buffer
+ */
+static bool waitForResponse(void){
+    if (state == ASYNC_IDLE){
+        return false;
+    }
+
+    uint64_t start = getTimeUs();
+    while (state != ASYNC_DONE){
+        if (getTimeUs() - start > VN100_ASYNC_TIMEOUT_US){
+            //abort the transfer, leaving the bus free for the next one
+            IEC1bits.DMA2IE = 0;
+            IEC1bits.T5IE = 0;
+            T5CONbits.TON = 0;
+            DMA2CONbits.CHEN = 0;
+            DMA3CONbits.CHEN = 0;
+            SPI_SS(IMU_SPI_PORT, PIN_HIGH);
+            state = ASYNC_IDLE;
+            IFS1bits.DMA2IF = 0;
+            IFS1bits.T5IF = 0;
+            IEC1bits.DMA2IE = 1;
+            IEC1bits.T5IE = 1;
+            timeouts++;
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Decodes a YMR register response from the receive buffer
+ * @param sample Set to the sample received. Left untouched if the response is invalid
+ * @return False if the header isn't the response to a YMR read, or reports an error
+ */
+static bool parseSample(VN100_Sample* sample){
+    //the sensor answers with zeros while it is starting up, and with an error ID
+    //if the request got corrupted
+    if (dma2_space[0] != 0 || dma2_space[1] != VN100_CmdID_ReadRegister ||
+            dma2_space[2] != VN100_REG_YMR || dma2_space[3] != VN100_Error_None){
+        response_errors++;
+        return false;
+    }
+
+    sample->time = request_time;
+    sample->received = getTimeUs();
+    memcpy(&sample->yaw, (uint8_t*)dma2_space + YMR_YPR_OFFSET, 3 * sizeof(float)); //yaw, pitch, roll
+    memcpy(sample->rates, (uint8_t*)dma2_space + YMR_RATES_OFFSET, 3 * sizeof(float));
+    return true;
+}
+
+/**
+ * Clocks the given number of bytes out of the send buffer, and into the receive buffer
+ */
+static void startTransfer(uint16_t length){
+    DMA2CNT = length - 1; //count is 0-indexed, so -1
+    DMA3CNT = length - 1;
+    SPI_SS(IMU_SPI_PORT, PIN_LOW);
+    DMA2CONbits.CHEN = 1;
+    DMA3CONbits.CHEN = 1;
+    DMA3REQbits.FORCE = 1; //the first byte has to be forced, the rest follow the SPI
+}
+
+// receiving data
+static void initDMA2(void)
+{
+    DMA2CONbits.CHEN = 0; //disable the channel for now
+    IFS1bits.DMA2IF = 0;
+    IEC1bits.DMA2IE = 1;
+    IPC6bits.DMA2IP = 5;
+    DMACS0 = 0; //Clear any IO error flags
+
+    DMA2CONbits.DIR = 0; //Transfer from SPI to DSPRAM
+    DMA2CONbits.AMODE = 0b00; //With post increment mode
+    DMA2CONbits.MODE = 0b01; //One shot transfer, ping pong mode disabled
+    DMA2CONbits.SIZE = 1; //Transfer byte (8 bits)
+    DMA2CONbits.HALF = 0; //Initiate dma interrupt when all of the data has been moved
+
+    DMA2STA = __builtin_dmaoffset(&dma2_space); //Primary Transfer Buffer
+    DMA2PAD = (volatile unsigned int) &SPI2BUF; //Peripheral Address
+    DMA2REQ = 0b0100001; //IRQ code for SPI2
+}
+
+// sending data
+static void initDMA3(void)
+{
+    DMA3CONbits.CHEN = 0; //disable the channel for now
+    IFS2bits.DMA3IF = 0;
+    IEC2bits.DMA3IE = 0; //completion is handled by the receiving channel
+    DMACS1 = 0; //Clear any IO error flags
+
+    DMA3CONbits.DIR = 1; //Transfer from DSPRAM to SPI
+    DMA3CONbits.AMODE = 0b00; //With post increment mode
+    DMA3CONbits.MODE = 0b01; //One shot transfer, ping pong mode disabled
+    DMA3CONbits.SIZE = 1; //Transfer byte (8 bits)
+    DMA3CONbits.HALF = 0;
+
+    DMA3STA = __builtin_dmaoffset(&dma3_space); //Primary Transfer Buffer
+    DMA3PAD = (volatile unsigned int) &SPI2BUF; //Peripheral Address
+    DMA3REQ = 0b0100001; //IRQ code for SPI2
+
+    memset((uint8_t*)dma3_space, 0, sizeof(dma3_space));
+}
+
+/**
+ * Initializes Timer1 as a periodic timer, at the streaming rate. It's only started
+ * once streaming starts
+ */
+static void initTimer1(void)
+{
+    T1CONbits.TON = 0; // Disable Timer
+    T1CONbits.TCS = 0; // Select internal instruction cycle clock
+    T1CONbits.TGATE = 0; // Disable Gated Timer mode
+    T1CONbits.TCKPS = 0b01; // Select 1:8 Prescaler
+    TMR1 = 0x00; // Clear timer register
+    PR1 = T1_TICKS_TO_USEC * (1000000UL / VN100_STREAM_RATE_HZ) - 1; // Load the period value
+    IPC0bits.T1IP = 5; // Same priority as the DMA, so they can't preempt each other
+    IFS0bits.T1IF = 0; // Clear Timer 1 Interrupt Flag
+    IEC0bits.T1IE = 1; // Enable Timer 1 interrupt
+}
+
+/**
+ * Initializes Timer5 as a one-shot turnaround timer. It's only started once a
+ * request has been sent
+ */
+static void initTimer5(void)
+{
+    T5CONbits.TON = 0; // Disable Timer
+    T5CONbits.TCS = 0; // Select internal instruction cycle clock
+    T5CONbits.TGATE = 0; // Disable Gated Timer mode
+    T5CONbits.TCKPS = 0b01; // Select 1:8 Prescaler
+    TMR5 = 0x00; // Clear timer register
+    PR5 = T5_TICKS_TO_USEC * VN100_ASYNC_TURNAROUND_US; // Load the period value
+    IPC7bits.T5IP = 5; // Same priority as the DMA, so they can't preempt each other
+    IFS1bits.T5IF = 0; // Clear Timer 5 Interrupt Flag
+    IEC1bits.T5IE = 1; // Enable Timer 5 interrupt
+}
+
+/*
+ * Called when all the bytes of the request or response have been received
+ */
+void __attribute__((__interrupt__, no_auto_psv)) _DMA2Interrupt(void)
+{
+    SPI_SS(IMU_SPI_PORT, PIN_HIGH);
+    if (state == ASYNC_REQUEST){
+        request_time = getTimeUs();
+        TMR5 = 0;
+        T5CONbits.TON = 1;
+        state = ASYNC_TURNAROUND;
+    } else if (state == ASYNC_RESPONSE){
+        if (streaming && T1CONbits.TON){
+            //parse it right away, so that the newest sample is always ready to use
+            if (parseSample(&samples[sample_count & (VN100_SAMPLE_BUFFER_SIZE - 1)])){
+                sample_count++;
+            }
+            state = ASYNC_IDLE;
+        } else {
+            state = ASYNC_DONE;
+        }
+    }
+    IFS1bits.DMA2IF = 0; //clear the interrupt flag
+}
+
+/*
+ * Called at the streaming rate, to start the next read
+ */
+void __attribute__((__interrupt__, no_auto_psv)) _T1Interrupt(void)
+{
+    //if the last read hasn't completed yet, just wait for the next period
+    VN100_startSample();
+    IFS0bits.T1IF = 0;
+}
+
+/*
+ * Called once the sensor has had time to process the request
+ */
+void __attribute__((__interrupt__, no_auto_psv)) _T5Interrupt(void)
+{
+    T5CONbits.TON = 0;
+    if (state == ASYNC_TURNAROUND){
+        dma3_space[0] = 0;
+        dma3_space[1] = 0;
+        state = ASYNC_RESPONSE;
+        startTransfer(RESPONSE_HEADER_SIZE + response_width * 4);
+    }
+    IFS1bits.T5IF = 0;
+}
@@ -0,0 +1,169 @@
+/**
+ * @file VN100Async.h
+ * @author Waterloo Aerial Robotics Group
+ * @date October 18, 2026
+ * @brief
+ * Non-blocking register reads from the VN100 over SPI2. The blocking VectorNav
+ * library routines busy-wait on every byte and on the 50us turnaround the sensor
+ * needs between a request and its response, so the CPU idles for the whole
+ * transaction. Here, the request and response are moved by DMA (channel 2 receives,
+ * channel 3 sends) and the turnaround is timed by Timer5, so the caller can do
+ * other work until the read completes.
+ *
+ * Reads can either be started by the caller once per control step (polled mode),
+ * or run continuously in the background at a fixed rate (streaming mode). The
+ * VN100 is an SPI slave and can't push data on its own, so in streaming mode
+ * Timer1 paces the reads instead. Each sample is timestamped and parsed as soon
+ * as it arrives, so the control loop can pick up the newest one without waiting.
+ *
+ * The blocking library routines share the same SPI port, so they must not be
+ * called while an asynchronous read is in progress. In polled mode, the control
+ * loop always waits for its read to complete within the same step, so the bus
+ * is free outside of it. In streaming mode, VN100_pauseStreaming() must be called
+ * first.
+ *
+ * @copyright Waterloo Aerial Robotics Group 2017 \n
+ *   https://raw.githubusercontent.com/UWARG/PICpilot/master/LICENCE
+ */
+
+#ifndef VN100ASYNC_H
+#define	VN100ASYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "VN100.h"
+
+/**
+ * Whether the IMU is read in the background at VN100_STREAM_RATE_HZ (1), or
+ * once per control step (0)
+ */
+#define VN100_STREAMING 1
+
+/**
+ * Rate at which samples are read in streaming mode, in Hz. The VN100 filter
+ * runs at 200Hz, so reading any faster only returns duplicate samples
+ */
+#define VN100_STREAM_RATE_HZ 200
+
+/**
+ * Number of parsed samples kept in streaming mode. Must be a power of 2
+ */
+#define VN100_SAMPLE_BUFFER_SIZE 4
+
+/**
+ * Largest register that can be read asynchronously, in 32-bit words
+ */
+#define VN100_ASYNC_MAX_REG_WIDTH 12
+
+/**
+ * Time the VN100 needs between the end of a request and the start of the
+ * response, in us
+ */
+#define VN100_ASYNC_TURNAROUND_US 50
+
+/**
+ * Maximum time to wait for an asynchronous read before giving up on it, in us
+ */
+#define VN100_ASYNC_TIMEOUT_US 2000
+
+/**
+ * Time the VN100 needs to restart after a reset command, before it answers
+ * reads again, in us
+ */
+#define VN100_RESET_DELAY_US 100000
+
+typedef struct {
+    uint64_t time; //time the sensor was asked for the sample, in us
+    uint64_t received; //time the whole sample was received, in us
+    float yaw, pitch, roll; //in degrees
+    float rates[3]; //roll, pitch and yaw rates in rad/s
+} VN100_Sample;
+
+/**
+ * Initializes the DMA channels and turnaround timer. VN100_initSPI() must have
+ * been called first
+ */
+void VN100_initAsync(void);
+
+/**
+ * Starts reading a register in the background
+ * @param regID The register ID number
+ * @param regWidth The width of the register in 32-bit words. At most VN100_ASYNC_MAX_REG_WIDTH
+ * @return False if a read is already in progress or the register is too wide
+ */
+bool VN100_startReadRegister(unsigned char regID, unsigned char regWidth);
+
+/**
+ * @return Whether the last read started has completed
+ */
+bool VN100_isReadComplete(void);
+
+/**
+ * Waits for the read in progress to complete, and copies out its response.
+ * If the read doesn't complete within VN100_ASYNC_TIMEOUT_US it is aborted
+ * @param packet Set to the response of the sensor
+ * @return True if a response was received
+ */
+bool VN100_waitReadRegister(VN100_SPI_Packet* packet);
+
+/**
+ * Starts reading the yaw, pitch, roll and angular rates in the background, in
+ * polled mode. The result is retrieved with VN100_waitSample()
+ * @return False if a read is already in progress
+ */
+bool VN100_startSample(void);
+
+/**
+ * Waits for the read started by VN100_startSample() and decodes it
+ * @param sample Set to the sample received. Left untouched if the read failed
+ * @return True if a new sample was received. False if the read timed out, or
+ *      the response header was invalid
+ */
+bool VN100_waitSample(VN100_Sample* sample);
+
+/**
+ * Starts reading samples in the background every 1/VN100_STREAM_RATE_HZ s.
+ * No reads can be started by the caller while streaming
+ */
+void VN100_startStreaming(void);
+
+/**
+ * Stops the background reads and waits for the one in progress to complete, so
+ * that the blocking library routines can be used. Does nothing if not streaming
+ */
+void VN100_pauseStreaming(void);
+
+/**
+ * Restarts the background reads stopped by VN100_pauseStreaming()
+ */
+void VN100_resumeStreaming(void);
+
+/**
+ * Checks whether a sample has been received in streaming mode since the last call
+ * to VN100_getLatestSample(). This is the data-ready signal for the control loop
+ * @param received_time Set to the time (us) at which the newest sample was received
+ * @param skipped_samples Set to how many samples were received without ever being
+ *      read, ie were replaced by a newer one first
+ * @return True if a new sample is ready
+ */
+bool VN100_checkNewSample(uint64_t* received_time, uint16_t* skipped_samples);
+
+/**
+ * Gets the newest sample received in streaming mode
+ * @param sample Set to the newest sample
+ * @return True if the sample is new since the last call
+ */
+bool VN100_getLatestSample(VN100_Sample* sample);
+
+/**
+ * @return Number of reads that were aborted since startup
+ */
+uint16_t VN100_getAsyncTimeouts(void);
+
+/**
+ * @return Number of samples that were dropped since startup, because the header
+ *      of the response wasn't the one of a YMR read, or reported an error
+ */
+uint16_t VN100_getAsyncResponseErrors(void);
+
+#endif
@@ -110,6 +110,15 @@ void test_bQueueMultiplePushPop(void){
     TEST_ASSERT_EQUAL_UINT8('d' ,val);
 }
 
+void test_bQueuePeekShouldNotPop(void){
+    pushBQueue(&bqueue, 'a');
+    pushBQueue(&bqueue, 'b');
+    TEST_ASSERT_EQUAL_UINT8('a' ,peekBQueue(&bqueue));
+    TEST_ASSERT_EQUAL_INT(2 ,getBQueueSize(&bqueue));
+    TEST_ASSERT_EQUAL_UINT8('a' ,popBQueue(&bqueue));
+    TEST_ASSERT_EQUAL_UINT8('b' ,peekBQueue(&bqueue));
+}
+
 void test_bQueueEmptyPop(void){
     unsigned char val = popBQueue(&bqueue);
     TEST_ASSERT_EQUAL_INT(0 ,getBQueueSize(&bqueue));
@@ -0,0 +1,165 @@
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+//-- unity: unit test framework
+#include "unity.h"
+
+//-- module being tested
+#include "../../../Common/Utilities/ByteRing.h"
+#include "../../../Common/Utilities/ByteQueue.h"
+
+ // Mocked modules
+#include "mock_Timer.h"
+#include "mock_Logger.h"
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+#define RING_SIZE 8
+
+/*******************************************************************************
+ *    PRIVATE TYPES
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+static ByteRing ring;
+static uint8_t ring_data[RING_SIZE];
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    SETUP, TEARDOWN
+ ******************************************************************************/
+
+void setUp(void)
+{
+    initBRing(&ring, ring_data, RING_SIZE);
+}
+
+void tearDown(void)
+{
+}
+
+/*******************************************************************************
+ *    TESTS
+ ******************************************************************************/
+
+void test_bRingShouldStartEmpty(void)
+{
+    TEST_ASSERT_EQUAL_UINT16(0, getBRingSize(&ring));
+    TEST_ASSERT_EQUAL_UINT16(RING_SIZE, getBRingSpace(&ring));
+    TEST_ASSERT_EQUAL_UINT16(RING_SIZE, getBRingCapacity(&ring));
+}
+
+void test_bRingShouldRoundCapacityDownToPowerOfTwo(void)
+{
+    initBRing(&ring, ring_data, RING_SIZE - 1);
+    TEST_ASSERT_EQUAL_UINT16(RING_SIZE / 2, getBRingCapacity(&ring));
+}
+
+void test_bRingPushPeekPop(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(1, pushBRing(&ring, 'a'));
+    TEST_ASSERT_EQUAL_UINT8(1, pushBRing(&ring, 'b'));
+    TEST_ASSERT_EQUAL_UINT16(2, getBRingSize(&ring));
+    TEST_ASSERT_EQUAL_UINT8('a', peekBRing(&ring));
+    TEST_ASSERT_EQUAL_UINT16(2, getBRingSize(&ring));
+    TEST_ASSERT_EQUAL_UINT8('a', popBRing(&ring));
+    TEST_ASSERT_EQUAL_UINT8('b', popBRing(&ring));
+    TEST_ASSERT_EQUAL_UINT16(0, getBRingSize(&ring));
+}
+
+void test_bRingEmptyPop(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(0, popBRing(&ring));
+    TEST_ASSERT_EQUAL_UINT16(0, getBRingSize(&ring));
+}
+
+void test_bRingShouldRejectPushWhenFull(void)
+{
+    int i;
+    //non zero, so that they can't be mistaken for the 0 an empty ring pops
+    for (i = 0; i < RING_SIZE; i++) {
+        TEST_ASSERT_EQUAL_UINT8(1, pushBRing(&ring, i + 1));
+    }
+    TEST_ASSERT_EQUAL_UINT8(0, pushBRing(&ring, 'x'));
+    TEST_ASSERT_EQUAL_UINT16(RING_SIZE, getBRingSize(&ring));
+    TEST_ASSERT_EQUAL_UINT16(0, getBRingSpace(&ring));
+    for (i = 0; i < RING_SIZE; i++) {
+        TEST_ASSERT_EQUAL_UINT8(i + 1, popBRing(&ring)); //nothing was overwritten
+    }
+}
+
+//keeps the ring half full while the indices wrap around the storage, and around 2^16
+void test_bRingShouldKeepOrderAcrossWraps(void)
+{
+    uint32_t i;
+    ring._head = 0xFFF0;
+    ring._tail = 0xFFF0;
+    for (i = 0; i < RING_SIZE / 2; i++) {
+        pushBRing(&ring, i);
+    }
+    for (i = RING_SIZE / 2; i < 100; i++) {
+        pushBRing(&ring, i);
+        TEST_ASSERT_EQUAL_UINT8(i - RING_SIZE / 2, popBRing(&ring));
+        TEST_ASSERT_EQUAL_UINT16(RING_SIZE / 2, getBRingSize(&ring));
+    }
+}
+
+void test_bRingPushNPopNShouldWrapAround(void)
+{
+    uint8_t data[RING_SIZE] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint8_t popped[RING_SIZE];
+
+    pushNBRing(&ring, data, 5);
+    popNBRing(&ring, popped, 5);
+
+    //starts 5 bytes in, so this wraps around the end of the storage
+    TEST_ASSERT_EQUAL_UINT16(RING_SIZE, pushNBRing(&ring, data, RING_SIZE));
+    TEST_ASSERT_EQUAL_UINT16(0, pushNBRing(&ring, data, 1));
+    TEST_ASSERT_EQUAL_UINT16(RING_SIZE, popNBRing(&ring, popped, RING_SIZE + 1));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, popped, RING_SIZE);
+    TEST_ASSERT_EQUAL_UINT16(0, getBRingSize(&ring));
+}
+
+void test_bRingPushNShouldStopWhenFull(void)
+{
+    uint8_t data[RING_SIZE + 2] = {0};
+
+    TEST_ASSERT_EQUAL_UINT16(RING_SIZE, pushNBRing(&ring, data, sizeof(data)));
+    TEST_ASSERT_EQUAL_UINT16(RING_SIZE, getBRingSize(&ring));
+}
+
+void test_bRingSpansShouldEndWhereStorageWraps(void)
+{
+    uint8_t* span;
+
+    ring._head = RING_SIZE - 3;
+    ring._tail = RING_SIZE - 3;
+    TEST_ASSERT_EQUAL_UINT16(3, reserveBRing(&ring, &span));
+    TEST_ASSERT_EQUAL_PTR(&ring_data[RING_SIZE - 3], span);
+    span[0] = 'a';
+    span[1] = 'b';
+    span[2] = 'c';
+    commitBRing(&ring, 3);
+
+    TEST_ASSERT_EQUAL_UINT16(RING_SIZE - 3, reserveBRing(&ring, &span));
+    TEST_ASSERT_EQUAL_PTR(ring_data, span);
+    span[0] = 'd';
+    commitBRing(&ring, 1);
+
+    TEST_ASSERT_EQUAL_UINT16(3, peekSpanBRing(&ring, &span));
+    TEST_ASSERT_EQUAL_MEMORY("abc", span, 3);
+    consumeBRing(&ring, 2);
+    TEST_ASSERT_EQUAL_UINT16(1, peekSpanBRing(&ring, &span));
+    consumeBRing(&ring, 1);
+    TEST_ASSERT_EQUAL_UINT16(1, peekSpanBRing(&ring, &span));
+    TEST_ASSERT_EQUAL_UINT8('d', *span);
+    consumeBRing(&ring, 1);
+    TEST_ASSERT_EQUAL_UINT16(0, peekSpanBRing(&ring, &span));
+}
@@ -0,0 +1,161 @@
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+//-- unity: unit test framework
+#include "unity.h"
+
+//-- module being tested
+#include "../../Network/CompactTelemetry.h"
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    PRIVATE TYPES
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+static struct packet_type_position_block position;
+static struct packet_type_compact_position_block compact;
+static struct packet_type_position_reference_block reference;
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+/**
+ * Decodes the last encoded block
+ */
+static bool decode(struct packet_type_position_block* decoded)
+{
+    return decodeCompactPosition(&compact, &reference, decoded);
+}
+
+/*******************************************************************************
+ *    SETUP, TEARDOWN
+ ******************************************************************************/
+
+void setUp(void)
+{
+    position.lat = 43.4728954;
+    position.lon = -80.5400734;
+    position.sys_time = 123456;
+    position.gps_time = 174512.5f;
+    position.pitch = 12.344f;
+    position.roll = -45.678f;
+    position.yaw = 179.99f;
+    position.pitch_rate = 1.5f;
+    position.roll_rate = -200.25f;
+    position.yaw_rate = 0.004f;
+    position.airspeed = 17.38f;
+    position.altitude = 312.07f;
+    position.ground_speed = 15.91f;
+    position.heading = 271;
+    position.imu_sample_age = 850;
+    resetCompactPositionReference();
+}
+
+void tearDown(void)
+{
+}
+
+/*******************************************************************************
+ *    TESTS
+ ******************************************************************************/
+
+void test_compactPositionShouldDecodeWithinResolution(void)
+{
+    struct packet_type_position_block decoded;
+
+    TEST_ASSERT_TRUE(encodeCompactPosition(&position, &compact, &reference));
+    TEST_ASSERT_TRUE(decode(&decoded));
+
+    //a float can't resolve 1e-7 degrees this far from 0, so check the quantised values
+    TEST_ASSERT_EQUAL_INT32(434728954, compact.lat);
+    TEST_ASSERT_EQUAL_INT32(-805400734, compact.lon);
+    TEST_ASSERT_EQUAL_UINT32(position.sys_time, decoded.sys_time);
+    TEST_ASSERT_EQUAL_FLOAT(position.gps_time, decoded.gps_time);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, position.pitch, decoded.pitch);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, position.roll, decoded.roll);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, position.yaw, decoded.yaw);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, position.roll_rate, decoded.roll_rate);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, position.yaw_rate, decoded.yaw_rate);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, position.altitude, decoded.altitude);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, position.airspeed, decoded.airspeed);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, position.ground_speed, decoded.ground_speed);
+    TEST_ASSERT_EQUAL_INT16(position.heading, decoded.heading);
+    TEST_ASSERT_EQUAL_UINT16(position.imu_sample_age, decoded.imu_sample_age);
+}
+
+void test_compactPositionShouldBeDeltaCodedFromReference(void)
+{
+    struct packet_type_position_block decoded;
+    uint8_t i;
+
+    TEST_ASSERT_TRUE(encodeCompactPosition(&position, &compact, &reference));
+    TEST_ASSERT_EQUAL_INT16(0, compact.altitude_delta);
+    TEST_ASSERT_EQUAL_INT32(31207, reference.altitude);
+
+    //the following blocks use the same reference
+    for (i = 1; i < COMPACT_POSITION_REFERENCE_INTERVAL; i++) {
+        position.altitude -= 1.5f;
+        position.ground_speed += 0.25f;
+        TEST_ASSERT_FALSE(encodeCompactPosition(&position, &compact, &reference));
+    }
+    TEST_ASSERT_TRUE(decode(&decoded));
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, position.altitude, decoded.altitude);
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, position.ground_speed, decoded.ground_speed);
+    TEST_ASSERT_EQUAL_INT16(-150 * (COMPACT_POSITION_REFERENCE_INTERVAL - 1), compact.altitude_delta);
+}
+
+void test_compactPositionShouldMakeNewReferenceEveryInterval(void)
+{
+    uint8_t i;
+    uint8_t first_id;
+
+    encodeCompactPosition(&position, &compact, &reference);
+    first_id = reference.reference_id;
+    for (i = 1; i < COMPACT_POSITION_REFERENCE_INTERVAL; i++) {
+        encodeCompactPosition(&position, &compact, &reference);
+    }
+    TEST_ASSERT_TRUE(encodeCompactPosition(&position, &compact, &reference));
+    TEST_ASSERT_EQUAL_UINT8(first_id + 1, reference.reference_id);
+    TEST_ASSERT_EQUAL_UINT8(first_id + 1, compact.reference_id);
+}
+
+void test_compactPositionShouldMakeNewReferenceWhenDeltaDoesNotFit(void)
+{
+    struct packet_type_position_block decoded;
+
+    encodeCompactPosition(&position, &compact, &reference);
+    position.altitude += 400; //40000cm doesn't fit in an int16
+    TEST_ASSERT_TRUE(encodeCompactPosition(&position, &compact, &reference));
+    TEST_ASSERT_TRUE(decode(&decoded));
+    TEST_ASSERT_FLOAT_WITHIN(0.005f, position.altitude, decoded.altitude);
+}
+
+void test_compactPositionShouldNotDecodeWithStaleReference(void)
+{
+    struct packet_type_position_block decoded;
+    struct packet_type_position_reference_block stale;
+
+    encodeCompactPosition(&position, &compact, &reference);
+    stale = reference;
+    resetCompactPositionReference();
+    encodeCompactPosition(&position, &compact, &reference);
+    reference = stale; //the new reference was lost
+    TEST_ASSERT_FALSE(decode(&decoded));
+}
+
+void test_compactPositionShouldSaturateRates(void)
+{
+    position.yaw_rate = 500;
+    position.roll_rate = -500;
+    encodeCompactPosition(&position, &compact, &reference);
+    TEST_ASSERT_EQUAL_INT16(INT16_MAX, compact.yaw_rate);
+    TEST_ASSERT_EQUAL_INT16(INT16_MIN, compact.roll_rate);
+}
@@ -0,0 +1,153 @@
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+//-- unity: unit test framework
+#include "unity.h"
+
+//-- module being tested
+#include "../../CPULoad.h"
+
+ // Mocked modules
+#include "mock_Timer.h"
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    PRIVATE TYPES
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+//start of the window of the current test, in us
+static uint32_t window_start = 0;
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+/**
+ * Charges a run of a task
+ * @param start us into the window at which the task started
+ * @param duration us
+ */
+static void runTask(StateMachineTask task, uint32_t start, uint32_t duration)
+{
+    getTimeUs_ExpectAndReturn(window_start + start + duration);
+    accountTask(task, window_start + start);
+}
+
+/**
+ * Polls updateCPULoad
+ * @param time us into the window
+ */
+static void updateAt(uint32_t time)
+{
+    getTimeUs_ExpectAndReturn(window_start + time);
+    updateCPULoad();
+}
+
+/*******************************************************************************
+ *    SETUP, TEARDOWN
+ ******************************************************************************/
+
+void setUp(void)
+{
+    //closes whatever window the last test left open, so each test starts a fresh one
+    window_start += 10 * CPU_LOAD_WINDOW_MS * 1000UL;
+    updateAt(0);
+}
+
+void tearDown(void)
+{
+}
+
+/*******************************************************************************
+ *    TESTS
+ ******************************************************************************/
+
+void test_accountTaskShouldAddUpRuns(void)
+{
+    const CPULoadStats* stats;
+
+    runTask(TASK_CONTROL, 0, 300);
+    runTask(TASK_CONTROL, 5000, 700);
+    runTask(TASK_CONTROL, 10000, 500);
+    runTask(TASK_DATALINK_PARSE, 11000, 20);
+    updateAt(CPU_LOAD_WINDOW_MS * 1000UL);
+
+    stats = getCPULoadStats();
+    TEST_ASSERT_EQUAL_UINT32(1500, stats->tasks[TASK_CONTROL].total_time);
+    TEST_ASSERT_EQUAL_UINT16(700, stats->tasks[TASK_CONTROL].max_time);
+    TEST_ASSERT_EQUAL_UINT16(3, stats->tasks[TASK_CONTROL].calls);
+    TEST_ASSERT_EQUAL_UINT32(20, stats->tasks[TASK_DATALINK_PARSE].total_time);
+    TEST_ASSERT_EQUAL_UINT16(1, stats->tasks[TASK_DATALINK_PARSE].calls);
+    TEST_ASSERT_EQUAL_UINT16(0, stats->tasks[TASK_UHF].calls);
+}
+
+void test_accountTaskShouldSaturateMaxTime(void)
+{
+    runTask(TASK_DOWNLINK, 0, 70000);
+    updateAt(CPU_LOAD_WINDOW_MS * 1000UL);
+
+    TEST_ASSERT_EQUAL_UINT16(UINT16_MAX, getCPULoadStats()->tasks[TASK_DOWNLINK].max_time);
+    TEST_ASSERT_EQUAL_UINT32(70000, getCPULoadStats()->tasks[TASK_DOWNLINK].total_time);
+}
+
+void test_updateCPULoadShouldWaitForAFullWindow(void)
+{
+    runTask(TASK_LED, 0, 100);
+    updateAt(CPU_LOAD_WINDOW_MS * 1000UL - 1);
+
+    //still the stats of the window setUp closed, which had nothing in it
+    TEST_ASSERT_EQUAL_UINT16(0, getCPULoadStats()->tasks[TASK_LED].calls);
+
+    updateAt(CPU_LOAD_WINDOW_MS * 1000UL);
+    TEST_ASSERT_EQUAL_UINT16(1, getCPULoadStats()->tasks[TASK_LED].calls);
+}
+
+void test_updateCPULoadShouldComputeLoadPerMille(void)
+{
+    const CPULoadStats* stats;
+
+    runTask(TASK_CONTROL, 0, 200000); //20%
+    runTask(TASK_UHF, 300000, 50000); //5%
+    runTask(TASK_TRACE, 400000, 1000); //0.1%
+    updateAt(CPU_LOAD_WINDOW_MS * 1000UL);
+
+    stats = getCPULoadStats();
+    TEST_ASSERT_EQUAL_UINT16(200, stats->tasks[TASK_CONTROL].load);
+    TEST_ASSERT_EQUAL_UINT16(50, stats->tasks[TASK_UHF].load);
+    TEST_ASSERT_EQUAL_UINT16(1, stats->tasks[TASK_TRACE].load);
+    TEST_ASSERT_EQUAL_UINT16(251, stats->cpu_load);
+}
+
+void test_updateCPULoadShouldScaleToALongWindow(void)
+{
+    const CPULoadStats* stats;
+
+    runTask(TASK_CONTROL, 0, 200000);
+    runTask(TASK_DATALINK_SEND, 300000, 600000);
+    updateAt(2 * CPU_LOAD_WINDOW_MS * 1000UL); //the main loop was held up for a second
+
+    stats = getCPULoadStats();
+    TEST_ASSERT_EQUAL_UINT16(100, stats->tasks[TASK_CONTROL].load);
+    TEST_ASSERT_EQUAL_UINT16(300, stats->tasks[TASK_DATALINK_SEND].load);
+    TEST_ASSERT_EQUAL_UINT16(400, stats->cpu_load);
+}
+
+void test_updateCPULoadShouldStartANewWindow(void)
+{
+    runTask(TASK_INTERCHIP, 0, 100);
+    updateAt(CPU_LOAD_WINDOW_MS * 1000UL);
+
+    window_start += CPU_LOAD_WINDOW_MS * 1000UL;
+    updateAt(CPU_LOAD_WINDOW_MS * 1000UL);
+    TEST_ASSERT_EQUAL_UINT16(0, getCPULoadStats()->tasks[TASK_INTERCHIP].calls);
+    TEST_ASSERT_EQUAL_UINT32(0, getCPULoadStats()->tasks[TASK_INTERCHIP].total_time);
+    TEST_ASSERT_EQUAL_UINT16(0, getCPULoadStats()->cpu_load);
+}
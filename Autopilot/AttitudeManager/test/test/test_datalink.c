@@ -5,8 +5,10 @@
 //-- unity: unit test framework
 #include "unity.h"
 #include "mock_Radio.h"
+#include "mock_Timer.h"
 #include "../../Network/Datalink.h"
 #include <stdlib.h>
+#include <string.h>
  
 //-- module being tested
 //   TODO
@@ -29,6 +31,7 @@ uint8_t test_data[20];
 uint8_t test_data2[34];
 uint16_t test_data_length;
 uint16_t test_data2_length;
+int parse_calls;
 /*******************************************************************************
  *    PRIVATE FUNCTIONS
  ******************************************************************************/
@@ -68,37 +71,53 @@ void test_initDatalinkShouldInitializeRadio(void)
 
 void test_parseDatalinkBufferShouldDoNothingWithNoIncomingData(void)
 {
-    uint16_t length;
-    parseUplinkPacket_ExpectAndReturn(&length, NULL);
-    parseDatalinkBuffer();
+    initRadio_Expect();
+    initDatalink();
+    parseUplinkPacket_IgnoreAndReturn(NULL);
+    TEST_ASSERT_FALSE(parseDatalinkBuffer());
+    TEST_ASSERT_NULL(popDatalinkCommand());
 }
 
-uint8_t* parseDatalinkBufferValidDataMock(uint16_t* length, int NumCalls){
+/**
+ * Parses test data into the receive buffer the way the radio drivers do, starting
+ * at an odd address
+ */
+uint8_t* parseDatalinkBufferValidDataMock(uint8_t* buffer, uint16_t* length, int NumCalls){
     NumCalls++; //so compiler doesn't complain
+    parse_calls++;
+    memcpy(buffer + 1, test_data, test_data_length);
     *length = test_data_length;
-    return test_data;
+    return buffer + 1;
 }
 
-uint8_t* parseDatalinkBufferValidDataMock2(uint16_t* length, int NumCalls){
+uint8_t* parseDatalinkBufferValidDataMock2(uint8_t* buffer, uint16_t* length, int NumCalls){
     NumCalls++; //so compiler doesn't complain
+    memcpy(buffer + 1, test_data2, test_data2_length);
     *length = test_data2_length;
-    return test_data2;
+    return buffer + 1;
 }
 
 void test_parseDatalinkBufferShouldAddToCommandQueueWithIncomingData(void)
 {
+    initRadio_Expect();
+    initDatalink();
+    getTimeUs_IgnoreAndReturn(0);
     parseUplinkPacket_StubWithCallback((CMOCK_parseUplinkPacket_CALLBACK) parseDatalinkBufferValidDataMock);
-    parseDatalinkBuffer();
+    TEST_ASSERT_TRUE(parseDatalinkBuffer());
     DatalinkCommand* command = popDatalinkCommand();
     
     TEST_ASSERT_EQUAL_UINT8_MESSAGE(test_data[0], command->cmd, "Command ID should be first byte of received uplink");
     TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(&test_data[1], command->data, test_data_length - 1, "Command payload should be copied correctly");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, (uintptr_t)command->data % 2, "Command payload should be word aligned");
     TEST_ASSERT_NULL(command->next);
-    free(command);
+    freeDatalinkCommand(command);
 }
 
 void test_parseDatalinkBufferPopCommandMultiple(void)
 {
+    initRadio_Expect();
+    initDatalink();
+    getTimeUs_IgnoreAndReturn(0);
     parseUplinkPacket_StubWithCallback((CMOCK_parseUplinkPacket_CALLBACK) parseDatalinkBufferValidDataMock);
     parseDatalinkBuffer();
     parseUplinkPacket_StubWithCallback((CMOCK_parseUplinkPacket_CALLBACK) parseDatalinkBufferValidDataMock2);
@@ -109,13 +128,67 @@ void test_parseDatalinkBufferPopCommandMultiple(void)
     
     TEST_ASSERT_EQUAL_UINT8_MESSAGE(test_data[0], command1->cmd, "Command ID should be first byte of received uplink");
     TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(&test_data[1], command1->data, test_data_length - 1, "Command payload should be copied correctly");
-    TEST_ASSERT_NULL(command1->next);
   
     TEST_ASSERT_EQUAL_UINT8_MESSAGE(test_data2[0], command2->cmd, "Command ID should be first byte of received uplink");
     TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(&test_data2[1], command2->data, test_data2_length - 1, "Command payload should be copied correctly");
     TEST_ASSERT_NULL(command2->next);
-    free(command1);
-    free(command2);
+    TEST_ASSERT_NULL(popDatalinkCommand());
+    freeDatalinkCommand(command1);
+    freeDatalinkCommand(command2);
+}
+
+void test_peekDatalinkCommandShouldNotPop(void)
+{
+    initRadio_Expect();
+    initDatalink();
+    getTimeUs_IgnoreAndReturn(0);
+    TEST_ASSERT_NULL(peekDatalinkCommand());
+    parseUplinkPacket_StubWithCallback((CMOCK_parseUplinkPacket_CALLBACK) parseDatalinkBufferValidDataMock);
+    parseDatalinkBuffer();
+
+    DatalinkCommand* command = peekDatalinkCommand();
+    TEST_ASSERT_EQUAL_UINT8(test_data[0], command->cmd);
+    TEST_ASSERT_EQUAL_PTR(command, peekDatalinkCommand());
+    TEST_ASSERT_EQUAL_PTR(command, popDatalinkCommand());
+    TEST_ASSERT_NULL(peekDatalinkCommand());
+    freeDatalinkCommand(command);
+}
+
+void test_getUplinkStatsShouldReportQueueDepthAndLatency(void)
+{
+    UplinkStats stats;
+    
+    initRadio_Expect();
+    initDatalink();
+    parseUplinkPacket_StubWithCallback((CMOCK_parseUplinkPacket_CALLBACK) parseDatalinkBufferValidDataMock);
+    getTimeUs_ExpectAndReturn(1000);
+    getTimeUs_ExpectAndReturn(1000);
+    getTimeUs_ExpectAndReturn(1000);
+    parseDatalinkBuffer();
+    parseDatalinkBuffer();
+    parseDatalinkBuffer();
+    
+    //latency counts from when the command is received until it's freed
+    getTimeUs_ExpectAndReturn(3000);
+    freeDatalinkCommand(popDatalinkCommand());
+    getTimeUs_ExpectAndReturn(5000);
+    freeDatalinkCommand(popDatalinkCommand());
+    
+    getUplinkStats(&stats);
+    TEST_ASSERT_EQUAL_UINT16(2, stats.applied);
+    TEST_ASSERT_EQUAL_UINT32(3000, stats.mean_latency);
+    TEST_ASSERT_EQUAL_UINT32(4000, stats.max_latency);
+    TEST_ASSERT_EQUAL_UINT8(1, stats.queue_depth);
+    TEST_ASSERT_EQUAL_UINT8(3, stats.max_queue_depth);
+    
+    //reading the stats resets them, except for the command still queued
+    getUplinkStats(&stats);
+    TEST_ASSERT_EQUAL_UINT16(0, stats.applied);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.max_latency);
+    TEST_ASSERT_EQUAL_UINT8(1, stats.queue_depth);
+    TEST_ASSERT_EQUAL_UINT8(1, stats.max_queue_depth);
+    getTimeUs_IgnoreAndReturn(0);
+    freeDatalinkCommand(popDatalinkCommand());
 }
 
 void test_popDatalinkCommandShouldReturnNullIfNoCommands(void)
@@ -123,34 +196,338 @@ void test_popDatalinkCommandShouldReturnNullIfNoCommands(void)
     TEST_ASSERT_NULL(popDatalinkCommand());
 }
 
-void test_freeDatalinkCommandShouldDeleteCommandWithoutErrors(void)
+void test_parseDatalinkBufferShouldDropCommandsWhenCommandPoolIsExhausted(void)
+{
+    DatalinkCommand* command;
+    UplinkStats stats;
+    
+    initRadio_Expect();
+    initDatalink();
+    getTimeUs_IgnoreAndReturn(0);
+    parseUplinkPacket_StubWithCallback((CMOCK_parseUplinkPacket_CALLBACK) parseDatalinkBufferValidDataMock);
+    for (i = 0; i < DATALINK_COMMAND_POOL_SIZE; i++){
+        TEST_ASSERT_TRUE(parseDatalinkBuffer());
+    }
+    //the radio is still read, so that its own frames get through, but the command is dropped
+    parse_calls = 0;
+    TEST_ASSERT_FALSE(parseDatalinkBuffer());
+    TEST_ASSERT_EQUAL_INT(1, parse_calls);
+    getUplinkStats(&stats);
+    TEST_ASSERT_EQUAL_UINT16(1, stats.dropped);
+    TEST_ASSERT_EQUAL_UINT8(DATALINK_COMMAND_POOL_SIZE, stats.queue_depth);
+    
+    command = popDatalinkCommand();
+    freeDatalinkCommand(command);
+    parseUplinkPacket_StubWithCallback((CMOCK_parseUplinkPacket_CALLBACK) parseDatalinkBufferValidDataMock2);
+    TEST_ASSERT_TRUE(parseDatalinkBuffer());
+    
+    //the freed slot was reused for the new command
+    for (i = 1; i < DATALINK_COMMAND_POOL_SIZE; i++){
+        freeDatalinkCommand(popDatalinkCommand());
+    }
+    TEST_ASSERT_EQUAL_PTR(command, popDatalinkCommand());
+    TEST_ASSERT_EQUAL_UINT8(test_data2[0], command->cmd);
+    freeDatalinkCommand(command);
+}
+
+/**
+ * Receives test_data2 over two calls, the way the radios keep a partial packet
+ * in the buffer between calls
+ */
+uint8_t* parseDatalinkBufferPartialDataMock(uint8_t* buffer, uint16_t* length, int NumCalls){
+    NumCalls++; //so compiler doesn't complain
+    if (parse_calls++ == 0){
+        memcpy(buffer + 1, test_data2, test_data2_length / 2);
+        return NULL;
+    }
+    memcpy(buffer + 1 + test_data2_length / 2, &test_data2[test_data2_length / 2], test_data2_length - test_data2_length / 2);
+    *length = test_data2_length;
+    return buffer + 1;
+}
+
+void test_parseDatalinkBufferShouldKeepPartialCommandWhenSlotIsFreed(void)
 {
+    DatalinkCommand* command;
     
-    DatalinkCommand* command = malloc(sizeof(DatalinkCommand));
-    command->data = malloc(12) + 1;
-    command->data_length = 12;
-    command->next = NULL;
+    initRadio_Expect();
+    initDatalink();
+    getTimeUs_IgnoreAndReturn(0);
+    parseUplinkPacket_StubWithCallback((CMOCK_parseUplinkPacket_CALLBACK) parseDatalinkBufferValidDataMock);
+    for (i = 0; i < DATALINK_COMMAND_POOL_SIZE; i++){
+        TEST_ASSERT_TRUE(parseDatalinkBuffer());
+    }
+    
+    //half of a command arrives while every slot is in use, and the rest after one is freed
+    for (i = 0; i < test_data2_length; i++){
+        test_data2[i] = 0xA0 + i; //unlike test_data, which the freed slot still holds
+    }
+    parse_calls = 0;
+    parseUplinkPacket_StubWithCallback((CMOCK_parseUplinkPacket_CALLBACK) parseDatalinkBufferPartialDataMock);
+    TEST_ASSERT_FALSE(parseDatalinkBuffer());
+    freeDatalinkCommand(popDatalinkCommand());
+    TEST_ASSERT_TRUE(parseDatalinkBuffer());
+    
+    for (i = 1; i < DATALINK_COMMAND_POOL_SIZE; i++){
+        freeDatalinkCommand(popDatalinkCommand());
+    }
+    command = popDatalinkCommand();
+    TEST_ASSERT_EQUAL_UINT8(test_data2[0], command->cmd);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(&test_data2[1], command->data, test_data2_length - 1);
     freeDatalinkCommand(command);
 }
 
-void test_createTelemetryBlockShouldReturnWithoutErrors(void)
+static uint8_t queued_frame[DOWNLINK_FRAME_LENGTH];
+static uint16_t queued_frame_length;
+static int queued_frames;
+static RadioPacketClass queued_frame_class;
+
+static void recordQueuedFrame(uint8_t* data, uint16_t data_length){
+    memcpy(queued_frame, data, data_length);
+    queued_frame_length = data_length;
+    queued_frames++;
+}
+
+bool queueDownlinkPacketMock(uint8_t* data, uint16_t data_length, const RadioPacketClass* packet_class, int NumCalls){
+    NumCalls++; //so compiler doesn't complain
+    recordQueuedFrame(data, data_length);
+    queued_frame_class = *packet_class;
+    return true;
+}
+
+bool queueReliableDownlinkPacketMock(uint8_t* data, uint16_t data_length, int NumCalls){
+    NumCalls++; //so compiler doesn't complain
+    recordQueuedFrame(data, data_length);
+    return true;
+}
+
+void test_flushTelemetryBlocksShouldDoNothingWhenEmpty(void)
+{
+    TEST_ASSERT_TRUE(flushTelemetryBlocks());
+}
+
+void test_queueTelemetryBlockShouldPackBlocksIntoOneFrame(void)
 {
-    TelemetryBlock* block = createTelemetryBlock(PRIORITY0);
-    free(block);
+    TelemetryBlock block;
+    uint8_t size = sizeof(struct packet_type_interchip_block);
+    
+    queued_frames = 0;
+    queueDownlinkPacket_StubWithCallback((CMOCK_queueDownlinkPacket_CALLBACK) queueDownlinkPacketMock);
+    
+    block.type = PACKET_TYPE_INTERCHIP;
+    block.data.interchip_block.good_frames = 123;
+    TEST_ASSERT_TRUE(queueTelemetryBlock(&block));
+    TEST_ASSERT_TRUE(telemetryBlockFits(PACKET_TYPE_INTERCHIP));
+    block.data.interchip_block.good_frames = 456;
+    TEST_ASSERT_TRUE(queueTelemetryBlock(&block));
+    TEST_ASSERT_FALSE(telemetryBlockFits(PACKET_TYPE_INTERCHIP));
+    TEST_ASSERT_EQUAL_INT(0, queued_frames);
+    
+    TEST_ASSERT_TRUE(flushTelemetryBlocks());
+    TEST_ASSERT_EQUAL_INT(1, queued_frames);
+    TEST_ASSERT_EQUAL_UINT16(2 * (size + TELEMETRY_BLOCK_HEADER_LENGTH), queued_frame_length);
+    TEST_ASSERT_EQUAL_UINT8(PACKET_TYPE_INTERCHIP, queued_frame[0]);
+    TEST_ASSERT_EQUAL_UINT8(size, queued_frame[1]);
+    TEST_ASSERT_EQUAL_UINT8(123, queued_frame[2]);
+    TEST_ASSERT_EQUAL_UINT8(PACKET_TYPE_INTERCHIP, queued_frame[size + 2]);
+    TEST_ASSERT_EQUAL_UINT8(456 & 0xFF, queued_frame[size + 4]);
 }
 
-void test_queueTelemetryBlockShouldCallRadioQueueMethodAndReturnTrue(void)
+void test_queueTelemetryBlockShouldQueueFrameWhenBlockDoesNotFit(void)
 {
-    TelemetryBlock* block = createTelemetryBlock(PRIORITY0);
-    queueDownlinkPacket_IgnoreAndReturn(true);
-    TEST_ASSERT_TRUE(queueTelemetryBlock(block));
-    free(block);
+    TelemetryBlock block;
+    
+    queued_frames = 0;
+    queueDownlinkPacket_StubWithCallback((CMOCK_queueDownlinkPacket_CALLBACK) queueDownlinkPacketMock);
+    
+    block.type = PACKET_TYPE_LATENCY;
+    TEST_ASSERT_TRUE(queueTelemetryBlock(&block));
+    block.type = PACKET_TYPE_CPU_LOAD;
+    TEST_ASSERT_TRUE(queueTelemetryBlock(&block));
+    TEST_ASSERT_EQUAL_INT(1, queued_frames);
+    TEST_ASSERT_EQUAL_UINT8(PACKET_TYPE_LATENCY, queued_frame[0]);
+    TEST_ASSERT_EQUAL_UINT16(sizeof(struct packet_type_latency_block) + TELEMETRY_BLOCK_HEADER_LENGTH, queued_frame_length);
+    
+    TEST_ASSERT_TRUE(flushTelemetryBlocks());
+    TEST_ASSERT_EQUAL_INT(2, queued_frames);
+    TEST_ASSERT_EQUAL_UINT8(PACKET_TYPE_CPU_LOAD, queued_frame[0]);
 }
 
-void test_queueTelemetryBlockShouldCallRadioQueueMethodAndReturnFalse(void)
+void test_queueTelemetryBlockShouldReturnFalseIfFrameCannotBeQueued(void)
 {
-    TelemetryBlock* block = createTelemetryBlock(PRIORITY0);
+    TelemetryBlock block;
+    
+    block.type = PACKET_TYPE_LATENCY;
+    TEST_ASSERT_TRUE(queueTelemetryBlock(&block));
     queueDownlinkPacket_IgnoreAndReturn(false);
-    TEST_ASSERT_FALSE(queueTelemetryBlock(block));
-    free(block);
-}
\ No newline at end of file
+    TEST_ASSERT_FALSE(queueTelemetryBlock(&block));
+    TEST_ASSERT_TRUE(flushTelemetryBlocks()); //the frame was discarded, so there's nothing left to queue
+}
+
+void test_queueTelemetryBlockShouldSendReliableBlocksOnTheirOwn(void)
+{
+    TelemetryBlock block;
+    
+    queued_frames = 0;
+    queueDownlinkPacket_StubWithCallback((CMOCK_queueDownlinkPacket_CALLBACK) queueDownlinkPacketMock);
+    
+    block.type = PACKET_TYPE_CPU_LOAD;
+    TEST_ASSERT_TRUE(queueTelemetryBlock(&block));
+    
+    //the gains skip the packed frame
+    queueReliableDownlinkPacket_StubWithCallback((CMOCK_queueReliableDownlinkPacket_CALLBACK) queueReliableDownlinkPacketMock);
+    block.type = PACKET_TYPE_GAINS;
+    TEST_ASSERT_TRUE(telemetryBlockFits(PACKET_TYPE_GAINS));
+    TEST_ASSERT_TRUE(queueTelemetryBlock(&block));
+    TEST_ASSERT_EQUAL_INT(1, queued_frames);
+    TEST_ASSERT_EQUAL_UINT8(PACKET_TYPE_GAINS, queued_frame[0]);
+    TEST_ASSERT_EQUAL_UINT16(sizeof(struct packet_type_gain_block) + TELEMETRY_BLOCK_HEADER_LENGTH, queued_frame_length);
+    
+    //and are sent best effort if the radio can't take them reliably
+    queueReliableDownlinkPacket_IgnoreAndReturn(false);
+    TEST_ASSERT_TRUE(queueTelemetryBlock(&block));
+    TEST_ASSERT_EQUAL_INT(2, queued_frames);
+    TEST_ASSERT_EQUAL_UINT8(PACKET_TYPE_GAINS, queued_frame[0]);
+    
+    TEST_ASSERT_TRUE(flushTelemetryBlocks());
+    TEST_ASSERT_EQUAL_INT(3, queued_frames);
+    TEST_ASSERT_EQUAL_UINT8(PACKET_TYPE_CPU_LOAD, queued_frame[0]);
+}
+
+void test_flushTelemetryBlocksShouldClassifyFramesByTheirBlocks(void)
+{
+    TelemetryBlock block;
+    
+    queueDownlinkPacket_StubWithCallback((CMOCK_queueDownlinkPacket_CALLBACK) queueDownlinkPacketMock);
+    
+    //latest values only, so the frame can be replaced by a newer one
+    block.type = PACKET_TYPE_POSITION_COMPACT;
+    TEST_ASSERT_TRUE(queueTelemetryBlock(&block));
+    block.type = PACKET_TYPE_STATUS;
+    TEST_ASSERT_TRUE(queueTelemetryBlock(&block));
+    TEST_ASSERT_TRUE(flushTelemetryBlocks());
+    TEST_ASSERT_EQUAL_UINT8(PACKET_TYPE_PRIORITY[PACKET_TYPE_STATUS], queued_frame_class.priority);
+    TEST_ASSERT_EQUAL_UINT16(PACKET_TYPE_DEADLINE[PACKET_TYPE_STATUS], queued_frame_class.deadline);
+    TEST_ASSERT_EQUAL_HEX16((1 << PACKET_TYPE_POSITION_COMPACT) | (1 << PACKET_TYPE_STATUS), queued_frame_class.contents);
+    
+    //the position reference doesn't expire, and isn't superseded by the next position
+    block.type = PACKET_TYPE_POSITION_REFERENCE;
+    TEST_ASSERT_TRUE(queueTelemetryBlock(&block));
+    block.type = PACKET_TYPE_POSITION_COMPACT;
+    TEST_ASSERT_TRUE(queueTelemetryBlock(&block));
+    TEST_ASSERT_TRUE(flushTelemetryBlocks());
+    TEST_ASSERT_EQUAL_UINT16(0, queued_frame_class.deadline);
+    TEST_ASSERT_EQUAL_HEX16(0, queued_frame_class.contents);
+    TEST_ASSERT_TRUE(queued_frame_class.barrier);
+}
+
+//compact positions can share a frame with any type that isn't sent on its own
+void test_positionReferenceShouldNotBeOvertakenByCompactPositions(void)
+{
+    uint8_t type;
+
+    for (type = 0; type < sizeof(PACKET_TYPE_PRIORITY); type++) {
+        if (!(RELIABLE_PACKET_TYPES & (1 << type))) {
+            TEST_ASSERT_TRUE(PACKET_TYPE_PRIORITY[PACKET_TYPE_POSITION_REFERENCE] >= PACKET_TYPE_PRIORITY[type]);
+        }
+    }
+}
+
+void test_updateDownlinkRateShouldBackOffUnderBackpressure(void)
+{
+    initRadio_Expect();
+    initDatalink();
+    queueRadioStatusPacket_Ignore();
+    getRadioTransmissionErrors_IgnoreAndReturn(0);
+    
+    getRadioBackpressure_IgnoreAndReturn(DOWNLINK_BACKPRESSURE_HIGH);
+    updateDownlinkRate();
+    TEST_ASSERT_EQUAL_UINT16(2 * DOWNLINK_SEND_INTERVAL, getDownlinkInterval());
+    for (i = 0; i < 10; i++){
+        updateDownlinkRate();
+    }
+    TEST_ASSERT_EQUAL_UINT16(DOWNLINK_MAX_SEND_INTERVAL, getDownlinkInterval());
+    
+    //neither backed up nor clear, so the rate holds
+    getRadioBackpressure_IgnoreAndReturn(DOWNLINK_BACKPRESSURE_LOW + 1);
+    updateDownlinkRate();
+    TEST_ASSERT_EQUAL_UINT16(DOWNLINK_MAX_SEND_INTERVAL, getDownlinkInterval());
+}
+
+void test_updateDownlinkRateShouldSpeedUpWhenRadioKeepsUp(void)
+{
+    initRadio_Expect();
+    initDatalink();
+    queueRadioStatusPacket_Ignore();
+    getRadioTransmissionErrors_IgnoreAndReturn(0);
+    
+    getRadioBackpressure_IgnoreAndReturn(DOWNLINK_BACKPRESSURE_LOW);
+    updateDownlinkRate();
+    TEST_ASSERT_EQUAL_UINT16(DOWNLINK_SEND_INTERVAL - DOWNLINK_INTERVAL_STEP, getDownlinkInterval());
+    for (i = 0; i < 20; i++){
+        updateDownlinkRate();
+    }
+    TEST_ASSERT_EQUAL_UINT16(DOWNLINK_MIN_SEND_INTERVAL, getDownlinkInterval());
+}
+
+void test_updateDownlinkRateShouldBackOffOnTransmissionErrors(void)
+{
+    initRadio_Expect();
+    initDatalink();
+    queueRadioStatusPacket_Ignore();
+    getRadioBackpressure_IgnoreAndReturn(0);
+    
+    getRadioTransmissionErrors_IgnoreAndReturn(3);
+    updateDownlinkRate();
+    TEST_ASSERT_EQUAL_UINT16(2 * DOWNLINK_SEND_INTERVAL, getDownlinkInterval());
+    updateDownlinkRate(); //no new errors
+    TEST_ASSERT_EQUAL_UINT16(2 * DOWNLINK_SEND_INTERVAL - DOWNLINK_INTERVAL_STEP, getDownlinkInterval());
+}
+
+void test_getNextPacketTypeShouldShedDiagnosticsWhenSlowedDown(void)
+{
+    PacketType type;
+    
+    initRadio_Expect();
+    initDatalink();
+    queueRadioStatusPacket_Ignore();
+    getRadioTransmissionErrors_IgnoreAndReturn(0);
+    getRadioBackpressure_IgnoreAndReturn(RADIO_BACKPRESSURE_MAX);
+    updateDownlinkRate();
+    
+    for (i = 0; i < 2 * (int)sizeof(DEFAULT_PACKET_ORDER); i++){
+        type = peekNextPacketType();
+        TEST_ASSERT_EQUAL_INT(type, getNextPacketType());
+        TEST_ASSERT_FALSE(DOWNLINK_SHED_PACKET_TYPES & (1 << type));
+    }
+    
+    //requested packets are still sent
+    queuePacketType(PACKET_TYPE_LATENCY);
+    TEST_ASSERT_EQUAL_INT(PACKET_TYPE_LATENCY, getNextPacketType());
+}
+
+void test_peekNextPacketTypeShouldNotSkipShedPacketTypes(void)
+{
+    PacketType shed;
+    
+    initRadio_Expect();
+    initDatalink();
+    queueRadioStatusPacket_Ignore();
+    getRadioTransmissionErrors_IgnoreAndReturn(0);
+    
+    //move the order up to a diagnostic type at the full rate
+    while (!(DOWNLINK_SHED_PACKET_TYPES & (1 << peekNextPacketType()))){
+        getNextPacketType();
+    }
+    shed = peekNextPacketType();
+    
+    //peeking while slowed down doesn't move the order past it
+    getRadioBackpressure_IgnoreAndReturn(RADIO_BACKPRESSURE_MAX);
+    updateDownlinkRate();
+    TEST_ASSERT_FALSE(DOWNLINK_SHED_PACKET_TYPES & (1 << peekNextPacketType()));
+    
+    getRadioBackpressure_IgnoreAndReturn(0);
+    for (i = 0; i < 20; i++){
+        updateDownlinkRate();
+    }
+    TEST_ASSERT_EQUAL_INT(shed, getNextPacketType());
+}
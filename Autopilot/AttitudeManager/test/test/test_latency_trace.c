@@ -0,0 +1,150 @@
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+//-- unity: unit test framework
+#include "unity.h"
+
+//-- module being tested
+#include "../../LatencyTrace.h"
+
+ // Mocked modules
+#include "mock_Timer.h"
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    PRIVATE TYPES
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+static LatencyStats stats;
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+/**
+ * Records a trace point at a time in us, as the raw Timer4 timestamp getTimeTicks() returns
+ */
+static void traceAt(uint64_t time, TraceSection section, bool end)
+{
+    uint16_t ms = (uint16_t)(time / 1000);
+    uint16_t ticks = (time % 1000) * T4_TICKS_TO_USEC;
+    getTimeTicks_ExpectAndReturn(((uint32_t)ms << 16) | ticks);
+    recordTracePoint(section, end);
+}
+
+/*******************************************************************************
+ *    SETUP, TEARDOWN
+ ******************************************************************************/
+
+void setUp(void)
+{
+    getLatencyStats(&stats); //clears anything left from the last test
+}
+
+void tearDown(void)
+{
+}
+
+/*******************************************************************************
+ *    TESTS
+ ******************************************************************************/
+
+void test_latencyTraceShouldTimeSections(void)
+{
+    traceAt(1000, TRACE_CONTROL, false);
+    traceAt(1010, TRACE_IMU, false);
+    traceAt(1200, TRACE_IMU, true);
+    traceAt(1500, TRACE_CONTROL, true);
+    traceAt(6000, TRACE_CONTROL, false);
+    traceAt(6300, TRACE_CONTROL, true);
+    processTracePoints();
+
+    getLatencyStats(&stats);
+    TEST_ASSERT_EQUAL_UINT16(2, stats.sections[TRACE_CONTROL].count);
+    TEST_ASSERT_EQUAL_UINT16(300, stats.sections[TRACE_CONTROL].min);
+    TEST_ASSERT_EQUAL_UINT16(500, stats.sections[TRACE_CONTROL].max);
+    TEST_ASSERT_EQUAL_UINT16(400, stats.sections[TRACE_CONTROL].mean);
+    TEST_ASSERT_EQUAL_UINT16(1, stats.sections[TRACE_IMU].count);
+    TEST_ASSERT_EQUAL_UINT16(190, stats.sections[TRACE_IMU].mean);
+    TEST_ASSERT_EQUAL_UINT16(0, stats.sections[TRACE_MIXING].count);
+}
+
+void test_latencyTraceShouldHandleTimestampWrap(void)
+{
+    traceAt(65535990, TRACE_MIXING, false); //the ms half of the timestamp wraps
+    traceAt(65536022, TRACE_MIXING, true);
+
+    getLatencyStats(&stats);
+    TEST_ASSERT_EQUAL_UINT16(32, stats.sections[TRACE_MIXING].max);
+}
+
+void test_latencyTraceShouldSaturateLongSections(void)
+{
+    traceAt(1000, TRACE_DATALINK_PARSE, false);
+    traceAt(101000, TRACE_DATALINK_PARSE, true);
+
+    getLatencyStats(&stats);
+    TEST_ASSERT_EQUAL_UINT16(UINT16_MAX, stats.sections[TRACE_DATALINK_PARSE].max);
+}
+
+void test_latencyTraceShouldBinDurations(void)
+{
+    traceAt(0, TRACE_PWM_WRITE, false);
+    traceAt(10, TRACE_PWM_WRITE, true); //under 32us
+    traceAt(100, TRACE_PWM_WRITE, false);
+    traceAt(140, TRACE_PWM_WRITE, true); //32 - 64us
+    traceAt(200, TRACE_PWM_WRITE, false);
+    traceAt(264, TRACE_PWM_WRITE, true); //64 - 128us
+    traceAt(1000, TRACE_PWM_WRITE, false);
+    traceAt(31000, TRACE_PWM_WRITE, true); //longer than the last bin
+
+    getLatencyStats(&stats);
+    TEST_ASSERT_EQUAL_UINT16(1, stats.sections[TRACE_PWM_WRITE].histogram[0]);
+    TEST_ASSERT_EQUAL_UINT16(1, stats.sections[TRACE_PWM_WRITE].histogram[1]);
+    TEST_ASSERT_EQUAL_UINT16(1, stats.sections[TRACE_PWM_WRITE].histogram[2]);
+    TEST_ASSERT_EQUAL_UINT16(1, stats.sections[TRACE_PWM_WRITE].histogram[LATENCY_HISTOGRAM_BINS - 1]);
+}
+
+void test_latencyTraceShouldIgnoreUnmatchedEnds(void)
+{
+    traceAt(100, TRACE_HIGH_LEVEL, true);
+    traceAt(200, TRACE_HIGH_LEVEL, false);
+    traceAt(250, TRACE_HIGH_LEVEL, true);
+    traceAt(300, TRACE_HIGH_LEVEL, true);
+
+    getLatencyStats(&stats);
+    TEST_ASSERT_EQUAL_UINT16(1, stats.sections[TRACE_HIGH_LEVEL].count);
+    TEST_ASSERT_EQUAL_UINT16(50, stats.sections[TRACE_HIGH_LEVEL].max);
+}
+
+void test_latencyTraceShouldCountDroppedPoints(void)
+{
+    uint8_t i;
+    for (i = 0; i < LATENCY_TRACE_BUFFER_SIZE - 1; i++) {
+        traceAt(i, TRACE_LOW_LEVEL, i & 1);
+    }
+    recordTracePoint(TRACE_LOW_LEVEL, false); //the ring is full, so the time isn't even read
+    recordTracePoint(TRACE_LOW_LEVEL, true);
+
+    getLatencyStats(&stats);
+    TEST_ASSERT_EQUAL_UINT16(2, stats.dropped);
+    TEST_ASSERT_EQUAL_UINT16((LATENCY_TRACE_BUFFER_SIZE - 1) / 2, stats.sections[TRACE_LOW_LEVEL].count);
+}
+
+void test_getLatencyStatsShouldReset(void)
+{
+    traceAt(0, TRACE_DATALINK_SEND, false);
+    traceAt(100, TRACE_DATALINK_SEND, true);
+    getLatencyStats(&stats);
+
+    getLatencyStats(&stats);
+    TEST_ASSERT_EQUAL_UINT16(0, stats.sections[TRACE_DATALINK_SEND].count);
+    TEST_ASSERT_EQUAL_UINT16(0, stats.sections[TRACE_DATALINK_SEND].max);
+}
@@ -23,10 +23,35 @@
 /*******************************************************************************
  *    PRIVATE DATA
  ******************************************************************************/
+
+/**
+ * Stands in for the free space at the end of the UART TX buffer
+ */
+static uint8_t tx_span[100];
+static uint16_t tx_span_length;
  
 /*******************************************************************************
  *    PRIVATE FUNCTIONS
  ******************************************************************************/
+
+static uint16_t reserveTXSpanCallback(uint8_t interface, uint8_t** span, int num_calls)
+{
+    (void)num_calls;
+    TEST_ASSERT_EQUAL_UINT8(LOGGER_UART_INTERFACE, interface);
+    *span = tx_span;
+    return tx_span_length;
+}
+
+/**
+ * Expects a message of the given length to be written straight into the TX buffer
+ */
+static void expectMessage(uint16_t length)
+{
+    getTXSpace_ExpectAndReturn(LOGGER_UART_INTERFACE, 100);
+    tx_span_length = sizeof(tx_span);
+    reserveTXSpan_StubWithCallback(reserveTXSpanCallback);
+    commitTXSpan_Expect(LOGGER_UART_INTERFACE, length);
+}
  
  
 /*******************************************************************************
@@ -58,44 +83,36 @@ void tearDown(void)
 
 void test_initLoggerShouldCallInitUART(void)
 {
-    initUART_Expect(LOGGER_UART_INTERFACE, LOGGER_UART_BAUD_RATE, LOGGER_BUFFER_INITIAL_LENGTH, LOGGER_BUFFER_MAX_LENGTH, 0b01);
+    initUART_Expect(LOGGER_UART_INTERFACE, LOGGER_UART_BAUD_RATE, LOGGER_BUFFER_LENGTH, 0b01);
     initLogger();
 }
 
 void test_debugShouldCallQueueUartWithCorrectMessage(void){
-    getTXSpace_ExpectAndReturn(LOGGER_UART_INTERFACE,100);
-    queueTXData_ExpectWithArray(LOGGER_UART_INTERFACE, (unsigned char*)DEBUG_TAG_STRING, DEBUG_TAG_STRING_LENGTH, DEBUG_TAG_STRING_LENGTH);
-    queueTXData_ExpectWithArray(LOGGER_UART_INTERFACE, (unsigned char*)"hello", 5, 5);
-    queueTXData_ExpectWithArray(LOGGER_UART_INTERFACE, (unsigned char*)"\r\n\0", 3, 3);
+    expectMessage(DEBUG_TAG_STRING_LENGTH + 5 + 3);
 
     debug("hello");
+    TEST_ASSERT_EQUAL_MEMORY(DEBUG_TAG_STRING "hello\r\n", tx_span, DEBUG_TAG_STRING_LENGTH + 5 + 3);
 }
 
 void test_warningShouldCallQueueUartWithCorrectMessage(void){
-    getTXSpace_ExpectAndReturn(LOGGER_UART_INTERFACE,100);
-    queueTXData_ExpectWithArray(LOGGER_UART_INTERFACE, (unsigned char*)WARNING_TAG_STRING, WARNING_TAG_STRING_LENGTH, WARNING_TAG_STRING_LENGTH);
-    queueTXData_ExpectWithArray(LOGGER_UART_INTERFACE, (unsigned char*)"hello", 5, 5);
-    queueTXData_ExpectWithArray(LOGGER_UART_INTERFACE, (unsigned char*)"\r\n\0", 3, 3);
+    expectMessage(WARNING_TAG_STRING_LENGTH + 5 + 3);
 
     warning("hello");
+    TEST_ASSERT_EQUAL_MEMORY(WARNING_TAG_STRING "hello\r\n", tx_span, WARNING_TAG_STRING_LENGTH + 5 + 3);
 }
 
 void test_errorShouldCallQueueUartWithCorrectMessage(void){
-    getTXSpace_ExpectAndReturn(LOGGER_UART_INTERFACE,100);
-    queueTXData_ExpectWithArray(LOGGER_UART_INTERFACE, (unsigned char*)ERROR_TAG_STRING, ERROR_TAG_STRING_LENGTH,ERROR_TAG_STRING_LENGTH);
-    queueTXData_ExpectWithArray(LOGGER_UART_INTERFACE, (unsigned char*)"hello", 5, 5);
-    queueTXData_ExpectWithArray(LOGGER_UART_INTERFACE, (unsigned char*)"\r\n\0", 3, 3);
+    expectMessage(ERROR_TAG_STRING_LENGTH + 5 + 3);
 
     error("hello");
+    TEST_ASSERT_EQUAL_MEMORY(ERROR_TAG_STRING "hello\r\n", tx_span, ERROR_TAG_STRING_LENGTH + 5 + 3);
 }
 
 void test_writeMessageWithOneCharacterShouldCallQueueWithCorrectMessage(void){
-    getTXSpace_ExpectAndReturn(LOGGER_UART_INTERFACE,100);
-    queueTXData_ExpectWithArray(LOGGER_UART_INTERFACE, (unsigned char*)ERROR_TAG_STRING, ERROR_TAG_STRING_LENGTH,ERROR_TAG_STRING_LENGTH);
-    queueTXData_ExpectWithArray(LOGGER_UART_INTERFACE, (unsigned char*)"r", 1, 1);
-    queueTXData_ExpectWithArray(LOGGER_UART_INTERFACE, (unsigned char*)"\r\n\0", 3, 3); 
+    expectMessage(ERROR_TAG_STRING_LENGTH + 1 + 3);
 
     error("r");
+    TEST_ASSERT_EQUAL_MEMORY(ERROR_TAG_STRING "r\r\n", tx_span, ERROR_TAG_STRING_LENGTH + 1 + 3);
 }
 
 void test_writeMessageThatIsTooLongShouldNotQueueUART(void){
@@ -105,10 +122,19 @@ void test_writeMessageThatIsTooLongShouldNotQueueUART(void){
 }
 
 void test_infoShouldCallQueueUartWithCorrectMessage(void){
+    expectMessage(INFO_TAG_STRING_LENGTH + 5 + 3);
+
+    info("hello");
+    TEST_ASSERT_EQUAL_MEMORY(INFO_TAG_STRING "hello\r\n", tx_span, INFO_TAG_STRING_LENGTH + 5 + 3);
+}
+
+void test_writeMessageShouldQueueInPartsIfTXBufferWrapsAround(void){
     getTXSpace_ExpectAndReturn(LOGGER_UART_INTERFACE,100);
+    tx_span_length = 4; //the rest of the space is at the start of the buffer
+    reserveTXSpan_StubWithCallback(reserveTXSpanCallback);
     queueTXData_ExpectWithArray(LOGGER_UART_INTERFACE, (unsigned char*)INFO_TAG_STRING, INFO_TAG_STRING_LENGTH, INFO_TAG_STRING_LENGTH);
     queueTXData_ExpectWithArray(LOGGER_UART_INTERFACE, (unsigned char*)"hello", 5, 5);
     queueTXData_ExpectWithArray(LOGGER_UART_INTERFACE, (unsigned char*)"\r\n\0", 3, 3);
 
     info("hello");
-}
\ No newline at end of file
+}
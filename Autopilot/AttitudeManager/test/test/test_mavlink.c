@@ -0,0 +1,240 @@
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+//-- unity: unit test framework
+#include "unity.h"
+#include <string.h>
+
+//-- module being tested
+#include "../../Network/Mavlink.h"
+#include "mock_UART.h"
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+#define UART_INTERFACE 2
+#define TX_CAPTURE_LENGTH 600
+
+/*******************************************************************************
+ *    PRIVATE TYPES
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+/**
+ * Everything queued for transmission
+ */
+static uint8_t tx_bytes[TX_CAPTURE_LENGTH];
+static uint16_t tx_length;
+
+static MavlinkParser parser;
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+static void queueTXDataCallback(uint8_t interface, uint8_t* data, uint16_t data_length, int num_calls)
+{
+    (void)num_calls;
+    TEST_ASSERT_EQUAL_UINT8(UART_INTERFACE, interface);
+    TEST_ASSERT_TRUE(tx_length + data_length <= TX_CAPTURE_LENGTH);
+    memcpy(&tx_bytes[tx_length], data, data_length);
+    tx_length += data_length;
+}
+
+/**
+ * Feeds bytes to the parser
+ * @return How many messages were parsed
+ */
+static uint8_t parseBytes(const uint8_t* data, uint16_t length)
+{
+    uint8_t parsed = 0;
+    uint16_t i;
+    for (i = 0; i < length; i++) {
+        parsed += parseMavlinkByte(&parser, data[i]);
+    }
+    return parsed;
+}
+
+/**
+ * Rewrites the sender of a frame, as if it came from another system
+ */
+static void setFrameSender(uint8_t* frame, uint16_t length, uint8_t system_id, uint8_t sequence, uint8_t crc_extra)
+{
+    uint16_t crc = 0xFFFF;
+    uint16_t i;
+
+    frame[4] = sequence;
+    frame[5] = system_id;
+    for (i = 1; i < length - MAVLINK_CHECKSUM_LENGTH; i++) {
+        crc = mavlinkCrcAccumulate(frame[i], crc);
+    }
+    crc = mavlinkCrcAccumulate(crc_extra, crc);
+    frame[length - 2] = crc & 0xFF;
+    frame[length - 1] = crc >> 8;
+}
+
+/*******************************************************************************
+ *    SETUP, TEARDOWN
+ ******************************************************************************/
+
+void setUp(void)
+{
+    tx_length = 0;
+    memset(&parser, 0, sizeof(parser));
+}
+
+void tearDown(void)
+{
+}
+
+/*******************************************************************************
+ *    TESTS
+ ******************************************************************************/
+
+void test_mavlinkCrcShouldMatchCheckValue(void)
+{
+    const char* check = "123456789";
+    uint16_t crc = 0xFFFF;
+
+    while (*check) {
+        crc = mavlinkCrcAccumulate(*check++, crc);
+    }
+    TEST_ASSERT_EQUAL_HEX16(0x6F91, crc); //CRC-16/MCRF4XX check value
+}
+
+void test_sendMavlinkMessageShouldSerialiseFrame(void)
+{
+    MavlinkHeartbeat heartbeat = {0x12345678, 1, 0, 1, 4, 3};
+    uint16_t crc = 0xFFFF;
+    uint8_t i;
+
+    getTXSpace_IgnoreAndReturn(100);
+    queueTXData_StubWithCallback((CMOCK_queueTXData_CALLBACK) queueTXDataCallback);
+
+    TEST_ASSERT_TRUE(MAVLINK_SEND(UART_INTERFACE, HEARTBEAT, &heartbeat));
+    TEST_ASSERT_EQUAL_UINT16(MAVLINK_FRAME_OVERHEAD + MAVLINK_MSG_HEARTBEAT_LEN, tx_length);
+
+    TEST_ASSERT_EQUAL_HEX8(MAVLINK_STX, tx_bytes[0]);
+    TEST_ASSERT_EQUAL_UINT8(MAVLINK_MSG_HEARTBEAT_LEN, tx_bytes[1]);
+    TEST_ASSERT_EQUAL_HEX8(0, tx_bytes[2]); //incompat flags
+    TEST_ASSERT_EQUAL_UINT8(MAVLINK_SYSTEM_ID, tx_bytes[5]);
+    TEST_ASSERT_EQUAL_UINT8(MAVLINK_COMPONENT_ID, tx_bytes[6]);
+    TEST_ASSERT_EQUAL_HEX8(MAVLINK_MSG_ID_HEARTBEAT, tx_bytes[7]);
+
+    //little endian custom mode first, then the byte fields
+    TEST_ASSERT_EQUAL_HEX8(0x78, tx_bytes[MAVLINK_HEADER_LENGTH]);
+    TEST_ASSERT_EQUAL_HEX8(0x12, tx_bytes[MAVLINK_HEADER_LENGTH + 3]);
+    TEST_ASSERT_EQUAL_UINT8(3, tx_bytes[MAVLINK_HEADER_LENGTH + 8]);
+
+    for (i = 1; i < MAVLINK_HEADER_LENGTH + MAVLINK_MSG_HEARTBEAT_LEN; i++) {
+        crc = mavlinkCrcAccumulate(tx_bytes[i], crc);
+    }
+    crc = mavlinkCrcAccumulate(MAVLINK_MSG_HEARTBEAT_CRC, crc);
+    TEST_ASSERT_EQUAL_HEX8(crc & 0xFF, tx_bytes[tx_length - 2]);
+    TEST_ASSERT_EQUAL_HEX8(crc >> 8, tx_bytes[tx_length - 1]);
+}
+
+void test_sendMavlinkMessageShouldNotQueuePartialFrames(void)
+{
+    MavlinkAttitude attitude;
+    uint16_t dropped = getMavlinkDroppedMessages();
+
+    //queueTXData has no expectations, so any call fails the test
+    getTXSpace_IgnoreAndReturn(MAVLINK_FRAME_OVERHEAD + MAVLINK_MSG_ATTITUDE_LEN - 1);
+    TEST_ASSERT_FALSE(MAVLINK_SEND(UART_INTERFACE, ATTITUDE, &attitude));
+    TEST_ASSERT_EQUAL_UINT16(dropped + 1, getMavlinkDroppedMessages());
+}
+
+void test_parseMavlinkByteShouldParseSentExtension(void)
+{
+    uint8_t data[] = {6, 3, 0xAA, 0xBB, 0xCC};
+
+    getTXSpace_IgnoreAndReturn(100);
+    queueTXData_StubWithCallback((CMOCK_queueTXData_CALLBACK) queueTXDataCallback);
+    TEST_ASSERT_TRUE(sendMavlinkExtension(UART_INTERFACE, 32768, data, sizeof(data)));
+
+    //the message is only complete on the last byte
+    TEST_ASSERT_EQUAL_UINT8(0, parseBytes(tx_bytes, tx_length - 1));
+    TEST_ASSERT_TRUE(parseMavlinkByte(&parser, tx_bytes[tx_length - 1]));
+
+    TEST_ASSERT_EQUAL_UINT32(MAVLINK_MSG_ID_V2_EXTENSION, parser.message.msg_id);
+    TEST_ASSERT_EQUAL_UINT8(MAVLINK_EXTENSION_HEADER_LENGTH + sizeof(data), parser.message.length);
+    TEST_ASSERT_EQUAL_HEX8(0x00, parser.message.payload[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x80, parser.message.payload[1]);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(data, &parser.message.payload[MAVLINK_EXTENSION_HEADER_LENGTH], sizeof(data));
+    //the rest of the payload is zero filled
+    TEST_ASSERT_EQUAL_HEX8(0, parser.message.payload[MAVLINK_MSG_V2_EXTENSION_LEN - 1]);
+    TEST_ASSERT_EQUAL_UINT16(1, parser.stats.received);
+}
+
+void test_parseMavlinkByteShouldRejectCorruptedFrames(void)
+{
+    MavlinkMissionCurrent mission_current = {7};
+
+    getTXSpace_IgnoreAndReturn(100);
+    queueTXData_StubWithCallback((CMOCK_queueTXData_CALLBACK) queueTXDataCallback);
+    MAVLINK_SEND(UART_INTERFACE, MISSION_CURRENT, &mission_current);
+    MAVLINK_SEND(UART_INTERFACE, MISSION_CURRENT, &mission_current);
+
+    tx_bytes[MAVLINK_HEADER_LENGTH] ^= 0x01; //corrupt the first frame's payload
+    TEST_ASSERT_EQUAL_UINT8(1, parseBytes(tx_bytes, tx_length));
+    TEST_ASSERT_EQUAL_UINT16(1, parser.stats.crc_errors);
+    TEST_ASSERT_EQUAL_UINT16(7, parser.message.payload[0]);
+}
+
+void test_parseMavlinkByteShouldCountUnknownMessages(void)
+{
+    uint8_t payload[4] = {1, 2, 3, 4};
+
+    getTXSpace_IgnoreAndReturn(100);
+    queueTXData_StubWithCallback((CMOCK_queueTXData_CALLBACK) queueTXDataCallback);
+    sendMavlinkMessage(UART_INTERFACE, 0x012345, payload, sizeof(payload), 0);
+
+    TEST_ASSERT_EQUAL_UINT8(0, parseBytes(tx_bytes, tx_length));
+    TEST_ASSERT_EQUAL_UINT16(1, parser.stats.unknown);
+}
+
+void test_parseMavlinkByteShouldCountSequenceGaps(void)
+{
+    MavlinkMissionCurrent mission_current = {1};
+    uint16_t frame_length = MAVLINK_FRAME_OVERHEAD + MAVLINK_MSG_MISSION_CURRENT_LEN;
+
+    getTXSpace_IgnoreAndReturn(100);
+    queueTXData_StubWithCallback((CMOCK_queueTXData_CALLBACK) queueTXDataCallback);
+    MAVLINK_SEND(UART_INTERFACE, MISSION_CURRENT, &mission_current);
+    MAVLINK_SEND(UART_INTERFACE, MISSION_CURRENT, &mission_current);
+    MAVLINK_SEND(UART_INTERFACE, MISSION_CURRENT, &mission_current);
+
+    //skip the second frame
+    TEST_ASSERT_EQUAL_UINT8(1, parseBytes(tx_bytes, frame_length));
+    TEST_ASSERT_EQUAL_UINT8(1, parseBytes(&tx_bytes[2 * frame_length], frame_length));
+    TEST_ASSERT_EQUAL_UINT16(1, parser.stats.sequence_gaps);
+    TEST_ASSERT_EQUAL_UINT16(2, parser.stats.received);
+}
+
+void test_parseMavlinkByteShouldTrackSequencesPerSystem(void)
+{
+    MavlinkMissionCurrent mission_current = {1};
+    uint16_t frame_length = MAVLINK_FRAME_OVERHEAD + MAVLINK_MSG_MISSION_CURRENT_LEN;
+    uint8_t i;
+
+    getTXSpace_IgnoreAndReturn(100);
+    queueTXData_StubWithCallback((CMOCK_queueTXData_CALLBACK) queueTXDataCallback);
+    for (i = 0; i < 4; i++) {
+        MAVLINK_SEND(UART_INTERFACE, MISSION_CURRENT, &mission_current);
+    }
+
+    //two systems interleave their messages, each numbering its own
+    setFrameSender(tx_bytes, frame_length, 255, 10, MAVLINK_MSG_MISSION_CURRENT_CRC);
+    setFrameSender(&tx_bytes[frame_length], frame_length, 51, 200, MAVLINK_MSG_MISSION_CURRENT_CRC);
+    setFrameSender(&tx_bytes[2 * frame_length], frame_length, 255, 11, MAVLINK_MSG_MISSION_CURRENT_CRC);
+    setFrameSender(&tx_bytes[3 * frame_length], frame_length, 51, 202, MAVLINK_MSG_MISSION_CURRENT_CRC);
+
+    TEST_ASSERT_EQUAL_UINT8(4, parseBytes(tx_bytes, 4 * frame_length));
+    TEST_ASSERT_EQUAL_UINT16(1, parser.stats.sequence_gaps); //only the one system 51 skipped
+    TEST_ASSERT_EQUAL_UINT16(4, parser.stats.received);
+}
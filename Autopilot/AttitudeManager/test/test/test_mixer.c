@@ -0,0 +1,136 @@
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+//-- unity: unit test framework
+#include "unity.h"
+
+//-- module being tested
+#include "../../Mixer.h"
+#include "../../PWM.h"
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+#define LIMIT 1000
+
+/*******************************************************************************
+ *    PRIVATE TYPES
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+
+//quad X, with the same signs as Multirotor.c
+static const MixerOutput quad_outputs[4] = {
+    {1, -LIMIT, LIMIT, {MIX(1), MIX(1), MIX(-1), MIX(1)}},
+    {2, -LIMIT, LIMIT, {MIX(-1), MIX(1), MIX(1), MIX(1)}},
+    {3, -LIMIT, LIMIT, {MIX(-1), MIX(-1), MIX(-1), MIX(1)}},
+    {4, -LIMIT, LIMIT, {MIX(1), MIX(-1), MIX(1), MIX(1)}}
+};
+
+//inverse V-tail, with a different limit on each output, and no desaturation
+static const MixerOutput plane_outputs[3] = {
+    {1, -1024, 1024, {0, 0, 0, MIX(1)}},
+    {3, -900, 900, {0, MIX(-0.75), MIX(0.75), 0}},
+    {4, -500, 500, {0, MIX(0.75), MIX(0.75), 0}}
+};
+
+static const MixerTable quad = {quad_outputs, 4, true};
+static const MixerTable plane = {plane_outputs, 3, false};
+
+static int outputs[NUM_CHANNELS];
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+static uint8_t mix(const MixerTable* mixer, int roll, int pitch, int yaw, int throttle)
+{
+    int inputs[MIXER_INPUTS];
+    inputs[MIXER_ROLL] = roll;
+    inputs[MIXER_PITCH] = pitch;
+    inputs[MIXER_YAW] = yaw;
+    inputs[MIXER_THROTTLE] = throttle;
+    return applyMixer(mixer, inputs, outputs);
+}
+
+/*******************************************************************************
+ *    SETUP, TEARDOWN
+ ******************************************************************************/
+
+void setUp(void)
+{
+    uint8_t i;
+    for (i = 0; i < NUM_CHANNELS; i++) {
+        outputs[i] = 12345;
+    }
+}
+
+void tearDown(void)
+{
+}
+
+/*******************************************************************************
+ *    TESTS
+ ******************************************************************************/
+
+void test_mixerShouldApplyWeights(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(0, mix(&quad, 10, 20, 30, 100));
+    TEST_ASSERT_EQUAL_INT(100 + 10 + 20 - 30, outputs[0]);
+    TEST_ASSERT_EQUAL_INT(100 - 10 + 20 + 30, outputs[1]);
+    TEST_ASSERT_EQUAL_INT(100 - 10 - 20 - 30, outputs[2]);
+    TEST_ASSERT_EQUAL_INT(100 + 10 - 20 + 30, outputs[3]);
+}
+
+void test_mixerShouldRoundFractionalWeights(void)
+{
+    mix(&plane, 0, 101, 0, 0);
+    TEST_ASSERT_EQUAL_INT(-76, outputs[2]); //-75.75
+    TEST_ASSERT_EQUAL_INT(76, outputs[3]);
+}
+
+void test_mixerShouldOnlyWriteItsChannels(void)
+{
+    mix(&plane, 0, 0, 0, 0);
+    TEST_ASSERT_EQUAL_INT(12345, outputs[1]);
+    TEST_ASSERT_EQUAL_INT(12345, outputs[4]);
+    TEST_ASSERT_EQUAL_INT(12345, outputs[7]);
+}
+
+void test_mixerShouldClipToPerOutputLimits(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(2, mix(&plane, 0, 0, 1000, 2000));
+    TEST_ASSERT_EQUAL_INT(1024, outputs[0]);
+    TEST_ASSERT_EQUAL_INT(750, outputs[2]);
+    TEST_ASSERT_EQUAL_INT(500, outputs[3]);
+}
+
+void test_mixerShouldLowerThrottleToKeepAttitudeControl(void)
+{
+    //full throttle with a roll command would saturate two motors
+    TEST_ASSERT_EQUAL_UINT8(0, mix(&quad, 200, 0, 0, 900));
+    TEST_ASSERT_EQUAL_INT(LIMIT, outputs[0]);
+    TEST_ASSERT_EQUAL_INT(LIMIT - 400, outputs[1]);
+    TEST_ASSERT_EQUAL_INT(LIMIT - 400, outputs[2]);
+    TEST_ASSERT_EQUAL_INT(LIMIT, outputs[3]);
+}
+
+void test_mixerShouldRaiseThrottleToKeepAttitudeControl(void)
+{
+    TEST_ASSERT_EQUAL_UINT8(0, mix(&quad, 0, 100, 0, -950));
+    TEST_ASSERT_EQUAL_INT(-LIMIT + 200, outputs[0]);
+    TEST_ASSERT_EQUAL_INT(-LIMIT, outputs[2]);
+}
+
+void test_mixerShouldCenterWhenAttitudeDoesNotFit(void)
+{
+    //a spread of 2400 can't fit in 2000, so both ends clip evenly
+    TEST_ASSERT_EQUAL_UINT8(2, mix(&quad, 600, 600, 0, 800));
+    TEST_ASSERT_EQUAL_INT(LIMIT, outputs[0]);
+    TEST_ASSERT_EQUAL_INT(0, outputs[1]);
+    TEST_ASSERT_EQUAL_INT(-LIMIT, outputs[2]);
+    TEST_ASSERT_EQUAL_INT(0, outputs[3]);
+}
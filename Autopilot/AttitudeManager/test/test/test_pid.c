@@ -0,0 +1,210 @@
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+//-- unity: unit test framework
+#include "unity.h"
+#include <math.h>
+
+//-- module being tested
+#include "../../PID.h"
+#include "../../../Common/Utilities/FixedPoint.h"
+
+ // Mocked modules
+#include "mock_Timer.h"
+#include "mock_Logger.h"
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+#define STEP_USEC 5000
+#define STEPS 400
+
+/*******************************************************************************
+ *    PRIVATE TYPES
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+static PIDVal pid_float;
+static PIDVal pid_fixed;
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+/**
+ * Runs both implementations over the same error signal and checks that their
+ * outputs never differ by more than the given tolerance
+ */
+static void assertEquivalent(float kp, float ki, float kd, float scale, float tolerance)
+{
+    uint16_t i;
+    initPID(&pid_float, kp, ki, kd, 1000);
+    initPID(&pid_fixed, kp, ki, kd, 1000);
+
+    for (i = 0; i < STEPS; i++) {
+        //a slow sine with a step in the middle, roughly what an attitude error looks like
+        float error = 20.f * sinf(i * 0.05f) + (i > STEPS / 2 ? 15.f : 0.f);
+        uint32_t delta = (i == 0) ? PID_RESET_TIME + 1 : STEP_USEC;
+
+        float expected = PIDcontrolFloat(&pid_float, error, scale, delta);
+        float actual = q16ToFloat(PIDcontrolFixed(&pid_fixed, floatToQ16(error), floatToQ16(scale), delta));
+
+        TEST_ASSERT_FLOAT_WITHIN(tolerance, expected, actual);
+    }
+}
+
+/*******************************************************************************
+ *    SETUP, TEARDOWN
+ ******************************************************************************/
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+/*******************************************************************************
+ *    TESTS
+ ******************************************************************************/
+
+void test_floatToQ16ShouldRoundTrip(void)
+{
+    TEST_ASSERT_EQUAL_INT32(Q16_ONE, floatToQ16(1.f));
+    TEST_ASSERT_EQUAL_INT32(-Q16_ONE / 2, floatToQ16(-0.5f));
+    TEST_ASSERT_EQUAL_INT32(Q16(5.6), floatToQ16(5.6f));
+    TEST_ASSERT_FLOAT_WITHIN(0.00002f, 123.456f, q16ToFloat(floatToQ16(123.456f)));
+}
+
+void test_floatToQ16ShouldSaturate(void)
+{
+    TEST_ASSERT_EQUAL_INT32(Q16_MAX, floatToQ16(40000.f));
+    TEST_ASSERT_EQUAL_INT32(Q16_MIN, floatToQ16(-40000.f));
+}
+
+void test_q16ArithmeticShouldSaturate(void)
+{
+    TEST_ASSERT_EQUAL_INT32(Q16_MAX, q16Add(Q16_MAX, Q16_ONE));
+    TEST_ASSERT_EQUAL_INT32(Q16_MIN, q16Sub(Q16_MIN, Q16_ONE));
+    TEST_ASSERT_EQUAL_INT32(Q16_MAX, q16Mul(INT_TO_Q16(1000), INT_TO_Q16(1000)));
+    TEST_ASSERT_EQUAL_INT32(Q16_MIN, q16Mul(INT_TO_Q16(-1000), INT_TO_Q16(1000)));
+}
+
+void test_q16MulShouldRound(void)
+{
+    TEST_ASSERT_EQUAL_INT32(INT_TO_Q16(6), q16Mul(INT_TO_Q16(2), INT_TO_Q16(3)));
+    TEST_ASSERT_EQUAL_INT32(INT_TO_Q16(-6), q16Mul(INT_TO_Q16(-2), INT_TO_Q16(3)));
+    TEST_ASSERT_EQUAL_INT32(1, q16Mul(1, Q16_ONE / 2 + 1)); //0.5 LSB rounds up
+}
+
+void test_q16TimeConversions(void)
+{
+    TEST_ASSERT_EQUAL_INT32(Q16(0.005), q16MulMicros(Q16_ONE, 5000));
+    TEST_ASSERT_EQUAL_INT32(Q16(-0.25), q16MulMicros(INT_TO_Q16(-50), 5000));
+    TEST_ASSERT_EQUAL_INT32(INT_TO_Q16(200), q16InverseMicros(5000));
+    TEST_ASSERT_EQUAL_INT32(INT_TO_Q16(2000), q16InverseMicros(500));
+}
+
+void test_PIDcontrolFixedShouldMatchFloatForProportional(void)
+{
+    assertEquivalent(1.5f, 0, 0, 1024.f / 180.f, 0.01f);
+}
+
+void test_PIDcontrolFixedShouldMatchFloatForProportionalIntegral(void)
+{
+    assertEquivalent(1.2f, 0.8f, 0, 1, 0.01f);
+}
+
+void test_PIDcontrolFixedShouldMatchFloatForFullPID(void)
+{
+    //the derivative of the error step is large, so allow a bit more error
+    assertEquivalent(2.f, 0.5f, 0.05f, 1024.f / 240.f, 0.1f);
+}
+
+void test_PIDcontrolFixedIntegralShouldBeLimited(void)
+{
+    uint16_t i;
+    initPID(&pid_fixed, 0, 100.f, 0, 50);
+    PIDcontrolFixed(&pid_fixed, INT_TO_Q16(10), Q16_ONE, PID_RESET_TIME + 1);
+    for (i = 0; i < 100; i++) {
+        PIDcontrolFixed(&pid_fixed, INT_TO_Q16(10), Q16_ONE, STEP_USEC);
+    }
+    TEST_ASSERT_EQUAL_INT32(INT_TO_Q16(50), pid_fixed.integral_q);
+}
+
+void test_PIDcontrolFixedShouldResetAfterTimeout(void)
+{
+    initPID(&pid_fixed, 0, 1.f, 0, 1000);
+    PIDcontrolFixed(&pid_fixed, INT_TO_Q16(10), Q16_ONE, PID_RESET_TIME + 1);
+    PIDcontrolFixed(&pid_fixed, INT_TO_Q16(10), Q16_ONE, STEP_USEC);
+    TEST_ASSERT_NOT_EQUAL(0, pid_fixed.integral_q);
+
+    PIDcontrolFixed(&pid_fixed, INT_TO_Q16(10), Q16_ONE, PID_RESET_TIME + 1);
+    TEST_ASSERT_EQUAL_INT32(0, pid_fixed.integral_q);
+}
+
+void test_updatePIDGainsShouldConvertGains(void)
+{
+    initPID(&pid_fixed, 1, 2, 3, 1000);
+    pid_fixed.kd = 0.25f;
+    updatePIDGains(&pid_fixed);
+    TEST_ASSERT_EQUAL_INT32(INT_TO_Q16(1), pid_fixed.kp_q);
+    TEST_ASSERT_EQUAL_INT32(INT_TO_Q16(2), pid_fixed.ki_q);
+    TEST_ASSERT_EQUAL_INT32(Q16_ONE / 4, pid_fixed.kd_q);
+    TEST_ASSERT_EQUAL_INT32(INT_TO_Q16(1000), pid_fixed.i_max_q);
+}
+
+void test_PIDcontrolShouldUseStepTime(void)
+{
+    initPID(&pid_fixed, 0, 1.f, 0, 1000);
+
+    setPIDStepTime(1000000, STEP_USEC);
+    TEST_ASSERT_EQUAL_FLOAT(0, PIDcontrol(&pid_fixed, 10.f, 1.f));
+
+    setPIDStepTime(1000000 + 100000, 100000); //0.1s later, so integral is 10 * 0.1
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.f, PIDcontrol(&pid_fixed, 10.f, 1.f));
+}
+
+//a loop that runs twice in the same step only skips the I and D terms, it isn't reset
+void test_PIDcontrolShouldNotResetWithinAStep(void)
+{
+    initPID(&pid_fixed, 0, 1.f, 0, 1000);
+
+    setPIDStepTime(3000000, 100000);
+    PIDcontrol(&pid_fixed, 10.f, 1.f);
+    setPIDStepTime(3000000 + 100000, 100000);
+    PIDcontrol(&pid_fixed, 10.f, 1.f);
+    TEST_ASSERT_EQUAL_FLOAT(0, PIDcontrol(&pid_fixed, 10.f, 1.f));
+
+    setPIDStepTime(3000000 + 200000, 100000);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 2.f, PIDcontrol(&pid_fixed, 10.f, 1.f));
+}
+
+void test_PIDcontrolShouldKeepScaleConversion(void)
+{
+    initPID(&pid_fixed, 1.f, 0, 0, 1000);
+
+    setPIDStepTime(4000000, STEP_USEC);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 25.f, PIDcontrol(&pid_fixed, 10.f, 2.5f));
+    TEST_ASSERT_EQUAL_INT32(Q16(2.5), pid_fixed.scale_q);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, -20.f, PIDcontrol(&pid_fixed, -8.f, 2.5f));
+}
+
+void test_PIDcontrolShouldShareStepTimeBetweenLoops(void)
+{
+    initPID(&pid_float, 0, 1.f, 0, 1000);
+    initPID(&pid_fixed, 0, 1.f, 0, 1000);
+
+    setPIDStepTime(2000000, STEP_USEC);
+    PIDcontrol(&pid_float, 10.f, 1.f);
+    PIDcontrol(&pid_fixed, 10.f, 1.f);
+
+    setPIDStepTime(2000000 + STEP_USEC, STEP_USEC);
+    TEST_ASSERT_EQUAL_FLOAT(PIDcontrol(&pid_float, 10.f, 1.f), PIDcontrol(&pid_fixed, 10.f, 1.f));
+    TEST_ASSERT_EQUAL_UINT32(2000000 + STEP_USEC, pid_float.last_time);
+    TEST_ASSERT_EQUAL_UINT32(2000000 + STEP_USEC, pid_fixed.last_time);
+}
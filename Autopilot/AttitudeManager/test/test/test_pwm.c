@@ -0,0 +1,220 @@
+/*******************************************************************************
+ *    INCLUDED FILES
+ ******************************************************************************/
+
+//-- unity: unit test framework
+#include "unity.h"
+
+//-- module being tested
+#include "../../PWM.h"
+#include "../../../Common/Utilities/FixedPoint.h"
+
+ // Mocked modules
+#include "mock_OutputCompare.h"
+#include "mock_InputCapture.h"
+#include "mock_Timer.h"
+#include "mock_Logger.h"
+
+/*******************************************************************************
+ *    DEFINITIONS
+ ******************************************************************************/
+#define DEFAULT_INPUT_SCALE (MAX_PWM/(float)(UPPER_PWM - MIDDLE_PWM))
+#define DEFAULT_OUTPUT_SCALE ((float)(UPPER_PWM - MIDDLE_PWM)/MAX_PWM)
+
+/*******************************************************************************
+ *    PRIVATE TYPES
+ ******************************************************************************/
+
+/*******************************************************************************
+ *    PRIVATE DATA
+ ******************************************************************************/
+static uint16_t oc_written[NUM_CHANNELS];
+static int oc_writes;
+static unsigned int ic_values[NUM_CHANNELS];
+static int ppm_frame[NUM_CHANNELS];
+static uint8_t ppm_calibrated_channel;
+static q16_t ppm_scale;
+static int ppm_offset;
+
+/*******************************************************************************
+ *    PRIVATE FUNCTIONS
+ ******************************************************************************/
+
+static void setAllOCValuesMock(const uint16_t* duty, int cmock_num_calls)
+{
+    uint8_t i;
+    (void)cmock_num_calls;
+    for (i = 0; i < NUM_CHANNELS; i++) {
+        oc_written[i] = duty[i];
+    }
+    oc_writes++;
+}
+
+static unsigned int* getICValuesMock(unsigned long int sys_time, int cmock_num_calls)
+{
+    (void)sys_time;
+    (void)cmock_num_calls;
+    return ic_values;
+}
+
+static void calibratePPMChannelMock(uint8_t channel, q16_t scale, int offset, int cmock_num_calls)
+{
+    (void)cmock_num_calls;
+    ppm_calibrated_channel = channel;
+    ppm_scale = scale;
+    ppm_offset = offset;
+}
+
+/**
+ * The OC value the float implementation used to calculate
+ */
+static int floatOutput(int pwm, float scale, int offset)
+{
+    return (int) (pwm * scale + offset);
+}
+
+/*******************************************************************************
+ *    SETUP, TEARDOWN
+ ******************************************************************************/
+
+void setUp(void)
+{
+    initTimer2_Ignore();
+    initIC_Ignore();
+    initOC_Ignore();
+    setAllOCValues_StubWithCallback((CMOCK_setAllOCValues_CALLBACK) setAllOCValuesMock);
+    getICValues_StubWithCallback((CMOCK_getICValues_CALLBACK) getICValuesMock);
+    calibratePPMChannel_StubWithCallback((CMOCK_calibratePPMChannel_CALLBACK) calibratePPMChannelMock);
+    getPPMFrame_IgnoreAndReturn(ppm_frame);
+    oc_writes = 0;
+    initPWM(0xFF, 0xFF);
+}
+
+void tearDown(void)
+{
+}
+
+/*******************************************************************************
+ *    TESTS
+ ******************************************************************************/
+
+void test_setAllPWMShouldMatchFloatScaling(void)
+{
+    int pwms[NUM_CHANNELS];
+    int pwm;
+    uint8_t i;
+
+    for (pwm = MIN_PWM; pwm <= MAX_PWM; pwm += 8) {
+        for (i = 0; i < NUM_CHANNELS; i++) {
+            pwms[i] = pwm;
+        }
+        setAllPWM(pwms);
+        //the float version truncated, rather than rounding
+        TEST_ASSERT_INT_WITHIN(1, floatOutput(pwm, DEFAULT_OUTPUT_SCALE, MIDDLE_PWM), oc_written[0]);
+    }
+    TEST_ASSERT_EQUAL_UINT16(UPPER_PWM, oc_written[7]);
+}
+
+void test_setAllPWMShouldWriteAllOutputsAtOnce(void)
+{
+    int pwms[NUM_CHANNELS] = {MIN_PWM, -512, 0, 512, MAX_PWM, 0, 0, 0};
+    setAllPWM(pwms);
+    TEST_ASSERT_EQUAL_INT(1, oc_writes);
+    TEST_ASSERT_EQUAL_UINT16(MIDDLE_PWM - (UPPER_PWM - MIDDLE_PWM), oc_written[0]);
+    TEST_ASSERT_EQUAL_UINT16(MIDDLE_PWM, oc_written[2]);
+    TEST_ASSERT_EQUAL_UINT16(UPPER_PWM, oc_written[4]);
+}
+
+void test_setAllPWMShouldKeepOutputsOutOfRange(void)
+{
+    int pwms[NUM_CHANNELS] = {500, 500, 500, 500, 500, 500, 500, 500};
+    setAllPWM(pwms);
+
+    pwms[1] = MAX_PWM + 1;
+    pwms[6] = MIN_PWM - 1;
+    pwms[0] = 0;
+    setAllPWM(pwms);
+    TEST_ASSERT_EQUAL_UINT16(MIDDLE_PWM, oc_written[0]);
+    TEST_ASSERT_EQUAL_UINT16(oc_written[2], oc_written[1]);
+    TEST_ASSERT_EQUAL_UINT16(oc_written[2], oc_written[6]);
+    TEST_ASSERT_EQUAL_INT(500, getPWMOutputs()[1]);
+}
+
+void test_calibratedOutputsShouldMatchFloatScaling(void)
+{
+    int pwms[NUM_CHANNELS] = {0};
+    int pwm;
+
+    calibratePWMOutputs(1, -0.41f, 900);
+    for (pwm = MIN_PWM; pwm <= MAX_PWM; pwm += 8) {
+        pwms[0] = pwm;
+        setAllPWM(pwms);
+        TEST_ASSERT_INT_WITHIN(1, floatOutput(pwm, -0.41f, 900), oc_written[0]);
+    }
+}
+
+void test_calibratePWMInputsShouldCalibratePPMFrames(void)
+{
+    calibratePWMInputs(2, 2.5f, 700);
+    TEST_ASSERT_EQUAL_UINT8(1, ppm_calibrated_channel);
+    TEST_ASSERT_EQUAL_INT32(Q16(2.5), ppm_scale);
+    TEST_ASSERT_EQUAL_INT(700, ppm_offset);
+}
+
+void test_scalePWMInputShouldMatchFloatScaling(void)
+{
+    unsigned int ic;
+
+    calibratePWMInputs(2, 2.5f, 700);
+    for (ic = LOWER_PWM - 50; ic <= UPPER_PWM + 50; ic++) {
+        TEST_ASSERT_INT_WITHIN(1, (int)(((int)ic - MIDDLE_PWM) * DEFAULT_INPUT_SCALE), scalePWMInput(0, ic));
+        TEST_ASSERT_INT_WITHIN(1, (int)(((int)ic - 700) * 2.5f), scalePWMInput(1, ic));
+    }
+}
+
+void test_getPWMArrayShouldUseCalibratedPPMFrame(void)
+{
+    uint8_t i;
+    int* inputs;
+    for (i = 0; i < NUM_CHANNELS; i++) {
+        ic_values[i] = MIDDLE_PWM + 100;
+        ppm_frame[i] = 300 + i;
+    }
+
+    inputs = getPWMArray(0);
+    TEST_ASSERT_EQUAL_INT(300, inputs[0]);
+    TEST_ASSERT_EQUAL_INT(307, inputs[7]);
+}
+
+void test_checkNewPWMInputsShouldOnlyBeSetOnNewFrames(void)
+{
+    checkNewPPMFrame_ExpectAndReturn(NULL, true);
+    TEST_ASSERT_TRUE(checkNewPWMInputs(100, NULL));
+
+    checkNewPPMFrame_ExpectAndReturn(NULL, false);
+    isPPMConnected_ExpectAndReturn(110, true);
+    TEST_ASSERT_FALSE(checkNewPWMInputs(110, NULL));
+}
+
+void test_checkNewPWMInputsShouldBeSetWhenDisconnected(void)
+{
+    checkNewPPMFrame_ExpectAndReturn(NULL, false);
+    isPPMConnected_ExpectAndReturn(500, false);
+    TEST_ASSERT_TRUE(checkNewPWMInputs(500, NULL));
+}
+
+void test_getPWMArrayShouldFlagDisconnectedInputs(void)
+{
+    uint8_t i;
+    int* inputs;
+    for (i = 0; i < NUM_CHANNELS; i++) {
+        ic_values[i] = MIDDLE_PWM;
+        ppm_frame[i] = 0;
+    }
+    ic_values[3] = 0;
+
+    inputs = getPWMArray(0);
+    TEST_ASSERT_EQUAL_INT(DISCONNECTED_PWM_VALUE, inputs[3]);
+    TEST_ASSERT_EQUAL_INT(0, inputs[2]);
+    TEST_ASSERT_EQUAL_HEX8(0b1000, getPWMInputStatus());
+}
@@ -10,6 +10,7 @@
 #include "../../Drivers/RadioXbee.h"
 #include "mock_UART.h"
 #include "mock_Logger.h"
+#include "mock_Timer.h"
 #include <string.h>
 
 /*******************************************************************************
@@ -29,6 +30,16 @@
 
 uint64_t destination_address = 0x123456789ABCDEFF;
 
+/**
+ * Class of the downlink packets that don't test the priorities
+ */
+static const RadioPacketClass best_effort = {0, 0, 0, false};
+
+/**
+ * Buffer uplink packets are parsed into
+ */
+static uint8_t uplink_buffer[RADIO_UPLINK_BUFFER_LENGTH];
+
 /**
  * Helper struct for testing various AT command responses
  */
@@ -51,6 +62,18 @@ typedef struct XbeeRXResponse {
     uint8_t checksum;
 } XbeeRXResponse;
 
+/**
+ * First payload byte of each frame sent, and whether their checksums were valid
+ */
+static uint8_t sent_payload_ids[XBEE_FRAME_POOL_SIZE + 2];
+static uint16_t sent_frames;
+static bool sent_checksums_valid;
+
+/**
+ * Frame id of the last frame sent
+ */
+static uint8_t sent_frame_id;
+
 /*******************************************************************************
  *    PRIVATE FUNCTIONS
  ******************************************************************************/
@@ -185,6 +208,88 @@ uint8_t* createExpectedTXRequest(uint64_t address, uint8_t* payload, uint8_t pay
     return expected;
 }
 
+/**
+ * Records the frames handed to the UART
+ */
+static void queueTXDataCallback(uint8_t interface, uint8_t* data, uint16_t data_length, int cmock_num_calls)
+{
+    uint8_t checksum = 0;
+    uint16_t i;
+    (void)interface;
+    (void)cmock_num_calls;
+
+    //the checksum is everything after the length, and should add up to 0xFF
+    for (i = 3; i < data_length; i++) {
+        checksum += data[i];
+    }
+    if (checksum != 0xFF || data[0] != XBEE_START_DELIMITER) {
+        sent_checksums_valid = false;
+    }
+    sent_payload_ids[sent_frames++] = data[17];
+    sent_frame_id = data[4];
+}
+
+/**
+ * Bytes that peekRXSpan() hands to the driver, as if they were in the UART RX buffer
+ */
+static uint8_t* rx_data;
+static uint16_t rx_length;
+static uint16_t rx_consumed;
+static uint16_t rx_span_max; //longest span handed over, as if the buffer wrapped around
+
+static uint16_t peekRXSpanCallback(uint8_t interface, uint8_t** span, int num_calls)
+{
+    uint16_t span_length = rx_length - rx_consumed;
+    (void)num_calls;
+
+    TEST_ASSERT_EQUAL_UINT8(XBEE_UART_INTERFACE, interface);
+    *span = &rx_data[rx_consumed];
+    return span_length > rx_span_max ? rx_span_max : span_length;
+}
+
+static void consumeRXSpanCallback(uint8_t interface, uint16_t length, int num_calls)
+{
+    (void)num_calls;
+
+    TEST_ASSERT_EQUAL_UINT8(XBEE_UART_INTERFACE, interface);
+    rx_consumed += length;
+    TEST_ASSERT_TRUE(rx_consumed <= rx_length);
+}
+
+/**
+ * Makes the given bytes the contents of the UART RX buffer
+ */
+static void receiveBytes(uint8_t* data, uint16_t length)
+{
+    rx_data = data;
+    rx_length = length;
+    rx_consumed = 0;
+    rx_span_max = UINT16_MAX;
+    peekRXSpan_StubWithCallback(peekRXSpanCallback);
+    consumeRXSpan_StubWithCallback(consumeRXSpanCallback);
+}
+
+/**
+ * Feeds the parser the transmit status the xbee would send after a TX request
+ * @param frame_id Frame id of the TX request
+ * @param delivery_status XBEE_DELIVERY_STATUS_SUCCESS, or an error code
+ */
+static void receiveTransmitStatus(uint8_t frame_id, uint8_t delivery_status)
+{
+    uint8_t frame[11] = {XBEE_START_DELIMITER, 0, 7, XBEE_FRAME_TYPE_TRANSMIT_STATUS, frame_id, 0xFF, 0xFE, 0, delivery_status, 0, 0};
+    uint8_t checksum = 0;
+    uint16_t length;
+    uint8_t i;
+
+    for (i = 3; i < 10; i++) {
+        checksum += frame[i];
+    }
+    frame[10] = 0xFF - checksum;
+
+    receiveBytes(frame, sizeof(frame));
+    TEST_ASSERT_NULL(parseUplinkPacket(uplink_buffer, &length));
+}
+
 /*******************************************************************************
  *    SETUP, TEARDOWN
  ******************************************************************************/
@@ -228,7 +333,7 @@ void test_xbeeInitRadioShouldAskForDestinationAddress(void)
     sb2[6] = XBEE_AT_COMMAND_DESTINATION_ADDRESS_LOW[1];
 
     info_Ignore();
-    initUART_Expect(XBEE_UART_INTERFACE, XBEE_UART_BAUD_RATE, XBEE_UART_BUFFER_INITIAL_SIZE, XBEE_UART_BUFFER_MAX_SIZE, 3);
+    initUART_Expect(XBEE_UART_INTERFACE, XBEE_UART_BAUD_RATE, XBEE_UART_BUFFER_SIZE, 3);
     initRadio();
     getTXSpace_IgnoreAndReturn(100); //give as much space as possible
     queueTXData_ExpectWithArray(XBEE_UART_INTERFACE, sb, 8, 8); //queue the data for tranmission over UART
@@ -257,7 +362,7 @@ void test_QueueDownlinkPacketShouldSendCorrectUARTMessageWithCorrectDestinationA
     uint8_t* expected = createExpectedTXRequest(XBEE_BROADCAST_ADDRESS, payload, payload_length);
 
     getTXSpace_ExpectAndReturn(XBEE_UART_INTERFACE, 20 + 18); //give enough space
-    TEST_ASSERT_TRUE(queueDownlinkPacket(payload, payload_length));
+    TEST_ASSERT_TRUE(queueDownlinkPacket(payload, payload_length, &best_effort));
     queueTXData_ExpectWithArray(XBEE_UART_INTERFACE, expected, total_frame_size, total_frame_size); //queue the data for tranmission over UART
     TEST_ASSERT_TRUE(sendQueuedDownlinkPacket());
 }
@@ -268,7 +373,7 @@ void test_sendQueuedDownlinkPacketShouldNotSendIfUARTIsTooFull(void)
     uint16_t payload_length = 20;
 
     getTXSpace_ExpectAndReturn(XBEE_UART_INTERFACE, 20 + 18 - 1); //give 1 less than the required space
-    TEST_ASSERT_TRUE(queueDownlinkPacket(payload, payload_length));
+    TEST_ASSERT_TRUE(queueDownlinkPacket(payload, payload_length, &best_effort));
     TEST_ASSERT_FALSE(sendQueuedDownlinkPacket());
 }
 
@@ -318,14 +423,13 @@ void test_QueueRadioStatusPacketShouldSendCorrectDataOverUart(void)
 void test_ParseUplinkPacketShouldReturnNullIfUARTEmpty(void)
 {
     uint16_t length;
-    getRXSize_ExpectAndReturn(XBEE_UART_INTERFACE, 0); //give too little space
-    TEST_ASSERT_NULL(parseUplinkPacket(&length));
+    receiveBytes(NULL, 0);
+    TEST_ASSERT_NULL(parseUplinkPacket(uplink_buffer, &length));
 }
 
 void test_ParseUplinkPacketShouldParseAndSendRssiATResponseCorrectly(void)
 {
     XbeeATResponse rssi;
-    uint16_t i;
 
     uint8_t payload[1];
     payload[0] = 34;
@@ -339,12 +443,8 @@ void test_ParseUplinkPacketShouldParseAndSendRssiATResponseCorrectly(void)
     uint16_t frame_length;
     uint8_t* expected = createATResponse(&rssi, true, &frame_length);
 
-    getRXSize_IgnoreAndReturn(100); //give enough space
-
-    for (i = 0; i < frame_length; i++) {
-        readRXData_ExpectAndReturn(XBEE_UART_INTERFACE, expected[i]);
-    }
-    TEST_ASSERT_NULL(parseUplinkPacket(&length)); //we should still return null since its an AT command
+    receiveBytes(expected, frame_length);
+    TEST_ASSERT_NULL(parseUplinkPacket(uplink_buffer, &length)); //we should still return null since its an AT command
     TEST_ASSERT_EQUAL_UINT8(payload[0], getRadioRSSI());
     free(expected);
 }
@@ -352,7 +452,6 @@ void test_ParseUplinkPacketShouldParseAndSendRssiATResponseCorrectly(void)
 void test_ParseUplinkPacketShouldParseAndSendTransmissionErrorsATResponseCorrectly(void)
 {
     XbeeATResponse errors;
-    uint16_t i;
     uint16_t transmission_errors = 34443;
 
     uint8_t payload[2];
@@ -368,12 +467,8 @@ void test_ParseUplinkPacketShouldParseAndSendTransmissionErrorsATResponseCorrect
     uint16_t frame_length;
     uint8_t* expected = createATResponse(&errors, true, &frame_length);
 
-    getRXSize_IgnoreAndReturn(100); //give enough space
-
-    for (i = 0; i < frame_length; i++) {
-        readRXData_ExpectAndReturn(XBEE_UART_INTERFACE, expected[i]);
-    }
-    TEST_ASSERT_NULL(parseUplinkPacket(&length)); //we should still return null since its an AT command
+    receiveBytes(expected, frame_length);
+    TEST_ASSERT_NULL(parseUplinkPacket(uplink_buffer, &length)); //we should still return null since its an AT command
     TEST_ASSERT_EQUAL_UINT8(transmission_errors, getRadioTransmissionErrors());
     free(expected);
 }
@@ -381,7 +476,6 @@ void test_ParseUplinkPacketShouldParseAndSendTransmissionErrorsATResponseCorrect
 void test_ParseUplinkPacketShouldParseAndReceiveErrorsATResponseCorrectly(void)
 {
     XbeeATResponse errors;
-    uint16_t i;
     uint16_t receive_errors = 32444;
 
     uint8_t payload[2];
@@ -397,12 +491,8 @@ void test_ParseUplinkPacketShouldParseAndReceiveErrorsATResponseCorrectly(void)
     uint16_t frame_length;
     uint8_t* expected = createATResponse(&errors, true, &frame_length);
 
-    getRXSize_IgnoreAndReturn(100); //give enough space
-
-    for (i = 0; i < frame_length; i++) {
-        readRXData_ExpectAndReturn(XBEE_UART_INTERFACE, expected[i]);
-    }
-    TEST_ASSERT_NULL(parseUplinkPacket(&length)); //we should still return null since its an AT command
+    receiveBytes(expected, frame_length);
+    TEST_ASSERT_NULL(parseUplinkPacket(uplink_buffer, &length)); //we should still return null since its an AT command
     TEST_ASSERT_EQUAL_UINT8(receive_errors, getRadioReceiveErrors());
     free(expected);
 }
@@ -435,19 +525,11 @@ void test_ParseUplinkPacketShouldParseAndSetDestinationAddressCorrectly(void)
     uint8_t* expected_high = createATResponse(&adress_high, true, &frame_length);
     uint8_t* expected_low = createATResponse(&adress_low, true, &frame_length);
 
-    getRXSize_IgnoreAndReturn(100); //give enough space
-
-    for (i = 0; i < frame_length; i++) {
-        readRXData_ExpectAndReturn(XBEE_UART_INTERFACE, expected_high[i]);
-    }
-    TEST_ASSERT_NULL(parseUplinkPacket(&length)); //we should still return null since its an AT command
-
-    getRXSize_IgnoreAndReturn(100); //give enough space
+    receiveBytes(expected_high, frame_length);
+    TEST_ASSERT_NULL(parseUplinkPacket(uplink_buffer, &length)); //we should still return null since its an AT command
 
-    for (i = 0; i < frame_length; i++) {
-        readRXData_ExpectAndReturn(XBEE_UART_INTERFACE, expected_low[i]);
-    }
-    TEST_ASSERT_NULL(parseUplinkPacket(&length)); //we should still return null since its an AT command
+    receiveBytes(expected_low, frame_length);
+    TEST_ASSERT_NULL(parseUplinkPacket(uplink_buffer, &length)); //we should still return null since its an AT command
 
     //test to make sure correct destination address is set by making a transmission
     uint8_t data[1];
@@ -455,7 +537,7 @@ void test_ParseUplinkPacketShouldParseAndSetDestinationAddressCorrectly(void)
 
     getTXSpace_ExpectAndReturn(XBEE_UART_INTERFACE, 100); //give enough space
     queueTXData_ExpectWithArray(XBEE_UART_INTERFACE, expected, 19, 19); //queue the data for tranmission over UART
-    queueDownlinkPacket(data, 1);
+    queueDownlinkPacket(data, 1, &best_effort);
     sendQueuedDownlinkPacket();
 
     free(expected_high);
@@ -485,12 +567,8 @@ void test_ParseUplinkPacketGivenInvalidATResponseForDestinationAddressHighShould
     uint16_t frame_length;
     uint8_t* expected_high = createATResponse(&adress_high, true, &frame_length);
 
-    getRXSize_IgnoreAndReturn(100); //give enough space
-
-    for (i = 0; i < frame_length; i++) {
-        readRXData_ExpectAndReturn(XBEE_UART_INTERFACE, expected_high[i]);
-    }
-    TEST_ASSERT_NULL(parseUplinkPacket(&length)); //we should still return null since its an AT command
+    receiveBytes(expected_high, frame_length);
+    TEST_ASSERT_NULL(parseUplinkPacket(uplink_buffer, &length)); //we should still return null since its an AT command
 
     //test to make sure destination address is not set by testing transmission
     uint8_t data[1];
@@ -498,7 +576,7 @@ void test_ParseUplinkPacketGivenInvalidATResponseForDestinationAddressHighShould
 
     getTXSpace_ExpectAndReturn(XBEE_UART_INTERFACE, 100); //give enough space
     queueTXData_ExpectWithArray(XBEE_UART_INTERFACE, expected, 19, 19); //queue the data for tranmission over UART
-    queueDownlinkPacket(data, 1);
+    queueDownlinkPacket(data, 1, &best_effort);
     sendQueuedDownlinkPacket();
     free(expected_high);
 }
@@ -526,12 +604,8 @@ void test_ParseUplinkPacketGivenInvalidATResponseForDestinationAddressLowShouldN
     uint16_t frame_length;
     uint8_t* expected_high = createATResponse(&adress_high, true, &frame_length);
 
-    getRXSize_IgnoreAndReturn(100); //give enough space
-
-    for (i = 0; i < frame_length; i++) {
-        readRXData_ExpectAndReturn(XBEE_UART_INTERFACE, expected_high[i]);
-    }
-    TEST_ASSERT_NULL(parseUplinkPacket(&length)); //we should still return null since its an AT command
+    receiveBytes(expected_high, frame_length);
+    TEST_ASSERT_NULL(parseUplinkPacket(uplink_buffer, &length)); //we should still return null since its an AT command
 
     //test to make sure destination address is not set by testing transmission
     uint8_t data[1];
@@ -539,7 +613,7 @@ void test_ParseUplinkPacketGivenInvalidATResponseForDestinationAddressLowShouldN
 
     getTXSpace_ExpectAndReturn(XBEE_UART_INTERFACE, 100); //give enough space
     queueTXData_ExpectWithArray(XBEE_UART_INTERFACE, expected, 19, 19); //queue the data for tranmission over UART
-    queueDownlinkPacket(data, 1);
+    queueDownlinkPacket(data, 1, &best_effort);
     sendQueuedDownlinkPacket();
     free(expected_high);
 }
@@ -562,17 +636,14 @@ void test_ParseUplinkPacketGivenValidRXIndicatorShouldReturnData(void)
     
     uint8_t* expected = createRXResponse(&rf, true, &frame_length);
     
-    getRXSize_IgnoreAndReturn(100); //give enough space
-
-    for (i = 0; i < frame_length; i++) {
-        readRXData_ExpectAndReturn(XBEE_UART_INTERFACE, expected[i]);
-    }
+    receiveBytes(expected, frame_length);
     
     uint16_t returned_length;
-    uint8_t* returned = parseUplinkPacket(&returned_length);
+    uint8_t* returned = parseUplinkPacket(uplink_buffer, &returned_length);
     TEST_ASSERT_NOT_NULL_MESSAGE(returned, "Returned message should not be null");
     TEST_ASSERT_EQUAL_UINT16_MESSAGE(payload_length, returned_length, "Returned length should match that of payload");
     TEST_ASSERT_EQUAL_UINT8_ARRAY_MESSAGE(payload, returned,10, "Returned payload should match");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(1, (returned - uplink_buffer) % 2, "Returned payload should start at an odd offset");
     
     free(expected);
 }
@@ -580,16 +651,382 @@ void test_ParseUplinkPacketGivenValidRXIndicatorShouldReturnData(void)
 void test_ParseUplinkPacketShouldDoNothingWithoutStartDelimiter(void)
 {
     uint16_t length;
-    int i;
-    //for the first byte
-    getRXSize_ExpectAndReturn(XBEE_UART_INTERFACE, 20); //give enough space
-    readRXData_ExpectAndReturn(XBEE_UART_INTERFACE, 0xEF);
-    for (i = 19; i >0; i--) {
-        getRXSize_ExpectAndReturn(XBEE_UART_INTERFACE, i); //give enough space
-        readRXData_ExpectAndReturn(XBEE_UART_INTERFACE, 0xEF);
+    uint8_t noise[20];
+
+    memset(noise, 0xEF, sizeof(noise));
+    receiveBytes(noise, sizeof(noise));
+    TEST_ASSERT_NULL(parseUplinkPacket(uplink_buffer, &length));
+    TEST_ASSERT_EQUAL_UINT16(sizeof(noise), rx_consumed); //all of it is thrown away
+}
+
+void test_ParseUplinkPacketShouldParseFramesSplitAcrossSpans(void)
+{
+    XbeeRXResponse rf;
+    uint8_t payload[10] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    uint8_t received[40];
+    uint16_t frame_length;
+    uint16_t returned_length;
+    uint8_t* returned;
+
+    rf.source_address = destination_address;
+    rf.payload = payload;
+    rf.payload_length = sizeof(payload);
+    uint8_t* expected = createRXResponse(&rf, true, &frame_length);
+    uint8_t checksum = 0;
+    uint16_t i;
+
+    for (i = 3; i < frame_length - 1; i++) {
+        checksum += expected[i];
     }
-    getRXSize_ExpectAndReturn(XBEE_UART_INTERFACE, i); //give enough space
-    
-    TEST_ASSERT_NULL(parseUplinkPacket(&length)); //we should still return null since its an AT command
+    expected[frame_length - 1] = 0xFF - checksum;
+
+    //a frame wrapping around the end of the UART buffer, and the start of the next one
+    memcpy(received, expected, frame_length);
+    memcpy(&received[frame_length], expected, 3);
+    receiveBytes(received, frame_length + 3);
+    rx_span_max = 7;
+
+    returned = parseUplinkPacket(uplink_buffer, &returned_length);
+    TEST_ASSERT_NOT_NULL(returned);
+    TEST_ASSERT_EQUAL_UINT16(sizeof(payload), returned_length);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(payload, returned, sizeof(payload));
+    TEST_ASSERT_EQUAL_UINT16(frame_length, rx_consumed); //the next frame is left to be parsed
+
+    free(expected);
+}
+
+void test_queueDownlinkPacketShouldBuildValidFrames(void)
+{
+    uint8_t payload[XBEE_MAX_PAYLOAD_LENGTH];
+    uint16_t i;
+
+    for (i = 0; i < XBEE_MAX_PAYLOAD_LENGTH; i++) {
+        payload[i] = i * 7;
+    }
+    sent_frames = 0;
+    sent_checksums_valid = true;
+    queueTXData_StubWithCallback((CMOCK_queueTXData_CALLBACK) queueTXDataCallback);
+    getTXSpace_IgnoreAndReturn(200);
+
+    TEST_ASSERT_TRUE(queueDownlinkPacket(payload, XBEE_MAX_PAYLOAD_LENGTH, &best_effort));
+    TEST_ASSERT_TRUE(queueDownlinkPacket(payload, 1, &best_effort));
+    TEST_ASSERT_TRUE(sendQueuedDownlinkPacket());
+    TEST_ASSERT_TRUE(sendQueuedDownlinkPacket());
+    TEST_ASSERT_FALSE(sendQueuedDownlinkPacket());
+    TEST_ASSERT_EQUAL_UINT16(2, sent_frames);
+    TEST_ASSERT_TRUE(sent_checksums_valid);
 }
 
+void test_queueDownlinkPacketShouldRejectPayloadsThatAreTooLong(void)
+{
+    uint8_t payload[XBEE_MAX_PAYLOAD_LENGTH + 1];
+    uint16_t rejected = getXbeeFramePoolStats()->rejected;
+
+    TEST_ASSERT_FALSE(queueDownlinkPacket(payload, XBEE_MAX_PAYLOAD_LENGTH + 1, &best_effort));
+    TEST_ASSERT_EQUAL_UINT16(rejected + 1, getXbeeFramePoolStats()->rejected);
+    TEST_ASSERT_EQUAL_UINT8(0, getXbeeFramePoolStats()->depth);
+}
+
+void test_queueDownlinkPacketShouldDropOldestFramesWhenPoolIsFull(void)
+{
+    uint8_t payload[1];
+    uint16_t dropped = getXbeeFramePoolStats()->dropped;
+    uint8_t i;
+
+    sent_frames = 0;
+    sent_checksums_valid = true;
+    queueTXData_StubWithCallback((CMOCK_queueTXData_CALLBACK) queueTXDataCallback);
+    getTXSpace_IgnoreAndReturn(200);
+
+    for (i = 0; i < XBEE_FRAME_POOL_SIZE + 2; i++) {
+        payload[0] = i;
+        TEST_ASSERT_TRUE(queueDownlinkPacket(payload, 1, &best_effort));
+    }
+    TEST_ASSERT_EQUAL_UINT8(XBEE_FRAME_POOL_SIZE, getXbeeFramePoolStats()->depth);
+    TEST_ASSERT_EQUAL_UINT8(XBEE_FRAME_POOL_SIZE, getXbeeFramePoolStats()->max_depth);
+    TEST_ASSERT_EQUAL_UINT16(dropped + 2, getXbeeFramePoolStats()->dropped);
+
+    while (sendQueuedDownlinkPacket());
+
+    //the 2 oldest frames were dropped, and the rest were sent in order
+    TEST_ASSERT_EQUAL_UINT16(XBEE_FRAME_POOL_SIZE, sent_frames);
+    for (i = 0; i < XBEE_FRAME_POOL_SIZE; i++) {
+        TEST_ASSERT_EQUAL_UINT8(i + 2, sent_payload_ids[i]);
+    }
+    TEST_ASSERT_TRUE(sent_checksums_valid);
+}
+
+void test_getRadioBackpressureShouldReportFullerOfPoolAndUART(void)
+{
+    uint8_t payload[1];
+    uint8_t i;
+
+    for (i = 0; i < XBEE_FRAME_POOL_SIZE / 2; i++) {
+        TEST_ASSERT_TRUE(queueDownlinkPacket(payload, 1, &best_effort));
+    }
+    getTXCapacity_ExpectAndReturn(XBEE_UART_INTERFACE, XBEE_UART_BUFFER_SIZE);
+    getTXSpace_ExpectAndReturn(XBEE_UART_INTERFACE, XBEE_UART_BUFFER_SIZE);
+    TEST_ASSERT_EQUAL_UINT8(RADIO_BACKPRESSURE_MAX / 2, getRadioBackpressure());
+
+    getTXCapacity_ExpectAndReturn(XBEE_UART_INTERFACE, XBEE_UART_BUFFER_SIZE);
+    getTXSpace_ExpectAndReturn(XBEE_UART_INTERFACE, XBEE_UART_BUFFER_SIZE / 4);
+    TEST_ASSERT_EQUAL_UINT8(RADIO_BACKPRESSURE_MAX * 3 / 4, getRadioBackpressure());
+}
+
+void test_getRadioBackpressureShouldUseTheRealUARTCapacity(void)
+{
+    //the buffer was rounded up, so there's more free space than the size asked for
+    getTXCapacity_ExpectAndReturn(XBEE_UART_INTERFACE, 2 * XBEE_UART_BUFFER_SIZE);
+    getTXSpace_ExpectAndReturn(XBEE_UART_INTERFACE, XBEE_UART_BUFFER_SIZE + 1);
+    TEST_ASSERT_TRUE(getRadioBackpressure() < RADIO_BACKPRESSURE_MAX / 2);
+
+    getTXCapacity_ExpectAndReturn(XBEE_UART_INTERFACE, 0);
+    TEST_ASSERT_EQUAL_UINT8(RADIO_BACKPRESSURE_MAX, getRadioBackpressure());
+}
+
+void test_queueReliableDownlinkPacketShouldResendUntilDelivered(void)
+{
+    uint8_t payload[1] = {42};
+    uint8_t frame_id;
+    XbeeReliableStats stats = *getXbeeReliableStats();
+
+    sent_frames = 0;
+    sent_checksums_valid = true;
+    queueTXData_StubWithCallback((CMOCK_queueTXData_CALLBACK) queueTXDataCallback);
+    getTXSpace_IgnoreAndReturn(200);
+
+    getTime_ExpectAndReturn(1000);
+    TEST_ASSERT_TRUE(queueReliableDownlinkPacket(payload, 1));
+    getTime_ExpectAndReturn(1000);
+    getTime_ExpectAndReturn(1000);
+    TEST_ASSERT_TRUE(sendQueuedDownlinkPacket());
+    frame_id = sent_frame_id;
+    TEST_ASSERT_NOT_EQUAL(0, frame_id); //so that the xbee reports the transmit status
+
+    //not resent while waiting for the status
+    getTime_ExpectAndReturn(1010);
+    TEST_ASSERT_FALSE(sendQueuedDownlinkPacket());
+
+    //resent after the backoff when it failed
+    getTime_ExpectAndReturn(1020);
+    receiveTransmitStatus(frame_id, 0x21);
+    getTime_ExpectAndReturn(1020 + XBEE_RELIABLE_BACKOFF - 1);
+    TEST_ASSERT_FALSE(sendQueuedDownlinkPacket());
+    getTime_ExpectAndReturn(1020 + XBEE_RELIABLE_BACKOFF);
+    getTime_ExpectAndReturn(1020 + XBEE_RELIABLE_BACKOFF);
+    TEST_ASSERT_TRUE(sendQueuedDownlinkPacket());
+    TEST_ASSERT_EQUAL_UINT8(frame_id, sent_frame_id);
+
+    receiveTransmitStatus(frame_id, XBEE_DELIVERY_STATUS_SUCCESS);
+    TEST_ASSERT_FALSE(sendQueuedDownlinkPacket()); //nothing left, so the time isn't needed
+
+    TEST_ASSERT_EQUAL_UINT16(2, sent_frames);
+    TEST_ASSERT_EQUAL_UINT8(42, sent_payload_ids[1]);
+    TEST_ASSERT_TRUE(sent_checksums_valid);
+    TEST_ASSERT_EQUAL_UINT16(stats.queued + 1, getXbeeReliableStats()->queued);
+    TEST_ASSERT_EQUAL_UINT16(stats.sent + 2, getXbeeReliableStats()->sent);
+    TEST_ASSERT_EQUAL_UINT16(stats.retransmitted + 1, getXbeeReliableStats()->retransmitted);
+    TEST_ASSERT_EQUAL_UINT16(stats.delivered + 1, getXbeeReliableStats()->delivered);
+    TEST_ASSERT_EQUAL_UINT8(0, getXbeeReliableStats()->pending);
+}
+
+void test_queueReliableDownlinkPacketShouldGiveUpAfterMaxAttempts(void)
+{
+    uint8_t payload[1] = {0};
+    uint32_t now = 0;
+    uint16_t failed = getXbeeReliableStats()->failed;
+    uint8_t i;
+
+    queueTXData_Ignore();
+    getTXSpace_IgnoreAndReturn(200);
+    getTime_IgnoreAndReturn(now);
+    TEST_ASSERT_TRUE(queueReliableDownlinkPacket(payload, 1));
+
+    //no transmit status ever comes back, so each attempt times out and is resent after the backoff
+    for (i = 0; i < XBEE_RELIABLE_MAX_ATTEMPTS; i++) {
+        TEST_ASSERT_TRUE(sendQueuedDownlinkPacket());
+        now += XBEE_RELIABLE_STATUS_TIMEOUT;
+        getTime_IgnoreAndReturn(now);
+        TEST_ASSERT_FALSE(sendQueuedDownlinkPacket());
+        now += XBEE_RELIABLE_BACKOFF << i;
+        getTime_IgnoreAndReturn(now);
+    }
+    TEST_ASSERT_EQUAL_UINT16(failed + 1, getXbeeReliableStats()->failed);
+    TEST_ASSERT_EQUAL_UINT8(0, getXbeeReliableStats()->pending);
+}
+
+void test_queueReliableDownlinkPacketShouldNotHoldUpBestEffortFrames(void)
+{
+    uint8_t payload[1];
+    uint16_t rejected = getXbeeReliableStats()->rejected;
+    uint8_t i;
+
+    sent_frames = 0;
+    queueTXData_StubWithCallback((CMOCK_queueTXData_CALLBACK) queueTXDataCallback);
+    getTXSpace_IgnoreAndReturn(200);
+    getTime_IgnoreAndReturn(0);
+
+    for (i = 0; i < XBEE_RELIABLE_FRAME_COUNT; i++) {
+        payload[0] = i;
+        TEST_ASSERT_TRUE(queueReliableDownlinkPacket(payload, 1));
+    }
+    TEST_ASSERT_FALSE(queueReliableDownlinkPacket(payload, 1));
+    TEST_ASSERT_EQUAL_UINT16(rejected + 1, getXbeeReliableStats()->rejected);
+
+    payload[0] = 0xBE;
+    TEST_ASSERT_TRUE(queueDownlinkPacket(payload, 1, &best_effort));
+    for (i = 0; i < XBEE_RELIABLE_FRAME_COUNT + 1; i++) {
+        TEST_ASSERT_TRUE(sendQueuedDownlinkPacket());
+    }
+
+    //the best effort frame goes out while the reliable ones wait for their status
+    TEST_ASSERT_EQUAL_UINT8(0xBE, sent_payload_ids[XBEE_RELIABLE_FRAME_COUNT]);
+    TEST_ASSERT_EQUAL_UINT8(0, sent_frame_id);
+    TEST_ASSERT_FALSE(sendQueuedDownlinkPacket());
+}
+
+void test_sendQueuedDownlinkPacketShouldSendHighestPriorityFirst(void)
+{
+    RadioPacketClass high = {2, 0, 0, false};
+    uint8_t payload[1];
+
+    sent_frames = 0;
+    queueTXData_StubWithCallback((CMOCK_queueTXData_CALLBACK) queueTXDataCallback);
+    getTXSpace_IgnoreAndReturn(200);
+
+    payload[0] = 1;
+    TEST_ASSERT_TRUE(queueDownlinkPacket(payload, 1, &best_effort));
+    payload[0] = 2;
+    TEST_ASSERT_TRUE(queueDownlinkPacket(payload, 1, &high));
+    payload[0] = 3;
+    TEST_ASSERT_TRUE(queueDownlinkPacket(payload, 1, &high));
+    while (sendQueuedDownlinkPacket());
+
+    TEST_ASSERT_EQUAL_UINT16(3, sent_frames);
+    TEST_ASSERT_EQUAL_UINT8(2, sent_payload_ids[0]);
+    TEST_ASSERT_EQUAL_UINT8(3, sent_payload_ids[1]);
+    TEST_ASSERT_EQUAL_UINT8(1, sent_payload_ids[2]);
+}
+
+void test_queueDownlinkPacketShouldReplaceFramesWithOlderValues(void)
+{
+    RadioPacketClass position = {1, 0, 0x01, false};
+    RadioPacketClass position_and_status = {1, 0, 0x03, false};
+    uint16_t coalesced = getXbeeFramePoolStats()->coalesced;
+    uint8_t payload[1];
+
+    sent_frames = 0;
+    queueTXData_StubWithCallback((CMOCK_queueTXData_CALLBACK) queueTXDataCallback);
+    getTXSpace_IgnoreAndReturn(200);
+
+    payload[0] = 1;
+    TEST_ASSERT_TRUE(queueDownlinkPacket(payload, 1, &position));
+    payload[0] = 2;
+    TEST_ASSERT_TRUE(queueDownlinkPacket(payload, 1, &position_and_status));
+    TEST_ASSERT_EQUAL_UINT8(1, getXbeeFramePoolStats()->depth);
+
+    //the status in the queued frame would be lost, so it isn't replaced
+    payload[0] = 3;
+    TEST_ASSERT_TRUE(queueDownlinkPacket(payload, 1, &position));
+    TEST_ASSERT_EQUAL_UINT8(2, getXbeeFramePoolStats()->depth);
+    TEST_ASSERT_EQUAL_UINT16(coalesced + 1, getXbeeFramePoolStats()->coalesced);
+
+    while (sendQueuedDownlinkPacket());
+    TEST_ASSERT_EQUAL_UINT16(2, sent_frames);
+    TEST_ASSERT_EQUAL_UINT8(2, sent_payload_ids[0]);
+    TEST_ASSERT_EQUAL_UINT8(3, sent_payload_ids[1]);
+}
+
+void test_queueDownlinkPacketShouldNotReplaceFramesQueuedBeforeABarrier(void)
+{
+    RadioPacketClass position = {1, 0, 0x01, false};
+    RadioPacketClass reference = {1, 0, 0, true};
+    uint16_t coalesced = getXbeeFramePoolStats()->coalesced;
+    uint8_t payload[1];
+
+    sent_frames = 0;
+    queueTXData_StubWithCallback((CMOCK_queueTXData_CALLBACK) queueTXDataCallback);
+    getTXSpace_IgnoreAndReturn(200);
+
+    payload[0] = 1;
+    TEST_ASSERT_TRUE(queueDownlinkPacket(payload, 1, &position));
+    payload[0] = 2;
+    TEST_ASSERT_TRUE(queueDownlinkPacket(payload, 1, &reference));
+
+    //taking the place of the first frame would send it ahead of the barrier
+    payload[0] = 3;
+    TEST_ASSERT_TRUE(queueDownlinkPacket(payload, 1, &position));
+    TEST_ASSERT_EQUAL_UINT8(3, getXbeeFramePoolStats()->depth);
+    TEST_ASSERT_EQUAL_UINT16(coalesced, getXbeeFramePoolStats()->coalesced);
+
+    //frames queued after it can still be replaced
+    payload[0] = 4;
+    TEST_ASSERT_TRUE(queueDownlinkPacket(payload, 1, &position));
+    TEST_ASSERT_EQUAL_UINT8(3, getXbeeFramePoolStats()->depth);
+    TEST_ASSERT_EQUAL_UINT16(coalesced + 1, getXbeeFramePoolStats()->coalesced);
+
+    while (sendQueuedDownlinkPacket());
+    TEST_ASSERT_EQUAL_UINT16(3, sent_frames);
+    TEST_ASSERT_EQUAL_UINT8(1, sent_payload_ids[0]);
+    TEST_ASSERT_EQUAL_UINT8(2, sent_payload_ids[1]);
+    TEST_ASSERT_EQUAL_UINT8(4, sent_payload_ids[2]);
+}
+
+void test_sendQueuedDownlinkPacketShouldDropExpiredFrames(void)
+{
+    RadioPacketClass fresh = {1, 100, 0, false};
+    uint16_t expired = getXbeeFramePoolStats()->expired;
+    uint8_t payload[1] = {0};
+
+    getTime_ExpectAndReturn(1000);
+    TEST_ASSERT_TRUE(queueDownlinkPacket(payload, 1, &fresh));
+
+    getTime_ExpectAndReturn(1100);
+    TEST_ASSERT_FALSE(sendQueuedDownlinkPacket());
+    TEST_ASSERT_EQUAL_UINT16(expired + 1, getXbeeFramePoolStats()->expired);
+    TEST_ASSERT_EQUAL_UINT8(0, getXbeeFramePoolStats()->depth);
+}
+
+void test_queueDownlinkPacketShouldNotDropHigherPriorityFrames(void)
+{
+    RadioPacketClass high = {2, 0, 0, false};
+    uint16_t dropped = getXbeeFramePoolStats()->dropped;
+    uint8_t payload[1] = {0};
+    uint8_t i;
+
+    for (i = 0; i < XBEE_FRAME_POOL_SIZE - 1; i++) {
+        TEST_ASSERT_TRUE(queueDownlinkPacket(payload, 1, &high));
+    }
+    TEST_ASSERT_TRUE(queueDownlinkPacket(payload, 1, &best_effort));
+
+    //the low priority frame makes room for a high priority one, but not the other way around
+    TEST_ASSERT_TRUE(queueDownlinkPacket(payload, 1, &high));
+    TEST_ASSERT_FALSE(queueDownlinkPacket(payload, 1, &best_effort));
+    TEST_ASSERT_EQUAL_UINT16(dropped + 2, getXbeeFramePoolStats()->dropped);
+    TEST_ASSERT_EQUAL_UINT8(XBEE_FRAME_POOL_SIZE, getXbeeFramePoolStats()->depth);
+}
+
+void test_reliableFramesShouldHaveTheirOwnFrameIds(void)
+{
+    uint8_t payload[1] = {0};
+    uint8_t i;
+
+    queueTXData_StubWithCallback((CMOCK_queueTXData_CALLBACK) queueTXDataCallback);
+    getTXSpace_IgnoreAndReturn(200);
+    getTime_IgnoreAndReturn(0);
+
+    //AT commands stay below the reliable range
+    queueRadioStatusPacket();
+    for (i = 0; i < 3; i++) {
+        TEST_ASSERT_TRUE(sendQueuedDownlinkPacket());
+        TEST_ASSERT_TRUE(sent_frame_id >= XBEE_AT_FRAME_ID_FIRST && sent_frame_id <= XBEE_AT_FRAME_ID_LAST);
+    }
+
+    //and reliable frames stay in theirs, even once their ids wrap around
+    for (i = 0; i < XBEE_RELIABLE_FRAME_ID_LAST - XBEE_RELIABLE_FRAME_ID_FIRST + 3; i++) {
+        TEST_ASSERT_TRUE(queueReliableDownlinkPacket(payload, 1));
+        TEST_ASSERT_TRUE(sendQueuedDownlinkPacket());
+        TEST_ASSERT_TRUE(sent_frame_id >= XBEE_RELIABLE_FRAME_ID_FIRST);
+        receiveTransmitStatus(sent_frame_id, XBEE_DELIVERY_STATUS_SUCCESS);
+    }
+}
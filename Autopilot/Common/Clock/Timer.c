@@ -10,6 +10,10 @@
 
 static volatile uint32_t time_ms = 0;
 
+static volatile bool timer3_tick = false;
+static volatile uint64_t timer3_tick_time = 0;
+static volatile uint16_t timer3_missed_ticks = 0;
+
 /**
  * Initializes Timer2. Its used as a 16-bit timer
  */
@@ -27,6 +31,49 @@ void initTimer2(void)
     T2CONbits.TON = 1; // Start Timer
 }
 
+/**
+ * Initializes Timer3 as a 16-bit timer with an interrupt every period
+ */
+void initTimer3(uint16_t period_us)
+{
+    T3CONbits.TON = 0; // Disable Timer
+    T3CONbits.TCS = 0; // Select internal instruction cycle clock
+    T3CONbits.TGATE = 0; // Disable Gated Timer mode
+    T3CONbits.TCKPS = 0b01; // Select 1:8 Prescaler
+    TMR3 = 0x00; // Clear timer register
+    PR3 = T3_TICKS_TO_USEC * period_us - 1; // Load the period value
+    IPC2bits.T3IP = 0x01; // Set Timer 3 Interrupt Priority Level
+    IFS0bits.T3IF = 0; // Clear Timer 3 Interrupt Flag
+    IEC0bits.T3IE = 1; // Enable Timer 3 interrupt
+    T3CONbits.TON = 1; // Start Timer
+}
+
+bool checkTimer3Tick(uint64_t* tick_time, uint16_t* missed_ticks)
+{
+    if (!timer3_tick) {
+        return false;
+    }
+    IEC0bits.T3IE = 0;
+    *tick_time = timer3_tick_time;
+    *missed_ticks = timer3_missed_ticks;
+    timer3_missed_ticks = 0;
+    timer3_tick = false;
+    IEC0bits.T3IE = 1;
+    return true;
+}
+
+/**
+ * Timer3 interrupt. Executed every period
+ */
+void __attribute__((__interrupt__, no_auto_psv)) _T3Interrupt(void){
+    if (timer3_tick) { //the last tick hasn't been handled yet
+        timer3_missed_ticks++;
+    }
+    timer3_tick = true;
+    timer3_tick_time = getTimeUs();
+    IFS0bits.T3IF = 0;
+}
+
 /**
  * Initializes Timer4 as a 1ms, 16-bit timer
  */
@@ -59,3 +106,16 @@ uint32_t getTime(){
 uint64_t getTimeUs(){
     return ((uint64_t)time_ms)*1000 + TMR4/T4_TICKS_TO_USEC;
 }
+
+uint32_t getTimeTicks(){
+    uint16_t ms;
+    uint16_t ticks;
+
+    //read again if the ms ticked over in between, so that the two halves match
+    do {
+        ms = (uint16_t)time_ms;
+        ticks = TMR4;
+    } while (ms != (uint16_t)time_ms);
+
+    return ((uint32_t)ms << 16) | ticks;
+}
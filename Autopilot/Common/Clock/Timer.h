@@ -10,6 +10,7 @@
 #define	TIMER_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 /**
  * Number of Timer2 ticks in a millisecond. To calculate this, take:
@@ -34,11 +35,33 @@
  */
 #define T4_TICKS_TO_USEC 5 //5 ticks per us with 1:8 prescaler
 
+/**
+ * Timer3 ticks per us with the 1:8 prescaler. Limits the Timer3 period to 13107us
+ */
+#define T3_TICKS_TO_USEC 5
+
 /**
  * Initializes Timer2. Its used as a 16-bit timer. Used for PWM input and output management
  */
 void initTimer2(void);
 
+/**
+ * Initializes Timer3 as a periodic, interrupt enabled, 16-bit timer. Used to
+ * trigger the control loop at a fixed rate on the attitude manager. Note that
+ * the path manager uses Timer3 for the LED PWM instead
+ * @param period_us Period in us. At most 13107
+ */
+void initTimer3(uint16_t period_us);
+
+/**
+ * Checks whether a Timer3 period elapsed since the last call
+ * @param tick_time Set to the time (us) at which the period elapsed
+ * @param missed_ticks Set to how many periods elapsed without being checked
+ *      since the last call, ie overruns
+ * @return True if a period elapsed
+ */
+bool checkTimer3Tick(uint64_t* tick_time, uint16_t* missed_ticks);
+
 /**
  * Initializes Timer4. Used as a 16-bit, interrupt enabled, 1ms timer
  */
@@ -56,6 +79,15 @@ uint32_t getTime(void);
  */
 uint64_t getTimeUs(void);
 
+/**
+ * Get the current system time as a raw Timer4 timestamp, for timing code in hot
+ * paths. Unlike getTimeUs(), this doesn't need a 64-bit multiply and divide, so
+ * timestamps should be converted later, where the time doesn't matter
+ * @return The low 16 bits of the time in ms in the upper half, and the Timer4
+ *      ticks into that ms (T4_TICKS_TO_USEC per us) in the lower half
+ */
+uint32_t getTimeTicks(void);
+
 /*
  * Macros for timing various operations.
  * Usage: put TST (time start) before the block, and 
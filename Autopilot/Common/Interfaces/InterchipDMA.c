@@ -9,9 +9,10 @@
 #include "InterchipDMA.h"
 #include "../Common.h"
 #include "../Utilities/Logger.h"
+#include "../Clock/Timer.h"
 #include <stdbool.h>
+#include <stddef.h>
 
-volatile InterchipDataBuffer interchip_send_buffer;
 volatile InterchipDataBuffer interchip_receive_buffer;
 
 /** To indicate to users that new data is available to read from */
@@ -20,25 +21,85 @@ static volatile bool is_dma_available = 0;
 /** Used to make sure we write to the appropriate buffers */
 static uint8_t chip;
 
-/** To keep track of how many communication errors we get */
-static volatile uint16_t dma_error_count = 0;
+/** Receive side health of the link. Frame age and message rate are filled in on request */
+static volatile InterchipLinkStats link_stats;
+
+/** Time (ms) of the last frame with a valid checksum */
+static volatile uint32_t last_good_frame_time = 0;
+
+/** Used to calculate the message rate over 1 second windows */
+static volatile uint32_t rate_window_start = 0;
+static volatile uint16_t rate_window_frames = 0;
+
+/** Sequence number of the last frame we sent */
+static uint16_t tx_sequence = 0;
+
+/** Link header values of the last good frame we received */
+static volatile uint16_t last_rx_sequence = 0;
+static volatile uint16_t last_rx_timestamp = 0;
+static volatile uint16_t last_rx_echo_timestamp = 0;
 
 //allocate specific space that the DMA controller can write to. Add a byte for the checksum, 
 //and another to take into account the 1 byte shift that the path manager receives
 static volatile uint8_t dma0_space[sizeof(InterchipDataBuffer) + 2] __attribute__((space(dma)));
-static volatile uint8_t dma1_space[sizeof(InterchipDataBuffer) + 2] __attribute__((space(dma)));
+
+//the send frames are double buffered. Users write directly into the back frame
+//through interchip_send_buffer while the DMA sends the front frame
+static volatile uint8_t dma1_frame_a[sizeof(InterchipDataBuffer) + 2] __attribute__((space(dma), aligned(2)));
+static volatile uint8_t dma1_frame_b[sizeof(InterchipDataBuffer) + 2] __attribute__((space(dma), aligned(2)));
+
+/** Frame the DMA is currently sending, and the back frame users write into */
+static volatile uint8_t* send_frame = dma1_frame_a;
+static volatile uint8_t* back_frame = dma1_frame_b;
+
+/** Size of the frames this chip sends. The checksum byte follows the frame */
+static uint16_t send_frame_size = 0;
+
+/**
+ * DMA1 blocks finished since the last commit, up to 2. On the attitude manager, the
+ * path manager may still be clocking out the old front frame when they are swapped.
+ * It is done with it after the first block, and has clocked out the committed frame
+ * after the second
+ */
+static volatile uint8_t send_blocks_done = 2;
+
+#define SEND_FRAME_WORDS ((sizeof(InterchipDataBuffer) + 1) / 2)
+#define SEND_MASK_WORDS ((SEND_FRAME_WORDS + 15) / 16)
+
+/**
+ * 16 bit words of the back frame written since the last commit, and the words
+ * written before the last commit that the new back frame is still missing. These
+ * are the only words the two frames can differ in
+ */
+static uint16_t written_words[SEND_MASK_WORDS];
+static uint16_t pending_words[SEND_MASK_WORDS];
+
+volatile const InterchipDataBuffer* interchip_send_buffer = (volatile const InterchipDataBuffer*) dma1_frame_b;
 
 static void initDMA0(uint8_t chip_id);
 static void initDMA1(uint8_t chip_id);
+static void commitSendFrame(void);
+static void syncSendFrame(void);
+static void writeSendFrame(uint16_t offset, const uint8_t* data, uint16_t length);
+static void updateSendTimestamps(uint16_t timestamp, uint16_t echo_timestamp);
+static uint16_t nextSequence(uint16_t sequence);
 
 void initInterchip(uint8_t chip_id)
 {
     //some input validation
     if (chip_id == DMA_CHIP_ID_ATTITUDE_MANAGER || chip_id == DMA_CHIP_ID_PATH_MANAGER) {
         chip = chip_id;
+        send_frame_size = (chip == DMA_CHIP_ID_ATTITUDE_MANAGER) ? sizeof(AMData) : sizeof(PMData);
+
+        //both frames start out zeroed, so their checksums are just the sum of the
+        //indices. The checksums are kept up to date from here on as bytes are written.
+        //The attitude manager frame is always available to the path manager, so this
+        //also makes it valid (sequence 0) before the first command
+        dma1_frame_a[send_frame_size] = (uint8_t)(((uint32_t)send_frame_size * (send_frame_size - 1)) / 2);
+        dma1_frame_b[send_frame_size] = dma1_frame_a[send_frame_size];
+
         initDMA0(chip);
         initDMA1(chip);
-
     }
 }
 
@@ -53,40 +114,180 @@ bool newInterchipData()
 
 uint16_t getInterchipErrorCount()
 {
-    return dma_error_count;
+    return link_stats.checksum_errors;
 }
 
-void sendInterchipData()
+bool isInterchipSendReady()
 {
-    uint16_t i = 0;
-    uint8_t checksum = 0;
-    switch (chip) {
-    case DMA_CHIP_ID_ATTITUDE_MANAGER:
-        //copy all the bytes to the dma space to send over
-        for (i = 0; i < sizeof(AMData); i++) {
-            dma1_space[i] = ((uint8_t*) (&interchip_send_buffer.am_data))[i];
-            checksum += ((uint8_t*) (&interchip_send_buffer.am_data))[i] + i;
-        }
-        break;
-    case DMA_CHIP_ID_PATH_MANAGER:
-        //copy all the bytes to the dma space to send over
-        for (i = 0; i < sizeof(PMData); i++) {
-            dma1_space[i] = ((uint8_t*) (&interchip_send_buffer.pm_data))[i];
-            checksum += ((uint8_t*) (&interchip_send_buffer.pm_data))[i] + i;
-        }
-        break;
-    default:
-        break;
+    //the path manager clocks its own frames out as soon as they are sent
+    return chip == DMA_CHIP_ID_PATH_MANAGER || send_blocks_done >= 2;
+}
+
+void getInterchipLinkStats(InterchipLinkStats* stats)
+{
+    IEC0bits.DMA0IE = 0;
+    *stats = link_stats;
+    uint32_t last_frame_time = last_good_frame_time;
+    IEC0bits.DMA0IE = 1;
+
+    uint32_t age = getTime() - last_frame_time;
+
+    if (last_frame_time == 0 || age > UINT16_MAX) {
+        stats->last_frame_age = UINT16_MAX;
+    } else {
+        stats->last_frame_age = (uint16_t)age;
     }
 
-    //add the checksum to the end of the payload
-    dma1_space[i] = checksum;
+    //the rate is only updated when frames come in, so it goes stale if the link dies
+    if (age > 1000) {
+        stats->message_rate = 0;
+    }
+}
+
+void writeInterchipSendData(uint16_t offset, const void* data, uint16_t length)
+{
+    uint16_t i;
+
+    syncSendFrame();
+    writeSendFrame(offset, (const uint8_t*) data, length);
+
+    for (i = offset / 2; i <= (offset + length - 1) / 2; i++) {
+        written_words[i / 16] |= 1u << (i % 16);
+    }
+}
+
+void sendInterchipData()
+{
+    InterchipLinkHeader header;
+
+    //the link header is the first member of both PMData and AMData
+    tx_sequence = nextSequence(tx_sequence);
+    header.sequence = tx_sequence;
+    header.timestamp = (uint16_t)getTimeUs();
+    header.echo_timestamp = last_rx_timestamp;
+    writeInterchipSendData(offsetof(InterchipDataBuffer, pm_data.link), &header, sizeof(header));
+
+    commitSendFrame();
 
     if (chip == DMA_CHIP_ID_PATH_MANAGER) {
         //trigger a DMA send
         DMA1CONbits.CHEN = 1;
         DMA1REQbits.FORCE = 1;
+
+        //the old front frame was sent long ago, so it can catch up right away and
+        //be read back through interchip_send_buffer
+        syncSendFrame();
+    }
+    //the attitude manager frame may still be clocked out, so it catches up on the first write
+}
+
+/**
+ * Makes the back frame the frame the DMA sends. Its checksum is already up to
+ * date, so this is just a swap
+ */
+static void commitSendFrame(void)
+{
+    volatile uint8_t* frame = back_frame;
+    uint8_t i;
+
+    //the words written since the last commit are now the ones the new back frame is missing
+    for (i = 0; i < SEND_MASK_WORDS; i++) {
+        pending_words[i] = written_words[i];
+        written_words[i] = 0;
+    }
+
+    //the attitude manager receive interrupt patches the timestamps of the front frame,
+    //and the send interrupt counts blocks from the swap
+    IEC0bits.DMA0IE = 0;
+    IEC0bits.DMA1IE = 0;
+    back_frame = send_frame;
+    send_frame = frame;
+    DMA1STA = (frame == dma1_frame_a) ? __builtin_dmaoffset(&dma1_frame_a) : __builtin_dmaoffset(&dma1_frame_b);
+    send_blocks_done = 0;
+    IEC0bits.DMA1IE = 1;
+    IEC0bits.DMA0IE = 1;
+
+    interchip_send_buffer = (volatile const InterchipDataBuffer*) back_frame;
+}
+
+/**
+ * Copies the words written before the last commit from the front frame into the
+ * back frame, so that fields users don't rewrite before every send keep their last
+ * values. Only has work to do once per commit. The DMA only reads the front frame,
+ * so this can run while it is being sent, as long as the DMA is done with the back frame
+ */
+static void syncSendFrame(void)
+{
+    uint8_t i;
+    uint8_t bit;
+
+    for (i = 0; i < SEND_MASK_WORDS; i++) {
+        for (bit = 0; pending_words[i] != 0; bit++) {
+            if (pending_words[i] & (1u << bit)) {
+                uint16_t offset = (i * 16 + bit) * 2;
+                //the last word can run into the checksum byte, which is never copied
+                uint16_t length = (offset + 2 > send_frame_size) ? 1 : 2;
+                uint8_t word[2];
+
+                word[0] = send_frame[offset];
+                word[1] = send_frame[offset + 1];
+                pending_words[i] &= ~(1u << bit);
+                writeSendFrame(offset, word, length);
+            }
+        }
+    }
+}
+
+/**
+ * Writes into the back frame, without marking the bytes as written. The checksum
+ * is the sum of (byte + index), so the index part never changes and it only has
+ * to be adjusted by the difference of each byte written
+ */
+static void writeSendFrame(uint16_t offset, const uint8_t* data, uint16_t length)
+{
+    uint8_t checksum = back_frame[send_frame_size];
+    uint16_t i;
+
+    for (i = 0; i < length; i++) {
+        checksum += data[i] - back_frame[offset + i];
+        back_frame[offset + i] = data[i];
+    }
+    back_frame[send_frame_size] = checksum;
+}
+
+/**
+ * The attitude manager frame sits in the DMA space until the path manager clocks
+ * it out, so its timestamps are refreshed in place every time a path manager frame
+ * comes in. Since the checksum is a plain sum, it can be adjusted for just the
+ * changed bytes instead of being recalculated
+ */
+static void updateSendTimestamps(uint16_t timestamp, uint16_t echo_timestamp)
+{
+    uint16_t offset = offsetof(InterchipLinkHeader, timestamp);
+    uint8_t new_bytes[4];
+    uint8_t i;
+
+    new_bytes[0] = timestamp & 0xFF;
+    new_bytes[1] = timestamp >> 8;
+    new_bytes[2] = echo_timestamp & 0xFF;
+    new_bytes[3] = echo_timestamp >> 8;
+
+    for (i = 0; i < 4; i++) {
+        send_frame[sizeof(AMData)] += new_bytes[i] - send_frame[offset + i];
+        send_frame[offset + i] = new_bytes[i];
+    }
+}
+
+/**
+ * Sequence numbers skip 0, as that means that no frame was sent yet
+ */
+static uint16_t nextSequence(uint16_t sequence)
+{
+    sequence++;
+    if (sequence == 0) {
+        sequence = 1;
     }
+    return sequence;
 }
 
 // receiving data
@@ -135,8 +336,8 @@ static void initDMA1(uint8_t chip_id)
     DMA1CONbits.SIZE = 1; //Transfer byte (8 bits)
     DMA1CONbits.HALF = 0; //Initiate dma interrupt when all of the data has been moved
 
-    DMA1STA = __builtin_dmaoffset(&dma1_space); //Primary Transfer Buffer
-    DMA1CNT = (sizeof(dma1_space) - 1); //count is 0-indexed, so -1
+    DMA1STA = __builtin_dmaoffset(&dma1_frame_a); //Primary Transfer Buffer, swapped on every send
+    DMA1CNT = (sizeof(dma1_frame_a) - 1); //count is 0-indexed, so -1
 
     DMA1PAD = (volatile unsigned int) &SPI1BUF; //Peripheral Address
     DMA1REQ = 0x000A; //0b0100001; //IRQ code for SPI1
@@ -146,13 +347,14 @@ static void initDMA1(uint8_t chip_id)
 /*
  * Called when we've just received data from our SPI buffers
  */
-static uint8_t last_checksum = 0;
-
 void __attribute__((__interrupt__, no_auto_psv)) _DMA0Interrupt(void)
 {
     is_dma_available = false;
     uint8_t checksum = 0;
     uint16_t i = 0;
+    uint16_t frame_size = 0;
+    volatile uint8_t* frame = dma0_space;
+    volatile uint8_t* destination = NULL;
 
     //if the attitude manager has nothing to send, its perfectly acceptable for us
     //to get all 0's. We don't want to add to the error count in this case
@@ -160,49 +362,90 @@ void __attribute__((__interrupt__, no_auto_psv)) _DMA0Interrupt(void)
 
     switch (chip) {
     case DMA_CHIP_ID_ATTITUDE_MANAGER:
-        for (i = 0; i < sizeof(PMData); i++) { //go through all the bytes, including the checksum
-            ((uint8_t*) (&interchip_receive_buffer.pm_data))[i] = dma0_space[i];
-            checksum += dma0_space[i] + i;
-        }
-        
-        if (checksum == dma0_space[i]) {
-            is_dma_available = true;
-        } else {
-            dma_error_count++;
-        }
+        frame_size = sizeof(PMData);
+        destination = (volatile uint8_t*) &interchip_receive_buffer.pm_data;
         break;
     case DMA_CHIP_ID_PATH_MANAGER:
-        for (i = 0; i < sizeof(AMData); i++) { //go through all the bytes, including the checksum
-            //we do i+1 here since the path manager gets a byte shift of 1 to the right when receiving data from path manager
-            ((uint8_t*) (&interchip_receive_buffer.am_data))[i] = dma0_space[i + 1];
-            checksum += dma0_space[i + 1] + i;
-
-            //its only acceptable for the path manager to receive empty data
-            if (dma0_space[i + 1] != 0) {
-                empty_data = false;
-            }
-        }
-        
-        if (checksum == dma0_space[i + 1]) {
-            if(checksum != last_checksum){
-                is_dma_available = true;
-            }
-            last_checksum = checksum;
-        } else if (!empty_data) {
-            dma_error_count++;
-        } //otherwise we received all zero's. Do nothing.
+        frame_size = sizeof(AMData);
+        destination = (volatile uint8_t*) &interchip_receive_buffer.am_data;
+        //the path manager gets a byte shift of 1 to the right when receiving data from the attitude manager
+        frame = &dma0_space[1];
         break;
     default:
-        break;
+        IFS0bits.DMA0IF = 0;
+        return;
+    }
+
+    for (i = 0; i < frame_size; i++) { //go through all the bytes, including the checksum
+        destination[i] = frame[i];
+        checksum += frame[i] + i;
+
+        if (frame[i] != 0) {
+            empty_data = false;
+        }
+    }
+
+    if (checksum != frame[i]) {
+        //its only acceptable for the path manager to receive empty data
+        if (empty_data && chip == DMA_CHIP_ID_PATH_MANAGER) {
+            link_stats.empty_frames++;
+        } else {
+            link_stats.checksum_errors++;
+        }
+        IFS0bits.DMA0IF = 0;
+        return;
+    }
+
+    volatile InterchipLinkHeader* header = (volatile InterchipLinkHeader*) destination;
+    uint16_t now_us = (uint16_t)getTimeUs();
+    uint32_t now_ms = getTime();
+
+    link_stats.good_frames++;
+    last_good_frame_time = now_ms;
+    if (now_ms - rate_window_start >= 1000) {
+        link_stats.message_rate = rate_window_frames;
+        rate_window_frames = 0;
+        rate_window_start = now_ms;
+    }
+    rate_window_frames++;
+
+    //the other chip echoes back the timestamp of the last frame it got from us
+    if (header->echo_timestamp != last_rx_echo_timestamp) {
+        last_rx_echo_timestamp = header->echo_timestamp;
+        link_stats.round_trip_time = now_us - header->echo_timestamp;
+    }
+    last_rx_timestamp = header->timestamp;
+
+    if (header->sequence == last_rx_sequence) {
+        //the attitude manager repeats its last frame until it has something new,
+        //so this is only unexpected on the attitude manager
+        if (chip == DMA_CHIP_ID_ATTITUDE_MANAGER) {
+            link_stats.duplicate_frames++;
+        }
+    } else {
+        if (last_rx_sequence != 0 && header->sequence != nextSequence(last_rx_sequence)) {
+            link_stats.sequence_errors++;
+        }
+        last_rx_sequence = header->sequence;
+        is_dma_available = true;
+    }
+
+    if (chip == DMA_CHIP_ID_ATTITUDE_MANAGER) {
+        updateSendTimestamps(now_us, header->timestamp);
     }
 
     IFS0bits.DMA0IF = 0; //clear the interrupt flag
 }
 
 /**
- * Called when we've finished sending data from our SPI buffer. We do nothing here
+ * Called when we've finished sending data from our SPI buffer. The next block
+ * starts from DMA1STA, so the DMA is done with the frame it was sending before
+ * the last swap
  */
 void __attribute__((__interrupt__, no_auto_psv)) _DMA1Interrupt(void)
 {
+    if (send_blocks_done < 2) {
+        send_blocks_done++;
+    }
     IFS0bits.DMA1IF = 0; //clear the interrupt flag
 }
@@ -24,6 +24,7 @@
 #define	INTERCHIPDMA_H
 
 #include "../Common.h"
+#include <stddef.h>
 
 #define DMA_CHIP_ID_PATH_MANAGER 0
 #define DMA_CHIP_ID_ATTITUDE_MANAGER 1
@@ -38,11 +39,37 @@
  */
 #define DMA_CLOCK_KHZ 40000 //40Mhz
 
+/**
+ * Link header at the start of every interchip frame, in both directions. Used
+ * to detect duplicate and lost frames, and to measure the round trip time of
+ * the link. Filled in by the interchip module, users shouldn't write to it
+ */
+typedef struct { // 6 Bytes
+    uint16_t sequence; //incremented on every new frame. 0 means no frame was sent yet
+    uint16_t timestamp; //lower 16 bits of the sender's getTimeUs() when the frame was sent
+    uint16_t echo_timestamp; //timestamp of the last good frame the sender received from the other chip
+} InterchipLinkHeader;
+
+/**
+ * Health of the receiving side of the interchip link on this chip
+ */
+typedef struct {
+    uint16_t good_frames; //frames with a valid checksum
+    uint16_t checksum_errors;
+    uint16_t empty_frames; //all zero frames, ie the attitude manager had nothing to send yet. Path manager only, not counted as checksum errors
+    uint16_t duplicate_frames; //valid frames that repeated the last sequence number
+    uint16_t sequence_errors; //valid frames that skipped or went back in sequence
+    uint16_t round_trip_time; //us, from sending a frame until the other chip echoes its timestamp back. Includes the wait for the next transfer
+    uint16_t last_frame_age; //ms since the last good frame
+    uint16_t message_rate; //good frames received in the last second
+} InterchipLinkStats;
+
 /**
  * Data that the path manager sends to the attitude manager. Note that its
  * vital that the last byte be the checksum byte!
  */
-typedef struct { // 60 Bytes
+typedef struct { // 88 Bytes
+    InterchipLinkHeader link;
     long double latitude; // 8 Bytes - ddd.mmmmmm
     long double longitude; // 8 Bytes - ddd.mmmmmm
     float time; // 4 Bytes   -  hhmmss.ssss
@@ -59,6 +86,8 @@ typedef struct { // 60 Bytes
     uint16_t batteryLevel2;
     uint16_t interchip_error_count; //how many dma errors the path manager has received from the attitude manager
     uint16_t gps_communication_error_count; //number of dma errors between gps and path manager, if applicable
+    uint16_t gps_setpoint_latency; //us from receiving a GPS update to sending the heading setpoint computed from it
+    InterchipLinkStats link_stats; //receive side health of the link on the path manager, when this frame was sent
     char satellites; //1 Byte
     char positionFix; //0 = No GPS, 1 = GPS fix, 2 = DGSP Fix
     char targetWaypoint;
@@ -71,6 +100,7 @@ typedef struct { // 60 Bytes
  * that the last byte be the checksum byte!
  */
 typedef struct {
+    InterchipLinkHeader link;
     WaypointWrapper waypoint;
     float pathGain;
     float orbitGain;
@@ -85,10 +115,22 @@ typedef union {
 } InterchipDataBuffer;
 
 /**
- * Global send buffer. Attitude manager should write to the am_data field,
- * path manager should write to the pm_data field
+ * Global send buffer, read only. Attitude manager should read the am_data field,
+ * path manager should read the pm_data field. This points directly into the DMA
+ * space, and is swapped to the other buffer on every send, so never keep a copy
+ * of the pointer. Write to it with INTERCHIP_SEND, which keeps the frame checksum
+ * up to date
+ */
+extern volatile const InterchipDataBuffer* interchip_send_buffer;
+
+/**
+ * Writes a field of the send buffer, ie INTERCHIP_SEND(am_data.command, PM_RETURN_HOME).
+ * On the attitude manager, only write when isInterchipSendReady() returns true
  */
-extern volatile InterchipDataBuffer interchip_send_buffer;
+#define INTERCHIP_SEND(field, value) do { \
+        __typeof__(((InterchipDataBuffer*)0)->field) interchip_send_value = (value); \
+        writeInterchipSendData(offsetof(InterchipDataBuffer, field), &interchip_send_value, sizeof(interchip_send_value)); \
+    } while (0)
 
 /**
  * Global receive buffer. Attitude manager should read the pm_data field, path
@@ -111,17 +153,42 @@ void initInterchip(uint8_t chip_id);
 bool newInterchipData(void);
 
 /**
- * Triggers a send of the DMA buffer. In the case of the path manager, will
- * copy over the data to the data buffer, and force a DMA update. In the case
- * of the attitude manager, will simply copy over the data. The next path manager
- * update will send it
+ * Writes bytes into the send buffer, and adjusts the frame checksum for just
+ * the bytes that changed. Use INTERCHIP_SEND instead of calling this directly
+ * @param offset Byte offset into InterchipDataBuffer
+ * @param data What to write
+ * @param length Number of bytes to write
+ */
+void writeInterchipSendData(uint16_t offset, const void* data, uint16_t length);
+
+/**
+ * Triggers a send of the DMA buffer. Swaps the send buffer with the one the DMA
+ * is sending from, which is all a send costs. Fields that aren't written again
+ * keep their last values. In the case of the path manager, will also force a DMA update.
+ * In the case of the attitude manager, the next path manager update will send it
  */
 void sendInterchipData(void);
 
+/**
+ * Whether the last frame sent has been clocked out, so the send buffer can be
+ * written to and sent again. Always true on the path manager. On the attitude
+ * manager, the path manager has to clock out the frame first, and sending again
+ * before that would replace it before the path manager ever sees it
+ */
+bool isInterchipSendReady(void);
+
 /**
  * @return Total number of communication errors between the path and
  * attitude manager
  */
 uint16_t getInterchipErrorCount(void);
 
+/**
+ * Copies the current receive link statistics of this chip. Note that on the path
+ * manager, the attitude manager repeats its last frame until it has a new command
+ * to send, so repeated frames aren't counted as duplicates there
+ * @param stats Where to copy the statistics to
+ */
+void getInterchipLinkStats(InterchipLinkStats* stats);
+
 #endif
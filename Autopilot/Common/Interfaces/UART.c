@@ -9,8 +9,10 @@
 #include "UART.h"
 #include <xc.h>
 #include "../Clock/Clock.h"
-#include "../Utilities/ByteQueue.h"
+#include "../Utilities/ByteRing.h"
 #include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
 
 /**
  * The chip requires the baud rate register to be set to a value that corresponds
@@ -25,15 +27,27 @@
 static char uart1_status = 0;
 static char uart2_status = 0;
 
-static ByteQueue uart1_rx_queue;
-static ByteQueue uart1_tx_queue;
-static ByteQueue uart2_rx_queue;
-static ByteQueue uart2_tx_queue;
+/**
+ * The main loop is the only producer of the TX rings and the only consumer of the
+ * RX rings, and the ISRs the other way around, so none of them need interrupts
+ * disabled around them
+ */
+static ByteRing uart1_rx_queue;
+static ByteRing uart1_tx_queue;
+static ByteRing uart2_rx_queue;
+static ByteRing uart2_tx_queue;
 
-void initUART(uint8_t interface, uint32_t baudrate, uint16_t initial_buffer_size, uint16_t max_buffer_size, uint8_t tx_rx)
+static bool initRings(ByteRing* tx_queue, ByteRing* rx_queue, uint16_t buffer_size, uint8_t tx_rx);
+
+void initUART(uint8_t interface, uint32_t baudrate, uint16_t buffer_size, uint8_t tx_rx)
 {
     //we don't initialize twice or don't initialize if the interface is disabled
     if (interface == 1) {
+        //the interface stays disabled if there's no memory for its buffers
+        if (!initRings(&uart1_tx_queue, &uart1_rx_queue, buffer_size, tx_rx)) {
+            uart1_status = 0;
+            return;
+        }
         uart1_status = tx_rx;
 
         U1MODEbits.UARTEN = 0; //Disable UART while we're configuring it
@@ -79,18 +93,20 @@ void initUART(uint8_t interface, uint32_t baudrate, uint16_t initial_buffer_size
         IFS0bits.U1RXIF = 0; // Clear the receive Interrupt Flag
 
         if (uart1_status & UART_TX_ENABLE) {
-            initBQueue(&uart1_tx_queue, initial_buffer_size, max_buffer_size);
             IEC0bits.U1TXIE = 1; // Enable Transmit Interrupts
         }
 
         if (uart1_status & UART_RX_ENABLE) {
-            initBQueue(&uart1_rx_queue, initial_buffer_size, max_buffer_size);
             IEC0bits.U1RXIE = 1; // Enable receive Interrupts 
         }
 
         U1MODEbits.UARTEN = 1; // And turn the peripheral on
         U1STAbits.UTXEN = 1; //enable transmit operations (must come after the uart enable)
     } else if (interface == 2) {
+        if (!initRings(&uart2_tx_queue, &uart2_rx_queue, buffer_size, tx_rx)) {
+            uart2_status = 0;
+            return;
+        }
         uart2_status = tx_rx;
 
         U2MODEbits.UARTEN = 0; //Disable UART while we're configuring it
@@ -135,12 +151,10 @@ void initUART(uint8_t interface, uint32_t baudrate, uint16_t initial_buffer_size
         IFS1bits.U2RXIF = 0; // Clear the receive Interrupt Flag
 
         if (uart2_status & UART_RX_ENABLE) {
-            initBQueue(&uart2_rx_queue, initial_buffer_size, max_buffer_size);
             IEC1bits.U2RXIE = 1; // Enable receive Interrupts
         }
 
         if (uart2_status & UART_TX_ENABLE) {
-            initBQueue(&uart2_tx_queue, initial_buffer_size, max_buffer_size);
             IEC1bits.U2TXIE = 1; // Enable Transmit Interrupts
         }
 
@@ -149,67 +163,124 @@ void initUART(uint8_t interface, uint32_t baudrate, uint16_t initial_buffer_size
     }
 }
 
+/**
+ * Allocates the storage of the rings that are enabled, and initializes them
+ * @return False if the storage of either ring couldn't be allocated. Nothing is
+ *      allocated then
+ */
+static bool initRings(ByteRing* tx_queue, ByteRing* rx_queue, uint16_t buffer_size, uint8_t tx_rx)
+{
+    uint8_t* tx_data = NULL;
+    uint8_t* rx_data = NULL;
+
+    if (tx_rx & UART_TX_ENABLE) {
+        tx_data = malloc(buffer_size);
+    }
+    if (tx_rx & UART_RX_ENABLE) {
+        rx_data = malloc(buffer_size);
+    }
+    if (((tx_rx & UART_TX_ENABLE) && tx_data == NULL) || ((tx_rx & UART_RX_ENABLE) && rx_data == NULL)) {
+        free(tx_data);
+        free(rx_data);
+        return false;
+    }
+
+    if (tx_data != NULL) {
+        initBRing(tx_queue, tx_data, buffer_size);
+    }
+    if (rx_data != NULL) {
+        initBRing(rx_queue, rx_data, buffer_size);
+    }
+    return true;
+}
+
 void queueTXData(uint8_t interface, uint8_t* data, uint16_t data_length)
 {
-    unsigned int i;
     if (interface == 1 && (uart1_status & UART_TX_ENABLE)) {
-        IEC0bits.U1TXIE = 0;	//Disable transmit interrupts for now
-        
-        for (i = 0; i < data_length; i++) {
-            pushBQueue(&uart1_tx_queue, data[i]);
-        }
+        pushNBRing(&uart1_tx_queue, data, data_length);
+        //let the TX interrupt pop the data, so that it stays the only consumer
+        IFS0bits.U1TXIF = 1;
+    } else if (interface == 2 && (uart2_status & UART_TX_ENABLE)) {
+        pushNBRing(&uart2_tx_queue, data, data_length);
+        IFS1bits.U2TXIF = 1;
+    }
+}
 
-        if (U1STAbits.TRMT) { //if the transmit buffer is empty and register (no sending)
-            U1TXREG = popBQueue(&uart1_tx_queue); //trigger a send
-        }
-        
-        IEC0bits.U1TXIE = 1;	//Re-enable transmit interrupts
+uint16_t reserveTXSpan(uint8_t interface, uint8_t** span)
+{
+    if (interface == 1 && (uart1_status & UART_TX_ENABLE)) {
+        return reserveBRing(&uart1_tx_queue, span);
     } else if (interface == 2 && (uart2_status & UART_TX_ENABLE)) {
-        IEC1bits.U2TXIE = 0;	//Disable transmit interrupts for now
-        
-        for (i = 0; i < data_length; i++) {
-            pushBQueue(&uart2_tx_queue, data[i]);
-        }
+        return reserveBRing(&uart2_tx_queue, span);
+    }
+    return 0;
+}
 
-        if (U2STAbits.TRMT) { //if the transmit buffer is empty and register (no sending)
-            U2TXREG = popBQueue(&uart2_tx_queue); //trigger a send
-        }
-        
-        IEC1bits.U2TXIE = 1;	//Re-enable transmit interrupts
+void commitTXSpan(uint8_t interface, uint16_t length)
+{
+    if (interface == 1 && (uart1_status & UART_TX_ENABLE)) {
+        commitBRing(&uart1_tx_queue, length);
+        IFS0bits.U1TXIF = 1;
+    } else if (interface == 2 && (uart2_status & UART_TX_ENABLE)) {
+        commitBRing(&uart2_tx_queue, length);
+        IFS1bits.U2TXIF = 1;
     }
 }
 
 uint8_t readRXData(uint8_t interface)
 {
     if (interface == 1 && (uart1_status & UART_RX_ENABLE)) {
-        IEC0bits.U1RXIE = 0; //disable RX interrupt for now
-        uint8_t byte = popBQueue(&uart1_rx_queue);
-        IEC0bits.U1RXIE = 1; //re-enable RX interrupts
-        return byte;
+        return popBRing(&uart1_rx_queue);
     } else if (interface == 2 && (uart2_status & UART_RX_ENABLE)) {
-        IEC1bits.U2RXIE = 0; //disable RX interrupt for now
-        uint8_t byte = popBQueue(&uart2_rx_queue);
-        IEC1bits.U2RXIE = 1; //re-enable RX interrupts
-        return byte;
+        return popBRing(&uart2_rx_queue);
     }
     return -1;
 }
 
+uint16_t peekRXSpan(uint8_t interface, uint8_t** span)
+{
+    if (interface == 1 && (uart1_status & UART_RX_ENABLE)) {
+        return peekSpanBRing(&uart1_rx_queue, span);
+    } else if (interface == 2 && (uart2_status & UART_RX_ENABLE)) {
+        return peekSpanBRing(&uart2_rx_queue, span);
+    }
+    return 0;
+}
+
+void consumeRXSpan(uint8_t interface, uint16_t length)
+{
+    if (interface == 1 && (uart1_status & UART_RX_ENABLE)) {
+        consumeBRing(&uart1_rx_queue, length);
+    } else if (interface == 2 && (uart2_status & UART_RX_ENABLE)) {
+        consumeBRing(&uart2_rx_queue, length);
+    }
+}
+
 uint16_t getTXSpace(uint8_t interface)
 {
     if (interface == 1 && (uart1_status & UART_TX_ENABLE)) {
-        return getBQueueSpace(&uart1_tx_queue);
+        return getBRingSpace(&uart1_tx_queue);
+    } else if (interface == 2 && (uart2_status & UART_TX_ENABLE)) {
+        return getBRingSpace(&uart2_tx_queue);
+    }
+    return 0;
+}
+
+uint16_t getTXCapacity(uint8_t interface)
+{
+    if (interface == 1 && (uart1_status & UART_TX_ENABLE)) {
+        return getBRingCapacity(&uart1_tx_queue);
     } else if (interface == 2 && (uart2_status & UART_TX_ENABLE)) {
-        return getBQueueSpace(&uart2_tx_queue);
+        return getBRingCapacity(&uart2_tx_queue);
     }
     return 0;
 }
 
 uint16_t getRXSize(uint8_t interface){
     if (interface == 1 && (uart1_status & UART_RX_ENABLE)) {
-        return getBQueueSize(&uart1_rx_queue);
+        return getBRingSize(&uart1_rx_queue);
     } else if (interface == 2 && (uart2_status & UART_RX_ENABLE)) {
-        return getBQueueSize(&uart2_rx_queue);
+        return getBRingSize(&uart2_rx_queue);
     }
     return 0;
 }
@@ -219,11 +290,13 @@ uint16_t getRXSize(uint8_t interface){
  */
 void __attribute__((__interrupt__, no_auto_psv)) _U2TXInterrupt(void)
 {
+    //cleared first, so that data queued while we're in here sets it again
+    IFS1bits.U2TXIF = 0;
+
     //while the TX buffer isn't full and we have data to send 
-    while (!U2STAbits.UTXBF && getBQueueSize(&uart2_tx_queue) != 0) {
-        U2TXREG = popBQueue(&uart2_tx_queue);
+    while (!U2STAbits.UTXBF && getBRingSize(&uart2_tx_queue) != 0) {
+        U2TXREG = popBRing(&uart2_tx_queue);
     }
-    IFS1bits.U2TXIF = 0;
 }
 
 /**
@@ -233,7 +306,7 @@ void __attribute__((__interrupt__, no_auto_psv)) _U2RXInterrupt(void)
 {
     //while the rx buffer has characters available to read
     while (U2STAbits.URXDA) {
-        pushBQueue(&uart2_rx_queue, U2RXREG);
+        pushBRing(&uart2_rx_queue, U2RXREG);
     }
     IFS1bits.U2RXIF = 0;
 }
@@ -243,18 +316,20 @@ void __attribute__((__interrupt__, no_auto_psv)) _U2RXInterrupt(void)
  */
 void __attribute__((__interrupt__, no_auto_psv)) _U1TXInterrupt(void)
 {
+    //cleared first, so that data queued while we're in here sets it again
+    IFS0bits.U1TXIF = 0;
+
     //while the TX buffer isn't full and we have data to send 
-    while (!U1STAbits.UTXBF && getBQueueSize(&uart1_tx_queue) != 0) {
-        U1TXREG = popBQueue(&uart1_tx_queue);
+    while (!U1STAbits.UTXBF && getBRingSize(&uart1_tx_queue) != 0) {
+        U1TXREG = popBRing(&uart1_tx_queue);
     }
-    IFS0bits.U1TXIF = 0;
 }
 
 void __attribute__((__interrupt__, no_auto_psv)) _U1RXInterrupt(void)
 {
     //while the rx buffer has characters available to read
     while (U1STAbits.URXDA) {
-        pushBQueue(&uart1_rx_queue, U1RXREG);
+        pushBRing(&uart1_rx_queue, U1RXREG);
     }
     
     IFS0bits.U1RXIF = 0;
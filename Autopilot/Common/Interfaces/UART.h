@@ -25,16 +25,12 @@
  * at the specified baud rate.
  * @param interface Which interface to initialize (1 or 2?)
  * @param baudrate Baudrate to operate at for this interface
- * @param initial_buffer_size Initial sizes of the RX and TX buffers
- * @param max_buffer_size Max size of the RX and TX buffers
+ * @param buffer_size Size of each of the RX and TX buffers. These are ring buffers
+ * that never resize, and their size has to be a power of 2 (a smaller power of 2 is used otherwise).
+ * If they can't be allocated, the interface is left disabled
  * @param tx_rx specifies to turn on either TX only, RX only, or BOTH. See status codes above
- * 
- * Note that the initial_buffer_size and max_buffer_size should ideally be even 
- * multiples of each other. ie. 100, 200, or 400, 800, etc.
- * This is because of the underlying bytequeue implementation that doubles and halves
- * the queue, which works better with even multiples.
  */
-void initUART(uint8_t interface, uint32_t baudrate, uint16_t initial_buffer_size, uint16_t max_buffer_size, uint8_t tx_rx);
+void initUART(uint8_t interface, uint32_t baudrate, uint16_t buffer_size, uint8_t tx_rx);
 
 /**
  * Read a byte from the uart RX buffer
@@ -52,6 +48,42 @@ uint8_t readRXData(uint8_t interface);
  */
 void queueTXData(uint8_t interface, uint8_t* data, uint16_t data_length);
 
+/**
+ * Gets the free space at the end of the TX buffer that can be written to directly,
+ * so that data can be built in place instead of being copied in. It ends where
+ * the buffer wraps around, so it can be shorter than getTXSpace(). Write into it,
+ * then call commitTXSpan() to send what was written
+ * @param interface Which UART interface to send through
+ * @param span Set to the start of the free space
+ * @return Length of the span in bytes. 0 if the buffer is full
+ */
+uint16_t reserveTXSpan(uint8_t interface, uint8_t** span);
+
+/**
+ * Queues data that was written into a span from reserveTXSpan() for sending
+ * @param interface Which UART interface to send through
+ * @param length Number of bytes written. At most the length of the span
+ */
+void commitTXSpan(uint8_t interface, uint16_t length);
+
+/**
+ * Gets the received bytes at the front of the RX buffer, so that they can be parsed
+ * in place instead of being read one at a time. It ends where the buffer wraps
+ * around, so it can be shorter than getRXSize(). Call consumeRXSpan() to remove
+ * what was parsed
+ * @param interface The interface to read from (1 or 2)
+ * @param span Set to the first received byte
+ * @return Length of the span in bytes. 0 if nothing was received
+ */
+uint16_t peekRXSpan(uint8_t interface, uint8_t** span);
+
+/**
+ * Removes bytes that were read from a span from peekRXSpan()
+ * @param interface The interface to read from (1 or 2)
+ * @param length Number of bytes to remove. At most the length of the span
+ */
+void consumeRXSpan(uint8_t interface, uint16_t length);
+
 /**
  * Get the number of bytes that are guaranteed to be succesfully queued to the TX buffer.
  * This is useful if sending partial amounts of data is unacceptable. You can use
@@ -62,6 +94,14 @@ void queueTXData(uint8_t interface, uint8_t* data, uint16_t data_length);
  */
 uint16_t getTXSpace(uint8_t interface);
 
+/**
+ * Get the total size of the TX buffer of an interface. It can be larger than the
+ * buffer size given to initUART(), since the buffer is rounded up to a power of 2
+ * @param interface
+ * @return Capacity of the TX buffer in bytes. 0 if TX isn't enabled on the interface
+ */
+uint16_t getTXCapacity(uint8_t interface);
+
 /**
  * Get the current size of the uart rx buffer for the specified interface
  * @param interface
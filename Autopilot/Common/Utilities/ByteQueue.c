@@ -42,6 +42,14 @@ unsigned char popBQueue(ByteQueue* queue)
     }
 }
 
+unsigned char peekBQueue(ByteQueue* queue)
+{
+    if (queue->_size == 0) {
+        return -1;
+    }
+    return queue->_data[queue->_start_index];
+}
+
 unsigned char pushBQueue(ByteQueue* queue, unsigned char byte)
 {
     //if the queue is full
@@ -49,6 +49,14 @@ void initBQueue(ByteQueue* queue, unsigned int initial_size, unsigned int max_si
  */
 unsigned char popBQueue(ByteQueue* queue);
 
+/**
+ * Gets the next element of the queue without popping it. Same as popBQueue, make
+ * sure to check the size of the queue before calling this
+ * @param queue
+ * @return -1 or 256 if the queue is empty, or the value of the next byte if not
+ */
+unsigned char peekBQueue(ByteQueue* queue);
+
 /**
  * Push/add a byte onto the end of the queue. If the size of the queue is exceeded
  * by this operation, the size of the queue will double
@@ -0,0 +1,193 @@
+/**
+ * @file ByteRing.c
+ * @author Waterloo Aerial Robotics Group
+ * @date October 18, 2026
+ * @copyright Waterloo Aerial Robotics Group 2017 \n
+ *   https://raw.githubusercontent.com/UWARG/PICpilot/master/LICENCE
+ */
+
+#include "ByteRing.h"
+#include "ByteQueue.h"
+#include "Logger.h"
+#include "../Clock/Timer.h"
+#include <string.h>
+
+/**
+ * Stops the compiler from moving memory accesses across it. Bytes written into
+ * or read from a span aren't volatile, so this keeps them on the right side of the
+ * head or tail update that hands them over
+ */
+#define COMPILER_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+void initBRing(ByteRing* ring, uint8_t* data, uint16_t capacity)
+{
+    uint16_t size = 1;
+
+    //round down to a power of 2, so that the mask covers the whole ring
+    while (size <= capacity / 2 && size < 0x8000) {
+        size <<= 1;
+    }
+
+    ring->_data = data;
+    ring->_mask = size - 1;
+    ring->_head = 0;
+    ring->_tail = 0;
+}
+
+uint8_t pushBRing(ByteRing* ring, uint8_t byte)
+{
+    uint16_t head = ring->_head;
+
+    if ((uint16_t)(head - ring->_tail) > ring->_mask) { //full
+        return 0;
+    }
+
+    //the byte has to be in place before the consumer can see the new head
+    ring->_data[head & ring->_mask] = byte;
+    ring->_head = head + 1;
+    return 1;
+}
+
+uint8_t popBRing(ByteRing* ring)
+{
+    uint16_t tail = ring->_tail;
+
+    if (tail == ring->_head) {
+        return 0;
+    }
+
+    //read the byte before the producer is allowed to overwrite it
+    uint8_t byte = ring->_data[tail & ring->_mask];
+    ring->_tail = tail + 1;
+    return byte;
+}
+
+uint8_t peekBRing(ByteRing* ring)
+{
+    uint16_t tail = ring->_tail;
+
+    if (tail == ring->_head) {
+        return 0;
+    }
+    return ring->_data[tail & ring->_mask];
+}
+
+uint16_t pushNBRing(ByteRing* ring, const uint8_t* data, uint16_t length)
+{
+    uint16_t pushed = 0;
+    uint16_t span_length;
+    uint8_t* span;
+
+    //at most twice: up to the end of the storage, then from its start
+    while (pushed < length && (span_length = reserveBRing(ring, &span)) != 0) {
+        if (span_length > length - pushed) {
+            span_length = length - pushed;
+        }
+        memcpy(span, &data[pushed], span_length);
+        commitBRing(ring, span_length);
+        pushed += span_length;
+    }
+    return pushed;
+}
+
+uint16_t popNBRing(ByteRing* ring, uint8_t* data, uint16_t length)
+{
+    uint16_t popped = 0;
+    uint16_t span_length;
+    uint8_t* span;
+
+    while (popped < length && (span_length = peekSpanBRing(ring, &span)) != 0) {
+        if (span_length > length - popped) {
+            span_length = length - popped;
+        }
+        memcpy(&data[popped], span, span_length);
+        consumeBRing(ring, span_length);
+        popped += span_length;
+    }
+    return popped;
+}
+
+uint16_t reserveBRing(ByteRing* ring, uint8_t** span)
+{
+    uint16_t head = ring->_head;
+    uint16_t index = head & ring->_mask;
+    uint16_t space = ring->_mask + 1 - (uint16_t)(head - ring->_tail);
+    uint16_t to_end = ring->_mask + 1 - index;
+
+    *span = (uint8_t*) &ring->_data[index];
+    return space < to_end ? space : to_end;
+}
+
+void commitBRing(ByteRing* ring, uint16_t length)
+{
+    COMPILER_BARRIER();
+    ring->_head += length;
+}
+
+uint16_t peekSpanBRing(ByteRing* ring, uint8_t** span)
+{
+    uint16_t tail = ring->_tail;
+    uint16_t index = tail & ring->_mask;
+    uint16_t size = ring->_head - tail;
+    uint16_t to_end = ring->_mask + 1 - index;
+
+    *span = (uint8_t*) &ring->_data[index];
+    return size < to_end ? size : to_end;
+}
+
+void consumeBRing(ByteRing* ring, uint16_t length)
+{
+    COMPILER_BARRIER();
+    ring->_tail += length;
+}
+
+uint16_t getBRingSize(ByteRing* ring)
+{
+    return ring->_head - ring->_tail;
+}
+
+uint16_t getBRingSpace(ByteRing* ring)
+{
+    return ring->_mask + 1 - (uint16_t)(ring->_head - ring->_tail);
+}
+
+uint16_t getBRingCapacity(ByteRing* ring)
+{
+    return ring->_mask + 1;
+}
+
+void benchmarkBRing(void)
+{
+    static uint8_t data[BYTE_RING_BENCHMARK_SIZE];
+    static uint8_t chunk[BYTE_RING_BENCHMARK_CHUNK];
+    ByteQueue queue;
+    ByteRing ring;
+    uint16_t i;
+    uint64_t start;
+
+    //same size initially and at most, so the queue never resizes
+    initBQueue(&queue, BYTE_RING_BENCHMARK_SIZE, BYTE_RING_BENCHMARK_SIZE);
+    start = getTimeUs();
+    for (i = 0; i < BYTE_RING_BENCHMARK_ITERATIONS; i++) {
+        pushBQueue(&queue, (uint8_t)i);
+        popBQueue(&queue);
+    }
+    debugInt("ByteQueue (us)", getTimeUs() - start);
+    deleteBQueue(&queue);
+
+    initBRing(&ring, data, BYTE_RING_BENCHMARK_SIZE);
+    start = getTimeUs();
+    for (i = 0; i < BYTE_RING_BENCHMARK_ITERATIONS; i++) {
+        pushBRing(&ring, (uint8_t)i);
+        popBRing(&ring);
+    }
+    debugInt("ByteRing (us)", getTimeUs() - start);
+
+    //the same number of bytes again, BYTE_RING_BENCHMARK_CHUNK at a time
+    start = getTimeUs();
+    for (i = 0; i < BYTE_RING_BENCHMARK_ITERATIONS; i += BYTE_RING_BENCHMARK_CHUNK) {
+        pushNBRing(&ring, chunk, BYTE_RING_BENCHMARK_CHUNK);
+        popNBRing(&ring, chunk, BYTE_RING_BENCHMARK_CHUNK);
+    }
+    debugInt("ByteRing bulk (us)", getTimeUs() - start);
+}
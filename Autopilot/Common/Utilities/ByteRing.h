@@ -0,0 +1,159 @@
+/**
+ * @file ByteRing.h
+ * @author Waterloo Aerial Robotics Group
+ * @date October 18, 2026
+ * @brief
+ * Fixed size byte ring buffer, for passing bytes between an ISR and the main loop.
+ * Unlike the ByteQueue, it never resizes, and its capacity is a power of 2 so that
+ * indices wrap with a mask instead of a (software) division.
+ *
+ * It is safe to use without disabling interrupts as long as there's a single producer
+ * (the only one to push) and a single consumer (the only one to pop). The producer
+ * only ever writes the head and the consumer only ever writes the tail, and both are
+ * 16 bits, so they are read and written atomically on the dsPIC
+ *
+ * @copyright Waterloo Aerial Robotics Group 2017 \n
+ *   https://raw.githubusercontent.com/UWARG/PICpilot/master/LICENCE
+ */
+
+#ifndef BYTERING_H
+#define BYTERING_H
+
+#include <stdint.h>
+
+/**
+ * Number of bytes benchmarkBRing() pushes and pops through each buffer
+ */
+#define BYTE_RING_BENCHMARK_ITERATIONS 1000
+
+/**
+ * Size of the buffers benchmarkBRing() uses
+ */
+#define BYTE_RING_BENCHMARK_SIZE 64
+
+/**
+ * Number of bytes benchmarkBRing() moves per call when timing pushNBRing()/popNBRing()
+ */
+#define BYTE_RING_BENCHMARK_CHUNK 20
+
+/**
+ * ByteRing struct. The head and tail count up forever (wrapping at 2^16), so
+ * head - tail is always the number of bytes in the ring, even when it's full
+ */
+typedef struct {
+    volatile uint8_t* _data;
+    uint16_t _mask; //capacity - 1
+    volatile uint16_t _head; //number of bytes ever pushed. Written by the producer only
+    volatile uint16_t _tail; //number of bytes ever popped. Written by the consumer only
+} ByteRing;
+
+/**
+ * Initializes the ring to use the given storage. If the capacity isn't a power of 2,
+ * only the largest power of 2 below it is used
+ * @param ring
+ * @param data Storage for the ring. Must stay valid for as long as the ring is used
+ * @param capacity Size of the storage in bytes. At most 32768
+ */
+void initBRing(ByteRing* ring, uint8_t* data, uint16_t capacity);
+
+/**
+ * Push a byte onto the end of the ring. Producer only
+ * @param ring
+ * @param byte The byte to add to the ring
+ * @return 1 if successfully pushed, 0 if the ring is full
+ */
+uint8_t pushBRing(ByteRing* ring, uint8_t byte);
+
+/**
+ * Pop a byte from the front of the ring. Consumer only. Make sure to check the
+ * size of the ring before calling this
+ * @param ring
+ * @return The next byte, or 0 if the ring is empty
+ */
+uint8_t popBRing(ByteRing* ring);
+
+/**
+ * Gets the next byte of the ring without popping it. Consumer only
+ * @param ring
+ * @return The next byte, or 0 if the ring is empty
+ */
+uint8_t peekBRing(ByteRing* ring);
+
+/**
+ * Copies as much of the data onto the end of the ring as fits. Producer only
+ * @param ring
+ * @param data Bytes to push
+ * @param length Number of bytes to push
+ * @return Number of bytes pushed. Less than the length if the ring filled up
+ */
+uint16_t pushNBRing(ByteRing* ring, const uint8_t* data, uint16_t length);
+
+/**
+ * Copies bytes from the front of the ring, and pops them. Consumer only
+ * @param ring
+ * @param data Where to copy the bytes to
+ * @param length Most bytes to pop
+ * @return Number of bytes popped. Less than the length if the ring emptied
+ */
+uint16_t popNBRing(ByteRing* ring, uint8_t* data, uint16_t length);
+
+/**
+ * Gets the free space at the end of the ring that can be written to directly, up
+ * to where the storage wraps around. Producer only. Write into it, then call
+ * commitBRing() to push what was written
+ * @param ring
+ * @param span Set to the start of the free space
+ * @return Length of the span. 0 if the ring is full
+ */
+uint16_t reserveBRing(ByteRing* ring, uint8_t** span);
+
+/**
+ * Pushes bytes that were written into a span from reserveBRing()
+ * @param ring
+ * @param length Number of bytes written. At most the length of the span
+ */
+void commitBRing(ByteRing* ring, uint16_t length);
+
+/**
+ * Gets the bytes at the front of the ring that can be read directly, up to where
+ * the storage wraps around. Consumer only. Call consumeBRing() to pop what was read
+ * @param ring
+ * @param span Set to the first byte of the ring
+ * @return Length of the span. 0 if the ring is empty
+ */
+uint16_t peekSpanBRing(ByteRing* ring, uint8_t** span);
+
+/**
+ * Pops bytes that were read from a span from peekSpanBRing()
+ * @param ring
+ * @param length Number of bytes to pop. At most the length of the span
+ */
+void consumeBRing(ByteRing* ring, uint16_t length);
+
+/**
+ * @param ring
+ * @return Number of bytes currently in the ring
+ */
+uint16_t getBRingSize(ByteRing* ring);
+
+/**
+ * @param ring
+ * @return Number of bytes that are guaranteed to be pushed to the ring. Only grows
+ *      until the producer pushes again
+ */
+uint16_t getBRingSpace(ByteRing* ring);
+
+/**
+ * @param ring
+ * @return Total number of bytes the ring can hold
+ */
+uint16_t getBRingCapacity(ByteRing* ring);
+
+/**
+ * Times BYTE_RING_BENCHMARK_ITERATIONS bytes through a ByteQueue and a ByteRing
+ * of BYTE_RING_BENCHMARK_SIZE bytes, one at a time, then through the ByteRing in
+ * chunks, and logs the result of each in us
+ */
+void benchmarkBRing(void);
+
+#endif
@@ -0,0 +1,79 @@
+/**
+ * @file FixedPoint.c
+ * @author Waterloo Aerial Robotics Group
+ * @date October 18, 2026
+ * @copyright Waterloo Aerial Robotics Group 2017 \n
+ *   https://raw.githubusercontent.com/UWARG/PICpilot/master/LICENCE
+ */
+
+#include "FixedPoint.h"
+
+q16_t floatToQ16(float value)
+{
+    float scaled = value * 65536.0f;
+
+    if (scaled >= 2147483647.0f) {
+        return Q16_MAX;
+    } else if (scaled <= -2147483648.0f) {
+        return Q16_MIN;
+    }
+    return (q16_t)(scaled >= 0 ? scaled + 0.5f : scaled - 0.5f);
+}
+
+float q16ToFloat(q16_t value)
+{
+    return value / 65536.0f;
+}
+
+q16_t q16Saturate(int64_t value)
+{
+    if (value > Q16_MAX) {
+        return Q16_MAX;
+    } else if (value < Q16_MIN) {
+        return Q16_MIN;
+    }
+    return (q16_t)value;
+}
+
+q16_t q16Add(q16_t a, q16_t b)
+{
+    return q16Saturate((int64_t)a + b);
+}
+
+q16_t q16Sub(q16_t a, q16_t b)
+{
+    return q16Saturate((int64_t)a - b);
+}
+
+q16_t q16Mul(q16_t a, q16_t b)
+{
+    //add half an LSB before shifting so that the result is rounded, not truncated
+    return q16Saturate(((int64_t)a * b + (1L << (Q16_FRACTIONAL_BITS - 1))) >> Q16_FRACTIONAL_BITS);
+}
+
+q16_t q16MulMicros(q16_t value, uint32_t usec)
+{
+    //2^32 / 1000000 is 4294.967, so this is within 0.001% of the exact fraction
+    uint32_t fraction = usec * 4295UL;
+    return q16Saturate(((int64_t)value * fraction + (1LL << 31)) >> 32);
+}
+
+q16_t q16InverseMicros(uint32_t usec)
+{
+    return q16Saturate((((int64_t)1000000 << Q16_FRACTIONAL_BITS) + usec / 2) / usec);
+}
+
+int16_t q16ScaleInt(int16_t value, q16_t scale)
+{
+    //scale == whole * 2^16 + fraction, so value * scale == value * whole + value * fraction / 2^16
+    int16_t whole = (int16_t)(scale >> Q16_FRACTIONAL_BITS);
+    uint16_t fraction = (uint16_t)scale;
+    int32_t result = (int32_t)value * whole + (((int32_t)value * fraction + 0x8000) >> Q16_FRACTIONAL_BITS);
+
+    if (result > INT16_MAX) {
+        return INT16_MAX;
+    } else if (result < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return (int16_t)result;
+}
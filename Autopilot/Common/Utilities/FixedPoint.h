@@ -0,0 +1,102 @@
+/**
+ * @file FixedPoint.h
+ * @author Waterloo Aerial Robotics Group
+ * @date October 18, 2026
+ * @brief
+ * Q16.16 fixed point math helpers. The dsPIC33 has no FPU, so all float math is
+ * emulated in software and costs hundreds of cycles per operation. Q16.16 values
+ * are stored in a 32 bit signed integer, with 16 integer bits and 16 fractional bits,
+ * giving a range of about +-32768 with a resolution of about 0.000015.
+ *
+ * All arithmetic saturates at the ends of the range rather than wrapping around.
+ *
+ * @copyright Waterloo Aerial Robotics Group 2017 \n
+ *   https://raw.githubusercontent.com/UWARG/PICpilot/master/LICENCE
+ */
+
+#ifndef FIXEDPOINT_H
+#define	FIXEDPOINT_H
+
+#include <stdint.h>
+
+typedef int32_t q16_t;
+
+#define Q16_FRACTIONAL_BITS 16
+#define Q16_ONE ((q16_t)0x00010000L)
+#define Q16_MAX ((q16_t)INT32_MAX)
+#define Q16_MIN ((q16_t)INT32_MIN)
+
+/**
+ * Converts a constant to Q16.16 at compile time. Don't use this on variables, use
+ * floatToQ16() instead
+ */
+#define Q16(x) ((q16_t)((x) * 65536.0 + ((x) >= 0 ? 0.5 : -0.5)))
+
+/**
+ * Converts an integer to Q16.16. The integer must be within the Q16.16 range
+ */
+#define INT_TO_Q16(x) ((q16_t)(x) * Q16_ONE)
+
+/**
+ * Converts a float to Q16.16, rounding to the nearest value
+ * @param value
+ * @return The saturated Q16.16 value
+ */
+q16_t floatToQ16(float value);
+
+/**
+ * @param value
+ * @return The float representation of the Q16.16 value
+ */
+float q16ToFloat(q16_t value);
+
+/**
+ * Clamps a 64 bit intermediate result to the Q16.16 range
+ * @param value
+ * @return
+ */
+q16_t q16Saturate(int64_t value);
+
+/**
+ * @return a + b, saturated
+ */
+q16_t q16Add(q16_t a, q16_t b);
+
+/**
+ * @return a - b, saturated
+ */
+q16_t q16Sub(q16_t a, q16_t b);
+
+/**
+ * @return a * b, rounded and saturated
+ */
+q16_t q16Mul(q16_t a, q16_t b);
+
+/**
+ * Multiplies a value by a time interval, ie value * usec / 1000000. The interval
+ * is converted to a 32 bit fraction of a second, so this is a lot more precise
+ * than multiplying by the interval in Q16.16
+ * @param value
+ * @param usec Interval in microseconds. Must be less than a second
+ * @return value * interval in seconds, rounded and saturated
+ */
+q16_t q16MulMicros(q16_t value, uint32_t usec);
+
+/**
+ * Calculates the reciprocal of a time interval, for use in derivatives
+ * @param usec Interval in microseconds. Must be non-zero
+ * @return 1/interval in 1/seconds, in Q16.16
+ */
+q16_t q16InverseMicros(uint32_t usec);
+
+/**
+ * Multiplies an integer by a Q16.16 scale factor. The scale factor is split into
+ * its whole and fractional parts, so that this only needs two 16x16 bit multiplies
+ * on the dsPIC, rather than a 32x32 bit one
+ * @param value
+ * @param scale
+ * @return value * scale, rounded to the nearest integer and saturated to 16 bits
+ */
+int16_t q16ScaleInt(int16_t value, q16_t scale);
+
+#endif
@@ -11,6 +11,7 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 static char logger_initialized = 0;
 
@@ -19,7 +20,7 @@ static char* buffer;
 
 void initLogger(void)
 {
-    initUART(LOGGER_UART_INTERFACE, LOGGER_UART_BAUD_RATE, LOGGER_BUFFER_INITIAL_LENGTH, LOGGER_BUFFER_MAX_LENGTH, UART_TX_ENABLE);
+    initUART(LOGGER_UART_INTERFACE, LOGGER_UART_BAUD_RATE, LOGGER_BUFFER_LENGTH, UART_TX_ENABLE);
     logger_initialized = 1;
     buffer = malloc(100); //allocate 100 bytes for the buffer
 }
@@ -32,12 +33,22 @@ static void writeMessage(char* message, char* label, unsigned int label_length)
         length++;
     }
 
+    unsigned int total_length = label_length + 3 + length;
+    uint8_t* span;
+
     //only send the uart data if theres enough space since we dont want to send over partial messages
-    if (getTXSpace(LOGGER_UART_INTERFACE) >= label_length + 3 + length) {
-        //add the message
-        queueTXData(LOGGER_UART_INTERFACE, (unsigned char*) label, label_length);
-        queueTXData(LOGGER_UART_INTERFACE, (unsigned char*) message, length);
-        queueTXData(LOGGER_UART_INTERFACE, (unsigned char*) "\r\n\0", 3);
+    if (getTXSpace(LOGGER_UART_INTERFACE) >= total_length) {
+        //build the message straight in the TX buffer, unless it wraps around there
+        if (reserveTXSpan(LOGGER_UART_INTERFACE, &span) >= total_length) {
+            memcpy(span, label, label_length);
+            memcpy(&span[label_length], message, length);
+            memcpy(&span[label_length + length], "\r\n\0", 3);
+            commitTXSpan(LOGGER_UART_INTERFACE, total_length);
+        } else {
+            queueTXData(LOGGER_UART_INTERFACE, (unsigned char*) label, label_length);
+            queueTXData(LOGGER_UART_INTERFACE, (unsigned char*) message, length);
+            queueTXData(LOGGER_UART_INTERFACE, (unsigned char*) "\r\n\0", 3);
+        }
     }
 }
 
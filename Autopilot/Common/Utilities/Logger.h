@@ -24,11 +24,10 @@
 #define LOGGER_UART_BAUD_RATE 115200
 
 /**
- * How long to make the string buffer. This should be the maximum length of the string
- * that can be logged, in bytes
+ * How long to make the UART TX buffer (a power of 2). This should be more than
+ * the maximum length of the string that can be logged, in bytes
  */
-#define LOGGER_BUFFER_INITIAL_LENGTH 100
-#define LOGGER_BUFFER_MAX_LENGTH 1000
+#define LOGGER_BUFFER_LENGTH 1024
 
 /**
  * Label prefixes to inject for each type of message
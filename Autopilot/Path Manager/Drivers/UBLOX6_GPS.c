@@ -31,44 +31,51 @@ static bool data_available = false;
 GPSData gps_data;
 
 void initGPS(){
-    //setup a 200-800 byte buffer for transmissions
-    initUART(UBLOX6_UART_INTERFACE, UBLOX6_UART_BAUD_RATE, 200, 800, UART_TX_RX_ENABLE);
+    //setup a 1024 byte buffer for transmissions
+    initUART(UBLOX6_UART_INTERFACE, UBLOX6_UART_BAUD_RATE, 1024, UART_TX_RX_ENABLE);
 }
 
 void requestGPSInfo(){
     static bool currently_parsing_string = false;
     char data;
+    uint8_t* span; //received bytes, straight out of the UART buffer
+    uint16_t span_length;
+    uint16_t i;
     
-    while (getRXSize(UBLOX6_UART_INTERFACE) != 0){
-        data = readRXData(UBLOX6_UART_INTERFACE);
+    while ((span_length = peekRXSpan(UBLOX6_UART_INTERFACE, &span)) != 0){
+        for (i = 0; i < span_length; i++){
+            data = span[i];
 
-        if (data == '$'){ //we've just started parsing a packet
-            currently_parsing_string = true;
-            receive_buffer_index = 0;
-        } else if (data == '\n'){ //we've just finished parsing a packet
-            currently_parsing_string = false;
-            
-            if (isValidNMEAString(receive_buffer, RECEIVE_BUFFER_LENGTH)){
-                if (strncmp(receive_buffer, GGA_HEADER, 5) == 0){ //if we received a gga string
-                    last_receive_time = getTime();
-                    parseGGA(receive_buffer, &gps_data.latitude, &gps_data.longitude, &gps_data.utc_time, &gps_data.altitude, &gps_data.fix_status, &gps_data.num_satellites);
-                    data_available = true;
-                } else if (strncmp(receive_buffer, VTG_HEADER, 5) == 0){ //if we received a vtg string
-                    last_receive_time = getTime();
-                    parseVTG(receive_buffer, &gps_data.ground_speed, &gps_data.heading);
-                    data_available = true;
-                } //otherwise ignore other string types
+            if (data == '$'){ //we've just started parsing a packet
+                currently_parsing_string = true;
+                receive_buffer_index = 0;
+            } else if (data == '\n'){ //we've just finished parsing a packet
+                currently_parsing_string = false;
 
-                //we'll break out of the loop here as we dont want this operation to take too long
-                //(we'll parse another packet, if available, in the next iteration)
-                break;
-            } else {
-                communication_errors++;
+                if (isValidNMEAString(receive_buffer, RECEIVE_BUFFER_LENGTH)){
+                    if (strncmp(receive_buffer, GGA_HEADER, 5) == 0){ //if we received a gga string
+                        last_receive_time = getTime();
+                        parseGGA(receive_buffer, &gps_data.latitude, &gps_data.longitude, &gps_data.utc_time, &gps_data.altitude, &gps_data.fix_status, &gps_data.num_satellites);
+                        data_available = true;
+                    } else if (strncmp(receive_buffer, VTG_HEADER, 5) == 0){ //if we received a vtg string
+                        last_receive_time = getTime();
+                        parseVTG(receive_buffer, &gps_data.ground_speed, &gps_data.heading);
+                        data_available = true;
+                    } //otherwise ignore other string types
+
+                    //we'll stop here as we dont want this operation to take too long
+                    //(we'll parse another packet, if available, in the next iteration)
+                    consumeRXSpan(UBLOX6_UART_INTERFACE, i + 1);
+                    return;
+                } else {
+                    communication_errors++;
+                }
+            } else if (currently_parsing_string){
+                receive_buffer[receive_buffer_index] = data;
+                receive_buffer_index = (receive_buffer_index + 1) % RECEIVE_BUFFER_LENGTH; //avoid opcode errors if possible
             }
-        } else if (currently_parsing_string){
-            receive_buffer[receive_buffer_index] = data;
-            receive_buffer_index = (receive_buffer_index + 1) % RECEIVE_BUFFER_LENGTH; //avoid opcode errors if possible
         }
+        consumeRXSpan(UBLOX6_UART_INTERFACE, span_length);
     }
 }
 
@@ -51,6 +51,16 @@ char inHold = 0;
 
 static uint64_t interchip_last_send_time = 0;
 
+/** Set when there is new GPS data or guidance output the AM hasn't been sent yet */
+static bool interchip_send_pending = false;
+
+/** Time (us) at which the oldest unsent GPS update was received. 0 if none */
+static uint64_t gps_receive_time = 0;
+
+/** Last heading setpoint and target waypoint sent to the attitude manager */
+static int last_sent_sp_heading = 0;
+static char last_sent_target_waypoint = 0;
+
 static uint8_t led_bright = 0;
 static bool going_up = true;
 
@@ -128,7 +138,12 @@ void pathManagerRuntime(void) {
 #endif
     requestGPSInfo();
 
-    copyGPSData();
+    if (copyGPSData()){
+        interchip_send_pending = true;
+        if (gps_receive_time == 0){
+            gps_receive_time = getTimeUs();
+        }
+    }
     
     // Update status LED
     if (led_bright == 0) going_up = true;
@@ -140,9 +155,9 @@ void pathManagerRuntime(void) {
     setLEDBrightness(led_bright);
 
     if (returnHome){
-        interchip_send_buffer.pm_data.targetWaypoint = -1;
+        INTERCHIP_SEND(pm_data.targetWaypoint, -1);
     } else {
-        interchip_send_buffer.pm_data.targetWaypoint = path[currentIndex]->id;
+        INTERCHIP_SEND(pm_data.targetWaypoint, path[currentIndex]->id);
     }
 
     //Check for new uplink command data
@@ -155,17 +170,40 @@ void pathManagerRuntime(void) {
     heading = (float)gps_data.heading;
 
     if (returnHome || (pathCount - currentIndex < 1 && pathCount >= 0)){
-        interchip_send_buffer.pm_data.sp_Heading = lastKnownHeadingHome;
-    } else if (followPath && pathCount - currentIndex >= 1 && interchip_send_buffer.pm_data.positionFix > 0) {
-        currentIndex = followWaypoints(path[currentIndex], (float*)position, heading, (int*)&interchip_send_buffer.pm_data.sp_Heading);
+        INTERCHIP_SEND(pm_data.sp_Heading, lastKnownHeadingHome);
+    } else if (followPath && pathCount - currentIndex >= 1 && interchip_send_buffer->pm_data.positionFix > 0) {
+        int sp_heading = interchip_send_buffer->pm_data.sp_Heading;
+        currentIndex = followWaypoints(path[currentIndex], (float*)position, heading, &sp_heading);
+        INTERCHIP_SEND(pm_data.sp_Heading, sp_heading);
     }
-    if (interchip_send_buffer.pm_data.positionFix >= 1){
+    if (interchip_send_buffer->pm_data.positionFix >= 1){
         lastKnownHeadingHome = calculateHeadingHome(home, (float*)position, heading);
     }
 
-    if (getTimeUs() - interchip_last_send_time >= INTERCHIP_SEND_INTERVAL_US){
-        interchip_last_send_time = getTimeUs();
-        interchip_send_buffer.pm_data.interchip_error_count = getInterchipErrorCount();
+    //new guidance output should go out right away, not on the next keep-alive
+    if (interchip_send_buffer->pm_data.sp_Heading != last_sent_sp_heading ||
+            interchip_send_buffer->pm_data.targetWaypoint != last_sent_target_waypoint){
+        interchip_send_pending = true;
+    }
+
+    uint64_t now = getTimeUs();
+    uint64_t since_last_send = now - interchip_last_send_time;
+    if ((interchip_send_pending && since_last_send >= INTERCHIP_MIN_SEND_INTERVAL_US) ||
+            since_last_send >= INTERCHIP_SEND_INTERVAL_US){
+        InterchipLinkStats interchip_stats;
+
+        if (gps_receive_time != 0){
+            uint64_t latency = now - gps_receive_time;
+            INTERCHIP_SEND(pm_data.gps_setpoint_latency, latency > UINT16_MAX ? UINT16_MAX : (uint16_t)latency);
+            gps_receive_time = 0;
+        }
+        interchip_last_send_time = now;
+        interchip_send_pending = false;
+        last_sent_sp_heading = interchip_send_buffer->pm_data.sp_Heading;
+        last_sent_target_waypoint = interchip_send_buffer->pm_data.targetWaypoint;
+        INTERCHIP_SEND(pm_data.interchip_error_count, getInterchipErrorCount());
+        getInterchipLinkStats(&interchip_stats);
+        INTERCHIP_SEND(pm_data.link_stats, interchip_stats);
         sendInterchipData();
     }
 }
@@ -415,7 +453,7 @@ int followLastLineSegment(PathData* currentWaypoint, float* position, float head
     float waypointPosition[3];
     waypointPosition[0] = position[0];
     waypointPosition[1] = position[1];
-    waypointPosition[2] = interchip_send_buffer.pm_data.altitude;
+    waypointPosition[2] = interchip_send_buffer->pm_data.altitude;
 
     PathData* targetWaypoint = currentWaypoint;
     float targetCoordinates[3];
@@ -645,30 +683,34 @@ unsigned int insertPathNode(PathData* node, unsigned int previousID, unsigned in
     return node->id;
 }
 
-void copyGPSData(){
+bool copyGPSData(){
+    bool new_data = false;
 
     if (isNewGPSDataAvailable()){
-        interchip_send_buffer.pm_data.time = gps_data.utc_time;
-        interchip_send_buffer.pm_data.longitude = gps_data.longitude;
-        interchip_send_buffer.pm_data.latitude = gps_data.latitude;
-        interchip_send_buffer.pm_data.heading = gps_data.heading;
-        interchip_send_buffer.pm_data.speed = gps_data.ground_speed;
-        interchip_send_buffer.pm_data.satellites = (char)gps_data.num_satellites;
-        interchip_send_buffer.pm_data.positionFix = (char)gps_data.fix_status;
+        new_data = true;
+        INTERCHIP_SEND(pm_data.time, gps_data.utc_time);
+        INTERCHIP_SEND(pm_data.longitude, gps_data.longitude);
+        INTERCHIP_SEND(pm_data.latitude, gps_data.latitude);
+        INTERCHIP_SEND(pm_data.heading, gps_data.heading);
+        INTERCHIP_SEND(pm_data.speed, gps_data.ground_speed);
+        INTERCHIP_SEND(pm_data.satellites, (char)gps_data.num_satellites);
+        INTERCHIP_SEND(pm_data.positionFix, (char)gps_data.fix_status);
 
         checkForFirstGPSLock();
     }
 
-    interchip_send_buffer.pm_data.gps_communication_error_count = getGPSCommunicationErrors();
-    interchip_send_buffer.pm_data.batteryLevel1 = getMainBatteryLevel();
-    interchip_send_buffer.pm_data.batteryLevel2 = getExtBatteryLevel();
-    interchip_send_buffer.pm_data.airspeed = getCurrentAirspeed();
-    interchip_send_buffer.pm_data.altitude = getAltitude(); //want to get altitude regardless of if there is new GPS data
-    interchip_send_buffer.pm_data.pmOrbitGain = k_gain[ORBIT];
-    interchip_send_buffer.pm_data.pmPathGain = k_gain[PATH];
-    interchip_send_buffer.pm_data.waypointCount = pathCount;
-    interchip_send_buffer.pm_data.waypointChecksum = getWaypointChecksum();
-    interchip_send_buffer.pm_data.pathFollowing = followPath;
+    INTERCHIP_SEND(pm_data.gps_communication_error_count, getGPSCommunicationErrors());
+    INTERCHIP_SEND(pm_data.batteryLevel1, getMainBatteryLevel());
+    INTERCHIP_SEND(pm_data.batteryLevel2, getExtBatteryLevel());
+    INTERCHIP_SEND(pm_data.airspeed, getCurrentAirspeed());
+    INTERCHIP_SEND(pm_data.altitude, getAltitude()); //want to get altitude regardless of if there is new GPS data
+    INTERCHIP_SEND(pm_data.pmOrbitGain, k_gain[ORBIT]);
+    INTERCHIP_SEND(pm_data.pmPathGain, k_gain[PATH]);
+    INTERCHIP_SEND(pm_data.waypointCount, pathCount);
+    INTERCHIP_SEND(pm_data.waypointChecksum, getWaypointChecksum());
+    INTERCHIP_SEND(pm_data.pathFollowing, followPath);
+
+    return new_data;
 }
 
 static void checkForFirstGPSLock(){
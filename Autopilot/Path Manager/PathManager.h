@@ -64,7 +64,7 @@ unsigned int updatePathNode(PathData* node, unsigned int ID);
 unsigned int removePathNode(unsigned int ID);
 void clearPathNodes(void);
 unsigned int insertPathNode(PathData* node, unsigned int previousID, unsigned int nextID);
-void copyGPSData(void);
+bool copyGPSData(void);
 char gpsErrorCheck(double lat, double lon);
 void checkAMData(void);
 float getWaypointChecksum(void);
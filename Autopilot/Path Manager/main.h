@@ -21,5 +21,16 @@
 
 #define GPS_OLD 1 //1 Being the Old GPS (Uses SPI), and 0 Being the New GPS (Uses UART)
 
-/** How often the path manager will send/request data from the attitude manager via DMA */
-#define INTERCHIP_SEND_INTERVAL_US 10000
\ No newline at end of file
+/**
+ * Keep-alive interval of the interchip link. If nothing new has been computed,
+ * the path manager will still send/request data from the attitude manager via
+ * DMA at least this often, so that uplink commands keep flowing
+ */
+#define INTERCHIP_SEND_INTERVAL_US 10000
+
+/**
+ * Minimum spacing between two interchip sends. New GPS data or a new heading
+ * setpoint is sent immediately, but never more often than this, to bound the
+ * load on the attitude manager when outputs change in bursts
+ */
+#define INTERCHIP_MIN_SEND_INTERVAL_US 2000
\ No newline at end of file
@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+"""
+Decodes and prints latency telemetry packets (PACKET_TYPE_LATENCY) from the
+attitude manager. See Autopilot/AttitudeManager/LatencyTrace.h and the
+packet_type_latency_block struct in Autopilot/AttitudeManager/Network/Datalink.h.
+
+Each line of input is one telemetry block, as hex: the 2 byte (little endian)
+packet type, followed by the packet_type_latency_block. Blocks of any other type
+are skipped. tools/unpack_downlink.py splits captured downlink frames into lines
+of this format.
+
+Usage: decode_latency.py [file]    (reads stdin if no file is given)
+"""
+
+import struct
+import sys
+
+PACKET_TYPE_LATENCY = 5
+
+# same order as TraceSection
+SECTIONS = ["control", "imu", "high level", "low level",
+            "mixing", "pwm write", "datalink parse", "datalink send"]
+HISTOGRAM_BINS = 8
+HISTOGRAM_MIN_US = 32
+
+# type, count[8], min[8], mean[8], max[8], histogram[8], histogram_section, dropped
+BLOCK_FORMAT = "<H" + "8H" * 5 + "HH"
+
+
+def histogram_labels():
+    labels = []
+    limit = HISTOGRAM_MIN_US
+    for i in range(HISTOGRAM_BINS - 1):
+        labels.append("<%dus" % limit)
+        limit *= 2
+    labels.append(">=%dus" % (limit // 2))
+    return labels
+
+
+def decode(block):
+    values = struct.unpack_from(BLOCK_FORMAT, block)
+    if values[0] != PACKET_TYPE_LATENCY:
+        return None
+    n = len(SECTIONS)
+    fields = values[1:]
+    return {
+        "count": fields[0:n],
+        "min": fields[n:2 * n],
+        "mean": fields[2 * n:3 * n],
+        "max": fields[3 * n:4 * n],
+        "histogram": fields[4 * n:4 * n + HISTOGRAM_BINS],
+        "histogram_section": fields[4 * n + HISTOGRAM_BINS],
+        "dropped": fields[4 * n + HISTOGRAM_BINS + 1],
+    }
+
+
+def print_stats(stats):
+    print("%-16s %7s %7s %7s %7s" % ("section", "count", "min", "mean", "max"))
+    for i, name in enumerate(SECTIONS):
+        print("%-16s %7d %7d %7d %7d" % (name, stats["count"][i], stats["min"][i],
+                                         stats["mean"][i], stats["max"][i]))
+    section = stats["histogram_section"]
+    name = SECTIONS[section] if section < len(SECTIONS) else str(section)
+    print("histogram (%s): %s" % (name, "  ".join(
+        "%s: %d" % (label, count) for label, count in zip(histogram_labels(), stats["histogram"]))))
+    if stats["dropped"]:
+        print("dropped trace points: %d" % stats["dropped"])
+    print()
+
+
+def main():
+    source = open(sys.argv[1]) if len(sys.argv) > 1 else sys.stdin
+    for line in source:
+        line = line.strip().replace(" ", "")
+        if not line:
+            continue
+        try:
+            block = bytes.fromhex(line)
+            stats = decode(block)
+        except (ValueError, struct.error) as e:
+            print("bad block: %s" % e, file=sys.stderr)
+            continue
+        if stats is not None:
+            print_stats(stats)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+"""
+Decodes and prints position telemetry from the attitude manager, in either the
+full (PACKET_TYPE_POSITION) or the compact (PACKET_TYPE_POSITION_COMPACT)
+encoding. See Autopilot/AttitudeManager/Network/CompactTelemetry.h and the
+position blocks in Autopilot/AttitudeManager/Network/Datalink.h.
+
+Each line of input is one telemetry block, as hex, starting with the 2 byte
+packet type, as printed by unpack_downlink.py. Blocks of any other type are skipped.
+Compact blocks are decoded relative to the last position reference block, and
+skipped if that reference was lost.
+
+Usage: decode_position.py [file]    (reads stdin if no file is given)
+"""
+
+import struct
+import sys
+
+PACKET_TYPE_POSITION = 0
+PACKET_TYPE_POSITION_COMPACT = 7
+PACKET_TYPE_POSITION_REFERENCE = 8
+COMPACT_TELEMETRY_VERSION = 1
+
+FIELDS = ["lat", "lon", "sys_time", "gps_time", "pitch", "roll", "yaw",
+          "pitch_rate", "roll_rate", "yaw_rate", "airspeed", "altitude",
+          "ground_speed", "heading", "imu_sample_age"]
+
+# long double is 8 bytes on the dsPIC
+POSITION_FORMAT = "<H2dIf9fhH"
+# type, version, reference_id, lat, lon, sys_time, gps_time, angles and rates,
+# altitude, airspeed and ground speed deltas, heading, imu_sample_age
+COMPACT_FORMAT = "<H2B2iIf6h3hhH"
+# type, version, reference_id, altitude, airspeed, ground_speed
+REFERENCE_FORMAT = "<H2B3i"
+
+
+class Decoder:
+    def __init__(self):
+        self.reference = None
+
+    def decode(self, block):
+        """Returns the decoded position as a dict, or None if the block isn't one"""
+        packet_type = struct.unpack_from("<H", block)[0]
+        if packet_type == PACKET_TYPE_POSITION:
+            values = struct.unpack_from(POSITION_FORMAT, block)[1:]
+            return dict(zip(FIELDS, values))
+        if packet_type == PACKET_TYPE_POSITION_REFERENCE:
+            values = struct.unpack_from(REFERENCE_FORMAT, block)
+            if values[1] == COMPACT_TELEMETRY_VERSION:
+                self.reference = values[2:]
+            return None
+        if packet_type == PACKET_TYPE_POSITION_COMPACT:
+            return self.decode_compact(struct.unpack_from(COMPACT_FORMAT, block))
+        return None
+
+    def decode_compact(self, values):
+        version, reference_id = values[1:3]
+        if version != COMPACT_TELEMETRY_VERSION:
+            raise ValueError("unknown compact telemetry version %d" % version)
+        if self.reference is None or self.reference[0] != reference_id:
+            print("missing position reference %d" % reference_id, file=sys.stderr)
+            return None
+        _, ref_altitude, ref_airspeed, ref_ground_speed = self.reference
+        lat, lon, sys_time, gps_time = values[3:7]
+        angles = [v / 100.0 for v in values[7:13]]
+        altitude_delta, airspeed_delta, ground_speed_delta, heading, age = values[13:18]
+        return dict(zip(FIELDS, [lat / 1e7, lon / 1e7, sys_time, gps_time] + angles + [
+            (ref_airspeed + airspeed_delta) / 100.0,
+            (ref_altitude + altitude_delta) / 100.0,
+            (ref_ground_speed + ground_speed_delta) / 100.0,
+            heading, age]))
+
+
+def main():
+    source = open(sys.argv[1]) if len(sys.argv) > 1 else sys.stdin
+    decoder = Decoder()
+    for line in source:
+        line = line.strip().replace(" ", "")
+        if not line:
+            continue
+        try:
+            position = decoder.decode(bytes.fromhex(line))
+        except (ValueError, struct.error) as e:
+            print("bad block: %s" % e, file=sys.stderr)
+            continue
+        if position is not None:
+            print("  ".join("%s=%s" % (field, position[field]) for field in FIELDS))
+
+
+if __name__ == "__main__":
+    main()
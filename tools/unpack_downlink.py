@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+"""
+Unpacks downlink frames from the attitude manager into their telemetry blocks.
+See queueTelemetryBlock() in Autopilot/AttitudeManager/Network/Datalink.c.
+
+A downlink frame is the payload of a single radio transmission. It holds one or
+more telemetry blocks, each preceded by a 1 byte packet type and the 1 byte
+length of the block data that follows.
+
+Each line of input is one frame, as hex. Each block is printed on its own line,
+as hex, starting with the 2 byte (little endian) packet type, so that the output
+can be piped into the other decoders, ie
+
+    unpack_downlink.py frames.txt | decode_latency.py
+
+Usage: unpack_downlink.py [file]    (reads stdin if no file is given)
+"""
+
+import struct
+import sys
+
+BLOCK_HEADER_LENGTH = 2
+
+
+def unpack(frame):
+    """Returns a list of (packet type, block data) tuples"""
+    blocks = []
+    pos = 0
+    while pos < len(frame):
+        if pos + BLOCK_HEADER_LENGTH > len(frame):
+            raise ValueError("truncated block header at byte %d" % pos)
+        packet_type, length = frame[pos], frame[pos + 1]
+        pos += BLOCK_HEADER_LENGTH
+        if pos + length > len(frame):
+            raise ValueError("block of type %d at byte %d is truncated" % (packet_type, pos))
+        blocks.append((packet_type, frame[pos:pos + length]))
+        pos += length
+    return blocks
+
+
+def main():
+    source = open(sys.argv[1]) if len(sys.argv) > 1 else sys.stdin
+    for line in source:
+        line = line.strip().replace(" ", "")
+        if not line:
+            continue
+        try:
+            blocks = unpack(bytes.fromhex(line))
+        except ValueError as e:
+            print("bad frame: %s" % e, file=sys.stderr)
+            continue
+        for packet_type, data in blocks:
+            print((struct.pack("<H", packet_type) + data).hex())
+
+
+if __name__ == "__main__":
+    main()